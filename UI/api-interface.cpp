@@ -27,6 +27,52 @@ extern volatile bool virtualcam_active;
 
 /* ------------------------------------------------------------------------- */
 
+static void SetLatencyStats(obs_data_t *data, const char *name,
+			    const obs_latency_stats &stats)
+{
+	obs_data_t *obj = obs_data_create();
+	obs_data_set_int(obj, "count", stats.count);
+	obs_data_set_int(obj, "p50_ns", stats.p50_ns);
+	obs_data_set_int(obj, "p90_ns", stats.p90_ns);
+	obs_data_set_int(obj, "p99_ns", stats.p99_ns);
+	obs_data_set_int(obj, "p999_ns", stats.p999_ns);
+	obs_data_set_int(obj, "max_ns", stats.max_ns);
+	obs_data_set_obj(data, name, obj);
+	obs_data_release(obj);
+}
+
+static void SetOutputLatencyStats(obs_data_t *data, const char *name,
+				  obs_output_t *output)
+{
+	if (!output)
+		return;
+
+	obs_data_t *obj = obs_data_create();
+	obs_latency_stats stats = {};
+
+	obs_output_get_interleave_latency(output, &stats);
+	SetLatencyStats(obj, "interleave", stats);
+	obs_output_get_send_latency(output, &stats);
+	SetLatencyStats(obj, "send", stats);
+
+	obs_encoder_t *encoder = obs_output_get_video_encoder(output);
+	if (encoder) {
+		obs_encoder_get_encode_latency(encoder, &stats);
+		SetLatencyStats(obj, "video_encode", stats);
+	}
+
+	encoder = obs_output_get_audio_encoder(output, 0);
+	if (encoder) {
+		obs_encoder_get_encode_latency(encoder, &stats);
+		SetLatencyStats(obj, "audio_encode", stats);
+	}
+
+	obs_data_set_obj(data, name, obj);
+	obs_data_release(obj);
+}
+
+/* ------------------------------------------------------------------------- */
+
 template<typename T> struct OBSStudioCallback {
 	T callback;
 	void *private_data;
@@ -606,6 +652,31 @@ struct OBSStudioAPI : obs_frontend_callbacks {
 
 	void obs_frontend_reset_video(void) override { main->ResetVideo(); }
 
+	obs_data_t *obs_frontend_get_latency_stats(void) override
+	{
+		obs_data_t *data = obs_data_create();
+		obs_latency_stats stats = {};
+
+		obs_get_render_latency(&stats);
+		SetLatencyStats(data, "render", stats);
+		obs_get_readback_latency(&stats);
+		SetLatencyStats(data, "readback", stats);
+		obs_get_audio_callback_latency(&stats);
+		SetLatencyStats(data, "audio_callback", stats);
+
+		BasicOutputHandler *handler = main->outputHandler.get();
+		if (handler) {
+			SetOutputLatencyStats(data, "streaming",
+					      handler->streamOutput);
+			SetOutputLatencyStats(data, "recording",
+					      handler->fileOutput);
+			SetOutputLatencyStats(data, "replay_buffer",
+					      handler->replayBuffer);
+		}
+
+		return data;
+	}
+
 	void obs_frontend_open_source_properties(obs_source_t *source) override
 	{
 		QMetaObject::invokeMethod(main, "OpenProperties",
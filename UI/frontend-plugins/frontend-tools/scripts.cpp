@@ -19,6 +19,8 @@
 #include <QMenu>
 #include <QUrl>
 #include <QDesktopServices>
+#include <QTimer>
+#include <QSignalBlocker>
 
 #include <obs.hpp>
 #include <obs-module.h>
@@ -30,6 +32,7 @@
 #include <util/util.hpp>
 
 #include <string>
+#include <vector>
 
 #include "ui_scripts.h"
 
@@ -47,6 +50,9 @@
 
 #define PYTHONPATH_LABEL_TEXT "PythonSettings.PythonInstallPath" ARCH_NAME
 
+#define PROFILE_REFRESH_MS 1000
+#define MAX_SHOWN_SAMPLES 20
+
 /* ----------------------------------------------------------------- */
 
 using OBSScript = OBSObj<obs_script_t *, obs_script_destroy>;
@@ -211,6 +217,14 @@ ScriptsTool::ScriptsTool() : QWidget(nullptr), ui(new Ui_ScriptsTool)
 	int row =
 		config_get_int(global_config, "scripts-tool", "prevScriptRow");
 	ui->scripts->setCurrentRow(row);
+
+	ui->profile->horizontalHeader()->setSectionResizeMode(
+		0, QHeaderView::Stretch);
+
+	profileTimer = new QTimer(this);
+	connect(profileTimer, &QTimer::timeout, this,
+		&ScriptsTool::UpdateProfile);
+	profileTimer->start(PROFILE_REFRESH_MS);
 }
 
 ScriptsTool::~ScriptsTool()
@@ -443,6 +457,142 @@ void ScriptsTool::on_scriptLog_clicked()
 	scriptLogWindow->raise();
 }
 
+static void SetProfileItem(QTableWidget *table, int row, int column,
+			   const QString &text)
+{
+	QTableWidgetItem *item = table->item(row, column);
+	if (!item) {
+		item = new QTableWidgetItem();
+		table->setItem(row, column, item);
+	}
+
+	item->setText(text);
+}
+
+void ScriptsTool::UpdateProfile()
+{
+	if (!isVisible() || ui->tabWidget->currentWidget() != ui->profilerTab)
+		return;
+
+	std::vector<OBSScript> &scripts = scriptData->scripts;
+	ui->profile->setRowCount((int)scripts.size());
+
+	for (size_t i = 0; i < scripts.size(); i++) {
+		obs_script_t *script = scripts[i];
+		struct obs_script_profile profile = {};
+		int row = (int)i;
+
+		obs_script_get_profile(script, &profile);
+
+		double avg = profile.calls ? (double)profile.total_ns /
+						     (double)profile.calls /
+						     1000000.0
+					   : 0.0;
+		double max = (double)profile.max_ns / 1000000.0;
+
+		SetProfileItem(ui->profile, row, 0,
+			       obs_script_get_file(script));
+		SetProfileItem(ui->profile, row, 1,
+			       QString::number(profile.calls));
+		SetProfileItem(ui->profile, row, 2,
+			       QString::number(avg, 'f', 2));
+		SetProfileItem(ui->profile, row, 3,
+			       QString::number(max, 'f', 2));
+		SetProfileItem(ui->profile, row, 4,
+			       QString::number(profile.overruns));
+
+		ui->profile->item(row, 0)->setData(
+			Qt::UserRole, QT_UTF8(obs_script_get_path(script)));
+	}
+
+	UpdateSamples();
+}
+
+obs_script_t *ScriptsTool::GetProfiledScript()
+{
+	QTableWidgetItem *item = ui->profile->item(ui->profile->currentRow(), 0);
+	if (!item)
+		return nullptr;
+
+	QByteArray array = item->data(Qt::UserRole).toString().toUtf8();
+	return scriptData->FindScript(array.constData());
+}
+
+struct SampleList {
+	std::vector<std::pair<std::string, uint64_t>> samples;
+	uint64_t total = 0;
+};
+
+void ScriptsTool::UpdateSamples()
+{
+	obs_script_t *script = GetProfiledScript();
+
+	ui->sampleScript->setEnabled(script != nullptr);
+	ui->resetProfile->setEnabled(script != nullptr);
+
+	{
+		QSignalBlocker blocker(ui->sampleScript);
+		ui->sampleScript->setChecked(script &&
+					     obs_script_sampling(script));
+	}
+
+	SampleList list;
+
+	if (script) {
+		auto addSample = [](void *param, const char *location,
+				    uint64_t count) {
+			SampleList *list = reinterpret_cast<SampleList *>(param);
+
+			if (list->samples.size() < MAX_SHOWN_SAMPLES)
+				list->samples.emplace_back(location, count);
+			list->total += count;
+			return true;
+		};
+
+		obs_script_enum_samples(script, addSample, &list);
+	}
+
+	QString text;
+	for (auto &sample : list.samples) {
+		double percent = (double)sample.second * 100.0 /
+				 (double)list.total;
+
+		text += QString("%1%\t%2\n")
+				.arg(percent, 5, 'f', 1)
+				.arg(QT_UTF8(sample.first.c_str()));
+	}
+
+	if (ui->samples->toPlainText() != text)
+		ui->samples->setPlainText(text);
+}
+
+void ScriptsTool::on_tabWidget_currentChanged(int)
+{
+	UpdateProfile();
+}
+
+void ScriptsTool::on_profile_currentCellChanged(int, int, int, int)
+{
+	UpdateSamples();
+}
+
+void ScriptsTool::on_sampleScript_toggled(bool checked)
+{
+	obs_script_t *script = GetProfiledScript();
+	if (script)
+		obs_script_set_sampling(script, checked);
+}
+
+void ScriptsTool::on_resetProfile_clicked()
+{
+	obs_script_t *script = GetProfiledScript();
+	if (!script)
+		return;
+
+	obs_script_reset_profile(script);
+	UpdateProfile();
+}
+
 void ScriptsTool::on_pythonPathBrowse_clicked()
 {
 	QString curPath = ui->pythonPath->text();
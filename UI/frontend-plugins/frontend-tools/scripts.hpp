@@ -2,8 +2,10 @@
 
 #include <QWidget>
 #include <QString>
+#include <obs-scripting.h>
 
 class Ui_ScriptsTool;
+class QTimer;
 
 class ScriptLogWindow : public QWidget {
 	Q_OBJECT
@@ -29,6 +31,10 @@ class ScriptsTool : public QWidget {
 
 	Ui_ScriptsTool *ui;
 	QWidget *propertiesView = nullptr;
+	QTimer *profileTimer;
+
+	obs_script_t *GetProfiledScript();
+	void UpdateSamples();
 
 public:
 	ScriptsTool();
@@ -58,4 +64,11 @@ public slots:
 private slots:
 	void on_description_linkActivated(const QString &link);
 	void on_scripts_customContextMenuRequested(const QPoint &pos);
+
+	void UpdateProfile();
+	void on_tabWidget_currentChanged(int index);
+	void on_profile_currentCellChanged(int row, int column, int prevRow,
+					   int prevColumn);
+	void on_sampleScript_toggled(bool checked);
+	void on_resetProfile_clicked();
 };
@@ -535,6 +535,12 @@ void obs_frontend_reset_video(void)
 		c->obs_frontend_reset_video();
 }
 
+obs_data_t *obs_frontend_get_latency_stats(void)
+{
+	return !!callbacks_valid() ? c->obs_frontend_get_latency_stats()
+				   : nullptr;
+}
+
 void obs_frontend_open_source_properties(obs_source_t *source)
 {
 	if (callbacks_valid())
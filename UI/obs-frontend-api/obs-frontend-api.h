@@ -215,6 +215,10 @@ EXPORT bool obs_frontend_virtualcam_active(void);
 
 EXPORT void obs_frontend_reset_video(void);
 
+/* Returns the core, streaming, recording and replay buffer latency
+ * percentiles, see obs_latency_stats */
+EXPORT obs_data_t *obs_frontend_get_latency_stats(void);
+
 EXPORT void obs_frontend_open_source_properties(obs_source_t *source);
 EXPORT void obs_frontend_open_source_filters(obs_source_t *source);
 
@@ -135,6 +135,8 @@ struct obs_frontend_callbacks {
 
 	virtual void obs_frontend_reset_video(void) = 0;
 
+	virtual obs_data_t *obs_frontend_get_latency_stats(void) = 0;
+
 	virtual void
 	obs_frontend_open_source_properties(obs_source_t *source) = 0;
 	virtual void obs_frontend_open_source_filters(obs_source_t *source) = 0;
@@ -1046,6 +1046,11 @@ void OBSBasic::LoadData(obs_data_t *data, const char *file)
 		UNUSED_PARAMETER(source);
 	};
 
+	/* sources outside of the current scene are only created once they're
+	 * first shown */
+	obs_set_lazy_source_loading(config_get_bool(
+		App()->GlobalConfig(), "General", "LazySourceLoading"));
+
 	obs_load_sources(sources, cb, files);
 
 	if (transitions)
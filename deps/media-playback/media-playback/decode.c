@@ -14,6 +14,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <util/platform.h>
+
 #include "decode.h"
 #include "media.h"
 
@@ -73,6 +75,38 @@ static void init_hw_decoder(struct mp_decode *d, AVCodecContext *c)
 }
 #endif
 
+/*
+ * Software video decoders share one budget of decoding threads, sized to the
+ * number of logical cores, rather than each starting a thread per core.  Each
+ * decoder takes half of what is left (always at least one), so the first few
+ * media sources still decode quickly while many of them don't oversubscribe
+ * the CPU.  Fewer frame threads also means less delay before the first frame.
+ */
+static pthread_mutex_t thread_budget_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int thread_budget_used = 0;
+
+static int reserve_decoder_threads(void)
+{
+	int cores = os_get_logical_cores();
+	int threads;
+
+	pthread_mutex_lock(&thread_budget_mutex);
+	threads = (cores - thread_budget_used + 1) / 2;
+	if (threads < 1)
+		threads = 1;
+	thread_budget_used += threads;
+	pthread_mutex_unlock(&thread_budget_mutex);
+
+	return threads;
+}
+
+static void release_decoder_threads(int threads)
+{
+	pthread_mutex_lock(&thread_budget_mutex);
+	thread_budget_used -= threads;
+	pthread_mutex_unlock(&thread_budget_mutex);
+}
+
 static int mp_open_codec(struct mp_decode *d, bool hw)
 {
 	AVCodecContext *c;
@@ -102,8 +136,14 @@ static int mp_open_codec(struct mp_decode *d, bool hw)
 	if (c->thread_count == 1 && c->codec_id != AV_CODEC_ID_PNG &&
 	    c->codec_id != AV_CODEC_ID_TIFF &&
 	    c->codec_id != AV_CODEC_ID_JPEG2000 &&
-	    c->codec_id != AV_CODEC_ID_MPEG4 && c->codec_id != AV_CODEC_ID_WEBP)
-		c->thread_count = 0;
+	    c->codec_id != AV_CODEC_ID_MPEG4 && c->codec_id != AV_CODEC_ID_WEBP) {
+		if (d->audio || d->hw) {
+			c->thread_count = 0;
+		} else {
+			d->threads = reserve_decoder_threads();
+			c->thread_count = d->threads;
+		}
+	}
 
 	ret = avcodec_open2(c, d->codec, NULL);
 	if (ret < 0)
@@ -236,6 +276,9 @@ void mp_decode_free(struct mp_decode *d)
 	}
 #endif
 
+	if (d->threads)
+		release_decoder_threads(d->threads);
+
 	memset(d, 0, sizeof(*d));
 }
 
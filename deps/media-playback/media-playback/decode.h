@@ -67,6 +67,7 @@ struct mp_decode {
 	bool frame_ready;
 	bool eof;
 	bool hw;
+	int threads;
 
 	AVPacket orig_pkt;
 	AVPacket pkt;
@@ -312,6 +312,20 @@ static inline bool mp_media_can_play_frame(mp_media_t *m, struct mp_decode *d)
 				  (d->frame_pts - m->next_pts_ns > MAX_TS_VAR));
 }
 
+static void mp_media_record_start(mp_media_t *m)
+{
+	uint64_t start_ns = os_gettime_ns() - m->start_request_ts;
+
+	pthread_mutex_lock(&m->mutex);
+	m->stats.start_ns = start_ns;
+	pthread_mutex_unlock(&m->mutex);
+
+	m->start_request_ts = 0;
+
+	blog(LOG_DEBUG, "MP: '%s' started in %.1f ms", m->path,
+	     (double)start_ns / 1000000.0);
+}
+
 static void mp_media_next_audio(mp_media_t *m)
 {
 	struct mp_decode *d = &m->a;
@@ -339,6 +353,9 @@ static void mp_media_next_audio(mp_media_t *m)
 		return;
 
 	m->a_cb(m->opaque, &audio);
+
+	if (m->start_request_ts)
+		mp_media_record_start(m);
 }
 
 static void mp_media_next_video(mp_media_t *m, bool preload)
@@ -440,6 +457,9 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 		}
 	} else {
 		m->v_cb(m->opaque, frame);
+
+		if (m->start_request_ts)
+			mp_media_record_start(m);
 	}
 }
 
@@ -645,9 +665,11 @@ static bool init_avformat(mp_media_t *m)
 		m->fmt->interrupt_callback.opaque = m;
 	}
 
+	uint64_t open_ts = os_gettime_ns();
 	int ret = avformat_open_input(&m->fmt, m->path, format,
 				      opts ? &opts : NULL);
 	av_dict_free(&opts);
+	uint64_t stream_info_ts = os_gettime_ns();
 
 	if (ret < 0) {
 		if (!m->reconnecting)
@@ -667,10 +689,19 @@ static bool init_avformat(mp_media_t *m)
 		return false;
 	}
 
+	uint64_t decoder_init_ts = os_gettime_ns();
+
 	m->reconnecting = false;
 	m->has_video = mp_decode_init(m, AVMEDIA_TYPE_VIDEO, m->hw);
 	m->has_audio = mp_decode_init(m, AVMEDIA_TYPE_AUDIO, m->hw);
 
+	pthread_mutex_lock(&m->mutex);
+	m->stats.open_ns = stream_info_ts - open_ts;
+	m->stats.stream_info_ns = decoder_init_ts - stream_info_ts;
+	m->stats.decoder_init_ns = os_gettime_ns() - decoder_init_ts;
+	m->stats.video_threads = m->v.threads;
+	pthread_mutex_unlock(&m->mutex);
+
 	if (!m->has_video && !m->has_audio) {
 		blog(LOG_WARNING,
 		     "MP: Could not initialize audio or video: "
@@ -690,6 +721,25 @@ static void reset_ts(mp_media_t *m)
 	m->next_ns = 0;
 }
 
+static void mp_media_set_ready(mp_media_t *m)
+{
+	struct mp_media_stats stats;
+
+	pthread_mutex_lock(&m->mutex);
+	m->stats.ready_ns = os_gettime_ns() - m->init_sys_ts;
+	m->stats.ready = true;
+	stats = m->stats;
+	pthread_mutex_unlock(&m->mutex);
+
+	blog(LOG_INFO,
+	     "MP: '%s' ready in %.1f ms (open: %.1f ms, stream info: %.1f ms, "
+	     "decoders: %.1f ms, video decoder threads: %d)",
+	     m->path, (double)stats.ready_ns / 1000000.0,
+	     (double)stats.open_ns / 1000000.0,
+	     (double)stats.stream_info_ns / 1000000.0,
+	     (double)stats.decoder_init_ns / 1000000.0, stats.video_threads);
+}
+
 static inline bool mp_media_thread(mp_media_t *m)
 {
 	os_set_thread_name("mp_media_thread");
@@ -701,6 +751,8 @@ static inline bool mp_media_thread(mp_media_t *m)
 		return false;
 	}
 
+	mp_media_set_ready(m);
+
 	for (;;) {
 		bool reset, kill, is_active, seek, pause, reset_time;
 		int64_t seek_pos;
@@ -734,6 +786,11 @@ static inline bool mp_media_thread(mp_media_t *m)
 		m->seek = false;
 		m->reset_ts = false;
 
+		if (m->play_request_ts) {
+			m->start_request_ts = m->play_request_ts;
+			m->play_request_ts = 0;
+		}
+
 		pthread_mutex_unlock(&m->mutex);
 
 		if (kill) {
@@ -805,6 +862,7 @@ static inline bool mp_media_init_internal(mp_media_t *m,
 	m->path = info->path ? bstrdup(info->path) : NULL;
 	m->format_name = info->format ? bstrdup(info->format) : NULL;
 	m->hw = info->hardware_decoding;
+	m->init_sys_ts = os_gettime_ns();
 
 	if (pthread_create(&m->thread, NULL, mp_media_thread_start, m) != 0) {
 		blog(LOG_WARNING, "MP: Could not create media thread");
@@ -897,6 +955,7 @@ void mp_media_play(mp_media_t *m, bool loop, bool reconnecting)
 	m->looping = loop;
 	m->active = true;
 	m->reconnecting = reconnecting;
+	m->play_request_ts = os_gettime_ns();
 
 	pthread_mutex_unlock(&m->mutex);
 
@@ -947,3 +1006,10 @@ void mp_media_seek_to(mp_media_t *m, int64_t pos)
 
 	os_sem_post(m->sem);
 }
+
+void mp_media_get_stats(mp_media_t *m, struct mp_media_stats *stats)
+{
+	pthread_mutex_lock(&m->mutex);
+	*stats = m->stats;
+	pthread_mutex_unlock(&m->mutex);
+}
@@ -42,6 +42,17 @@ typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
 
+/* startup latency of a media, all times in nanoseconds */
+struct mp_media_stats {
+	uint64_t open_ns;         /* avformat_open_input */
+	uint64_t stream_info_ns;  /* avformat_find_stream_info */
+	uint64_t decoder_init_ns; /* opening the decoders */
+	uint64_t ready_ns;        /* from init until the first frames decoded */
+	uint64_t start_ns;        /* from the last play until its first frame */
+	int video_threads;        /* decoder threads of the video decoder */
+	bool ready;
+};
+
 struct mp_media {
 	AVFormatContext *fmt;
 
@@ -86,6 +97,11 @@ struct mp_media {
 
 	uint64_t interrupt_poll_ts;
 
+	uint64_t init_sys_ts;
+	uint64_t play_request_ts;
+	uint64_t start_request_ts;
+	struct mp_media_stats stats;
+
 	pthread_mutex_t mutex;
 	os_sem_t *sem;
 	bool stopping;
@@ -134,6 +150,7 @@ extern void mp_media_stop(mp_media_t *media);
 extern void mp_media_play_pause(mp_media_t *media, bool pause);
 extern int64_t mp_get_current_time(mp_media_t *m);
 extern void mp_media_seek_to(mp_media_t *m, int64_t pos);
+extern void mp_media_get_stats(mp_media_t *m, struct mp_media_stats *stats);
 
 /* #define DETAILED_DEBUG_INFO */
 
@@ -18,9 +18,23 @@
 #pragma once
 
 #include <util/dstr.h>
+#include <util/darray.h>
 #include <callback/calldata.h>
 #include "obs-scripting.h"
 
+enum script_callback_type {
+	SCRIPT_CALLBACK_TICK,
+	SCRIPT_CALLBACK_TIMER,
+	SCRIPT_CALLBACK_TICK_CALLBACK,
+
+	SCRIPT_CALLBACK_TYPE_COUNT
+};
+
+struct script_sample {
+	char *location;
+	uint64_t count;
+};
+
 struct obs_script {
 	enum obs_script_lang type;
 	bool loaded;
@@ -30,6 +44,14 @@ struct obs_script {
 	struct dstr path;
 	struct dstr file;
 	struct dstr desc;
+
+	uint64_t last_overrun_report;
+
+	const char *profile_names[SCRIPT_CALLBACK_TYPE_COUNT];
+	struct obs_script_profile profile;
+
+	volatile bool sampling;
+	DARRAY(struct script_sample) samples;
 };
 
 struct script_callback;
@@ -37,6 +59,33 @@ typedef void (*defer_call_cb)(void *param);
 
 extern void defer_call_post(defer_call_cb call, void *cb);
 
+/* Scripts which export script_threaded() returning true get a worker thread
+ * of their own, which runs their script_tick and timer callbacks instead of
+ * the graphics thread. */
+struct script_worker;
+typedef void (*script_worker_tick_cb)(obs_script_t *script, float seconds);
+typedef void (*script_task_cb)(void *param);
+
+extern struct script_worker *
+script_worker_create(obs_script_t *script, script_worker_tick_cb tick);
+extern void script_worker_destroy(struct script_worker *worker);
+extern void script_worker_tick(struct script_worker *worker, float seconds);
+extern void script_worker_post(struct script_worker *worker, const char *name,
+			       script_task_cb task, void *param);
+
+/* Profiles a script_tick, timer or tick callback call.  Both have to be
+ * called on the thread the callback runs on, and calls which go over the
+ * tick budget are reported to the script log. */
+extern void script_profile_init(obs_script_t *script);
+extern void script_profile_free(obs_script_t *script);
+extern uint64_t script_profile_begin(obs_script_t *script,
+				     enum script_callback_type type);
+extern void script_profile_end(obs_script_t *script,
+			       enum script_callback_type type, uint64_t start);
+
+/* Records the location a sampled script is running at */
+extern void script_add_sample(obs_script_t *script, const char *location);
+
 extern void script_log(obs_script_t *script, int level, const char *format,
 		       ...);
 extern void script_log_va(obs_script_t *script, int level, const char *format,
@@ -179,7 +179,8 @@ struct obs_lua_data {
 	struct obs_lua_script *__data = ls->data;                  \
 	struct obs_lua_script *__prev_script = current_lua_script; \
 	current_lua_script = __data;                               \
-	pthread_mutex_lock(&__data->mutex);
+	pthread_mutex_lock(&__data->mutex);                        \
+	obs_lua_update_sampling(__data);
 #define unlock_script()                       \
 	pthread_mutex_unlock(&__data->mutex); \
 	current_lua_script = __prev_script;
@@ -72,6 +72,7 @@ pthread_mutex_t lua_source_def_mutex;
 /* ========================================================================= */
 
 static void add_hook_functions(lua_State *script);
+static void lua_worker_tick(obs_script_t *s, float seconds);
 static int obs_lua_remove_tick_callback(lua_State *script);
 static int obs_lua_remove_main_render_callback(lua_State *script);
 
@@ -141,6 +142,19 @@ static bool load_lua_script(struct obs_lua_script *data)
 		}
 	}
 
+	lua_getglobal(script, "script_threaded");
+	if (lua_isfunction(script, -1)) {
+		if (lua_pcall(script, 0, 1, 0) != 0) {
+			script_warn(&data->base,
+				    "Error calling "
+				    "script_threaded: %s",
+				    lua_tostring(script, -1));
+		} else if (lua_toboolean(script, -1)) {
+			data->worker = script_worker_create(&data->base,
+							    lua_worker_tick);
+		}
+	}
+
 	lua_getglobal(script, "script_tick");
 	if (lua_isfunction(script, -1)) {
 		pthread_mutex_lock(&tick_mutex);
@@ -240,6 +254,8 @@ struct lua_obs_timer {
 
 	uint64_t last_ts;
 	uint64_t interval;
+	volatile bool queued;
+	bool graphics_task;
 };
 
 static pthread_mutex_t timer_mutex;
@@ -287,13 +303,33 @@ static int timer_remove(lua_State *script)
 static void timer_call(struct script_callback *p_cb)
 {
 	struct lua_obs_callback *cb = (struct lua_obs_callback *)p_cb;
+	uint64_t start;
 
 	if (p_cb->removed)
 		return;
 
+	start = script_profile_begin(p_cb->script, SCRIPT_CALLBACK_TIMER);
+
 	lock_callback();
-	call_func_(cb->script, cb->reg_idx, 0, 0, "timer_cb", __FUNCTION__);
+
+	/* may have been removed from another thread before the lock was
+	 * taken */
+	if (!p_cb->removed)
+		call_func_(cb->script, cb->reg_idx, 0, 0, "timer_cb",
+			   __FUNCTION__);
+
 	unlock_callback();
+
+	script_profile_end(p_cb->script, SCRIPT_CALLBACK_TIMER, start);
+}
+
+static void worker_timer_call(void *p_cb)
+{
+	struct lua_obs_callback *cb = p_cb;
+	struct lua_obs_timer *timer = lua_obs_callback_extra_data(cb);
+
+	timer_call(&cb->base);
+	os_atomic_set_bool(&timer->queued, false);
 }
 
 static void defer_timer_init(void *p_cb)
@@ -322,6 +358,44 @@ static int timer_add(lua_State *script)
 	return 0;
 }
 
+/* graphics tasks are one-shot timers which always run on the graphics thread,
+ * even for threaded scripts */
+static void graphics_task_call(struct script_callback *p_cb)
+{
+	struct lua_obs_callback *cb = (struct lua_obs_callback *)p_cb;
+	uint64_t start;
+
+	start = script_profile_begin(p_cb->script, SCRIPT_CALLBACK_TIMER);
+
+	lock_callback();
+
+	if (!p_cb->removed) {
+		call_func_(cb->script, cb->reg_idx, 0, 0, "graphics_task",
+			   __FUNCTION__);
+		if (!p_cb->removed)
+			remove_lua_obs_callback(cb);
+	}
+
+	unlock_callback();
+
+	script_profile_end(p_cb->script, SCRIPT_CALLBACK_TIMER, start);
+}
+
+static int queue_graphics_task(lua_State *script)
+{
+	if (!verify_args1(script, is_function))
+		return 0;
+
+	struct lua_obs_callback *cb = add_lua_obs_callback_extra(
+		script, 1, sizeof(struct lua_obs_timer));
+	struct lua_obs_timer *timer = lua_obs_callback_extra_data(cb);
+
+	timer->graphics_task = true;
+
+	defer_call_post(defer_timer_init, cb);
+	return 0;
+}
+
 /* -------------------------------------------- */
 
 static void obs_lua_main_render_callback(void *priv, uint32_t cx, uint32_t cy)
@@ -376,18 +450,24 @@ static void obs_lua_tick_callback(void *priv, float seconds)
 {
 	struct lua_obs_callback *cb = priv;
 	lua_State *script = cb->script;
+	obs_script_t *s = cb->base.script;
+	uint64_t start;
 
 	if (cb->base.removed) {
 		obs_remove_tick_callback(obs_lua_tick_callback, cb);
 		return;
 	}
 
+	start = script_profile_begin(s, SCRIPT_CALLBACK_TICK_CALLBACK);
+
 	lock_callback();
 
 	lua_pushnumber(script, (lua_Number)seconds);
 	call_func(obs_lua_tick_callback, 1, 0);
 
 	unlock_callback();
+
+	script_profile_end(s, SCRIPT_CALLBACK_TICK_CALLBACK, start);
 }
 
 static int obs_lua_remove_tick_callback(lua_State *script)
@@ -1021,6 +1101,7 @@ static void add_hook_functions(lua_State *script)
 	add_func("obs_remove_main_render_callback",
 		 obs_lua_remove_main_render_callback);
 	add_func("obs_add_tick_callback", obs_lua_add_tick_callback);
+	add_func("queue_graphics_task", queue_graphics_task);
 	add_func("obs_remove_tick_callback", obs_lua_remove_tick_callback);
 	add_func("signal_handler_connect", obs_lua_signal_handler_connect);
 	add_func("signal_handler_disconnect",
@@ -1055,15 +1136,27 @@ static void lua_tick(void *param, float seconds)
 	data = first_tick_script;
 	while (data) {
 		lua_State *script = data->script;
+		uint64_t start;
+
+		if (data->worker) {
+			script_worker_tick(data->worker, seconds);
+			data = data->next_tick;
+			continue;
+		}
+
 		current_lua_script = data;
+		start = script_profile_begin(&data->base, SCRIPT_CALLBACK_TICK);
 
 		pthread_mutex_lock(&data->mutex);
+		obs_lua_update_sampling(data);
 
 		lua_pushnumber(script, (double)seconds);
 		call_func_(script, data->tick, 1, 0, "tick", __FUNCTION__);
 
 		pthread_mutex_unlock(&data->mutex);
 
+		script_profile_end(&data->base, SCRIPT_CALLBACK_TICK, start);
+
 		data = data->next_tick;
 	}
 	current_lua_script = NULL;
@@ -1080,11 +1173,27 @@ static void lua_tick(void *param, float seconds)
 
 		if (cb->base.removed) {
 			lua_obs_timer_remove(timer);
+		} else if (timer->graphics_task) {
+			graphics_task_call(&cb->base);
+			lua_obs_timer_remove(timer);
 		} else {
 			uint64_t elapsed = ts - timer->last_ts;
 
 			if (elapsed >= timer->interval) {
-				timer_call(&cb->base);
+				struct obs_lua_script *data =
+					lua_obs_callback_script(cb);
+
+				if (!data->worker) {
+					timer_call(&cb->base);
+
+				} else if (!os_atomic_set_bool(&timer->queued,
+							       true)) {
+					script_worker_post(data->worker,
+							   "timer",
+							   worker_timer_call,
+							   cb);
+				}
+
 				timer->last_ts += timer->interval;
 			}
 		}
@@ -1096,6 +1205,42 @@ static void lua_tick(void *param, float seconds)
 	UNUSED_PARAMETER(param);
 }
 
+static void lua_worker_tick(obs_script_t *s, float seconds)
+{
+	struct obs_lua_script *data = (struct obs_lua_script *)s;
+	lua_State *script = data->script;
+	uint64_t start;
+
+	current_lua_script = data;
+	start = script_profile_begin(s, SCRIPT_CALLBACK_TICK);
+
+	pthread_mutex_lock(&data->mutex);
+	obs_lua_update_sampling(data);
+
+	lua_pushnumber(script, (double)seconds);
+	call_func_(script, data->tick, 1, 0, "tick", __FUNCTION__);
+
+	pthread_mutex_unlock(&data->mutex);
+
+	script_profile_end(s, SCRIPT_CALLBACK_TICK, start);
+	current_lua_script = NULL;
+}
+
+/* count hooks run between two VM instructions of whatever callback the
+ * sampled script is currently running */
+void obs_lua_sample_hook(lua_State *script, lua_Debug *ar)
+{
+	struct obs_lua_script *data = current_lua_script;
+	char location[256];
+
+	if (!data || !lua_getinfo(script, "Sl", ar))
+		return;
+
+	snprintf(location, sizeof(location), "%s:%d", ar->short_src,
+		 ar->currentline);
+	script_add_sample(&data->base, location);
+}
+
 /* -------------------------------------------- */
 
 void obs_lua_script_update(obs_script_t *script, obs_data_t *settings);
@@ -1137,6 +1282,8 @@ obs_script_t *obs_lua_script_create(const char *path, obs_data_t *settings)
 		dstr_copy(&data->base.file, path);
 	}
 
+	script_profile_init(&data->base);
+
 	data->base.settings = obs_data_create();
 	if (settings)
 		obs_data_apply(data->base.settings, settings);
@@ -1178,6 +1325,12 @@ void obs_lua_script_unload(obs_script_t *s)
 		data->next_tick = NULL;
 	}
 
+	/* ---------------------------- */
+	/* stop worker thread           */
+
+	script_worker_destroy(data->worker);
+	data->worker = NULL;
+
 	/* ---------------------------- */
 	/* call script_unload           */
 
@@ -1204,6 +1357,7 @@ void obs_lua_script_unload(obs_script_t *s)
 	/* close script                 */
 
 	lua_close(script);
+	data->sampling_hooked = false;
 	s->loaded = false;
 }
 
@@ -1212,6 +1366,7 @@ void obs_lua_script_destroy(obs_script_t *s)
 	struct obs_lua_script *data = (struct obs_lua_script *)s;
 
 	if (data) {
+		script_profile_free(&data->base);
 		pthread_mutex_destroy(&data->mutex);
 		dstr_free(&data->base.path);
 		dstr_free(&data->base.file);
@@ -52,6 +52,9 @@
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
+/* VM instructions between two samples of a sampled script */
+#define LUA_SAMPLE_INSTRUCTIONS 1000
+
 /* ------------------------------------------------------------ */
 
 struct obs_lua_script;
@@ -83,15 +86,39 @@ struct obs_lua_script {
 	struct obs_lua_script *next_tick;
 	struct obs_lua_script **p_prev_next_tick;
 
+	struct script_worker *worker;
+
+	bool sampling_hooked;
 	bool defined_sources;
 };
 
+extern void obs_lua_sample_hook(lua_State *script, lua_Debug *ar);
+
+/* installs or removes the sampling hook once the script mutex is held, as
+ * the hook can only safely be changed while no other thread runs the script */
+static inline void obs_lua_update_sampling(struct obs_lua_script *data)
+{
+	bool sampling = os_atomic_load_bool(&data->base.sampling);
+
+	if (!data->base.loaded || sampling == data->sampling_hooked)
+		return;
+
+	if (sampling)
+		lua_sethook(data->script, obs_lua_sample_hook, LUA_MASKCOUNT,
+			    LUA_SAMPLE_INSTRUCTIONS);
+	else
+		lua_sethook(data->script, NULL, 0, 0);
+
+	data->sampling_hooked = sampling;
+}
+
 #define lock_callback()                                                \
 	struct obs_lua_script *__last_script = current_lua_script;     \
 	struct lua_obs_callback *__last_callback = current_lua_cb;     \
 	current_lua_cb = cb;                                           \
 	current_lua_script = (struct obs_lua_script *)cb->base.script; \
-	pthread_mutex_lock(&current_lua_script->mutex);
+	pthread_mutex_lock(&current_lua_script->mutex);                \
+	obs_lua_update_sampling(current_lua_script);
 #define unlock_callback()                                 \
 	pthread_mutex_unlock(&current_lua_script->mutex); \
 	current_lua_script = __last_script;               \
@@ -142,12 +142,15 @@ bool import_python(const char *python_path)
 	IMPORT_FUNC(PyArg_VaParse);
 	IMPORT_FUNC(_Py_NoneStruct);
 	IMPORT_FUNC(PyTuple_New);
+	IMPORT_FUNC(PyEval_SetProfile);
+	IMPORT_FUNC(PyFrame_GetLineNumber);
 
 #if defined(Py_DEBUG) || PY_VERSION_HEX >= 0x030900b0
 	IMPORT_FUNC(_Py_Dealloc);
 #endif
 #if PY_VERSION_HEX >= 0x030900b0
 	IMPORT_FUNC(PyType_GetFlags);
+	IMPORT_FUNC(PyFrame_GetCode);
 #endif
 
 #undef IMPORT_FUNC
@@ -39,6 +39,11 @@
 #include <Python.h>
 #endif
 
+/* frames only became opaque, with accessors, in 3.9 */
+#if PY_VERSION_HEX < 0x030900b0
+#include <frameobject.h>
+#endif
+
 #if defined(HAVE_ATTRIBUTE_UNUSED) || defined(__MINGW32__)
 #if !defined(UNUSED)
 #define UNUSED __attribute__((unused))
@@ -143,8 +148,11 @@ PY_EXTERN PyObject *(*Import_PyLong_FromUnsignedLongLong)(unsigned long long);
 PY_EXTERN int (*Import_PyArg_VaParse)(PyObject *, const char *, va_list);
 PY_EXTERN PyObject(*Import__Py_NoneStruct);
 PY_EXTERN PyObject *(*Import_PyTuple_New)(Py_ssize_t size);
+PY_EXTERN void (*Import_PyEval_SetProfile)(Py_tracefunc func, PyObject *obj);
+PY_EXTERN int (*Import_PyFrame_GetLineNumber)(PyFrameObject *frame);
 #if PY_VERSION_HEX >= 0x030900b0
 PY_EXTERN int (*Import_PyType_GetFlags)(PyTypeObject *o);
+PY_EXTERN PyCodeObject *(*Import_PyFrame_GetCode)(PyFrameObject *frame);
 #endif
 #if defined(Py_DEBUG) || PY_VERSION_HEX >= 0x030900b0
 PY_EXTERN void (*Import__Py_Dealloc)(PyObject *obj);
@@ -156,6 +164,7 @@ extern bool import_python(const char *python_path);
 #define PyType_Ready Import_PyType_Ready
 #if PY_VERSION_HEX >= 0x030900b0
 #define PyType_GetFlags Import_PyType_GetFlags
+#define PyFrame_GetCode Import_PyFrame_GetCode
 #endif
 #if defined(Py_DEBUG) || PY_VERSION_HEX >= 0x030900b0
 #define _Py_Dealloc Import__Py_Dealloc
@@ -230,6 +239,8 @@ extern bool import_python(const char *python_path);
 #define PyArg_VaParse Import_PyArg_VaParse
 #define _Py_NoneStruct (*Import__Py_NoneStruct)
 #define PyTuple_New Import_PyTuple_New
+#define PyEval_SetProfile Import_PyEval_SetProfile
+#define PyFrame_GetLineNumber Import_PyFrame_GetLineNumber
 #if PY_VERSION_HEX >= 0x030800f0
 static inline void Import__Py_DECREF(const char *filename UNUSED,
 				     int lineno UNUSED, PyObject *op)
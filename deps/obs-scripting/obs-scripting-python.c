@@ -59,8 +59,9 @@ static pthread_mutex_t tick_mutex;
 static struct obs_python_script *first_tick_script = NULL;
 
 static PyObject *py_obspython = NULL;
-struct obs_python_script *cur_python_script = NULL;
-struct python_obs_callback *cur_python_cb = NULL;
+/* thread local, threaded scripts run callbacks on their own worker thread */
+THREAD_LOCAL struct obs_python_script *cur_python_script = NULL;
+THREAD_LOCAL struct python_obs_callback *cur_python_cb = NULL;
 
 /* -------------------------------------------- */
 
@@ -113,13 +114,97 @@ bool libobs_to_py_(const char *type, void *libobs_in, bool ownership,
 #define py_to_libobs(type, py_obj, libobs_out) \
 	py_to_libobs_(#type " *", py_obj, libobs_out, NULL, __func__, __LINE__)
 
+/* -------------------------------------------- */
+
+/* profile events between two samples of a sampled script, every call and
+ * return counts as one */
+#define PYTHON_SAMPLE_EVENTS 1000
+
+static THREAD_LOCAL bool sample_profile_set = false;
+static THREAD_LOCAL uint32_t sample_events = 0;
+
+static int python_sample_profile(PyObject *obj, PyFrameObject *frame,
+				 int what, PyObject *arg)
+{
+	struct obs_python_script *data = cur_python_script;
+	char location[256];
+
+	if (!data || !os_atomic_load_bool(&data->base.sampling))
+		return 0;
+	if (++sample_events < PYTHON_SAMPLE_EVENTS)
+		return 0;
+
+	sample_events = 0;
+
+#if PY_VERSION_HEX >= 0x030900b0
+	PyCodeObject *code = PyFrame_GetCode(frame);
+#else
+	PyCodeObject *code = frame->f_code;
+	Py_XINCREF(code);
+#endif
+	if (!code)
+		return 0;
+
+	PyObject *py_file = PyUnicode_AsUTF8String(code->co_filename);
+	PyObject *py_name = PyUnicode_AsUTF8String(code->co_name);
+
+	if (py_file && py_name) {
+		const char *file = PyBytes_AS_STRING(py_file);
+		const char *slash = strrchr(file, '/');
+		const char *backslash = strrchr(file, '\\');
+
+		if (backslash > slash)
+			slash = backslash;
+
+		snprintf(location, sizeof(location), "%s:%d (%s)",
+			 slash ? slash + 1 : file,
+			 PyFrame_GetLineNumber(frame),
+			 PyBytes_AS_STRING(py_name));
+		script_add_sample(&data->base, location);
+	} else {
+		PyErr_Clear();
+	}
+
+	Py_XDECREF(py_file);
+	Py_XDECREF(py_name);
+	Py_XDECREF(code);
+
+	UNUSED_PARAMETER(obj);
+	UNUSED_PARAMETER(what);
+	UNUSED_PARAMETER(arg);
+	return 0;
+}
+
+/* the profile function is per thread, so it is only set while a sampled
+ * script runs, must hold the GIL */
+static bool python_sample_begin(struct obs_python_script *data)
+{
+	if (sample_profile_set || !os_atomic_load_bool(&data->base.sampling))
+		return false;
+
+	PyEval_SetProfile(python_sample_profile, NULL);
+	sample_profile_set = true;
+	return true;
+}
+
+static void python_sample_end(bool sampled)
+{
+	if (!sampled)
+		return;
+
+	PyEval_SetProfile(NULL, NULL);
+	sample_profile_set = false;
+}
+
 #define lock_callback(cb)                                                \
 	lock_python();                                                   \
 	struct obs_python_script *__last_script = cur_python_script;     \
 	struct python_obs_callback *__last_cb = cur_python_cb;           \
 	cur_python_script = (struct obs_python_script *)cb->base.script; \
-	cur_python_cb = cb
+	cur_python_cb = cb;                                              \
+	bool __sampled = python_sample_begin(cur_python_script)
 #define unlock_callback()                  \
+	python_sample_end(__sampled);      \
 	cur_python_cb = __last_cb;         \
 	cur_python_script = __last_script; \
 	unlock_python()
@@ -171,6 +256,8 @@ static void get_defaults(struct obs_python_script *data, PyObject *get_defs)
 	Py_XDECREF(py_settings);
 }
 
+static void python_worker_tick(obs_script_t *s, float seconds);
+
 static bool load_python_script(struct obs_python_script *data)
 {
 	PyObject *py_file = NULL;
@@ -256,6 +343,19 @@ static bool load_python_script(struct obs_python_script *data)
 		PyErr_Clear();
 	}
 
+	func = PyObject_GetAttrString(py_module, "script_threaded");
+	if (func) {
+		PyObject *py_ret = PyObject_CallObject(func, NULL);
+		py_error();
+		if (py_ret && PyObject_IsTrue(py_ret) == 1)
+			data->worker = script_worker_create(&data->base,
+							    python_worker_tick);
+		Py_XDECREF(py_ret);
+		Py_DECREF(func);
+	} else {
+		PyErr_Clear();
+	}
+
 	py_tick = PyObject_GetAttrString(py_module, "script_tick");
 	if (py_tick) {
 		pthread_mutex_lock(&tick_mutex);
@@ -377,6 +477,8 @@ struct python_obs_timer {
 
 	uint64_t last_ts;
 	uint64_t interval;
+	volatile bool queued;
+	bool graphics_task;
 };
 
 static pthread_mutex_t timer_mutex;
@@ -430,15 +532,35 @@ static PyObject *timer_remove(PyObject *self, PyObject *args)
 static void timer_call(struct script_callback *p_cb)
 {
 	struct python_obs_callback *cb = (struct python_obs_callback *)p_cb;
+	uint64_t start;
 
 	if (p_cb->removed)
 		return;
 
+	start = script_profile_begin(p_cb->script, SCRIPT_CALLBACK_TIMER);
+
 	lock_callback(cb);
-	PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
-	py_error();
-	Py_XDECREF(py_ret);
+
+	/* may have been removed from another thread before the GIL was
+	 * taken */
+	if (!p_cb->removed) {
+		PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
+		py_error();
+		Py_XDECREF(py_ret);
+	}
+
 	unlock_callback();
+
+	script_profile_end(p_cb->script, SCRIPT_CALLBACK_TIMER, start);
+}
+
+static void worker_timer_call(void *p_cb)
+{
+	struct python_obs_callback *cb = p_cb;
+	struct python_obs_timer *timer = python_obs_callback_extra_data(cb);
+
+	timer_call(&cb->base);
+	os_atomic_set_bool(&timer->queued, false);
 }
 
 static void defer_timer_init(void *p_cb)
@@ -470,17 +592,66 @@ static PyObject *timer_add(PyObject *self, PyObject *args)
 	return python_none();
 }
 
+/* graphics tasks are one-shot timers which always run on the graphics thread,
+ * even for threaded scripts */
+static void graphics_task_call(struct script_callback *p_cb)
+{
+	struct python_obs_callback *cb = (struct python_obs_callback *)p_cb;
+	uint64_t start;
+
+	start = script_profile_begin(p_cb->script, SCRIPT_CALLBACK_TIMER);
+
+	lock_callback(cb);
+
+	if (!p_cb->removed) {
+		PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
+		py_error();
+		Py_XDECREF(py_ret);
+
+		if (!p_cb->removed)
+			remove_python_obs_callback(cb);
+	}
+
+	unlock_callback();
+
+	script_profile_end(p_cb->script, SCRIPT_CALLBACK_TIMER, start);
+}
+
+static PyObject *queue_graphics_task(PyObject *self, PyObject *args)
+{
+	struct obs_python_script *script = cur_python_script;
+	PyObject *py_cb;
+
+	UNUSED_PARAMETER(self);
+
+	if (!parse_args(args, "O", &py_cb))
+		return python_none();
+
+	struct python_obs_callback *cb = add_python_obs_callback_extra(
+		script, py_cb, sizeof(struct python_obs_timer));
+	struct python_obs_timer *timer = python_obs_callback_extra_data(cb);
+
+	timer->graphics_task = true;
+
+	defer_call_post(defer_timer_init, cb);
+	return python_none();
+}
+
 /* -------------------------------------------- */
 
 static void obs_python_tick_callback(void *priv, float seconds)
 {
 	struct python_obs_callback *cb = priv;
+	obs_script_t *s = cb->base.script;
+	uint64_t start;
 
 	if (cb->base.removed) {
 		obs_remove_tick_callback(obs_python_tick_callback, cb);
 		return;
 	}
 
+	start = script_profile_begin(s, SCRIPT_CALLBACK_TICK_CALLBACK);
+
 	lock_callback(cb);
 
 	PyObject *args = Py_BuildValue("(f)", seconds);
@@ -490,6 +661,8 @@ static void obs_python_tick_callback(void *priv, float seconds)
 	Py_XDECREF(args);
 
 	unlock_callback();
+
+	script_profile_end(s, SCRIPT_CALLBACK_TICK_CALLBACK, start);
 }
 
 static PyObject *obs_python_remove_tick_callback(PyObject *self, PyObject *args)
@@ -1237,6 +1410,7 @@ static void add_hook_functions(PyObject *module)
 		DEF_FUNC("obs_remove_tick_callback",
 			 obs_python_remove_tick_callback),
 		DEF_FUNC("obs_add_tick_callback", obs_python_add_tick_callback),
+		DEF_FUNC("queue_graphics_task", queue_graphics_task),
 		DEF_FUNC("signal_handler_disconnect",
 			 obs_python_signal_handler_disconnect),
 		DEF_FUNC("signal_handler_connect",
@@ -1306,6 +1480,8 @@ obs_script_t *obs_python_script_create(const char *path, obs_data_t *settings)
 	if (ext)
 		dstr_resize(&data->name, ext - path);
 
+	script_profile_init(&data->base);
+
 	data->base.settings = obs_data_create();
 	if (settings)
 		obs_data_apply(data->base.settings, settings);
@@ -1350,6 +1526,12 @@ void obs_python_script_unload(obs_script_t *s)
 		data->next_tick = NULL;
 	}
 
+	/* ---------------------------- */
+	/* stop worker thread           */
+
+	script_worker_destroy(data->worker);
+	data->worker = NULL;
+
 	lock_python();
 
 	Py_XDECREF(data->tick);
@@ -1391,6 +1573,7 @@ void obs_python_script_destroy(obs_script_t *s)
 			unlock_python();
 		}
 
+		script_profile_free(&data->base);
 		dstr_free(&data->base.path);
 		dstr_free(&data->base.file);
 		dstr_free(&data->base.desc);
@@ -1486,11 +1669,20 @@ void obs_python_script_save(obs_script_t *s)
 static void python_tick(void *param, float seconds)
 {
 	struct obs_python_script *data;
-	bool valid;
+	bool valid = false;
 	uint64_t ts = obs_get_video_frame_time();
 
+	/* threaded scripts are ticked without taking the GIL */
 	pthread_mutex_lock(&tick_mutex);
-	valid = !!first_tick_script;
+	data = first_tick_script;
+	while (data) {
+		if (data->worker)
+			script_worker_tick(data->worker, seconds);
+		else
+			valid = true;
+
+		data = data->next_tick;
+	}
 	pthread_mutex_unlock(&tick_mutex);
 
 	/* --------------------------------- */
@@ -1504,13 +1696,28 @@ static void python_tick(void *param, float seconds)
 		pthread_mutex_lock(&tick_mutex);
 		data = first_tick_script;
 		while (data) {
+			uint64_t start;
+			bool sampled;
+
+			if (data->worker) {
+				data = data->next_tick;
+				continue;
+			}
+
 			cur_python_script = data;
+			start = script_profile_begin(&data->base,
+						     SCRIPT_CALLBACK_TICK);
+			sampled = python_sample_begin(data);
 
 			PyObject *py_ret =
 				PyObject_CallObject(data->tick, args);
 			Py_XDECREF(py_ret);
 			py_error();
 
+			python_sample_end(sampled);
+			script_profile_end(&data->base, SCRIPT_CALLBACK_TICK,
+					   start);
+
 			data = data->next_tick;
 		}
 
@@ -1534,13 +1741,26 @@ static void python_tick(void *param, float seconds)
 
 		if (cb->base.removed) {
 			python_obs_timer_remove(timer);
+		} else if (timer->graphics_task) {
+			graphics_task_call(&cb->base);
+			python_obs_timer_remove(timer);
 		} else {
 			uint64_t elapsed = ts - timer->last_ts;
 
 			if (elapsed >= timer->interval) {
-				lock_python();
-				timer_call(&cb->base);
-				unlock_python();
+				struct obs_python_script *data =
+					python_obs_callback_script(cb);
+
+				if (!data->worker) {
+					timer_call(&cb->base);
+
+				} else if (!os_atomic_set_bool(&timer->queued,
+							       true)) {
+					script_worker_post(data->worker,
+							   "timer",
+							   worker_timer_call,
+							   cb);
+				}
 
 				timer->last_ts += timer->interval;
 			}
@@ -1553,6 +1773,28 @@ static void python_tick(void *param, float seconds)
 	UNUSED_PARAMETER(param);
 }
 
+static void python_worker_tick(obs_script_t *s, float seconds)
+{
+	struct obs_python_script *data = (struct obs_python_script *)s;
+	uint64_t start = script_profile_begin(s, SCRIPT_CALLBACK_TICK);
+
+	lock_python();
+	cur_python_script = data;
+	bool sampled = python_sample_begin(data);
+
+	PyObject *args = Py_BuildValue("(f)", seconds);
+	PyObject *py_ret = PyObject_CallObject(data->tick, args);
+	Py_XDECREF(py_ret);
+	py_error();
+	Py_XDECREF(args);
+
+	python_sample_end(sampled);
+	cur_python_script = NULL;
+	unlock_python();
+
+	script_profile_end(s, SCRIPT_CALLBACK_TICK, start);
+}
+
 /* -------------------------------------------- */
 
 void obs_python_unload(void);
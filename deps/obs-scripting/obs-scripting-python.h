@@ -80,6 +80,8 @@ struct obs_python_script {
 	PyObject *tick;
 	struct obs_python_script *next_tick;
 	struct obs_python_script **p_prev_next_tick;
+
+	struct script_worker *worker;
 };
 
 /* ------------------------------------------------------------ */
@@ -201,8 +203,8 @@ struct py_source;
 typedef struct py_source py_source_t;
 
 extern PyObject *py_libobs;
-extern struct python_obs_callback *cur_python_cb;
-extern struct obs_python_script *cur_python_script;
+extern THREAD_LOCAL struct python_obs_callback *cur_python_cb;
+extern THREAD_LOCAL struct obs_python_script *cur_python_script;
 
 extern void py_to_obs_source_info(py_source_t *py_info);
 extern PyObject *py_obs_register_source(PyObject *self, PyObject *args);
@@ -120,6 +120,386 @@ void defer_call_post(defer_call_cb call, void *cb)
 
 /* -------------------------------------------- */
 
+#define DEFAULT_TICK_BUDGET_US 8000
+#define OVERRUN_REPORT_INTERVAL_NS 10000000000ULL
+
+static volatile long tick_budget_us = DEFAULT_TICK_BUDGET_US;
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void obs_scripting_set_tick_budget(uint32_t budget_us)
+{
+	os_atomic_set_long(&tick_budget_us, (long)budget_us);
+}
+
+uint32_t obs_scripting_get_tick_budget(void)
+{
+	return (uint32_t)os_atomic_load_long(&tick_budget_us);
+}
+
+static inline uint64_t get_tick_budget_ns(void)
+{
+	return (uint64_t)os_atomic_load_long(&tick_budget_us) * 1000ULL;
+}
+
+/* must hold profile_mutex */
+static bool should_report_overrun(obs_script_t *script, uint64_t elapsed_ns)
+{
+	uint64_t budget = get_tick_budget_ns();
+	uint64_t now;
+
+	if (!budget || elapsed_ns <= budget)
+		return false;
+
+	/* a slow script would otherwise flood its log every frame */
+	now = os_gettime_ns();
+	if (script->last_overrun_report &&
+	    now - script->last_overrun_report < OVERRUN_REPORT_INTERVAL_NS)
+		return false;
+
+	script->last_overrun_report = now;
+	return true;
+}
+
+/* -------------------------------------------- */
+
+#define MAX_SAMPLE_LOCATIONS 256
+#define OTHER_SAMPLE_LOCATION "(other)"
+
+static const char *callback_type_names[SCRIPT_CALLBACK_TYPE_COUNT] = {
+	"script_tick",
+	"timer",
+	"tick callback",
+};
+
+void script_profile_init(obs_script_t *script)
+{
+	profiler_name_store_t *store = obs_get_profiler_name_store();
+
+	/* the profiler compares names by pointer, so every script needs its
+	 * own copies */
+	for (size_t i = 0; i < SCRIPT_CALLBACK_TYPE_COUNT; i++)
+		script->profile_names[i] =
+			profile_store_name(store, "%s: %s",
+					   callback_type_names[i],
+					   script->file.array);
+}
+
+static void free_samples(obs_script_t *script)
+{
+	for (size_t i = 0; i < script->samples.num; i++)
+		bfree(script->samples.array[i].location);
+	da_free(script->samples);
+}
+
+void script_profile_free(obs_script_t *script)
+{
+	pthread_mutex_lock(&profile_mutex);
+	free_samples(script);
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+uint64_t script_profile_begin(obs_script_t *script,
+			      enum script_callback_type type)
+{
+	profile_start(script->profile_names[type]);
+	return os_gettime_ns();
+}
+
+void script_profile_end(obs_script_t *script, enum script_callback_type type,
+			uint64_t start)
+{
+	uint64_t elapsed = os_gettime_ns() - start;
+	uint64_t budget = get_tick_budget_ns();
+	bool report;
+
+	profile_end(script->profile_names[type]);
+
+	pthread_mutex_lock(&profile_mutex);
+	script->profile.calls++;
+	script->profile.total_ns += elapsed;
+	if (elapsed > script->profile.max_ns)
+		script->profile.max_ns = elapsed;
+	if (budget && elapsed > budget)
+		script->profile.overruns++;
+
+	report = should_report_overrun(script, elapsed);
+	pthread_mutex_unlock(&profile_mutex);
+
+	if (report)
+		script_warn(script, "%s took %.1f ms, over the %.1f ms budget",
+			    callback_type_names[type],
+			    (double)elapsed / 1000000.0,
+			    (double)budget / 1000000.0);
+}
+
+static struct script_sample *find_sample(obs_script_t *script,
+					 const char *location)
+{
+	for (size_t i = 0; i < script->samples.num; i++) {
+		if (strcmp(script->samples.array[i].location, location) == 0)
+			return &script->samples.array[i];
+	}
+
+	return NULL;
+}
+
+void script_add_sample(obs_script_t *script, const char *location)
+{
+	struct script_sample *sample;
+
+	pthread_mutex_lock(&profile_mutex);
+
+	sample = find_sample(script, location);
+
+	/* scripts generating code could otherwise grow this forever, so the
+	 * last entry is kept for all locations that don't fit */
+	if (!sample && script->samples.num >= MAX_SAMPLE_LOCATIONS - 1) {
+		location = OTHER_SAMPLE_LOCATION;
+		sample = find_sample(script, location);
+	}
+
+	if (!sample) {
+		sample = da_push_back_new(script->samples);
+		sample->location = bstrdup(location);
+	}
+
+	sample->count++;
+
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+void obs_script_get_profile(const obs_script_t *script,
+			    struct obs_script_profile *profile)
+{
+	if (!script || !profile)
+		return;
+
+	pthread_mutex_lock(&profile_mutex);
+	*profile = script->profile;
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+void obs_script_reset_profile(obs_script_t *script)
+{
+	if (!script)
+		return;
+
+	pthread_mutex_lock(&profile_mutex);
+	memset(&script->profile, 0, sizeof(script->profile));
+	free_samples(script);
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+void obs_script_set_sampling(obs_script_t *script, bool enable)
+{
+	if (script)
+		os_atomic_set_bool(&script->sampling, enable);
+}
+
+bool obs_script_sampling(const obs_script_t *script)
+{
+	return script ? os_atomic_load_bool(&script->sampling) : false;
+}
+
+static int cmp_samples(const void *a, const void *b)
+{
+	const struct script_sample *sample_a = a;
+	const struct script_sample *sample_b = b;
+
+	if (sample_a->count == sample_b->count)
+		return 0;
+	return sample_a->count < sample_b->count ? 1 : -1;
+}
+
+/* the callback is called with the profile mutex held */
+void obs_script_enum_samples(obs_script_t *script, obs_script_sample_cb cb,
+			     void *param)
+{
+	if (!script || !cb)
+		return;
+
+	pthread_mutex_lock(&profile_mutex);
+
+	if (script->samples.num)
+		qsort(script->samples.array, script->samples.num,
+		      sizeof(struct script_sample), cmp_samples);
+
+	for (size_t i = 0; i < script->samples.num; i++) {
+		struct script_sample *sample = &script->samples.array[i];
+		if (!cb(param, sample->location, sample->count))
+			break;
+	}
+
+	pthread_mutex_unlock(&profile_mutex);
+}
+
+/* -------------------------------------------- */
+
+struct script_task {
+	const char *name;
+	script_task_cb call;
+	void *param;
+};
+
+struct script_worker {
+	obs_script_t *script;
+	script_worker_tick_cb tick;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	os_sem_t *semaphore;
+	bool exit;
+
+	struct circlebuf tasks;
+	bool tick_pending;
+	float tick_seconds;
+
+	const char *busy_name;
+	uint64_t busy_since;
+};
+
+static void *script_worker_thread(void *param)
+{
+	struct script_worker *worker = param;
+
+	os_set_thread_name("scripting: script worker");
+
+	/* one semaphore post per queued task or pending tick */
+	while (os_sem_wait(worker->semaphore) == 0) {
+		struct script_task task = {0};
+		float seconds = 0.0f;
+
+		pthread_mutex_lock(&worker->mutex);
+		if (worker->exit) {
+			pthread_mutex_unlock(&worker->mutex);
+			break;
+		}
+
+		if (worker->tasks.size) {
+			circlebuf_pop_front(&worker->tasks, &task,
+					    sizeof(task));
+		} else {
+			task.name = "script_tick";
+			seconds = worker->tick_seconds;
+			worker->tick_pending = false;
+			worker->tick_seconds = 0.0f;
+		}
+
+		worker->busy_name = task.name;
+		worker->busy_since = os_gettime_ns();
+		pthread_mutex_unlock(&worker->mutex);
+
+		if (task.call)
+			task.call(task.param);
+		else
+			worker->tick(worker->script, seconds);
+
+		pthread_mutex_lock(&worker->mutex);
+		worker->busy_name = NULL;
+		worker->busy_since = 0;
+		pthread_mutex_unlock(&worker->mutex);
+	}
+
+	return NULL;
+}
+
+struct script_worker *script_worker_create(obs_script_t *script,
+					   script_worker_tick_cb tick)
+{
+	struct script_worker *worker = bzalloc(sizeof(*worker));
+	worker->script = script;
+	worker->tick = tick;
+
+	if (pthread_mutex_init(&worker->mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_sem_init(&worker->semaphore, 0) != 0)
+		goto fail_sem;
+	if (pthread_create(&worker->thread, NULL, script_worker_thread,
+			   worker) != 0)
+		goto fail_thread;
+
+	return worker;
+
+fail_thread:
+	os_sem_destroy(worker->semaphore);
+fail_sem:
+	pthread_mutex_destroy(&worker->mutex);
+fail_mutex:
+	script_warn(script, "Failed to create script worker thread, "
+			    "running on the graphics thread instead");
+	bfree(worker);
+	return NULL;
+}
+
+/* waits for the running callback to return, and drops the queued ones */
+void script_worker_destroy(struct script_worker *worker)
+{
+	if (!worker)
+		return;
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->exit = true;
+	pthread_mutex_unlock(&worker->mutex);
+
+	os_sem_post(worker->semaphore);
+	pthread_join(worker->thread, NULL);
+
+	circlebuf_free(&worker->tasks);
+	os_sem_destroy(worker->semaphore);
+	pthread_mutex_destroy(&worker->mutex);
+	bfree(worker);
+}
+
+/* called from the graphics thread; ticks the worker hasn't gotten to yet are
+ * merged into one, so a slow script skips ticks instead of falling behind */
+void script_worker_tick(struct script_worker *worker, float seconds)
+{
+	const char *busy_name;
+	uint64_t busy_for = 0;
+	bool post = false;
+	bool report;
+
+	pthread_mutex_lock(&worker->mutex);
+	if (!worker->tick_pending) {
+		worker->tick_pending = true;
+		post = true;
+	}
+	worker->tick_seconds += seconds;
+
+	busy_name = worker->busy_name;
+	if (worker->busy_since)
+		busy_for = os_gettime_ns() - worker->busy_since;
+	pthread_mutex_unlock(&worker->mutex);
+
+	if (post)
+		os_sem_post(worker->semaphore);
+
+	/* also catches callbacks which never return */
+	pthread_mutex_lock(&profile_mutex);
+	report = busy_name && should_report_overrun(worker->script, busy_for);
+	pthread_mutex_unlock(&profile_mutex);
+
+	if (report)
+		script_warn(worker->script,
+			    "%s has been running for %.1f ms, script ticks "
+			    "are being skipped",
+			    busy_name, (double)busy_for / 1000000.0);
+}
+
+void script_worker_post(struct script_worker *worker, const char *name,
+			script_task_cb call, void *param)
+{
+	struct script_task task = {name, call, param};
+
+	pthread_mutex_lock(&worker->mutex);
+	circlebuf_push_back(&worker->tasks, &task, sizeof(task));
+	pthread_mutex_unlock(&worker->mutex);
+
+	os_sem_post(worker->semaphore);
+}
+
+/* -------------------------------------------- */
+
 bool obs_scripting_load(void)
 {
 	circlebuf_init(&defer_call_queue);
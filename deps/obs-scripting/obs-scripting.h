@@ -45,6 +45,11 @@ typedef void (*scripting_log_handler_t)(void *p, obs_script_t *script, int lvl,
 EXPORT void obs_scripting_set_log_callback(scripting_log_handler_t handler,
 					   void *param);
 
+/* Time a script_tick or timer callback may take before a warning is logged
+ * to the script log, 0 to disable */
+EXPORT void obs_scripting_set_tick_budget(uint32_t budget_us);
+EXPORT uint32_t obs_scripting_get_tick_budget(void);
+
 EXPORT bool obs_scripting_python_runtime_linked(void);
 EXPORT bool obs_scripting_python_loaded(void);
 EXPORT bool obs_scripting_load_python(const char *python_path);
@@ -65,6 +70,31 @@ EXPORT void obs_script_update(obs_script_t *script, obs_data_t *settings);
 EXPORT bool obs_script_loaded(const obs_script_t *script);
 EXPORT bool obs_script_reload(obs_script_t *script);
 
+/* Time spent in the script_tick, timer and tick callbacks of a script since
+ * it was created or its profile was last reset */
+struct obs_script_profile {
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t overruns; /* calls which went over the tick budget */
+};
+
+EXPORT void obs_script_get_profile(const obs_script_t *script,
+				   struct obs_script_profile *profile);
+EXPORT void obs_script_reset_profile(obs_script_t *script);
+
+/* While sampling, the line a script is running is recorded every thousand
+ * Lua instructions or Python calls and returns.  Samples are enumerated most
+ * frequent first, return false from the callback to stop.  Past 255
+ * locations, new ones are counted together as "(other)". */
+typedef bool (*obs_script_sample_cb)(void *param, const char *location,
+				     uint64_t count);
+
+EXPORT void obs_script_set_sampling(obs_script_t *script, bool enable);
+EXPORT bool obs_script_sampling(const obs_script_t *script);
+EXPORT void obs_script_enum_samples(obs_script_t *script,
+				    obs_script_sample_cb cb, void *param);
+
 #ifdef __cplusplus
 }
 #endif
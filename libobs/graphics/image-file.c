@@ -18,6 +18,9 @@
 #include "image-file.h"
 #include "../util/base.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/circlebuf.h"
+#include "../util/darray.h"
 #include "vec4.h"
 
 #define blog(level, format, ...) \
@@ -73,7 +76,8 @@ static inline void *alloc_mem(gs_image_file_t *image, uint64_t *mem_usage,
 
 static bool init_animated_gif(gs_image_file_t *image, const char *path,
 			      uint64_t *mem_usage,
-			      enum gs_image_alpha_mode alpha_mode)
+			      enum gs_image_alpha_mode alpha_mode,
+			      bool streamed)
 {
 	bool is_animated_gif = true;
 	gif_result result;
@@ -134,7 +138,16 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 	}
 
 	image->is_animated_gif = (image->gif.frame_count > 1 && result >= 0);
-	if (image->is_animated_gif) {
+	if (image->is_animated_gif && streamed) {
+		/* frames are decoded by the gs_image_file4 decode ring */
+		image->cx = (uint32_t)image->gif.width;
+		image->cy = (uint32_t)image->gif.height;
+		image->format = GS_RGBA;
+
+		if (mem_usage)
+			*mem_usage += size;
+
+	} else if (image->is_animated_gif) {
 		gif_decode_frame(&image->gif, 0);
 
 		image->animation_frame_cache =
@@ -192,7 +205,8 @@ not_animated:
 
 static void gs_image_file_init_internal(gs_image_file_t *image,
 					const char *file, uint64_t *mem_usage,
-					enum gs_image_alpha_mode alpha_mode)
+					enum gs_image_alpha_mode alpha_mode,
+					bool streamed)
 {
 	size_t len;
 
@@ -207,7 +221,8 @@ static void gs_image_file_init_internal(gs_image_file_t *image,
 	len = strlen(file);
 
 	if (len > 4 && strcmp(file + len - 4, ".gif") == 0) {
-		if (init_animated_gif(image, file, mem_usage, alpha_mode)) {
+		if (init_animated_gif(image, file, mem_usage, alpha_mode,
+				      streamed)) {
 			return;
 		}
 	}
@@ -229,7 +244,8 @@ static void gs_image_file_init_internal(gs_image_file_t *image,
 
 void gs_image_file_init(gs_image_file_t *image, const char *file)
 {
-	gs_image_file_init_internal(image, file, NULL, GS_IMAGE_ALPHA_STRAIGHT);
+	gs_image_file_init_internal(image, file, NULL, GS_IMAGE_ALPHA_STRAIGHT,
+				    false);
 }
 
 void gs_image_file_free(gs_image_file_t *image)
@@ -255,14 +271,14 @@ void gs_image_file_free(gs_image_file_t *image)
 void gs_image_file2_init(gs_image_file2_t *if2, const char *file)
 {
 	gs_image_file_init_internal(&if2->image, file, &if2->mem_usage,
-				    GS_IMAGE_ALPHA_STRAIGHT);
+				    GS_IMAGE_ALPHA_STRAIGHT, false);
 }
 
 void gs_image_file3_init(gs_image_file3_t *if3, const char *file,
 			 enum gs_image_alpha_mode alpha_mode)
 {
 	gs_image_file_init_internal(&if3->image2.image, file,
-				    &if3->image2.mem_usage, alpha_mode);
+				    &if3->image2.mem_usage, alpha_mode, false);
 	if3->alpha_mode = alpha_mode;
 }
 
@@ -433,3 +449,541 @@ void gs_image_file3_update_texture(gs_image_file3_t *if3)
 	gs_image_file_update_texture_internal(&if3->image2.image,
 					      if3->alpha_mode);
 }
+
+/* ------------------------------------------------------------------------- */
+/* Streamed gif decoding (gs_image_file4) */
+
+/*
+ * Animated gifs loaded through gs_image_file4 are decoded ahead of playback,
+ * each with its own libnsgif state.  If every frame fits within the memory
+ * limit, each frame is decoded once and kept.  Otherwise the frames go
+ * through a small ring of buffers that is refilled as frames are shown, so
+ * memory stays bounded however long the gif is.
+ *
+ * All rings share one decode thread, which decodes one frame at a time for
+ * each ring that has a free buffer in turn.  It runs while any ring exists.
+ */
+
+/* frames decoded ahead when not every frame fits in the memory limit */
+#define GIF_RING_MIN_FRAMES 3
+#define GIF_RING_MAX_FRAMES 8
+
+struct gif_ring_entry {
+	int frame;
+	uint8_t *buffer;
+};
+
+struct gif_decode_ring {
+	gif_animation gif;
+	enum gs_image_alpha_mode alpha_mode;
+	size_t frame_size;
+	unsigned int frame_count;
+
+	/* all frames fit in memory: buffers[i] holds frame i once ready[i] */
+	bool cache_all;
+	bool *ready;
+
+	uint8_t **buffers;
+	size_t num_buffers;
+
+	pthread_mutex_t mutex;
+	bool decoding;
+
+	/* decode thread state */
+	struct circlebuf queue;
+	DARRAY(uint8_t *) free_buffers;
+	int next_frame;
+	int seek_frame;
+	int last_decoded;
+
+	/* consumer state */
+	uint8_t *current;
+	int current_frame;
+	int missed_frame;
+
+	uint64_t frames_decoded;
+	uint64_t decode_misses;
+};
+
+static void ring_decode_frame(struct gif_decode_ring *ring, int frame,
+			      uint8_t *buffer)
+{
+	int first = frame > ring->last_decoded ? ring->last_decoded + 1 : 0;
+
+	/* frames are composited on top of each other, so decode any frames
+	 * that were skipped (or start over if looped) */
+	for (int i = first; i <= frame; i++) {
+		if (gif_decode_frame(&ring->gif, i) != GIF_OK)
+			break;
+		ring->last_decoded = i;
+	}
+
+	/* on error the last good composite is shown for this frame */
+	if (ring->gif.frame_image)
+		memcpy(buffer, ring->gif.frame_image, ring->frame_size);
+	else
+		memset(buffer, 0, ring->frame_size);
+
+	if (ring->alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
+		gs_premultiply_xyza_srgb_loop(buffer, ring->frame_size / 4);
+	} else if (ring->alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY) {
+		gs_premultiply_xyza_loop(buffer, ring->frame_size / 4);
+	}
+}
+
+static void ring_flush_queue(struct gif_decode_ring *ring)
+{
+	while (ring->queue.size) {
+		struct gif_ring_entry entry;
+
+		circlebuf_pop_front(&ring->queue, &entry, sizeof(entry));
+		da_push_back(ring->free_buffers, &entry.buffer);
+	}
+}
+
+/* decodes the next frame the ring needs, if it has a buffer for it */
+static bool ring_decode_next(struct gif_decode_ring *ring)
+{
+	uint8_t *buffer = NULL;
+	int frame;
+
+	pthread_mutex_lock(&ring->mutex);
+
+	if (ring->seek_frame != -1) {
+		ring_flush_queue(ring);
+		ring->next_frame = ring->seek_frame;
+		ring->seek_frame = -1;
+	}
+
+	frame = ring->next_frame;
+
+	if (ring->cache_all) {
+		if ((unsigned int)frame < ring->frame_count)
+			buffer = ring->buffers[frame];
+	} else if (ring->free_buffers.num) {
+		buffer = *(uint8_t **)da_end(ring->free_buffers);
+		da_pop_back(ring->free_buffers);
+	}
+	pthread_mutex_unlock(&ring->mutex);
+
+	if (!buffer)
+		return false;
+
+	ring_decode_frame(ring, frame, buffer);
+
+	pthread_mutex_lock(&ring->mutex);
+	ring->frames_decoded++;
+
+	if (ring->cache_all) {
+		ring->ready[frame] = true;
+		ring->next_frame = frame + 1;
+
+	} else if (ring->seek_frame != -1) {
+		da_push_back(ring->free_buffers, &buffer);
+
+	} else {
+		struct gif_ring_entry entry = {frame, buffer};
+
+		circlebuf_push_back(&ring->queue, &entry, sizeof(entry));
+		ring->next_frame =
+			(unsigned int)(frame + 1) % ring->frame_count;
+	}
+	pthread_mutex_unlock(&ring->mutex);
+
+	return true;
+}
+
+struct gif_decoder {
+	/* held while starting or stopping the thread, outside of mutex */
+	pthread_mutex_t thread_mutex;
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	os_event_t *idle;
+	pthread_t thread;
+	bool thread_active;
+	bool stop;
+
+	DARRAY(struct gif_decode_ring *) rings;
+	struct gif_decode_ring *busy;
+	size_t next;
+};
+
+static struct gif_decoder decoder = {
+	.thread_mutex = PTHREAD_MUTEX_INITIALIZER,
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static inline void gif_decoder_wake(void)
+{
+	os_sem_post(decoder.sem);
+}
+
+/* picks rings round robin, so one long gif can't hold up the others */
+static void *gif_decode_thread(void *param)
+{
+	os_set_thread_name("libobs: gif decode thread");
+
+	for (;;) {
+		struct gif_decode_ring *ring;
+		bool decoded = false;
+
+		pthread_mutex_lock(&decoder.mutex);
+		if (decoder.stop) {
+			pthread_mutex_unlock(&decoder.mutex);
+			break;
+		}
+
+		for (size_t i = 0; i < decoder.rings.num && !decoded; i++) {
+			size_t idx = (decoder.next + i) % decoder.rings.num;
+
+			ring = decoder.rings.array[idx];
+			decoder.busy = ring;
+			os_event_reset(decoder.idle);
+			pthread_mutex_unlock(&decoder.mutex);
+
+			decoded = ring_decode_next(ring);
+
+			pthread_mutex_lock(&decoder.mutex);
+			decoder.busy = NULL;
+			os_event_signal(decoder.idle);
+
+			if (decoded)
+				decoder.next = idx + 1;
+		}
+		pthread_mutex_unlock(&decoder.mutex);
+
+		if (!decoded)
+			os_sem_wait(decoder.sem);
+	}
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
+
+static bool gif_decoder_add(struct gif_decode_ring *ring)
+{
+	bool success = true;
+
+	pthread_mutex_lock(&decoder.thread_mutex);
+
+	if (!decoder.thread_active) {
+		decoder.stop = false;
+		success = os_sem_init(&decoder.sem, 0) == 0 &&
+			  os_event_init(&decoder.idle, OS_EVENT_TYPE_MANUAL) ==
+				  0 &&
+			  pthread_create(&decoder.thread, NULL,
+					 gif_decode_thread, NULL) == 0;
+		if (success) {
+			decoder.thread_active = true;
+		} else {
+			os_sem_destroy(decoder.sem);
+			os_event_destroy(decoder.idle);
+			decoder.sem = NULL;
+			decoder.idle = NULL;
+		}
+	}
+
+	if (success) {
+		pthread_mutex_lock(&decoder.mutex);
+		da_push_back(decoder.rings, &ring);
+		pthread_mutex_unlock(&decoder.mutex);
+
+		gif_decoder_wake();
+	}
+
+	pthread_mutex_unlock(&decoder.thread_mutex);
+	return success;
+}
+
+static void gif_decoder_remove(struct gif_decode_ring *ring)
+{
+	bool last;
+
+	pthread_mutex_lock(&decoder.thread_mutex);
+
+	/* wait for this ring's decode only, the ring is out of the list so it
+	 * won't be picked again */
+	pthread_mutex_lock(&decoder.mutex);
+	da_erase_item(decoder.rings, &ring);
+	while (decoder.busy == ring) {
+		pthread_mutex_unlock(&decoder.mutex);
+		os_event_wait(decoder.idle);
+		pthread_mutex_lock(&decoder.mutex);
+	}
+
+	last = decoder.rings.num == 0;
+	if (last) {
+		decoder.stop = true;
+		da_free(decoder.rings);
+		decoder.next = 0;
+	}
+	pthread_mutex_unlock(&decoder.mutex);
+
+	if (last) {
+		gif_decoder_wake();
+		pthread_join(decoder.thread, NULL);
+		os_sem_destroy(decoder.sem);
+		os_event_destroy(decoder.idle);
+		decoder.sem = NULL;
+		decoder.idle = NULL;
+		decoder.thread_active = false;
+	}
+
+	pthread_mutex_unlock(&decoder.thread_mutex);
+}
+
+static void gif_ring_destroy(struct gif_decode_ring *ring)
+{
+	if (!ring)
+		return;
+
+	if (ring->decoding)
+		gif_decoder_remove(ring);
+
+	for (size_t i = 0; i < ring->num_buffers; i++)
+		bfree(ring->buffers[i]);
+
+	gif_finalise(&ring->gif);
+	circlebuf_free(&ring->queue);
+	da_free(ring->free_buffers);
+	pthread_mutex_destroy(&ring->mutex);
+	bfree(ring->buffers);
+	bfree(ring->ready);
+	bfree(ring);
+}
+
+static struct gif_decode_ring *
+gif_ring_create(gs_image_file_t *image, enum gs_image_alpha_mode alpha_mode,
+		uint64_t memory_limit, uint64_t *mem_usage)
+{
+	struct gif_decode_ring *ring = bzalloc(sizeof(*ring));
+	uint64_t full_size;
+	gif_result result;
+
+	pthread_mutex_init_value(&ring->mutex);
+
+	ring->alpha_mode = alpha_mode;
+	ring->frame_size = (size_t)image->cx * image->cy * 4;
+	ring->frame_count = image->gif.frame_count;
+	ring->seek_frame = -1;
+	ring->last_decoded = -1;
+	ring->missed_frame = -1;
+
+	/* the ring gets its own libnsgif state on the same gif data, so the
+	 * image's copy can still be used for frame timing */
+	gif_create(&ring->gif, &image->bitmap_callbacks);
+	do {
+		result = gif_initialise(&ring->gif, image->gif.buffer_size,
+					image->gif_data);
+		if (result < 0)
+			goto fail;
+	} while (result != GIF_OK);
+
+	full_size = (uint64_t)ring->frame_size * ring->frame_count;
+	ring->cache_all = full_size <= memory_limit;
+
+	if (ring->cache_all) {
+		ring->num_buffers = ring->frame_count;
+		ring->ready = bzalloc(ring->frame_count * sizeof(bool));
+	} else {
+		/* one buffer is always held by the frame being shown */
+		uint64_t fit = memory_limit / ring->frame_size;
+
+		if (fit < GIF_RING_MIN_FRAMES)
+			ring->num_buffers = GIF_RING_MIN_FRAMES;
+		else if (fit > GIF_RING_MAX_FRAMES)
+			ring->num_buffers = GIF_RING_MAX_FRAMES;
+		else
+			ring->num_buffers = (size_t)fit;
+	}
+
+	ring->buffers = bzalloc(ring->num_buffers * sizeof(uint8_t *));
+	for (size_t i = 0; i < ring->num_buffers; i++)
+		ring->buffers[i] = bmalloc(ring->frame_size);
+
+	if (mem_usage)
+		*mem_usage += (uint64_t)ring->num_buffers * ring->frame_size;
+
+	/* decode the first frame right away for the initial texture */
+	ring_decode_frame(ring, 0, ring->buffers[0]);
+	ring->frames_decoded = 1;
+	ring->current = ring->buffers[0];
+	ring->current_frame = 0;
+	ring->next_frame = 1;
+
+	if (ring->cache_all) {
+		ring->ready[0] = true;
+	} else {
+		for (size_t i = ring->num_buffers; i > 1; i--)
+			da_push_back(ring->free_buffers, &ring->buffers[i - 1]);
+	}
+
+	if (pthread_mutex_init(&ring->mutex, NULL) != 0)
+		goto fail;
+	if (!gif_decoder_add(ring))
+		goto fail;
+
+	ring->decoding = true;
+	return ring;
+
+fail:
+	gif_ring_destroy(ring);
+	return NULL;
+}
+
+static bool gif_ring_take_frame(struct gif_decode_ring *ring, int frame)
+{
+	uint8_t *buffer = NULL;
+
+	pthread_mutex_lock(&ring->mutex);
+
+	if (ring->cache_all) {
+		if (ring->ready[frame])
+			buffer = ring->buffers[frame];
+	} else {
+		/* frames that were skipped over are dropped */
+		while (ring->queue.size) {
+			struct gif_ring_entry entry;
+
+			circlebuf_pop_front(&ring->queue, &entry,
+					    sizeof(entry));
+			if (entry.frame == frame) {
+				da_push_back(ring->free_buffers,
+					     &ring->current);
+				buffer = entry.buffer;
+				break;
+			}
+
+			da_push_back(ring->free_buffers, &entry.buffer);
+		}
+
+		/* if the frame isn't the one being decoded next, playback
+		 * jumped (restart, or the decoder fell behind) */
+		if (!buffer && ring->next_frame != frame)
+			ring->seek_frame = frame;
+	}
+
+	if (buffer) {
+		ring->current = buffer;
+		ring->current_frame = frame;
+	} else if (ring->missed_frame != frame) {
+		ring->missed_frame = frame;
+		ring->decode_misses++;
+	}
+
+	pthread_mutex_unlock(&ring->mutex);
+
+	gif_decoder_wake();
+	return !!buffer;
+}
+
+void gs_image_file4_init(gs_image_file4_t *if4, const char *file,
+			 enum gs_image_alpha_mode alpha_mode,
+			 uint64_t gif_memory_limit)
+{
+	gs_image_file_t *image = &if4->image3.image2.image;
+
+	if4->ring = NULL;
+	gs_image_file_init_internal(image, file, &if4->image3.image2.mem_usage,
+				    alpha_mode, true);
+	if4->image3.alpha_mode = alpha_mode;
+
+	if (!image->loaded || !image->is_animated_gif)
+		return;
+
+	if4->ring = gif_ring_create(image, alpha_mode, gif_memory_limit,
+				    &if4->image3.image2.mem_usage);
+	if (!if4->ring) {
+		blog(LOG_WARNING, "Failed to start decoding gif '%s'", file);
+
+		/* no texture yet, so this doesn't need the graphics context */
+		gif_finalise(&image->gif);
+		image->loaded = false;
+		gs_image_file_free(image);
+		if4->image3.image2.mem_usage = 0;
+	}
+}
+
+void gs_image_file4_free(gs_image_file4_t *if4)
+{
+	gif_ring_destroy(if4->ring);
+	if4->ring = NULL;
+
+	gs_image_file3_free(&if4->image3);
+}
+
+void gs_image_file4_init_texture(gs_image_file4_t *if4)
+{
+	gs_image_file_t *image = &if4->image3.image2.image;
+
+	if (!if4->ring) {
+		gs_image_file3_init_texture(&if4->image3);
+		return;
+	}
+
+	image->texture = gs_texture_create(
+		image->cx, image->cy, image->format, 1,
+		(const uint8_t **)&if4->ring->current, GS_DYNAMIC);
+}
+
+bool gs_image_file4_tick(gs_image_file4_t *if4, uint64_t elapsed_time_ns)
+{
+	gs_image_file_t *image = &if4->image3.image2.image;
+	int loops;
+
+	if (!if4->ring)
+		return gs_image_file3_tick(&if4->image3, elapsed_time_ns);
+	if (!image->loaded)
+		return false;
+
+	loops = image->gif.loop_count;
+	if (loops >= 0xFFFF)
+		loops = 0;
+
+	if (!loops || image->cur_loop < loops)
+		image->cur_frame =
+			calculate_new_frame(image, elapsed_time_ns, loops);
+
+	/* if the frame isn't decoded yet, the previous frame stays up and
+	 * it'll be picked up on a later tick */
+	if (if4->ring->current_frame == image->cur_frame)
+		return false;
+
+	return gif_ring_take_frame(if4->ring, image->cur_frame);
+}
+
+void gs_image_file4_update_texture(gs_image_file4_t *if4)
+{
+	gs_image_file_t *image = &if4->image3.image2.image;
+
+	if (!if4->ring) {
+		gs_image_file3_update_texture(&if4->image3);
+		return;
+	}
+
+	if (!image->loaded)
+		return;
+
+	if (if4->ring->current_frame != image->cur_frame)
+		gif_ring_take_frame(if4->ring, image->cur_frame);
+
+	gs_texture_set_image(image->texture, if4->ring->current, image->cx * 4,
+			     false);
+}
+
+void gs_image_file4_get_gif_stats(gs_image_file4_t *if4,
+				  struct gs_image_file_gif_stats *stats)
+{
+	struct gif_decode_ring *ring = if4->ring;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!ring)
+		return;
+
+	pthread_mutex_lock(&ring->mutex);
+	stats->buffered_frames = (uint32_t)ring->num_buffers;
+	stats->frames_decoded = ring->frames_decoded;
+	stats->decode_misses = ring->decode_misses;
+	pthread_mutex_unlock(&ring->mutex);
+}
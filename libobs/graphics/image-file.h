@@ -56,9 +56,27 @@ struct gs_image_file3 {
 	enum gs_image_alpha_mode alpha_mode;
 };
 
+struct gif_decode_ring;
+
+/* animated gifs are decoded ahead on a background thread, using at most
+ * gif_memory_limit bytes for decoded frames */
+struct gs_image_file4 {
+	struct gs_image_file3 image3;
+	struct gif_decode_ring *ring;
+};
+
+struct gs_image_file_gif_stats {
+	uint32_t buffered_frames;
+	uint64_t frames_decoded;
+	uint64_t decode_misses;
+};
+
+#define GS_IMAGE_FILE_GIF_MEMORY_LIMIT (128 * 1024 * 1024)
+
 typedef struct gs_image_file gs_image_file_t;
 typedef struct gs_image_file2 gs_image_file2_t;
 typedef struct gs_image_file3 gs_image_file3_t;
+typedef struct gs_image_file4 gs_image_file4_t;
 
 EXPORT void gs_image_file_init(gs_image_file_t *image, const char *file);
 EXPORT void gs_image_file_free(gs_image_file_t *image);
@@ -81,6 +99,18 @@ EXPORT bool gs_image_file3_tick(gs_image_file3_t *if3,
 				uint64_t elapsed_time_ns);
 EXPORT void gs_image_file3_update_texture(gs_image_file3_t *if3);
 
+EXPORT void gs_image_file4_init(gs_image_file4_t *if4, const char *file,
+				enum gs_image_alpha_mode alpha_mode,
+				uint64_t gif_memory_limit);
+EXPORT void gs_image_file4_free(gs_image_file4_t *if4);
+EXPORT void gs_image_file4_init_texture(gs_image_file4_t *if4);
+
+EXPORT bool gs_image_file4_tick(gs_image_file4_t *if4,
+				uint64_t elapsed_time_ns);
+EXPORT void gs_image_file4_update_texture(gs_image_file4_t *if4);
+EXPORT void gs_image_file4_get_gif_stats(gs_image_file4_t *if4,
+					 struct gs_image_file_gif_stats *stats);
+
 static void gs_image_file2_free(gs_image_file2_t *if2)
 {
 	gs_image_file_free(&if2->image);
@@ -74,10 +74,6 @@ struct obs_volmeter {
 
 	enum obs_peak_meter_type peak_meter_type;
 	unsigned int update_ms;
-	float prev_samples[MAX_AUDIO_CHANNELS][4];
-
-	float magnitude[MAX_AUDIO_CHANNELS];
-	float peak[MAX_AUDIO_CHANNELS];
 };
 
 static float cubic_def_to_db(const float def)
@@ -313,8 +309,8 @@ static int get_nr_channels_from_audio_data(const struct audio_data *data)
 		r = fmaxf(r, x4_mem[3]);   \
 	} while (false)
 
-/* Calculate the true peak over a set of samples.
- * The algorithm implements 5x oversampling by using Whittaker–Shannon
+/* Calculate the sample peak and the true peak over a set of samples.
+ * The true peak implements 5x oversampling by using Whittaker–Shannon
  * interpolation over four samples.
  *
  * The four samples have location t=-1.5, -0.5, +0.5, +1.5
@@ -323,10 +319,11 @@ static int get_nr_channels_from_audio_data(const struct audio_data *data)
  * @param previous_samples  Last 4 samples from the previous iteration.
  * @param samples           The samples to find the peak in.
  * @param nr_samples        Number of sets of 4 samples.
- * @returns 5 times oversampled true-peak from the set of samples.
+ * @param sample_peak       Returns the maximum of all samples.
+ * @param true_peak         Returns the 5 times oversampled true-peak.
  */
-static float get_true_peak(__m128 previous_samples, const float *samples,
-			   size_t nr_samples)
+static void get_peaks(__m128 previous_samples, const float *samples,
+		      size_t nr_samples, float *sample_peak, float *true_peak)
 {
 	/* These are normalized-sinc parameters for interpolating over sample
 	 * points which are located at x-coords: -1.5, -0.5, +0.5, +1.5.
@@ -342,8 +339,9 @@ static float get_true_peak(__m128 previous_samples, const float *samples,
 
 	__m128 work = previous_samples;
 	__m128 peak = previous_samples;
+	__m128 intrp_peak = previous_samples;
 	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
-		__m128 new_work = _mm_load_ps(&samples[i]);
+		__m128 new_work = _mm_loadu_ps(&samples[i]);
 		__m128 intrp_samples;
 
 		/* Include the actual sample values in the peak. */
@@ -353,46 +351,55 @@ static float get_true_peak(__m128 previous_samples, const float *samples,
 		/* Shift in the next point. */
 		SHIFT_RIGHT_2PS(new_work, work);
 		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
-		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
+		intrp_peak = _mm_max_ps(intrp_peak, abs_ps(intrp_samples));
 
 		SHIFT_RIGHT_2PS(new_work, work);
 		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
-		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
+		intrp_peak = _mm_max_ps(intrp_peak, abs_ps(intrp_samples));
 
 		SHIFT_RIGHT_2PS(new_work, work);
 		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
-		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
+		intrp_peak = _mm_max_ps(intrp_peak, abs_ps(intrp_samples));
 
 		SHIFT_RIGHT_2PS(new_work, work);
 		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
-		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
+		intrp_peak = _mm_max_ps(intrp_peak, abs_ps(intrp_samples));
 	}
 
 	float r;
 	hmax_ps(r, peak);
-	return r;
+	*sample_peak = r;
+
+	hmax_ps(r, intrp_peak);
+	*true_peak = fmaxf(*sample_peak, r);
 }
 
-/* points contain the first four samples to calculate the sinc interpolation
- * over. They will have come from a previous iteration.
- */
-static float get_sample_peak(__m128 previous_samples, const float *samples,
-			     size_t nr_samples)
+static float get_magnitude(const float *samples, size_t nr_samples)
 {
-	__m128 peak = previous_samples;
-	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
-		__m128 new_work = _mm_load_ps(&samples[i]);
-		peak = _mm_max_ps(peak, abs_ps(new_work));
+	__m128 sum4 = _mm_setzero_ps();
+	float sum4_mem[4];
+	float sum;
+	size_t i = 0;
+
+	if (!nr_samples)
+		return 0.0f;
+
+	for (; (i + 3) < nr_samples; i += 4) {
+		__m128 work = _mm_loadu_ps(&samples[i]);
+		sum4 = _mm_add_ps(sum4, _mm_mul_ps(work, work));
 	}
 
-	float r;
-	hmax_ps(r, peak);
-	return r;
+	_mm_storeu_ps(sum4_mem, sum4);
+	sum = sum4_mem[0] + sum4_mem[1] + sum4_mem[2] + sum4_mem[3];
+
+	for (; i < nr_samples; i++)
+		sum += samples[i] * samples[i];
+
+	return sqrtf(sum / nr_samples);
 }
 
-static void volmeter_process_peak_last_samples(obs_volmeter_t *volmeter,
-					       int channel_nr, float *samples,
-					       size_t nr_samples)
+static void store_last_samples(float prev_samples[4], const float *samples,
+			       size_t nr_samples)
 {
 	/* Take the last 4 samples that need to be used for the next peak
 	 * calculation. If there are less than 4 samples in total the new
@@ -402,128 +409,168 @@ static void volmeter_process_peak_last_samples(obs_volmeter_t *volmeter,
 	case 0:
 		break;
 	case 1:
-		volmeter->prev_samples[channel_nr][0] =
-			volmeter->prev_samples[channel_nr][1];
-		volmeter->prev_samples[channel_nr][1] =
-			volmeter->prev_samples[channel_nr][2];
-		volmeter->prev_samples[channel_nr][2] =
-			volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev_samples[0] = prev_samples[1];
+		prev_samples[1] = prev_samples[2];
+		prev_samples[2] = prev_samples[3];
+		prev_samples[3] = samples[nr_samples - 1];
 		break;
 	case 2:
-		volmeter->prev_samples[channel_nr][0] =
-			volmeter->prev_samples[channel_nr][2];
-		volmeter->prev_samples[channel_nr][1] =
-			volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev_samples[0] = prev_samples[2];
+		prev_samples[1] = prev_samples[3];
+		prev_samples[2] = samples[nr_samples - 2];
+		prev_samples[3] = samples[nr_samples - 1];
 		break;
 	case 3:
-		volmeter->prev_samples[channel_nr][0] =
-			volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][1] = samples[nr_samples - 3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev_samples[0] = prev_samples[3];
+		prev_samples[1] = samples[nr_samples - 3];
+		prev_samples[2] = samples[nr_samples - 2];
+		prev_samples[3] = samples[nr_samples - 1];
 		break;
 	default:
-		volmeter->prev_samples[channel_nr][0] = samples[nr_samples - 4];
-		volmeter->prev_samples[channel_nr][1] = samples[nr_samples - 3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev_samples[0] = samples[nr_samples - 4];
+		prev_samples[1] = samples[nr_samples - 3];
+		prev_samples[2] = samples[nr_samples - 2];
+		prev_samples[3] = samples[nr_samples - 1];
 	}
 }
 
-static void volmeter_process_peak(obs_volmeter_t *volmeter,
-				  const struct audio_data *data,
-				  int nr_channels)
+/* ------------------------------------------------------------------------- */
+/* Shared source audio levels
+ *
+ * The levels of a source are measured once per chunk of audio it outputs, on
+ * the thread outputting it with audio_cb_mutex held, for as long as anything
+ * uses them.  They are published with a sequence counter so that they can be
+ * read from any thread without locking: the counter is odd while the levels
+ * are being written, and readers retry if it changed while they copied. */
+
+void obs_source_meter_audio(obs_source_t *source,
+			    const struct audio_data *data, bool muted)
 {
-	int nr_samples = data->frames;
+	struct obs_audio_levels levels = {0};
+	int nr_channels = get_nr_channels_from_audio_data(data);
+	size_t nr_samples = data->frames;
 	int channel_nr = 0;
+
+	if (nr_channels != source->audio_levels.channels)
+		memset(source->audio_levels_prev_samples, 0,
+		       sizeof(source->audio_levels_prev_samples));
+
 	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
 		float *samples = (float *)data->data[plane_nr];
-		if (!samples) {
-			continue;
-		}
-		if (((uintptr_t)samples & 0xf) > 0) {
-			printf("Audio plane %i is not aligned %p skipping "
-			       "peak volume measurement.\n",
-			       plane_nr, samples);
-			volmeter->peak[channel_nr] = 1.0;
-			channel_nr++;
+		float *prev_samples;
+
+		if (!samples)
 			continue;
-		}
 
-		/* volmeter->prev_samples may not be aligned to 16 bytes;
-		 * use unaligned load. */
-		__m128 previous_samples =
-			_mm_loadu_ps(volmeter->prev_samples[channel_nr]);
+		prev_samples = source->audio_levels_prev_samples[channel_nr];
+		get_peaks(_mm_loadu_ps(prev_samples), samples, nr_samples,
+			  &levels.peak[channel_nr],
+			  &levels.true_peak[channel_nr]);
+		store_last_samples(prev_samples, samples, nr_samples);
 
-		float peak;
-		switch (volmeter->peak_meter_type) {
-		case TRUE_PEAK_METER:
-			peak = get_true_peak(previous_samples, samples,
-					     nr_samples);
-			break;
+		levels.magnitude[channel_nr] =
+			get_magnitude(samples, nr_samples);
 
-		case SAMPLE_PEAK_METER:
-		default:
-			peak = get_sample_peak(previous_samples, samples,
-					       nr_samples);
-			break;
-		}
+		channel_nr++;
+	}
 
-		volmeter_process_peak_last_samples(volmeter, channel_nr,
-						   samples, nr_samples);
+	levels.channels = nr_channels;
+	levels.muted = muted;
+	levels.timestamp = os_gettime_ns();
 
-		volmeter->peak[channel_nr] = peak;
+	os_atomic_inc_long(&source->audio_levels_seq);
+	source->audio_levels = levels;
+	os_atomic_inc_long(&source->audio_levels_seq);
 
-		channel_nr++;
+	for (size_t i = source->audio_levels_cb_list.num; i > 0; i--) {
+		struct audio_levels_cb_info info =
+			source->audio_levels_cb_list.array[i - 1];
+		info.callback(info.param, source, &levels);
 	}
+}
 
-	/* Clear the peak of the channels that have not been handled. */
-	for (; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
-		volmeter->peak[channel_nr] = 0.0;
-	}
+bool obs_source_get_audio_levels(obs_source_t *source,
+				 struct obs_audio_levels *levels)
+{
+	long seq;
+
+	if (!obs_source_valid(source, "obs_source_get_audio_levels"))
+		return false;
+	if (!obs_ptr_valid(levels, "obs_source_get_audio_levels"))
+		return false;
+
+	/* the compare-and-swap keeps the copy from being moved past the
+	 * second read of the counter */
+	do {
+		seq = os_atomic_load_long(&source->audio_levels_seq);
+		*levels = source->audio_levels;
+	} while ((seq & 1) != 0 ||
+		 !os_atomic_compare_swap_long(&source->audio_levels_seq, seq,
+					      seq));
+
+	return levels->timestamp != 0;
 }
 
-static void volmeter_process_magnitude(obs_volmeter_t *volmeter,
-				       const struct audio_data *data,
-				       int nr_channels)
+void obs_source_inc_audio_levels(obs_source_t *source)
 {
-	size_t nr_samples = data->frames;
+	if (!obs_source_valid(source, "obs_source_inc_audio_levels"))
+		return;
 
-	int channel_nr = 0;
-	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
-		float *samples = (float *)data->data[plane_nr];
-		if (!samples) {
-			continue;
-		}
+	os_atomic_inc_long(&source->audio_levels_refs);
+}
+
+void obs_source_dec_audio_levels(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_dec_audio_levels"))
+		return;
 
-		float sum = 0.0;
-		for (size_t i = 0; i < nr_samples; i++) {
-			float sample = samples[i];
-			sum += sample * sample;
-		}
-		volmeter->magnitude[channel_nr] = sqrtf(sum / nr_samples);
+	os_atomic_dec_long(&source->audio_levels_refs);
+}
 
-		channel_nr++;
-	}
+void obs_source_add_audio_levels_callback(obs_source_t *source,
+					  obs_source_audio_levels_t callback,
+					  void *param)
+{
+	struct audio_levels_cb_info info = {callback, param};
+
+	if (!obs_source_valid(source, "obs_source_add_audio_levels_callback"))
+		return;
+
+	pthread_mutex_lock(&source->audio_cb_mutex);
+	da_push_back(source->audio_levels_cb_list, &info);
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+
+	os_atomic_inc_long(&source->audio_levels_refs);
 }
 
-static void volmeter_process_audio_data(obs_volmeter_t *volmeter,
-					const struct audio_data *data)
+void obs_source_remove_audio_levels_callback(obs_source_t *source,
+					     obs_source_audio_levels_t callback,
+					     void *param)
 {
-	int nr_channels = get_nr_channels_from_audio_data(data);
+	struct audio_levels_cb_info info = {callback, param};
+	size_t idx;
 
-	volmeter_process_peak(volmeter, data, nr_channels);
-	volmeter_process_magnitude(volmeter, data, nr_channels);
+	if (!obs_source_valid(source,
+			      "obs_source_remove_audio_levels_callback"))
+		return;
+
+	pthread_mutex_lock(&source->audio_cb_mutex);
+	idx = da_find(source->audio_levels_cb_list, &info, 0);
+	if (idx != DARRAY_INVALID)
+		da_erase(source->audio_levels_cb_list, idx);
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+
+	if (idx != DARRAY_INVALID)
+		os_atomic_dec_long(&source->audio_levels_refs);
 }
 
-static void volmeter_source_data_received(void *vptr, obs_source_t *source,
-					  const struct audio_data *data,
-					  bool muted)
+/* ------------------------------------------------------------------------- */
+
+static void volmeter_source_levels_received(void *vptr, obs_source_t *source,
+					    const struct obs_audio_levels *levels)
 {
 	struct obs_volmeter *volmeter = (struct obs_volmeter *)vptr;
+	const float *levels_peak;
 	float mul;
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
@@ -531,20 +578,22 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 
 	pthread_mutex_lock(&volmeter->mutex);
 
-	volmeter_process_audio_data(volmeter, data);
+	levels_peak = volmeter->peak_meter_type == TRUE_PEAK_METER
+			      ? levels->true_peak
+			      : levels->peak;
 
 	// Adjust magnitude/peak based on the volume level set by the user.
 	// And convert to dB.
-	mul = muted ? 0.0f : db_to_mul(volmeter->cur_db);
+	mul = levels->muted ? 0.0f : db_to_mul(volmeter->cur_db);
 	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS;
 	     channel_nr++) {
 		magnitude[channel_nr] =
-			mul_to_db(volmeter->magnitude[channel_nr] * mul);
-		peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr] * mul);
+			mul_to_db(levels->magnitude[channel_nr] * mul);
+		peak[channel_nr] = mul_to_db(levels_peak[channel_nr] * mul);
 
 		/* The input-peak is NOT adjusted with volume, so that the user
 		 * can check the input-gain. */
-		input_peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr]);
+		input_peak[channel_nr] = mul_to_db(levels_peak[channel_nr]);
 	}
 
 	pthread_mutex_unlock(&volmeter->mutex);
@@ -819,8 +868,8 @@ bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
 			       volmeter);
 	signal_handler_connect(sh, "destroy", volmeter_source_destroyed,
 			       volmeter);
-	obs_source_add_audio_capture_callback(
-		source, volmeter_source_data_received, volmeter);
+	obs_source_add_audio_levels_callback(
+		source, volmeter_source_levels_received, volmeter);
 	vol = obs_source_get_volume(source);
 
 	pthread_mutex_lock(&volmeter->mutex);
@@ -854,8 +903,8 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 				  volmeter);
 	signal_handler_disconnect(sh, "destroy", volmeter_source_destroyed,
 				  volmeter);
-	obs_source_remove_audio_capture_callback(
-		source, volmeter_source_data_received, volmeter);
+	obs_source_remove_audio_levels_callback(
+		source, volmeter_source_levels_received, volmeter);
 }
 
 void obs_volmeter_set_peak_meter_type(obs_volmeter_t *volmeter,
@@ -452,6 +452,7 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
+	uint64_t callback_start = os_gettime_ns();
 	size_t audio_size;
 	uint64_t min_ts;
 
@@ -586,6 +587,9 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	*out_ts = ts.start;
 
+	histogram_record(&audio->callback_latency,
+			 os_gettime_ns() - callback_start);
+
 	if (audio->buffering_wait_ticks) {
 		audio->buffering_wait_ticks--;
 		return false;
@@ -0,0 +1,480 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stdio.h>
+
+#include "util/array-serializer.h"
+#include "util/base.h"
+#include "util/bmem.h"
+#include "util/darray.h"
+#include "util/platform.h"
+#include "obs-data.h"
+
+/*
+ * Compact binary obs_data format, meant for files that are written often and
+ * only ever read back by libobs (autosaves and the like).
+ *
+ *   file   := "OBSD" version:u8 object
+ *   object := item* TAG_END
+ *   item   := tag:u8 name value
+ *   name   := varint 0, varint length, bytes    (first use of a name)
+ *           | varint n                          (n-th name seen, from 1)
+ *   value  := string: varint length, bytes
+ *           | int: zigzag varint
+ *           | double: 8 bytes, little endian
+ *           | true/false: nothing
+ *           | object: object
+ *           | array: varint count, object*
+ *
+ * Names repeat a lot across objects, so each one is written once per file.
+ * Only user values are stored, same as the JSON format.
+ */
+
+#define BINARY_MAGIC "OBSD"
+#define BINARY_VERSION 1
+#define MAX_DEPTH 2048
+
+enum binary_tag {
+	TAG_END,
+	TAG_STRING,
+	TAG_INT,
+	TAG_DOUBLE,
+	TAG_FALSE,
+	TAG_TRUE,
+	TAG_OBJECT,
+	TAG_ARRAY,
+};
+
+/* ------------------------------------------------------------------------- */
+/* Writer */
+
+struct name_entry {
+	const char *name;
+	size_t idx;
+};
+
+struct binary_writer {
+	struct serializer s;
+	struct array_output_data output;
+
+	/* item names are interned, so they can be looked up by pointer */
+	struct name_entry *names;
+	size_t names_size;
+	size_t num_names;
+};
+
+static inline size_t hash_ptr(const void *ptr)
+{
+	uintptr_t val = (uintptr_t)ptr;
+	return (size_t)((val >> 4) ^ (val >> 12));
+}
+
+static void grow_names(struct binary_writer *w)
+{
+	size_t new_size = w->names_size ? w->names_size * 2 : 64;
+	struct name_entry *names = bzalloc(new_size * sizeof(*names));
+
+	for (size_t i = 0; i < w->names_size; i++) {
+		struct name_entry *entry = &w->names[i];
+		size_t slot;
+
+		if (!entry->name)
+			continue;
+
+		slot = hash_ptr(entry->name) & (new_size - 1);
+		while (names[slot].name)
+			slot = (slot + 1) & (new_size - 1);
+		names[slot] = *entry;
+	}
+
+	bfree(w->names);
+	w->names = names;
+	w->names_size = new_size;
+}
+
+static void write_varint(struct binary_writer *w, uint64_t val)
+{
+	while (val >= 0x80) {
+		s_w8(&w->s, (uint8_t)(val | 0x80));
+		val >>= 7;
+	}
+	s_w8(&w->s, (uint8_t)val);
+}
+
+static void write_bytes(struct binary_writer *w, const char *str)
+{
+	size_t len = strlen(str);
+	write_varint(w, len);
+	s_write(&w->s, str, len);
+}
+
+static void write_name(struct binary_writer *w, const char *name)
+{
+	size_t slot;
+
+	if ((w->num_names + 1) * 2 > w->names_size)
+		grow_names(w);
+
+	slot = hash_ptr(name) & (w->names_size - 1);
+	while (w->names[slot].name) {
+		if (w->names[slot].name == name) {
+			write_varint(w, w->names[slot].idx + 1);
+			return;
+		}
+		slot = (slot + 1) & (w->names_size - 1);
+	}
+
+	w->names[slot].name = name;
+	w->names[slot].idx = w->num_names++;
+
+	write_varint(w, 0);
+	write_bytes(w, name);
+}
+
+static void write_object(struct binary_writer *w, obs_data_t *data);
+
+static void write_item(struct binary_writer *w, obs_data_item_t *item)
+{
+	const char *name = obs_data_item_get_name(item);
+
+	switch (obs_data_item_gettype(item)) {
+	case OBS_DATA_STRING:
+		s_w8(&w->s, TAG_STRING);
+		write_name(w, name);
+		write_bytes(w, obs_data_item_get_string(item));
+		break;
+
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_INT) {
+			int64_t val = obs_data_item_get_int(item);
+
+			s_w8(&w->s, TAG_INT);
+			write_name(w, name);
+			write_varint(w, ((uint64_t)val << 1) ^
+						(uint64_t)(val >> 63));
+		} else {
+			s_w8(&w->s, TAG_DOUBLE);
+			write_name(w, name);
+			s_wld(&w->s, obs_data_item_get_double(item));
+		}
+		break;
+
+	case OBS_DATA_BOOLEAN:
+		s_w8(&w->s, obs_data_item_get_bool(item) ? TAG_TRUE : TAG_FALSE);
+		write_name(w, name);
+		break;
+
+	case OBS_DATA_OBJECT: {
+		obs_data_t *obj = obs_data_item_get_obj(item);
+
+		s_w8(&w->s, TAG_OBJECT);
+		write_name(w, name);
+		write_object(w, obj);
+
+		obs_data_release(obj);
+		break;
+	}
+
+	case OBS_DATA_ARRAY: {
+		obs_data_array_t *array = obs_data_item_get_array(item);
+		size_t count = obs_data_array_count(array);
+
+		s_w8(&w->s, TAG_ARRAY);
+		write_name(w, name);
+		write_varint(w, count);
+
+		for (size_t i = 0; i < count; i++) {
+			obs_data_t *obj = obs_data_array_item(array, i);
+			write_object(w, obj);
+			obs_data_release(obj);
+		}
+
+		obs_data_array_release(array);
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+static void write_object(struct binary_writer *w, obs_data_t *data)
+{
+	obs_data_item_t *item;
+
+	for (item = obs_data_first(data); item; obs_data_item_next(&item)) {
+		if (obs_data_item_has_user_value(item))
+			write_item(w, item);
+	}
+
+	s_w8(&w->s, TAG_END);
+}
+
+bool obs_data_save_binary_safe(obs_data_t *data, const char *file,
+			       const char *temp_ext, const char *backup_ext)
+{
+	struct binary_writer w = {0};
+	bool success;
+
+	if (!data)
+		return false;
+
+	array_output_serializer_init(&w.s, &w.output);
+
+	s_write(&w.s, BINARY_MAGIC, 4);
+	s_w8(&w.s, BINARY_VERSION);
+	write_object(&w, data);
+
+	success = os_quick_write_utf8_file_safe(
+		file, (const char *)w.output.bytes.array, w.output.bytes.num,
+		false, temp_ext, backup_ext);
+
+	array_output_serializer_free(&w.output);
+	bfree(w.names);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Reader */
+
+struct binary_reader {
+	const uint8_t *p;
+	const uint8_t *end;
+	int depth;
+
+	DARRAY(char *) names;
+};
+
+static bool read_varint(struct binary_reader *r, uint64_t *val)
+{
+	uint64_t result = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		uint8_t byte;
+
+		if (r->p == r->end)
+			return false;
+
+		byte = *r->p++;
+		result |= (uint64_t)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80)) {
+			*val = result;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static char *read_bytes(struct binary_reader *r)
+{
+	uint64_t len;
+	char *str;
+
+	if (!read_varint(r, &len) || len > (uint64_t)(r->end - r->p))
+		return NULL;
+
+	str = bmalloc((size_t)len + 1);
+	memcpy(str, r->p, (size_t)len);
+	str[len] = 0;
+
+	r->p += len;
+	return str;
+}
+
+static const char *read_name(struct binary_reader *r)
+{
+	uint64_t idx;
+	char *name;
+
+	if (!read_varint(r, &idx))
+		return NULL;
+
+	if (idx)
+		return idx <= r->names.num ? r->names.array[idx - 1] : NULL;
+
+	name = read_bytes(r);
+	if (name)
+		da_push_back(r->names, &name);
+	return name;
+}
+
+static bool read_object(struct binary_reader *r, obs_data_t *data);
+
+static bool read_array(struct binary_reader *r, obs_data_array_t *array)
+{
+	uint64_t count;
+
+	if (!read_varint(r, &count))
+		return false;
+
+	for (uint64_t i = 0; i < count; i++) {
+		obs_data_t *obj = obs_data_create();
+		bool success = read_object(r, obj);
+
+		if (success)
+			obs_data_array_push_back(array, obj);
+		obs_data_release(obj);
+
+		if (!success)
+			return false;
+	}
+
+	return true;
+}
+
+static bool read_item(struct binary_reader *r, obs_data_t *data, uint8_t tag)
+{
+	const char *name = read_name(r);
+	uint64_t val;
+	double dval;
+
+	if (!name)
+		return false;
+
+	switch (tag) {
+	case TAG_STRING: {
+		char *str = read_bytes(r);
+		if (!str)
+			return false;
+
+		obs_data_set_string(data, name, str);
+		bfree(str);
+		return true;
+	}
+
+	case TAG_INT:
+		if (!read_varint(r, &val))
+			return false;
+
+		obs_data_set_int(data, name,
+				 (long long)((val >> 1) ^ (~(val & 1) + 1)));
+		return true;
+
+	case TAG_DOUBLE:
+		if (r->end - r->p < 8)
+			return false;
+
+		val = 0;
+		for (int i = 0; i < 8; i++)
+			val |= (uint64_t)r->p[i] << (i * 8);
+		memcpy(&dval, &val, sizeof(dval));
+
+		obs_data_set_double(data, name, dval);
+		r->p += 8;
+		return true;
+
+	case TAG_FALSE:
+	case TAG_TRUE:
+		obs_data_set_bool(data, name, tag == TAG_TRUE);
+		return true;
+
+	case TAG_OBJECT: {
+		obs_data_t *obj = obs_data_create();
+		bool success = read_object(r, obj);
+
+		if (success)
+			obs_data_set_obj(data, name, obj);
+		obs_data_release(obj);
+		return success;
+	}
+
+	case TAG_ARRAY: {
+		obs_data_array_t *array = obs_data_array_create();
+		bool success = read_array(r, array);
+
+		if (success)
+			obs_data_set_array(data, name, array);
+		obs_data_array_release(array);
+		return success;
+	}
+	}
+
+	return false;
+}
+
+static bool read_object(struct binary_reader *r, obs_data_t *data)
+{
+	if (++r->depth > MAX_DEPTH)
+		return false;
+
+	while (r->p != r->end) {
+		uint8_t tag = *r->p++;
+
+		if (tag == TAG_END) {
+			r->depth--;
+			return true;
+		}
+
+		if (!read_item(r, data, tag))
+			return false;
+	}
+
+	return false;
+}
+
+obs_data_t *obs_data_create_from_binary_file(const char *file)
+{
+	struct binary_reader r = {0};
+	obs_data_t *data = NULL;
+	uint8_t *buf = NULL;
+	int64_t size;
+	FILE *f;
+
+	f = os_fopen(file, "rb");
+	if (!f)
+		return NULL;
+
+	size = os_fgetsize(f);
+	if (size > 5) {
+		buf = bmalloc((size_t)size);
+		if (fread(buf, 1, (size_t)size, f) != (size_t)size) {
+			bfree(buf);
+			buf = NULL;
+		}
+	}
+
+	fclose(f);
+
+	if (!buf || memcmp(buf, BINARY_MAGIC, 4) != 0 ||
+	    buf[4] != BINARY_VERSION) {
+		blog(LOG_ERROR,
+		     "obs-data-binary.c: [obs_data_create_from_binary_file] "
+		     "'%s' is not a valid obs_data file",
+		     file);
+		goto cleanup;
+	}
+
+	r.p = buf + 5;
+	r.end = buf + size;
+
+	data = obs_data_create();
+	if (!read_object(&r, data) || r.p != r.end) {
+		blog(LOG_ERROR,
+		     "obs-data-binary.c: [obs_data_create_from_binary_file] "
+		     "'%s' is corrupt",
+		     file);
+		obs_data_release(data);
+		data = NULL;
+	}
+
+cleanup:
+	for (size_t i = 0; i < r.names.num; i++)
+		bfree(r.names.array[i]);
+	da_free(r.names);
+	bfree(buf);
+	return data;
+}
@@ -0,0 +1,930 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <errno.h>
+#include <locale.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/darray.h"
+#include "util/dstr.h"
+#include "util/platform.h"
+#include "obs-data.h"
+
+/*
+ * Streaming JSON reader/writer for obs_data.
+ *
+ * Values are read straight from the text into obs_data items, and written
+ * straight from the items into the output string, without building a
+ * jansson tree in between.  Both directions follow what the jansson based
+ * conversion did: the reader accepts and rejects the same documents as
+ * json_loads with JSON_REJECT_DUPLICATES (non-object array elements and
+ * nulls are dropped, a top level array gives an empty object), and the
+ * writer produces the same text as json_dumps with JSON_COMPACT.
+ */
+
+#define MAX_DEPTH 2048
+
+struct json_reader {
+	const char *start;
+	const char *p;
+	int line;
+	int depth;
+	bool failed;
+
+	struct dstr error;
+	struct dstr str;
+	struct dstr num;
+};
+
+/* empties a scratch string without giving up its buffer */
+static inline void str_clear(struct dstr *str)
+{
+	if (str->array) {
+		str->array[0] = 0;
+		str->len = 0;
+	}
+}
+
+static inline const char *str_value(const struct dstr *str)
+{
+	return str->array ? str->array : "";
+}
+
+static void reader_error(struct json_reader *r, const char *format, ...)
+{
+	va_list args;
+
+	if (r->failed)
+		return;
+
+	va_start(args, format);
+	dstr_vprintf(&r->error, format, args);
+	va_end(args);
+
+	r->failed = true;
+}
+
+static inline void skip_whitespace(struct json_reader *r)
+{
+	for (;;) {
+		char ch = *r->p;
+
+		if (ch == '\n')
+			r->line++;
+		else if (ch != ' ' && ch != '\t' && ch != '\r')
+			return;
+
+		r->p++;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* Strings */
+
+static inline int hex_value(char ch)
+{
+	if (ch >= '0' && ch <= '9')
+		return ch - '0';
+	if (ch >= 'a' && ch <= 'f')
+		return ch - 'a' + 10;
+	if (ch >= 'A' && ch <= 'F')
+		return ch - 'A' + 10;
+	return -1;
+}
+
+static int32_t read_hex4(const char *p)
+{
+	int32_t value = 0;
+
+	for (int i = 0; i < 4; i++) {
+		int digit = hex_value(p[i]);
+		if (digit < 0)
+			return -1;
+		value = (value << 4) | digit;
+	}
+
+	return value;
+}
+
+static void cat_utf8(struct dstr *str, int32_t codepoint)
+{
+	char buf[4];
+	size_t len;
+
+	if (codepoint < 0x80) {
+		buf[0] = (char)codepoint;
+		len = 1;
+	} else if (codepoint < 0x800) {
+		buf[0] = (char)(0xC0 | (codepoint >> 6));
+		buf[1] = (char)(0x80 | (codepoint & 0x3F));
+		len = 2;
+	} else if (codepoint < 0x10000) {
+		buf[0] = (char)(0xE0 | (codepoint >> 12));
+		buf[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+		buf[2] = (char)(0x80 | (codepoint & 0x3F));
+		len = 3;
+	} else {
+		buf[0] = (char)(0xF0 | (codepoint >> 18));
+		buf[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+		buf[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+		buf[3] = (char)(0x80 | (codepoint & 0x3F));
+		len = 4;
+	}
+
+	dstr_ncat(str, buf, len);
+}
+
+/* returns the length of the valid UTF-8 sequence at 'p', or 0 if invalid.
+ * overlong encodings, surrogates and values past U+10FFFF are rejected,
+ * same as jansson. */
+static size_t utf8_sequence_len(const uint8_t *p)
+{
+	uint8_t ch = p[0];
+	int32_t codepoint;
+	size_t len;
+
+	if (ch < 0x80)
+		return 1;
+	else if (ch >= 0xC2 && ch <= 0xDF)
+		len = 2, codepoint = ch & 0x1F;
+	else if (ch >= 0xE0 && ch <= 0xEF)
+		len = 3, codepoint = ch & 0x0F;
+	else if (ch >= 0xF0 && ch <= 0xF4)
+		len = 4, codepoint = ch & 0x07;
+	else
+		return 0;
+
+	for (size_t i = 1; i < len; i++) {
+		if ((p[i] & 0xC0) != 0x80)
+			return 0;
+		codepoint = (codepoint << 6) | (p[i] & 0x3F);
+	}
+
+	if ((len == 3 && codepoint < 0x800) ||
+	    (len == 4 && codepoint < 0x10000) || codepoint > 0x10FFFF ||
+	    (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+		return 0;
+
+	return len;
+}
+
+static bool read_escape(struct json_reader *r, struct dstr *out)
+{
+	const char *p = r->p;
+	int32_t value;
+
+	switch (p[1]) {
+	case '"':
+	case '\\':
+	case '/':
+		dstr_cat_ch(out, p[1]);
+		break;
+	case 'b':
+		dstr_cat_ch(out, '\b');
+		break;
+	case 'f':
+		dstr_cat_ch(out, '\f');
+		break;
+	case 'n':
+		dstr_cat_ch(out, '\n');
+		break;
+	case 'r':
+		dstr_cat_ch(out, '\r');
+		break;
+	case 't':
+		dstr_cat_ch(out, '\t');
+		break;
+	case 'u':
+		value = read_hex4(p + 2);
+		if (value < 0) {
+			reader_error(r, "invalid escape");
+			return false;
+		}
+
+		p += 6;
+
+		if (value >= 0xD800 && value <= 0xDBFF) {
+			/* surrogate pair */
+			int32_t low = -1;
+
+			if (p[0] == '\\' && p[1] == 'u')
+				low = read_hex4(p + 2);
+
+			if (low < 0xDC00 || low > 0xDFFF) {
+				reader_error(r, "invalid Unicode '\\u%04X'",
+					     value);
+				return false;
+			}
+
+			value = ((value - 0xD800) << 10) + (low - 0xDC00) +
+				0x10000;
+			p += 6;
+
+		} else if (value >= 0xDC00 && value <= 0xDFFF) {
+			reader_error(r, "invalid Unicode '\\u%04X'", value);
+			return false;
+
+		} else if (value == 0) {
+			reader_error(r, "\\u0000 is not allowed");
+			return false;
+		}
+
+		cat_utf8(out, value);
+		r->p = p;
+		return true;
+
+	default:
+		reader_error(r, "invalid escape");
+		return false;
+	}
+
+	r->p += 2;
+	return true;
+}
+
+/* reads a string token into 'out', the reader must be on the opening quote */
+static bool read_string(struct json_reader *r, struct dstr *out)
+{
+	str_clear(out);
+	r->p++;
+
+	for (;;) {
+		const char *run = r->p;
+		uint8_t ch;
+
+		/* copy unescaped runs in one go */
+		while ((ch = (uint8_t)*r->p) >= 0x20 && ch != '"' &&
+		       ch != '\\') {
+			if (ch < 0x80) {
+				r->p++;
+			} else {
+				size_t len = utf8_sequence_len((uint8_t *)r->p);
+				if (!len) {
+					reader_error(
+						r, "unable to decode byte 0x%x",
+						ch);
+					return false;
+				}
+				r->p += len;
+			}
+		}
+
+		if (r->p != run)
+			dstr_ncat(out, run, r->p - run);
+
+		if (ch == '"') {
+			r->p++;
+			return true;
+		} else if (ch == '\\') {
+			if (!read_escape(r, out))
+				return false;
+		} else if (ch == 0) {
+			reader_error(r, "premature end of input");
+			return false;
+		} else if (ch == '\n') {
+			reader_error(r, "unexpected newline");
+			return false;
+		} else {
+			reader_error(r, "control character 0x%x", ch);
+			return false;
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* Numbers */
+
+static inline bool is_digit(char ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+static double str_to_double(struct dstr *num)
+{
+	const char *point = localeconv()->decimal_point;
+	char *pos;
+
+	if (*point != '.') {
+		pos = strchr(num->array, '.');
+		if (pos)
+			*pos = *point;
+	}
+
+	return strtod(num->array, NULL);
+}
+
+/* reads a number token.  integers are reported as such so that the item
+ * keeps its number type, as with jansson's integer/real distinction. */
+static bool read_number(struct json_reader *r, bool *is_int, long long *ival,
+			double *dval)
+{
+	const char *start = r->p;
+	const char *p = start;
+
+	*is_int = true;
+
+	if (*p == '-')
+		p++;
+
+	if (*p == '0') {
+		p++;
+		if (is_digit(*p)) {
+			reader_error(r, "invalid token");
+			return false;
+		}
+	} else if (is_digit(*p)) {
+		while (is_digit(*p))
+			p++;
+	} else {
+		reader_error(r, "invalid token");
+		return false;
+	}
+
+	if (*p == '.') {
+		*is_int = false;
+		p++;
+		if (!is_digit(*p)) {
+			reader_error(r, "invalid token");
+			return false;
+		}
+		while (is_digit(*p))
+			p++;
+	}
+
+	if (*p == 'e' || *p == 'E') {
+		*is_int = false;
+		p++;
+		if (*p == '+' || *p == '-')
+			p++;
+		if (!is_digit(*p)) {
+			reader_error(r, "invalid token");
+			return false;
+		}
+		while (is_digit(*p))
+			p++;
+	}
+
+	str_clear(&r->num);
+	dstr_ncat(&r->num, start, p - start);
+	r->p = p;
+
+	errno = 0;
+
+	if (*is_int) {
+		*ival = strtoll(r->num.array, NULL, 10);
+		if (errno == ERANGE) {
+			reader_error(r, *ival < 0 ? "too big negative integer"
+						  : "too big integer");
+			return false;
+		}
+	} else {
+		*dval = str_to_double(&r->num);
+		if (errno == ERANGE && isinf(*dval)) {
+			reader_error(r, "real number overflow");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Values */
+
+static bool read_object(struct json_reader *r, obs_data_t *data);
+
+static inline bool match_literal(struct json_reader *r, const char *literal,
+				 size_t len)
+{
+	char next;
+
+	if (strncmp(r->p, literal, len) != 0) {
+		reader_error(r, "invalid token");
+		return false;
+	}
+
+	next = r->p[len];
+	if ((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z')) {
+		reader_error(r, "invalid token");
+		return false;
+	}
+
+	r->p += len;
+	return true;
+}
+
+/* reads any value and discards it, used for array elements that aren't
+ * objects, which obs_data arrays can't hold */
+static bool skip_value(struct json_reader *r);
+
+static bool skip_array(struct json_reader *r)
+{
+	if (++r->depth > MAX_DEPTH) {
+		reader_error(r, "maximum parsing depth reached");
+		return false;
+	}
+
+	r->p++;
+	skip_whitespace(r);
+
+	if (*r->p != ']') {
+		for (;;) {
+			if (!skip_value(r))
+				return false;
+
+			skip_whitespace(r);
+			if (*r->p != ',')
+				break;
+
+			r->p++;
+			skip_whitespace(r);
+		}
+
+		if (*r->p != ']') {
+			reader_error(r, "']' expected");
+			return false;
+		}
+	}
+
+	r->p++;
+	r->depth--;
+	return true;
+}
+
+static bool skip_value(struct json_reader *r)
+{
+	bool is_int;
+	long long ival;
+	double dval;
+
+	switch (*r->p) {
+	case '{': {
+		obs_data_t *obj = obs_data_create();
+		bool success = read_object(r, obj);
+		obs_data_release(obj);
+		return success;
+	}
+	case '[':
+		return skip_array(r);
+	case '"':
+		return read_string(r, &r->str);
+	case 't':
+		return match_literal(r, "true", 4);
+	case 'f':
+		return match_literal(r, "false", 5);
+	case 'n':
+		return match_literal(r, "null", 4);
+	case '\0':
+		reader_error(r, "unexpected token");
+		return false;
+	default:
+		return read_number(r, &is_int, &ival, &dval);
+	}
+}
+
+static bool read_array(struct json_reader *r, obs_data_array_t *array)
+{
+	if (++r->depth > MAX_DEPTH) {
+		reader_error(r, "maximum parsing depth reached");
+		return false;
+	}
+
+	r->p++;
+	skip_whitespace(r);
+
+	if (*r->p != ']') {
+		for (;;) {
+			if (*r->p == '{') {
+				obs_data_t *obj = obs_data_create();
+				bool success = read_object(r, obj);
+
+				if (success)
+					obs_data_array_push_back(array, obj);
+				obs_data_release(obj);
+
+				if (!success)
+					return false;
+
+			} else if (!skip_value(r)) {
+				return false;
+			}
+
+			skip_whitespace(r);
+			if (*r->p != ',')
+				break;
+
+			r->p++;
+			skip_whitespace(r);
+		}
+
+		if (*r->p != ']') {
+			reader_error(r, "']' expected");
+			return false;
+		}
+	}
+
+	r->p++;
+	r->depth--;
+	return true;
+}
+
+/* reads the value the reader is on and stores it in 'data' under 'name' */
+static bool read_item(struct json_reader *r, obs_data_t *data,
+		      const char *name)
+{
+	bool is_int;
+	long long ival;
+	double dval;
+
+	switch (*r->p) {
+	case '{': {
+		obs_data_t *obj = obs_data_create();
+		bool success = read_object(r, obj);
+
+		if (success)
+			obs_data_set_obj(data, name, obj);
+		obs_data_release(obj);
+		return success;
+	}
+	case '[': {
+		obs_data_array_t *array = obs_data_array_create();
+		bool success = read_array(r, array);
+
+		if (success)
+			obs_data_set_array(data, name, array);
+		obs_data_array_release(array);
+		return success;
+	}
+	case '"':
+		if (!read_string(r, &r->str))
+			return false;
+		obs_data_set_string(data, name, str_value(&r->str));
+		return true;
+	case 't':
+		if (!match_literal(r, "true", 4))
+			return false;
+		obs_data_set_bool(data, name, true);
+		return true;
+	case 'f':
+		if (!match_literal(r, "false", 5))
+			return false;
+		obs_data_set_bool(data, name, false);
+		return true;
+	case 'n':
+		return match_literal(r, "null", 4);
+	case '\0':
+		reader_error(r, "unexpected token");
+		return false;
+	default:
+		if (!read_number(r, &is_int, &ival, &dval))
+			return false;
+
+		if (is_int)
+			obs_data_set_int(data, name, ival);
+		else
+			obs_data_set_double(data, name, dval);
+		return true;
+	}
+}
+
+static bool has_null_name(char **null_names, size_t num, const char *name)
+{
+	for (size_t i = 0; i < num; i++) {
+		if (strcmp(null_names[i], name) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static bool read_object(struct json_reader *r, obs_data_t *data)
+{
+	/* null values aren't stored, but still count as duplicate keys */
+	DARRAY(char *) null_names;
+	struct dstr name = {0};
+	bool success = false;
+
+	da_init(null_names);
+
+	if (++r->depth > MAX_DEPTH) {
+		reader_error(r, "maximum parsing depth reached");
+		return false;
+	}
+
+	r->p++;
+	skip_whitespace(r);
+
+	if (*r->p == '}')
+		goto done;
+
+	for (;;) {
+		obs_data_item_t *existing;
+
+		if (*r->p != '"') {
+			reader_error(r, "string or '}' expected");
+			goto fail;
+		}
+		if (!read_string(r, &name))
+			goto fail;
+
+		existing = obs_data_item_byname(data, str_value(&name));
+		if (existing || has_null_name(null_names.array, null_names.num,
+					      str_value(&name))) {
+			obs_data_item_release(&existing);
+			reader_error(r, "duplicate object key");
+			goto fail;
+		}
+
+		skip_whitespace(r);
+		if (*r->p != ':') {
+			reader_error(r, "':' expected");
+			goto fail;
+		}
+
+		r->p++;
+		skip_whitespace(r);
+
+		if (*r->p == 'n') {
+			char *null_name = bstrdup(str_value(&name));
+			da_push_back(null_names, &null_name);
+		}
+
+		if (!read_item(r, data, str_value(&name)))
+			goto fail;
+
+		skip_whitespace(r);
+		if (*r->p != ',')
+			break;
+
+		r->p++;
+		skip_whitespace(r);
+	}
+
+	if (*r->p != '}') {
+		reader_error(r, "'}' expected");
+		goto fail;
+	}
+
+done:
+	r->p++;
+	r->depth--;
+	success = true;
+
+fail:
+	for (size_t i = 0; i < null_names.num; i++)
+		bfree(null_names.array[i]);
+	da_free(null_names);
+	dstr_free(&name);
+	return success;
+}
+
+bool obs_data_json_read(obs_data_t *data, const char *json, int *error_line,
+			struct dstr *error)
+{
+	struct json_reader r = {0};
+	bool success = false;
+
+	r.start = json;
+	r.p = json;
+	r.line = 1;
+
+	skip_whitespace(&r);
+
+	if (*r.p == '{') {
+		success = read_object(&r, data);
+	} else if (*r.p == '[') {
+		/* valid json, but there's nothing to put in an object */
+		success = skip_array(&r);
+	} else {
+		reader_error(&r, "'[' or '{' expected");
+	}
+
+	if (success) {
+		skip_whitespace(&r);
+		if (*r.p) {
+			reader_error(&r, "end of file expected");
+			success = false;
+		}
+	}
+
+	if (!success) {
+		*error_line = r.line;
+		dstr_move(error, &r.error);
+	}
+
+	dstr_free(&r.error);
+	dstr_free(&r.str);
+	dstr_free(&r.num);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Writer */
+
+static bool is_valid_utf8(const char *str)
+{
+	const uint8_t *p = (const uint8_t *)str;
+
+	while (*p) {
+		size_t len = utf8_sequence_len(p);
+		if (!len)
+			return false;
+		p += len;
+	}
+
+	return true;
+}
+
+static void write_string(struct dstr *out, const char *str)
+{
+	const char *run = str;
+	const char *p = str;
+
+	dstr_cat_ch(out, '"');
+
+	for (;; p++) {
+		uint8_t ch = (uint8_t)*p;
+		const char *escape;
+		char seq[7];
+
+		if (ch >= 0x20 && ch != '"' && ch != '\\')
+			continue;
+
+		if (p != run)
+			dstr_ncat(out, run, p - run);
+		if (!ch)
+			break;
+
+		switch (ch) {
+		case '"':
+			escape = "\\\"";
+			break;
+		case '\\':
+			escape = "\\\\";
+			break;
+		case '\b':
+			escape = "\\b";
+			break;
+		case '\f':
+			escape = "\\f";
+			break;
+		case '\n':
+			escape = "\\n";
+			break;
+		case '\r':
+			escape = "\\r";
+			break;
+		case '\t':
+			escape = "\\t";
+			break;
+		default:
+			snprintf(seq, sizeof(seq), "\\u%04X", ch);
+			escape = seq;
+		}
+
+		dstr_cat(out, escape);
+		run = p + 1;
+	}
+
+	dstr_cat_ch(out, '"');
+}
+
+static void write_object(obs_data_t *data, struct dstr *out);
+
+static void write_array(obs_data_array_t *array, struct dstr *out)
+{
+	size_t count = obs_data_array_count(array);
+
+	dstr_cat_ch(out, '[');
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *obj = obs_data_array_item(array, i);
+
+		if (i)
+			dstr_cat_ch(out, ',');
+		write_object(obj, out);
+
+		obs_data_release(obj);
+	}
+
+	dstr_cat_ch(out, ']');
+}
+
+/* items that jansson couldn't represent (invalid UTF-8, non-finite reals)
+ * are left out, as they were before */
+static bool item_writable(obs_data_item_t *item)
+{
+	enum obs_data_type type = obs_data_item_gettype(item);
+
+	if (!obs_data_item_has_user_value(item))
+		return false;
+	if (!is_valid_utf8(obs_data_item_get_name(item)))
+		return false;
+
+	switch (type) {
+	case OBS_DATA_STRING:
+		return is_valid_utf8(obs_data_item_get_string(item));
+	case OBS_DATA_NUMBER:
+		return obs_data_item_numtype(item) == OBS_DATA_NUM_INT ||
+		       isfinite(obs_data_item_get_double(item));
+	case OBS_DATA_BOOLEAN:
+	case OBS_DATA_OBJECT:
+	case OBS_DATA_ARRAY:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void write_value(obs_data_item_t *item, struct dstr *out)
+{
+	char buf[64];
+	int len;
+
+	switch (obs_data_item_gettype(item)) {
+	case OBS_DATA_STRING:
+		write_string(out, obs_data_item_get_string(item));
+		break;
+
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_INT) {
+			len = snprintf(buf, sizeof(buf), "%lld",
+				       obs_data_item_get_int(item));
+		} else {
+			/* not always null terminated, use the length */
+			len = os_dtostr(obs_data_item_get_double(item), buf,
+					sizeof(buf));
+		}
+
+		if (len > 0)
+			dstr_ncat(out, buf, len);
+		else
+			dstr_cat(out, "0.0");
+		break;
+
+	case OBS_DATA_BOOLEAN:
+		dstr_cat(out, obs_data_item_get_bool(item) ? "true" : "false");
+		break;
+
+	case OBS_DATA_OBJECT: {
+		obs_data_t *obj = obs_data_item_get_obj(item);
+		write_object(obj, out);
+		obs_data_release(obj);
+		break;
+	}
+
+	case OBS_DATA_ARRAY: {
+		obs_data_array_t *array = obs_data_item_get_array(item);
+		write_array(array, out);
+		obs_data_array_release(array);
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+static void write_object(obs_data_t *data, struct dstr *out)
+{
+	obs_data_item_t *item;
+	bool first = true;
+
+	dstr_cat_ch(out, '{');
+
+	for (item = obs_data_first(data); item; obs_data_item_next(&item)) {
+		if (!item_writable(item))
+			continue;
+
+		if (!first)
+			dstr_cat_ch(out, ',');
+		first = false;
+
+		write_string(out, obs_data_item_get_name(item));
+		dstr_cat_ch(out, ':');
+		write_value(item, out);
+	}
+
+	dstr_cat_ch(out, '}');
+}
+
+void obs_data_json_write(obs_data_t *data, struct dstr *out)
+{
+	str_clear(out);
+	write_object(data, out);
+}
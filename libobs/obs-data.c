@@ -26,12 +26,18 @@
 #include "graphics/quat.h"
 #include "obs-data.h"
 
-#include <jansson.h>
+struct obs_data_key {
+	volatile long refs;
+	uint32_t hash;
+	size_t len;
+};
 
 struct obs_data_item {
 	volatile long ref;
 	struct obs_data *parent;
+	struct obs_data_item *prev;
 	struct obs_data_item *next;
+	struct obs_data_key *key;
 	enum obs_data_type type;
 	size_t name_len;
 	size_t data_len;
@@ -46,6 +52,12 @@ struct obs_data {
 	volatile long ref;
 	char *json;
 	struct obs_data_item *first_item;
+	struct obs_data_item *last_item;
+	size_t num_items;
+
+	/* open-addressing name index, only built for larger objects */
+	struct obs_data_item **index;
+	size_t index_size;
 };
 
 struct obs_data_array {
@@ -61,6 +73,261 @@ struct obs_data_number {
 	};
 };
 
+/* ------------------------------------------------------------------------- */
+/* Interned item names
+ *
+ * The same few names ("id", "name", "settings", ...) are repeated across
+ * thousands of objects in a scene collection, so item names are stored once
+ * in a global table and shared by reference.  The hash is computed once per
+ * unique name and reused by every object's index.
+ *
+ * Only interning (setting a new item) and dropping the last reference to a
+ * name take key_mutex.  Other references are counted atomically, so freeing
+ * objects whose names are still used elsewhere doesn't touch the lock. */
+
+static struct obs_data_key **key_table = NULL;
+static size_t key_table_size = 0;
+static size_t key_count = 0;
+static pthread_mutex_t key_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline uint32_t hash_name(const char *name, size_t *len)
+{
+	/* FNV-1a */
+	const uint8_t *p = (const uint8_t *)name;
+	uint32_t hash = 2166136261u;
+
+	while (*p) {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+
+	if (len)
+		*len = (const char *)p - name;
+	return hash;
+}
+
+static inline const char *get_key_str(const struct obs_data_key *key)
+{
+	return (const char *)(key + 1);
+}
+
+static inline bool key_matches(const struct obs_data_key *key, uint32_t hash,
+			       const char *name)
+{
+	const char *str = get_key_str(key);
+	return key->hash == hash && (str == name || strcmp(str, name) == 0);
+}
+
+typedef uint32_t (*get_hash_t)(const void *entry);
+
+/* removes the entry at 'slot' from a linear-probing table, shifting later
+ * entries of the same probe run back so no tombstones are needed */
+static inline void table_remove_slot(void **table, size_t size, size_t slot,
+				     get_hash_t get_hash)
+{
+	size_t mask = size - 1;
+	size_t i = slot;
+
+	for (size_t j = (i + 1) & mask; table[j]; j = (j + 1) & mask) {
+		size_t home = get_hash(table[j]) & mask;
+
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			table[i] = table[j];
+			i = j;
+		}
+	}
+
+	table[i] = NULL;
+}
+
+static uint32_t get_key_hash(const void *key)
+{
+	return ((const struct obs_data_key *)key)->hash;
+}
+
+static uint32_t get_item_hash(const void *item)
+{
+	return ((const struct obs_data_item *)item)->key->hash;
+}
+
+static void grow_key_table(void)
+{
+	size_t new_size = key_table_size ? key_table_size * 2 : 256;
+	struct obs_data_key **new_table =
+		bzalloc(new_size * sizeof(struct obs_data_key *));
+
+	for (size_t i = 0; i < key_table_size; i++) {
+		struct obs_data_key *key = key_table[i];
+		size_t slot;
+
+		if (!key)
+			continue;
+
+		slot = key->hash & (new_size - 1);
+		while (new_table[slot])
+			slot = (slot + 1) & (new_size - 1);
+		new_table[slot] = key;
+	}
+
+	bfree(key_table);
+	key_table = new_table;
+	key_table_size = new_size;
+}
+
+static struct obs_data_key *intern_name(const char *name)
+{
+	struct obs_data_key *key;
+	size_t len;
+	uint32_t hash = hash_name(name, &len);
+	size_t slot;
+
+	pthread_mutex_lock(&key_mutex);
+
+	if ((key_count + 1) * 2 > key_table_size)
+		grow_key_table();
+
+	slot = hash & (key_table_size - 1);
+	while ((key = key_table[slot]) != NULL) {
+		if (key_matches(key, hash, name)) {
+			os_atomic_inc_long(&key->refs);
+			pthread_mutex_unlock(&key_mutex);
+			return key;
+		}
+		slot = (slot + 1) & (key_table_size - 1);
+	}
+
+	key = bmalloc(sizeof(struct obs_data_key) + len + 1);
+	key->refs = 1;
+	key->hash = hash;
+	key->len = len;
+	memcpy(key + 1, name, len + 1);
+
+	key_table[slot] = key;
+	key_count++;
+
+	pthread_mutex_unlock(&key_mutex);
+	return key;
+}
+
+/* drops a reference without the lock, unless it might be the last one */
+static inline bool release_name_ref(struct obs_data_key *key)
+{
+	long refs = os_atomic_load_long(&key->refs);
+
+	while (refs > 1) {
+		if (os_atomic_compare_exchange_long(&key->refs, &refs,
+						    refs - 1))
+			return true;
+	}
+
+	return false;
+}
+
+static void release_name(struct obs_data_key *key)
+{
+	size_t slot;
+
+	if (release_name_ref(key))
+		return;
+
+	/* other references can only be added by interning, which is blocked
+	 * while the lock is held */
+	pthread_mutex_lock(&key_mutex);
+
+	if (os_atomic_dec_long(&key->refs) > 0) {
+		pthread_mutex_unlock(&key_mutex);
+		return;
+	}
+
+	slot = key->hash & (key_table_size - 1);
+	while (key_table[slot] != key)
+		slot = (slot + 1) & (key_table_size - 1);
+
+	table_remove_slot((void **)key_table, key_table_size, slot,
+			  get_key_hash);
+	bfree(key);
+
+	/* don't leave the table behind once the last object is gone */
+	if (--key_count == 0) {
+		bfree(key_table);
+		key_table = NULL;
+		key_table_size = 0;
+	}
+
+	pthread_mutex_unlock(&key_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Per-object name index
+ *
+ * Items are kept in a list sorted by name, which is also the iteration
+ * order.  Once an object grows past INDEX_THRESHOLD items, a hash index over
+ * the list is built and kept up to date on insertion and removal so that
+ * lookups no longer walk the list.  The index is only ever modified on
+ * write paths, so concurrent readers are no worse off than before. */
+
+#define INDEX_THRESHOLD 8
+
+static void index_insert(struct obs_data_item **index, size_t size,
+			 struct obs_data_item *item)
+{
+	size_t slot = item->key->hash & (size - 1);
+
+	while (index[slot])
+		slot = (slot + 1) & (size - 1);
+	index[slot] = item;
+}
+
+static void rebuild_index(struct obs_data *data, size_t size)
+{
+	struct obs_data_item *item = data->first_item;
+
+	bfree(data->index);
+	data->index = bzalloc(size * sizeof(struct obs_data_item *));
+	data->index_size = size;
+
+	while (item) {
+		index_insert(data->index, size, item);
+		item = item->next;
+	}
+}
+
+static inline size_t index_find_slot(const struct obs_data *data,
+				     const struct obs_data_item *item,
+				     uint32_t hash)
+{
+	size_t mask = data->index_size - 1;
+	size_t slot = hash & mask;
+
+	while (data->index[slot] != item)
+		slot = (slot + 1) & mask;
+	return slot;
+}
+
+static void index_add_item(struct obs_data *data, struct obs_data_item *item)
+{
+	if (!data->index) {
+		if (data->num_items > INDEX_THRESHOLD)
+			rebuild_index(data, 32);
+		return;
+	}
+
+	if (data->num_items * 2 > data->index_size)
+		rebuild_index(data, data->index_size * 2);
+	else
+		index_insert(data->index, data->index_size, item);
+}
+
+static void index_remove_item(struct obs_data *data,
+			      struct obs_data_item *item)
+{
+	if (data->index) {
+		size_t slot = index_find_slot(data, item, item->key->hash);
+		table_remove_slot((void **)data->index, data->index_size,
+				  slot, get_item_hash);
+	}
+}
+
 /* ------------------------------------------------------------------------- */
 /* Item structure, designed to be one allocation only */
 
@@ -70,27 +337,21 @@ static inline size_t get_align_size(size_t size)
 	return (size + alignment - 1) & ~(alignment - 1);
 }
 
-/* ensures data after the name has alignment (in case of SSE) */
-static inline size_t get_name_align_size(const char *name)
+/* ensures data after the item header has alignment (in case of SSE) */
+static inline size_t get_header_pad_size(void)
 {
-	size_t name_size = strlen(name) + 1;
-	size_t alignment = base_get_alignment();
-	size_t total_size;
-
-	total_size = sizeof(struct obs_data_item) + (name_size + alignment - 1);
-	total_size &= ~(alignment - 1);
-
-	return total_size - sizeof(struct obs_data_item);
+	return get_align_size(sizeof(struct obs_data_item)) -
+	       sizeof(struct obs_data_item);
 }
 
-static inline char *get_item_name(struct obs_data_item *item)
+static inline const char *get_item_name(struct obs_data_item *item)
 {
-	return (char *)item + sizeof(struct obs_data_item);
+	return get_key_str(item->key);
 }
 
 static inline void *get_data_ptr(obs_data_item_t *item)
 {
-	return (uint8_t *)get_item_name(item) + item->name_len;
+	return (uint8_t *)item + sizeof(struct obs_data_item) + item->name_len;
 }
 
 static inline void *get_item_data(struct obs_data_item *item)
@@ -268,19 +529,20 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 						  bool autoselect_data)
 {
 	struct obs_data_item *item;
-	size_t name_size, total_size;
+	size_t pad_size, total_size;
 
 	if (!name || !data)
 		return NULL;
 
-	name_size = get_name_align_size(name);
-	total_size = name_size + sizeof(struct obs_data_item) + size;
+	pad_size = get_header_pad_size();
+	total_size = pad_size + sizeof(struct obs_data_item) + size;
 
 	item = bzalloc(total_size);
 
 	item->capacity = total_size;
 	item->type = type;
-	item->name_len = name_size;
+	item->name_len = pad_size;
+	item->key = intern_name(name);
 	item->ref = 1;
 
 	if (default_data) {
@@ -295,52 +557,89 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 		item->data_size = size;
 	}
 
-	strcpy(get_item_name(item), name);
 	memcpy(get_item_data(item), data, size);
 
 	item_data_addref(item);
 	return item;
 }
 
-static struct obs_data_item **get_item_prev_next(struct obs_data *data,
-						 struct obs_data_item *current)
+/* inserts a new item into the sorted item list.  the list is searched from
+ * the end, since items usually arrive in order (copies, saved json). */
+static void obs_data_item_attach(struct obs_data *data,
+				 struct obs_data_item *item)
 {
-	if (!current || !data)
-		return NULL;
+	const char *name = get_item_name(item);
+	struct obs_data_item *prev = data->last_item;
 
-	struct obs_data_item **prev_next = &data->first_item;
-	struct obs_data_item *item = data->first_item;
+	while (prev && strcmp(get_item_name(prev), name) > 0)
+		prev = prev->prev;
 
-	while (item) {
-		if (item == current)
-			return prev_next;
+	item->parent = data;
+	item->prev = prev;
+	item->next = prev ? prev->next : data->first_item;
 
-		prev_next = &item->next;
-		item = item->next;
-	}
+	if (item->next)
+		item->next->prev = item;
+	else
+		data->last_item = item;
 
-	return NULL;
+	if (prev)
+		prev->next = item;
+	else
+		data->first_item = item;
+
+	data->num_items++;
+	index_add_item(data, item);
 }
 
 static inline void obs_data_item_detach(struct obs_data_item *item)
 {
-	struct obs_data_item **prev_next =
-		get_item_prev_next(item->parent, item);
+	struct obs_data *data = item->parent;
 
-	if (prev_next) {
-		*prev_next = item->next;
-		item->next = NULL;
-	}
+	if (!data)
+		return;
+
+	index_remove_item(data, item);
+
+	if (item->prev)
+		item->prev->next = item->next;
+	else
+		data->first_item = item->next;
+
+	if (item->next)
+		item->next->prev = item->prev;
+	else
+		data->last_item = item->prev;
+
+	data->num_items--;
+
+	item->parent = NULL;
+	item->prev = NULL;
+	item->next = NULL;
 }
 
+/* old_ptr has already been freed by the reallocation and must not be read */
 static inline void obs_data_item_reattach(struct obs_data_item *old_ptr,
 					  struct obs_data_item *new_ptr)
 {
-	struct obs_data_item **prev_next =
-		get_item_prev_next(new_ptr->parent, old_ptr);
+	struct obs_data *data = new_ptr->parent;
 
-	if (prev_next)
-		*prev_next = new_ptr;
+	if (!data)
+		return;
+
+	if (new_ptr->prev)
+		new_ptr->prev->next = new_ptr;
+	else
+		data->first_item = new_ptr;
+
+	if (new_ptr->next)
+		new_ptr->next->prev = new_ptr;
+	else
+		data->last_item = new_ptr;
+
+	if (data->index)
+		data->index[index_find_slot(data, old_ptr,
+					    new_ptr->key->hash)] = new_ptr;
 }
 
 static struct obs_data_item *
@@ -365,6 +664,7 @@ static inline void obs_data_item_destroy(struct obs_data_item *item)
 	item_default_data_release(item);
 	item_autoselect_data_release(item);
 	obs_data_item_detach(item);
+	release_name(item->key);
 	bfree(item);
 }
 
@@ -470,155 +770,10 @@ obs_data_item_set_autoselect_data(struct obs_data_item **p_item,
 
 /* ------------------------------------------------------------------------- */
 
-static void obs_data_add_json_item(obs_data_t *data, const char *key,
-				   json_t *json);
-
-static inline void obs_data_add_json_object_data(obs_data_t *data, json_t *jobj)
-{
-	const char *item_key;
-	json_t *jitem;
-
-	json_object_foreach (jobj, item_key, jitem) {
-		obs_data_add_json_item(data, item_key, jitem);
-	}
-}
-
-static inline void obs_data_add_json_object(obs_data_t *data, const char *key,
-					    json_t *jobj)
-{
-	obs_data_t *sub_obj = obs_data_create();
-
-	obs_data_add_json_object_data(sub_obj, jobj);
-	obs_data_set_obj(data, key, sub_obj);
-	obs_data_release(sub_obj);
-}
-
-static void obs_data_add_json_array(obs_data_t *data, const char *key,
-				    json_t *jarray)
-{
-	obs_data_array_t *array = obs_data_array_create();
-	size_t idx;
-	json_t *jitem;
-
-	json_array_foreach (jarray, idx, jitem) {
-		obs_data_t *item;
-
-		if (!json_is_object(jitem))
-			continue;
-
-		item = obs_data_create();
-		obs_data_add_json_object_data(item, jitem);
-		obs_data_array_push_back(array, item);
-		obs_data_release(item);
-	}
-
-	obs_data_set_array(data, key, array);
-	obs_data_array_release(array);
-}
-
-static void obs_data_add_json_item(obs_data_t *data, const char *key,
-				   json_t *json)
-{
-	if (json_is_object(json))
-		obs_data_add_json_object(data, key, json);
-	else if (json_is_array(json))
-		obs_data_add_json_array(data, key, json);
-	else if (json_is_string(json))
-		obs_data_set_string(data, key, json_string_value(json));
-	else if (json_is_integer(json))
-		obs_data_set_int(data, key, json_integer_value(json));
-	else if (json_is_real(json))
-		obs_data_set_double(data, key, json_real_value(json));
-	else if (json_is_true(json))
-		obs_data_set_bool(data, key, true);
-	else if (json_is_false(json))
-		obs_data_set_bool(data, key, false);
-}
-
-/* ------------------------------------------------------------------------- */
-
-static inline void set_json_string(json_t *json, const char *name,
-				   obs_data_item_t *item)
-{
-	const char *val = obs_data_item_get_string(item);
-	json_object_set_new(json, name, json_string(val));
-}
-
-static inline void set_json_number(json_t *json, const char *name,
-				   obs_data_item_t *item)
-{
-	enum obs_data_number_type type = obs_data_item_numtype(item);
-
-	if (type == OBS_DATA_NUM_INT) {
-		long long val = obs_data_item_get_int(item);
-		json_object_set_new(json, name, json_integer(val));
-	} else {
-		double val = obs_data_item_get_double(item);
-		json_object_set_new(json, name, json_real(val));
-	}
-}
-
-static inline void set_json_bool(json_t *json, const char *name,
-				 obs_data_item_t *item)
-{
-	bool val = obs_data_item_get_bool(item);
-	json_object_set_new(json, name, val ? json_true() : json_false());
-}
-
-static json_t *obs_data_to_json(obs_data_t *data);
-
-static inline void set_json_obj(json_t *json, const char *name,
-				obs_data_item_t *item)
-{
-	obs_data_t *obj = obs_data_item_get_obj(item);
-	json_object_set_new(json, name, obs_data_to_json(obj));
-	obs_data_release(obj);
-}
-
-static inline void set_json_array(json_t *json, const char *name,
-				  obs_data_item_t *item)
-{
-	json_t *jarray = json_array();
-	obs_data_array_t *array = obs_data_item_get_array(item);
-	size_t count = obs_data_array_count(array);
-
-	for (size_t idx = 0; idx < count; idx++) {
-		obs_data_t *sub_item = obs_data_array_item(array, idx);
-		json_t *jitem = obs_data_to_json(sub_item);
-		json_array_append_new(jarray, jitem);
-		obs_data_release(sub_item);
-	}
-
-	json_object_set_new(json, name, jarray);
-	obs_data_array_release(array);
-}
-
-static json_t *obs_data_to_json(obs_data_t *data)
-{
-	json_t *json = json_object();
-	obs_data_item_t *item = NULL;
-
-	for (item = obs_data_first(data); item; obs_data_item_next(&item)) {
-		enum obs_data_type type = obs_data_item_gettype(item);
-		const char *name = get_item_name(item);
-
-		if (!obs_data_item_has_user_value(item))
-			continue;
-
-		if (type == OBS_DATA_STRING)
-			set_json_string(json, name, item);
-		else if (type == OBS_DATA_NUMBER)
-			set_json_number(json, name, item);
-		else if (type == OBS_DATA_BOOLEAN)
-			set_json_bool(json, name, item);
-		else if (type == OBS_DATA_OBJECT)
-			set_json_obj(json, name, item);
-		else if (type == OBS_DATA_ARRAY)
-			set_json_array(json, name, item);
-	}
-
-	return json;
-}
+/* obs-data-json.c */
+extern bool obs_data_json_read(obs_data_t *data, const char *json,
+			       int *error_line, struct dstr *error);
+extern void obs_data_json_write(obs_data_t *data, struct dstr *out);
 
 /* ------------------------------------------------------------------------- */
 
@@ -633,22 +788,22 @@ obs_data_t *obs_data_create()
 obs_data_t *obs_data_create_from_json(const char *json_string)
 {
 	obs_data_t *data = obs_data_create();
+	struct dstr error = {0};
+	int line = 0;
 
-	json_error_t error;
-	json_t *root = json_loads(json_string, JSON_REJECT_DUPLICATES, &error);
+	if (!json_string)
+		json_string = "";
 
-	if (root) {
-		obs_data_add_json_object_data(data, root);
-		json_decref(root);
-	} else {
+	if (!obs_data_json_read(data, json_string, &line, &error)) {
 		blog(LOG_ERROR,
 		     "obs-data.c: [obs_data_create_from_json] "
 		     "Failed reading json string (%d): %s",
-		     error.line, error.text);
+		     line, error.array);
 		obs_data_release(data);
 		data = NULL;
 	}
 
+	dstr_free(&error);
 	return data;
 }
 
@@ -708,12 +863,19 @@ static inline void obs_data_destroy(struct obs_data *data)
 
 	while (item) {
 		struct obs_data_item *next = item->next;
+
+		/* items may outlive the object if referenced elsewhere */
+		item->parent = NULL;
+		item->prev = NULL;
+		item->next = NULL;
+
 		obs_data_item_release(&item);
 		item = next;
 	}
 
-	/* NOTE: don't use bfree for json text, allocated by json */
-	free(data->json);
+	bfree(data->index);
+
+	bfree(data->json);
 	bfree(data);
 }
 
@@ -731,13 +893,14 @@ const char *obs_data_get_json(obs_data_t *data)
 	if (!data)
 		return NULL;
 
-	/* NOTE: don't use libobs bfree for json text */
-	free(data->json);
-	data->json = NULL;
+	struct dstr json = {0};
+
+	/* reuse the previous buffer, settings are often saved repeatedly */
+	json.array = data->json;
+	json.capacity = data->json ? strlen(data->json) + 1 : 0;
 
-	json_t *root = obs_data_to_json(data);
-	data->json = json_dumps(root, JSON_PRESERVE_ORDER | JSON_COMPACT);
-	json_decref(root);
+	obs_data_json_write(data, &json);
+	data->json = json.array;
 
 	return data->json;
 }
@@ -866,13 +1029,29 @@ obs_data_t *obs_data_get_defaults(obs_data_t *data)
 
 static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 {
-	if (!data)
+	if (!data || !name)
 		return NULL;
 
+	uint32_t hash = hash_name(name, NULL);
+
+	if (data->index) {
+		size_t mask = data->index_size - 1;
+		size_t slot = hash & mask;
+		struct obs_data_item *item;
+
+		while ((item = data->index[slot]) != NULL) {
+			if (key_matches(item->key, hash, name))
+				return item;
+			slot = (slot + 1) & mask;
+		}
+
+		return NULL;
+	}
+
 	struct obs_data_item *item = data->first_item;
 
 	while (item) {
-		if (strcmp(get_item_name(item), name) == 0)
+		if (key_matches(item->key, hash, name))
 			return item;
 
 		item = item->next;
@@ -891,31 +1070,8 @@ static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 	if ((!item || !*item) && data) {
 		new_item = obs_data_item_create(name, ptr, size, type,
 						default_data, autoselect_data);
-
-		obs_data_item_t *prev = obs_data_first(data);
-		obs_data_item_t *next = obs_data_first(data);
-		obs_data_item_next(&next);
-		for (; prev && next;
-		     obs_data_item_next(&prev), obs_data_item_next(&next)) {
-			if (strcmp(get_item_name(next), name) > 0)
-				break;
-		}
-
-		new_item->parent = data;
-		if (prev && strcmp(get_item_name(prev), name) < 0) {
-			prev->next = new_item;
-			new_item->next = next;
-
-		} else {
-			data->first_item = new_item;
-			new_item->next = prev;
-		}
-
-		if (!prev)
-			data->first_item = new_item;
-
-		obs_data_item_release(&prev);
-		obs_data_item_release(&next);
+		if (new_item)
+			obs_data_item_attach(data, new_item);
 
 	} else if (default_data) {
 		obs_data_item_set_default_data(item, ptr, size, type);
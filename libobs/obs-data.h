@@ -77,6 +77,12 @@ EXPORT bool obs_data_save_json_safe(obs_data_t *data, const char *file,
 				    const char *temp_ext,
 				    const char *backup_ext);
 
+/* Compact binary format, for files only ever read back by libobs */
+EXPORT obs_data_t *obs_data_create_from_binary_file(const char *file);
+EXPORT bool obs_data_save_binary_safe(obs_data_t *data, const char *file,
+				      const char *temp_ext,
+				      const char *backup_ext);
+
 EXPORT void obs_data_apply(obs_data_t *target, obs_data_t *apply_data);
 
 EXPORT void obs_data_erase(obs_data_t *data, const char *name);
@@ -23,7 +23,7 @@
 #define set_encoder_active(encoder, val) \
 	os_atomic_set_bool(&encoder->active, val)
 
-struct obs_encoder_info *find_encoder(const char *id)
+static struct obs_encoder_info *find_encoder_type(const char *id)
 {
 	for (size_t i = 0; i < obs->encoder_types.num; i++) {
 		struct obs_encoder_info *info = obs->encoder_types.array + i;
@@ -35,12 +35,26 @@ struct obs_encoder_info *find_encoder(const char *id)
 	return NULL;
 }
 
+struct obs_encoder_info *find_encoder(const char *id)
+{
+	struct obs_encoder_info *info = find_encoder_type(id);
+
+	if (!info && obs_load_deferred_module_for(OBS_REGISTRY_ENCODERS, id))
+		info = find_encoder_type(id);
+	return info;
+}
+
 const char *obs_encoder_get_display_name(const char *id)
 {
 	struct obs_encoder_info *ei = find_encoder(id);
 	return ei ? ei->get_name(ei->type_data) : NULL;
 }
 
+static const char *encoder_signals[] = {
+	"void encode_stats(ptr encoder, int encode_ns, int queue_depth)",
+	NULL,
+};
+
 static bool init_encoder(struct obs_encoder *encoder, const char *name,
 			 obs_data_t *settings, obs_data_t *hotkey_data)
 {
@@ -52,6 +66,7 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name,
 	if (!obs_context_data_init(&encoder->context, OBS_OBJ_TYPE_ENCODER,
 				   settings, name, hotkey_data, false))
 		return false;
+	signal_handler_add_array(encoder->context.signals, encoder_signals);
 	if (pthread_mutex_init_recursive(&encoder->init_mutex) != 0)
 		return false;
 	if (pthread_mutex_init_recursive(&encoder->callbacks_mutex) != 0)
@@ -186,8 +201,13 @@ static inline bool has_scaling(const struct obs_encoder *encoder)
 
 static inline bool gpu_encode_available(const struct obs_encoder *encoder)
 {
-	return (encoder->info.caps & OBS_ENCODER_CAP_PASS_TEXTURE) != 0 &&
-	       obs->video.using_nv12_tex;
+	struct obs_core_video *video = &obs->video;
+
+	if ((encoder->info.caps & OBS_ENCODER_CAP_PASS_TEXTURE) == 0)
+		return false;
+
+	return video->using_nv12_tex ||
+	       (video->using_nv12_planes && encoder->info.encode_texture2);
 }
 
 static void add_connection(struct obs_encoder *encoder)
@@ -421,6 +441,20 @@ obs_data_t *obs_encoder_get_settings(const obs_encoder_t *encoder)
 	return encoder->context.settings;
 }
 
+signal_handler_t *obs_encoder_get_signal_handler(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_get_signal_handler")
+		       ? encoder->context.signals
+		       : NULL;
+}
+
+proc_handler_t *obs_encoder_get_proc_handler(const obs_encoder_t *encoder)
+{
+	return obs_encoder_valid(encoder, "obs_encoder_get_proc_handler")
+		       ? encoder->context.procs
+		       : NULL;
+}
+
 static inline void reset_audio_buffers(struct obs_encoder *encoder)
 {
 	free_audio_buffers(encoder);
@@ -839,6 +873,17 @@ bool obs_encoder_active(const obs_encoder_t *encoder)
 		       : false;
 }
 
+void obs_encoder_get_encode_latency(const obs_encoder_t *encoder,
+				    struct obs_latency_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_encode_latency"))
+		return;
+	if (!obs_ptr_valid(stats, "obs_encoder_get_encode_latency"))
+		return;
+
+	obs_get_latency_stats(&encoder->encode_latency, stats);
+}
+
 static inline bool get_sei(const struct obs_encoder *encoder, uint8_t **sei,
 			   size_t *size)
 {
@@ -977,6 +1022,7 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame)
 
 	struct encoder_packet pkt = {0};
 	bool received = false;
+	uint64_t encode_start;
 	bool success;
 
 	if (encoder->reconfigure_requested) {
@@ -991,8 +1037,11 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame)
 	pkt.sys_time_ms = frame->timestamp_ms;
 
 	profile_start(encoder->profile_encoder_encode_name);
+	encode_start = os_gettime_ns();
 	success = encoder->info.encode(encoder->context.data, frame, &pkt,
 				       &received);
+	histogram_record(&encoder->encode_latency,
+			 os_gettime_ns() - encode_start);
 	profile_end(encoder->profile_encoder_encode_name);
 	send_off_encoder_packet(encoder, success, received, &pkt);
 
@@ -1345,12 +1394,11 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 					const struct encoder_packet *src)
 {
-	long *p_refs;
+	struct obs_packet_header *header;
 
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
+	header = obs_packet_pool_alloc(src->size);
+	dst->data = (void *)(header + 1);
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1374,8 +1422,9 @@ void obs_encoder_packet_ref(struct encoder_packet *dst,
 		return;
 
 	if (src->data) {
-		long *p_refs = ((long *)src->data) - 1;
-		os_atomic_inc_long(p_refs);
+		struct obs_packet_header *header =
+			((struct obs_packet_header *)src->data) - 1;
+		os_atomic_inc_long(&header->refs);
 	}
 
 	*dst = *src;
@@ -1387,9 +1436,10 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 		return;
 
 	if (pkt->data) {
-		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
-			bfree(p_refs);
+		struct obs_packet_header *header =
+			((struct obs_packet_header *)pkt->data) - 1;
+		if (os_atomic_dec_long(&header->refs) == 0)
+			obs_packet_pool_free(header);
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
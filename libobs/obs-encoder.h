@@ -108,6 +108,15 @@ struct encoder_frame {
 	int64_t timestamp_ms;
 };
 
+/** Encoder input texture */
+struct encoder_texture {
+	/** Shared texture handle, or GS_INVALID_HANDLE */
+	uint32_t handle;
+
+	/** Plane textures (Y and UV for NV12), NULL if unused */
+	gs_texture_t *tex[4];
+};
+
 /**
  * Encoder interface
  *
@@ -268,6 +277,29 @@ struct obs_encoder_info {
 			       uint64_t lock_key, uint64_t *next_key,
 			       struct encoder_packet *packet,
 			       bool *received_packet);
+
+	/**
+	 * Encodes video from the output textures rather than a shared
+	 * handle.  Used when NV12 output is rendered to separate plane
+	 * textures (see obs_nv12_planes_active), in which case the texture
+	 * handle is GS_INVALID_HANDLE.  The textures must only be used
+	 * inside the graphics context and must not be kept after returning.
+	 *
+	 * @param  data             Data associated with this encoder context
+	 * @param  texture          Output textures for this frame
+	 * @param  pts              Presentation timestamp of the frame
+	 * @param  lock_key         Keyed mutex key, if handle is valid
+	 * @param  next_key         Next keyed mutex key, if handle is valid
+	 * @param[out] packet       Encoder packet output, if any
+	 * @param[out] received_packet  Set to true if a packet was received,
+	 *                              false otherwise
+	 * @return                  true if successful, false otherwise.
+	 */
+	bool (*encode_texture2)(void *data, struct encoder_texture *texture,
+				int64_t pts, uint64_t lock_key,
+				uint64_t *next_key,
+				struct encoder_packet *packet,
+				bool *received_packet);
 };
 
 EXPORT void obs_register_encoder_s(const struct obs_encoder_info *info,
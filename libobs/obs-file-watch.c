@@ -0,0 +1,658 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <sys/stat.h>
+
+#include "util/dstr.h"
+#include "obs-internal.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+/*
+ * File change notifications for sources that show the contents of a file.
+ *
+ * Watches are grouped by directory, so files replaced by rename (which is how
+ * most editors and tools save) are still seen.  On Linux directories are
+ * watched with inotify; anything inotify can't watch (and every watch on
+ * other platforms) is polled with stat() from the watcher thread instead of
+ * from each source's video_tick.  Callbacks are called on the watcher thread
+ * once a file has been quiet for WATCH_QUIET_MS, or at most every
+ * WATCH_MAX_DELAY_MS while it keeps changing.
+ *
+ * Removing a watch only waits for that watch's own callback to return, so a
+ * slow callback doesn't hold up sources removing unrelated watches.
+ */
+
+#define WATCH_QUIET_MS 50
+#define WATCH_MAX_DELAY_MS 500
+#define WATCH_POLL_MS 1000
+
+struct obs_file_watch {
+	uint64_t id;
+	char *path;
+	char *dir;
+	char *name; /* NULL when watching a directory */
+
+	obs_file_watch_cb callback;
+	void *param;
+
+	int wd;
+
+	/* callback state, protected by the watcher mutex */
+	bool in_callback;
+	bool removed;
+	bool free_after_callback;
+	os_event_t *callback_done;
+
+	/* names that changed since the last callback (directory watches) */
+	DARRAY(char *) changed;
+	bool dirty;
+	uint64_t first_change;
+	uint64_t last_change;
+
+	/* stat state for polled watches */
+	bool exists;
+	time_t mtime;
+	int64_t size;
+};
+
+struct obs_file_watcher {
+	pthread_mutex_t mutex;
+	DARRAY(struct obs_file_watch *) watches;
+	uint64_t next_id;
+
+	pthread_t thread;
+	bool thread_active;
+	os_event_t *stop_event;
+
+	int fd;
+	int wake_fds[2];
+};
+
+static inline bool watching_dir(const struct obs_file_watch *watch)
+{
+	return watch->name == NULL;
+}
+
+static void stat_watch(struct obs_file_watch *watch, bool *changed)
+{
+	struct stat st;
+	bool exists = os_stat(watch->path, &st) == 0;
+	time_t mtime = exists ? st.st_mtime : 0;
+	int64_t size = exists ? (int64_t)st.st_size : 0;
+
+	if (changed)
+		*changed = exists != watch->exists || mtime != watch->mtime ||
+			   size != watch->size;
+
+	watch->exists = exists;
+	watch->mtime = mtime;
+	watch->size = size;
+}
+
+static void mark_changed(struct obs_file_watch *watch, const char *name,
+			 uint64_t now)
+{
+	if (!watch->dirty) {
+		watch->dirty = true;
+		watch->first_change = now;
+	}
+	watch->last_change = now;
+
+	if (!watching_dir(watch) || !name || !*name)
+		return;
+
+	for (size_t i = 0; i < watch->changed.num; i++) {
+		if (strcmp(watch->changed.array[i], name) == 0)
+			return;
+	}
+
+	char *copy = bstrdup(name);
+	da_push_back(watch->changed, &copy);
+}
+
+/* ------------------------------------------------------------------------- */
+/* inotify */
+
+#ifdef __linux__
+#define WATCH_MASK                                                         \
+	(IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE |  \
+	 IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | \
+	 IN_ONLYDIR)
+
+static void add_inotify_watch(struct obs_file_watcher *fw,
+			      struct obs_file_watch *watch)
+{
+	if (fw->fd != -1)
+		watch->wd = inotify_add_watch(fw->fd, watch->dir, WATCH_MASK);
+}
+
+static void remove_inotify_watch(struct obs_file_watcher *fw,
+				 struct obs_file_watch *watch)
+{
+	if (fw->fd == -1 || watch->wd == -1)
+		return;
+
+	/* the directory watch is shared with any other file in it */
+	for (size_t i = 0; i < fw->watches.num; i++) {
+		struct obs_file_watch *other = fw->watches.array[i];
+		if (other != watch && other->wd == watch->wd)
+			return;
+	}
+
+	inotify_rm_watch(fw->fd, watch->wd);
+}
+
+static void process_inotify_events(struct obs_file_watcher *fw, uint64_t now)
+{
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	while ((len = read(fw->fd, buf, sizeof(buf))) > 0) {
+		const struct inotify_event *ev;
+
+		pthread_mutex_lock(&fw->mutex);
+
+		for (char *ptr = buf; ptr < buf + len;
+		     ptr += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)ptr;
+			const char *name = ev->len ? ev->name : NULL;
+
+			for (size_t i = 0; i < fw->watches.num; i++) {
+				struct obs_file_watch *watch =
+					fw->watches.array[i];
+
+				if (watch->wd != ev->wd)
+					continue;
+
+				/* directory went away: fall back to polling
+				 * until it can be watched again */
+				if (ev->mask & IN_IGNORED) {
+					watch->wd = -1;
+					mark_changed(watch, NULL, now);
+					continue;
+				}
+
+				bool self = (ev->mask &
+					     (IN_DELETE_SELF | IN_MOVE_SELF));
+
+				if (watching_dir(watch) || self ||
+				    (name && strcmp(watch->name, name) == 0))
+					mark_changed(watch, name, now);
+			}
+		}
+
+		pthread_mutex_unlock(&fw->mutex);
+	}
+}
+
+static bool init_inotify(struct obs_file_watcher *fw)
+{
+	fw->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fw->fd == -1) {
+		blog(LOG_WARNING,
+		     "File watcher: inotify unavailable (%d), "
+		     "polling files instead",
+		     errno);
+		return true;
+	}
+
+	if (pipe(fw->wake_fds) != 0) {
+		close(fw->fd);
+		fw->fd = -1;
+		return false;
+	}
+
+	fcntl(fw->wake_fds[0], F_SETFL, O_NONBLOCK);
+	return true;
+}
+
+static void free_inotify(struct obs_file_watcher *fw)
+{
+	if (fw->fd != -1) {
+		close(fw->fd);
+		close(fw->wake_fds[0]);
+		close(fw->wake_fds[1]);
+		fw->fd = -1;
+	}
+}
+
+static void wake_thread(struct obs_file_watcher *fw)
+{
+	if (fw->fd != -1) {
+		char c = 0;
+		if (write(fw->wake_fds[1], &c, 1) != 1)
+			blog(LOG_DEBUG, "File watcher: failed to wake thread");
+	}
+}
+
+static bool wait_events(struct obs_file_watcher *fw, int timeout_ms)
+{
+	struct pollfd fds[2] = {
+		{.fd = fw->fd, .events = POLLIN},
+		{.fd = fw->wake_fds[0], .events = POLLIN},
+	};
+	char drain[64];
+
+	if (fw->fd == -1)
+		return os_event_timedwait(fw->stop_event, timeout_ms) != 0;
+
+	poll(fds, 2, timeout_ms);
+
+	if (fds[1].revents & POLLIN) {
+		while (read(fw->wake_fds[0], drain, sizeof(drain)) > 0)
+			;
+	}
+
+	if (fds[0].revents & POLLIN)
+		process_inotify_events(fw, os_gettime_ns());
+
+	return os_event_try(fw->stop_event) != 0;
+}
+
+#else
+static void add_inotify_watch(struct obs_file_watcher *fw,
+			      struct obs_file_watch *watch)
+{
+	UNUSED_PARAMETER(fw);
+	UNUSED_PARAMETER(watch);
+}
+
+static void remove_inotify_watch(struct obs_file_watcher *fw,
+				 struct obs_file_watch *watch)
+{
+	UNUSED_PARAMETER(fw);
+	UNUSED_PARAMETER(watch);
+}
+
+static bool init_inotify(struct obs_file_watcher *fw)
+{
+	fw->fd = -1;
+	return true;
+}
+
+static void free_inotify(struct obs_file_watcher *fw)
+{
+	UNUSED_PARAMETER(fw);
+}
+
+static void wake_thread(struct obs_file_watcher *fw)
+{
+	UNUSED_PARAMETER(fw);
+}
+
+static bool wait_events(struct obs_file_watcher *fw, int timeout_ms)
+{
+	return os_event_timedwait(fw->stop_event, timeout_ms) != 0;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* watcher thread */
+
+static void poll_watches(struct obs_file_watcher *fw, uint64_t now)
+{
+	pthread_mutex_lock(&fw->mutex);
+
+	for (size_t i = 0; i < fw->watches.num; i++) {
+		struct obs_file_watch *watch = fw->watches.array[i];
+		bool changed;
+
+		if (watch->wd != -1)
+			continue;
+
+		/* stat once more when inotify picks the directory back up,
+		 * in case the file appeared along with it */
+		add_inotify_watch(fw, watch);
+		stat_watch(watch, &changed);
+		if (changed)
+			mark_changed(watch, NULL, now);
+	}
+
+	pthread_mutex_unlock(&fw->mutex);
+}
+
+static bool ready_to_dispatch(const struct obs_file_watch *watch, uint64_t now)
+{
+	return watch->dirty &&
+	       (now - watch->last_change >= WATCH_QUIET_MS * 1000000ULL ||
+		now - watch->first_change >= WATCH_MAX_DELAY_MS * 1000000ULL);
+}
+
+static struct obs_file_watch *find_watch(struct obs_file_watcher *fw,
+					 uint64_t id)
+{
+	for (size_t i = 0; i < fw->watches.num; i++) {
+		if (fw->watches.array[i]->id == id)
+			return fw->watches.array[i];
+	}
+	return NULL;
+}
+
+static void free_watch(struct obs_file_watch *watch)
+{
+	for (size_t i = 0; i < watch->changed.num; i++)
+		bfree(watch->changed.array[i]);
+	da_free(watch->changed);
+	os_event_destroy(watch->callback_done);
+	bfree(watch->path);
+	bfree(watch->dir);
+	bfree(watch->name);
+	bfree(watch);
+}
+
+static void call_watch(struct obs_file_watcher *fw,
+		       struct obs_file_watch *watch, struct darray *names)
+{
+	DARRAY(char *) changed;
+	obs_file_watch_cb callback = watch->callback;
+	void *param = watch->param;
+	struct dstr path = {0};
+
+	changed.da = *names;
+
+	if (!watching_dir(watch) || !changed.num) {
+		callback(param, watch->path);
+		return;
+	}
+
+	/* turn the names into full paths first, the callback may remove the
+	 * watch */
+	for (size_t i = 0; i < changed.num; i++) {
+		dstr_copy(&path, watch->dir);
+		dstr_cat_ch(&path, '/');
+		dstr_cat(&path, changed.array[i]);
+		bfree(changed.array[i]);
+		changed.array[i] = path.array;
+		dstr_init(&path);
+	}
+
+	for (size_t i = 0; i < changed.num; i++) {
+		bool removed;
+
+		pthread_mutex_lock(&fw->mutex);
+		removed = watch->removed;
+		pthread_mutex_unlock(&fw->mutex);
+
+		if (removed)
+			break;
+
+		callback(param, changed.array[i]);
+	}
+}
+
+static void dispatch_watches(struct obs_file_watcher *fw, uint64_t now)
+{
+	DARRAY(uint64_t) ready;
+
+	da_init(ready);
+
+	/* watches can be removed while other callbacks run, so look each one up
+	 * again by id */
+	pthread_mutex_lock(&fw->mutex);
+	for (size_t i = 0; i < fw->watches.num; i++) {
+		struct obs_file_watch *watch = fw->watches.array[i];
+		if (ready_to_dispatch(watch, now))
+			da_push_back(ready, &watch->id);
+	}
+	pthread_mutex_unlock(&fw->mutex);
+
+	for (size_t i = 0; i < ready.num; i++) {
+		struct obs_file_watch *watch;
+		struct darray names;
+
+		bool free_watch_now;
+
+		pthread_mutex_lock(&fw->mutex);
+		watch = find_watch(fw, ready.array[i]);
+		if (watch) {
+			watch->dirty = false;
+			watch->in_callback = true;
+			os_event_reset(watch->callback_done);
+			names = watch->changed.da;
+			da_init(watch->changed);
+		}
+		pthread_mutex_unlock(&fw->mutex);
+
+		if (!watch)
+			continue;
+
+		call_watch(fw, watch, &names);
+
+		/* signal with the mutex held: once it's released, a thread
+		 * waiting in obs_file_watch_remove may free the watch */
+		pthread_mutex_lock(&fw->mutex);
+		watch->in_callback = false;
+		free_watch_now = watch->free_after_callback;
+		if (!free_watch_now)
+			os_event_signal(watch->callback_done);
+		pthread_mutex_unlock(&fw->mutex);
+
+		if (free_watch_now)
+			free_watch(watch);
+
+		for (size_t j = 0; j < names.num; j++)
+			bfree(((char **)names.array)[j]);
+		darray_free(&names);
+	}
+
+	da_free(ready);
+}
+
+static int next_timeout(struct obs_file_watcher *fw, uint64_t now,
+			uint64_t next_poll)
+{
+	uint64_t wake = next_poll;
+
+	pthread_mutex_lock(&fw->mutex);
+	for (size_t i = 0; i < fw->watches.num; i++) {
+		struct obs_file_watch *watch = fw->watches.array[i];
+		uint64_t t;
+
+		if (!watch->dirty)
+			continue;
+
+		t = watch->last_change + WATCH_QUIET_MS * 1000000ULL;
+		if (t > watch->first_change + WATCH_MAX_DELAY_MS * 1000000ULL)
+			t = watch->first_change +
+			    WATCH_MAX_DELAY_MS * 1000000ULL;
+		if (t < wake)
+			wake = t;
+	}
+	pthread_mutex_unlock(&fw->mutex);
+
+	return wake > now ? (int)((wake - now + 999999) / 1000000) : 0;
+}
+
+static void *file_watch_thread(void *param)
+{
+	struct obs_file_watcher *fw = param;
+	uint64_t next_poll = 0;
+
+	os_set_thread_name("libobs: file watch thread");
+
+	for (;;) {
+		uint64_t now = os_gettime_ns();
+
+		if (now >= next_poll) {
+			poll_watches(fw, now);
+			next_poll = now + WATCH_POLL_MS * 1000000ULL;
+		}
+
+		dispatch_watches(fw, now);
+
+		if (!wait_events(fw, next_timeout(fw, os_gettime_ns(),
+						  next_poll)))
+			break;
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+bool obs_init_file_watcher(void)
+{
+	struct obs_file_watcher *fw = bzalloc(sizeof(*fw));
+
+	pthread_mutex_init_value(&fw->mutex);
+	fw->fd = -1;
+	obs->file_watcher = fw;
+
+	if (pthread_mutex_init(&fw->mutex, NULL) != 0)
+		return false;
+	if (os_event_init(&fw->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		return false;
+	if (!init_inotify(fw))
+		return false;
+	if (pthread_create(&fw->thread, NULL, file_watch_thread, fw) != 0)
+		return false;
+
+	fw->thread_active = true;
+	return true;
+}
+
+void obs_stop_file_watcher(void)
+{
+	struct obs_file_watcher *fw = obs->file_watcher;
+
+	if (fw && fw->thread_active) {
+		os_event_signal(fw->stop_event);
+		wake_thread(fw);
+		pthread_join(fw->thread, NULL);
+		fw->thread_active = false;
+	}
+}
+
+void obs_free_file_watcher(void)
+{
+	struct obs_file_watcher *fw = obs->file_watcher;
+
+	if (!fw)
+		return;
+
+	obs_stop_file_watcher();
+
+	if (fw->watches.num)
+		blog(LOG_WARNING, "File watcher: %d watches were not removed",
+		     (int)fw->watches.num);
+	for (size_t i = 0; i < fw->watches.num; i++)
+		free_watch(fw->watches.array[i]);
+	da_free(fw->watches);
+
+	free_inotify(fw);
+	os_event_destroy(fw->stop_event);
+	pthread_mutex_destroy(&fw->mutex);
+	bfree(fw);
+	obs->file_watcher = NULL;
+}
+
+obs_file_watch_t *obs_file_watch_add(const char *path,
+				     obs_file_watch_cb callback, void *param)
+{
+	struct obs_file_watcher *fw = obs ? obs->file_watcher : NULL;
+	struct obs_file_watch *watch;
+	struct dstr dir = {0};
+	os_dir_t *test_dir;
+	char *slash;
+
+	if (!fw || !path || !*path || !callback)
+		return NULL;
+
+	watch = bzalloc(sizeof(*watch));
+	if (os_event_init(&watch->callback_done, OS_EVENT_TYPE_MANUAL) != 0) {
+		bfree(watch);
+		return NULL;
+	}
+
+	watch->path = bstrdup(path);
+	watch->callback = callback;
+	watch->param = param;
+	watch->wd = -1;
+
+	dstr_copy(&dir, path);
+	dstr_replace(&dir, "\\", "/");
+	while (dir.len > 1 && dstr_end(&dir) == '/')
+		dstr_resize(&dir, dir.len - 1);
+
+	test_dir = os_opendir(path);
+	if (test_dir) {
+		os_closedir(test_dir);
+		watch->dir = bstrdup(dir.array);
+	} else {
+		slash = strrchr(dir.array, '/');
+		if (slash) {
+			size_t len = (size_t)(slash - dir.array);
+
+			watch->name = bstrdup(slash + 1);
+			dstr_resize(&dir, len ? len : 1);
+		} else {
+			watch->name = bstrdup(dir.array);
+			dstr_copy(&dir, ".");
+		}
+		watch->dir = bstrdup(dir.array);
+	}
+	dstr_free(&dir);
+
+	stat_watch(watch, NULL);
+
+	pthread_mutex_lock(&fw->mutex);
+	watch->id = ++fw->next_id;
+	add_inotify_watch(fw, watch);
+	da_push_back(fw->watches, &watch);
+	pthread_mutex_unlock(&fw->mutex);
+
+	return watch;
+}
+
+void obs_file_watch_remove(obs_file_watch_t *watch)
+{
+	struct obs_file_watcher *fw = obs ? obs->file_watcher : NULL;
+
+	if (!fw || !watch)
+		return;
+
+	pthread_mutex_lock(&fw->mutex);
+	remove_inotify_watch(fw, watch);
+	da_erase_item(fw->watches, &watch);
+	watch->removed = true;
+
+	/* removed from its own callback: the watcher thread frees it once the
+	 * callback returns */
+	if (watch->in_callback && fw->thread_active &&
+	    pthread_equal(pthread_self(), fw->thread)) {
+		watch->free_after_callback = true;
+		pthread_mutex_unlock(&fw->mutex);
+		return;
+	}
+
+	/* otherwise wait for this watch's callback only; no new one can start
+	 * now that it's out of the list */
+	while (watch->in_callback) {
+		pthread_mutex_unlock(&fw->mutex);
+		os_event_wait(watch->callback_done);
+		pthread_mutex_lock(&fw->mutex);
+	}
+	pthread_mutex_unlock(&fw->mutex);
+
+	free_watch(watch);
+}
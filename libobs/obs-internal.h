@@ -24,6 +24,7 @@
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/profiler.h"
+#include "util/histogram.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -39,6 +40,7 @@
 #include <caption/caption.h>
 
 #define NUM_TEXTURES 2
+#define MAX_READBACK_DEPTH 8
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 3
@@ -102,12 +104,45 @@ struct obs_module {
 	const char *(*name)(void);
 	const char *(*description)(void);
 	const char *(*author)(void);
+	bool (*deferrable)(void);
 
 	struct obs_module *next;
 };
 
 extern void free_module(struct obs_module *mod);
 
+/* type registries covered by the module manifest */
+enum obs_type_registry {
+	OBS_REGISTRY_INPUTS,
+	OBS_REGISTRY_FILTERS,
+	OBS_REGISTRY_TRANSITIONS,
+	OBS_REGISTRY_OUTPUTS,
+	OBS_REGISTRY_ENCODERS,
+	OBS_REGISTRY_SERVICES,
+	OBS_REGISTRY_COUNT,
+
+	/* inputs, filters and transitions */
+	OBS_REGISTRY_ANY_SOURCE = OBS_REGISTRY_COUNT,
+};
+
+struct obs_module_manifest;
+
+extern void obs_load_deferred_modules(enum obs_type_registry registry);
+extern bool obs_load_deferred_module_for(enum obs_type_registry registry,
+					 const char *id);
+extern void obs_free_deferred_modules(void);
+
+/* ------------------------------------------------------------------------- */
+/* file watching */
+
+struct obs_file_watcher;
+
+extern bool obs_init_file_watcher(void);
+extern void obs_stop_file_watcher(void);
+extern void obs_free_file_watcher(void);
+
+/* ------------------------------------------------------------------------- */
+
 struct obs_module_path {
 	char *bin;
 	char *data;
@@ -243,16 +278,46 @@ struct obs_task_info {
 	void *param;
 };
 
+/* a staged output frame, mapped and handed to the readback thread once the
+ * GPU has finished copying it */
+struct obs_readback_slot {
+	struct video_data frame;
+	int count;
+	uint64_t stage_ts;
+	bool mapped;
+	os_event_t *done;
+};
+
+struct obs_video_rendition {
+	video_t *video;
+	uint32_t width;
+	uint32_t height;
+
+	gs_texture_t *output_texture;
+	gs_texture_t *convert_textures[NUM_CHANNELS];
+	float conversion_width_i;
+
+	/* read back through the same ring and thread as the main output */
+	gs_stagesurf_t *copy_surfaces[MAX_READBACK_DEPTH][NUM_CHANNELS];
+	bool textures_copied[MAX_READBACK_DEPTH];
+	struct obs_readback_slot readback_slots[MAX_READBACK_DEPTH];
+	int readback_head;
+	struct circlebuf vframe_info_buffer;
+
+	bool was_active;
+};
+
 struct obs_core_video {
 	graphics_t *graphics;
-	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *copy_surfaces[MAX_READBACK_DEPTH][NUM_CHANNELS];
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
 	gs_texture_t *convert_textures[NUM_CHANNELS];
 	bool texture_rendered;
-	bool textures_copied[NUM_TEXTURES];
+	bool textures_copied[MAX_READBACK_DEPTH];
 	bool texture_converted;
 	bool using_nv12_tex;
+	bool using_nv12_planes;
 	struct circlebuf vframe_info_buffer;
 	struct circlebuf vframe_info_buffer_gpu;
 	gs_effect_t *default_effect;
@@ -267,7 +332,6 @@ struct obs_core_video {
 	gs_effect_t *bilinear_lowres_effect;
 	gs_effect_t *premultiplied_alpha_effect;
 	gs_samplerstate_t *point_sampler;
-	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
 	int cur_texture;
 	long raw_active;
 	long gpu_encoder_active;
@@ -281,9 +345,25 @@ struct obs_core_video {
 	bool gpu_encode_thread_initialized;
 	volatile bool gpu_encode_stop;
 
+	struct obs_readback_slot readback_slots[MAX_READBACK_DEPTH];
+	int readback_depth;
+	int readback_head;
+	int requested_readback_depth;
+	pthread_mutex_t readback_mutex;
+	struct circlebuf readback_queue;
+	os_sem_t *readback_sem;
+	pthread_t readback_thread;
+	bool readback_thread_initialized;
+	volatile bool readback_stop;
+	uint64_t readback_latency_total;
+	uint32_t readback_frames;
+	uint32_t readback_stalls;
+	struct histogram readback_latency;
+
 	uint64_t video_time;
 	uint64_t video_frame_interval_ns;
 	uint64_t video_avg_frame_time_ns;
+	struct histogram render_latency;
 	double video_fps;
 	video_t *video;
 	pthread_t video_thread;
@@ -318,6 +398,16 @@ struct obs_core_video {
 
 	pthread_mutex_t task_mutex;
 	struct circlebuf tasks;
+
+	pthread_mutex_t renditions_mutex;
+	DARRAY(struct obs_video_rendition *) renditions;
+
+	/* see obs-screenshot.c, only pending is shared with other threads */
+	pthread_mutex_t screenshots_mutex;
+	DARRAY(struct obs_screenshot *) screenshots_pending;
+	DARRAY(struct obs_screenshot *) screenshots_staged;
+	DARRAY(struct screenshot_surface *) screenshot_surfaces;
+	uint64_t screenshot_frame;
 };
 
 struct audio_monitor;
@@ -334,6 +424,7 @@ struct obs_core_audio {
 	int total_buffering_ticks;
 
 	float user_volume;
+	struct histogram callback_latency;
 
 	pthread_mutex_t monitoring_mutex;
 	DARRAY(struct audio_monitor *) monitors;
@@ -366,9 +457,26 @@ struct obs_core_data {
 
 	obs_data_t *private_data;
 
+	bool lazy_source_loading;
+	volatile long pending_creates;
+
+	/* time-to-first-frame tracking for obs_load_sources */
+	uint64_t load_start_ns;
+	volatile bool load_in_progress;
+	bool load_frame_ready;
+
 	volatile bool valid;
 };
 
+/* threads for OBS_TASK_WORKER tasks */
+struct obs_core_workers {
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	struct circlebuf tasks;
+	DARRAY(pthread_t) threads;
+	bool running;
+};
+
 /* user hotkeys */
 struct obs_core_hotkeys {
 	pthread_mutex_t mutex;
@@ -404,8 +512,20 @@ struct obs_core_hotkeys {
 	char *sceneitem_hide;
 };
 
+/* runs task once for each element of array on the worker threads, and waits
+ * for all of them to finish */
+extern void obs_run_worker_tasks(obs_task_t task, void *array,
+				 size_t element_size, size_t count);
+
 struct obs_core {
 	struct obs_module *first_module;
+	struct obs_module_manifest *deferred_modules;
+	struct obs_file_watcher *file_watcher;
+	pthread_mutex_t deferred_modules_mutex;
+	volatile bool deferred_modules_pending;
+	volatile bool deferred_modules_queued;
+	pthread_t module_thread;
+	bool modules_post_loaded;
 	DARRAY(struct obs_module_path) module_paths;
 
 	DARRAY(struct obs_source_info) source_types;
@@ -432,6 +552,7 @@ struct obs_core {
 	struct obs_core_audio audio;
 	struct obs_core_data data;
 	struct obs_core_hotkeys hotkeys;
+	struct obs_core_workers workers;
 
 	obs_task_handler_t ui_task_handler;
 };
@@ -444,16 +565,18 @@ struct obs_graphics_context {
 	uint64_t frame_time_total_ns;
 	uint64_t fps_total_ns;
 	uint32_t fps_total_frames;
-#ifdef _WIN32
 	bool gpu_was_active;
-#endif
 	bool raw_was_active;
 	bool was_active;
 	const char *video_thread_name;
 };
 
 extern void *obs_graphics_thread(void *param);
+extern void *obs_video_readback_thread(void *param);
 extern bool obs_graphics_thread_loop(struct obs_graphics_context *context);
+
+extern void obs_render_screenshots(void);
+extern void obs_free_screenshots(void);
 #ifdef __APPLE__
 extern void *obs_graphics_thread_autorelease(void *param);
 extern bool
@@ -475,6 +598,9 @@ extern void stop_raw_video(video_t *video,
 					    struct video_data *frame),
 			   void *param);
 
+extern void obs_get_latency_stats(const struct histogram *histogram,
+				  struct obs_latency_stats *stats);
+
 /* ------------------------------------------------------------------------- */
 /* obs shared context data */
 
@@ -589,6 +715,11 @@ struct audio_cb_info {
 	void *param;
 };
 
+struct audio_levels_cb_info {
+	obs_source_audio_levels_t callback;
+	void *param;
+};
+
 struct caption_cb_info {
 	obs_source_caption_t callback;
 	void *param;
@@ -610,6 +741,13 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* lazy/parallel creation: the create callback result is stored in
+	 * pending_data and published to context.data in the video thread */
+	volatile long create_state;
+	void *pending_data;
+	volatile bool load_pending;
+	bool load_done;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -667,6 +805,14 @@ struct obs_source {
 	pthread_mutex_t audio_cb_mutex;
 	DARRAY(struct audio_cb_info) audio_cb_list;
 	struct obs_audio_data audio_data;
+
+	/* shared audio levels, see obs-audio-controls.c */
+	DARRAY(struct audio_levels_cb_info) audio_levels_cb_list;
+	volatile long audio_levels_refs;
+	volatile long audio_levels_seq;
+	struct obs_audio_levels audio_levels;
+	float audio_levels_prev_samples[MAX_AUDIO_CHANNELS][4];
+
 	size_t audio_storage_size;
 	uint32_t audio_mixers;
 	float user_volume;
@@ -798,7 +944,19 @@ extern obs_source_t *obs_source_create_set_last_ver(const char *id,
 						    const char *name,
 						    obs_data_t *settings,
 						    obs_data_t *hotkey_data,
-						    uint32_t last_obs_ver);
+						    uint32_t last_obs_ver,
+						    bool deferred);
+
+enum obs_source_create_state {
+	OBS_SOURCE_CREATED,
+	OBS_SOURCE_CREATE_DEFERRED,
+	OBS_SOURCE_CREATE_QUEUED,
+	OBS_SOURCE_CREATE_FINISHED,
+};
+
+extern bool obs_source_queue_deferred_create(obs_source_t *source);
+extern void obs_source_create_deferred_data(obs_source_t *source);
+extern bool obs_source_publish_deferred_data(obs_source_t *source);
 extern void obs_source_destroy(struct obs_source *source);
 
 enum view_type {
@@ -858,6 +1016,8 @@ extern void obs_source_video_tick(obs_source_t *source, float seconds);
 extern float obs_source_get_target_volume(obs_source_t *source,
 					  obs_source_t *target);
 
+extern void obs_source_meter_audio(obs_source_t *source,
+				   const struct audio_data *data, bool muted);
 extern void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 				    size_t channels, size_t sample_rate,
 				    size_t size);
@@ -964,6 +1124,9 @@ struct obs_output {
 
 	int total_frames;
 
+	struct histogram interleave_latency;
+	struct histogram send_latency;
+
 	volatile bool active;
 	volatile bool paused;
 	video_t *video;
@@ -1041,6 +1204,18 @@ extern void obs_output_remove_encoder(struct obs_output *output,
 extern void
 obs_encoder_packet_create_instance(struct encoder_packet *dst,
 				   const struct encoder_packet *src);
+
+/* precedes the payload of every packet instance */
+struct obs_packet_header {
+	volatile long refs;
+	uint32_t size_class;
+	size_t size;
+};
+
+extern struct obs_packet_header *obs_packet_pool_alloc(size_t payload_size);
+extern void obs_packet_pool_free(struct obs_packet_header *header);
+extern void obs_packet_pool_trim(void);
+
 void obs_output_destroy(obs_output_t *output);
 
 /* ------------------------------------------------------------------------- */
@@ -1119,6 +1294,7 @@ struct obs_encoder {
 	struct pause_data pause;
 
 	const char *profile_encoder_encode_name;
+	struct histogram encode_latency;
 	char *last_error_message;
 
 	/* reconfigure encoder at next possible opportunity */
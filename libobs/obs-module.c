@@ -18,10 +18,24 @@
 #include "util/platform.h"
 #include "util/dstr.h"
 
+#include <sys/stat.h>
+
 #include "obs-defs.h"
 #include "obs-internal.h"
 #include "obs-module.h"
 
+/* cached list of the types a module registers, see obs_load_all_modules */
+struct obs_module_manifest {
+	char *bin_path;
+	char *data_path;
+	int64_t mtime;
+	int64_t size;
+	bool deferrable;
+	DARRAY(char *) ids[OBS_REGISTRY_COUNT];
+
+	struct obs_module_manifest *next;
+};
+
 extern const char *get_module_extension(void);
 
 static inline int req_func_not_found(const char *name, const char *path)
@@ -56,6 +70,7 @@ static int load_module_exports(struct obs_module *mod, const char *path)
 	mod->description = os_dlsym(mod->module, "obs_module_description");
 	mod->author = os_dlsym(mod->module, "obs_module_author");
 	mod->get_string = os_dlsym(mod->module, "obs_module_get_string");
+	mod->deferrable = os_dlsym(mod->module, "obs_module_deferrable");
 	return MODULE_SUCCESS;
 }
 
@@ -177,6 +192,19 @@ void obs_log_loaded_modules(void)
 
 	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
 		blog(LOG_INFO, "    %s", mod->file);
+
+	pthread_mutex_lock(&obs->deferred_modules_mutex);
+
+	if (obs->deferred_modules)
+		blog(LOG_INFO, "  Deferred Modules:");
+
+	for (struct obs_module_manifest *manifest = obs->deferred_modules;
+	     !!manifest; manifest = manifest->next) {
+		const char *file = strrchr(manifest->bin_path, '/');
+		blog(LOG_INFO, "    %s", file ? file + 1 : manifest->bin_path);
+	}
+
+	pthread_mutex_unlock(&obs->deferred_modules_mutex);
 }
 
 const char *obs_get_module_file_name(obs_module_t *module)
@@ -209,7 +237,7 @@ const char *obs_get_module_data_path(obs_module_t *module)
 	return module ? module->data_path : NULL;
 }
 
-obs_module_t *obs_get_module(const char *name)
+static obs_module_t *find_module(const char *name)
 {
 	obs_module_t *module = obs->first_module;
 	while (module) {
@@ -223,6 +251,18 @@ obs_module_t *obs_get_module(const char *name)
 	return NULL;
 }
 
+static bool load_deferred_by_name(const char *name);
+
+obs_module_t *obs_get_module(const char *name)
+{
+	obs_module_t *module = find_module(name);
+
+	if (!module && load_deferred_by_name(name))
+		module = find_module(name);
+
+	return module;
+}
+
 void *obs_get_module_lib(obs_module_t *module)
 {
 	return module ? module->module : NULL;
@@ -274,24 +314,581 @@ void obs_add_module_path(const char *bin, const char *data)
 	da_push_back(obs->module_paths, &omp);
 }
 
-static void load_all_callback(void *param, const struct obs_module_info *info)
+/* ------------------------------------------------------------------------- */
+/* Module manifest
+ *
+ * The ids of the types each module registers are cached in the module config
+ * directory, keyed by the size and modification time of the module binary.
+ * Modules that use OBS_MODULE_DEFERRABLE() and have an up to date entry are
+ * not loaded at startup, but once one of their types is first looked up or
+ * enumerated. */
+
+#define MANIFEST_FILE "module-manifest.json"
+
+static const char *registry_names[OBS_REGISTRY_COUNT] = {
+	"inputs", "filters", "transitions", "outputs", "encoders", "services",
+};
+
+struct module_candidate {
+	char *bin_path;
+	char *data_path;
+	int64_t mtime;
+	int64_t size;
+	bool is_plugin;
+
+	struct obs_module_manifest *entry;
+	bool record_types;
+	bool defer;
+};
+
+static void free_manifest(struct obs_module_manifest *manifest)
+{
+	for (size_t i = 0; i < OBS_REGISTRY_COUNT; i++) {
+		for (size_t j = 0; j < manifest->ids[i].num; j++)
+			bfree(manifest->ids[i].array[j]);
+		da_free(manifest->ids[i]);
+	}
+
+	bfree(manifest->bin_path);
+	bfree(manifest->data_path);
+	bfree(manifest);
+}
+
+static void free_manifest_list(struct obs_module_manifest *manifest)
+{
+	while (manifest) {
+		struct obs_module_manifest *next = manifest->next;
+		free_manifest(manifest);
+		manifest = next;
+	}
+}
+
+static char *get_manifest_path(void)
+{
+	struct dstr path = {0};
+
+	if (!obs->module_config_path)
+		return NULL;
+
+	dstr_copy(&path, obs->module_config_path);
+	if (!dstr_is_empty(&path) && dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	dstr_cat(&path, MANIFEST_FILE);
+	return path.array;
+}
+
+static struct obs_module_manifest *read_manifest(const char *path)
 {
+	struct obs_module_manifest *first = NULL;
+	struct obs_module_manifest **last = &first;
+	obs_data_array_t *modules;
+	obs_data_t *data;
+
+	data = path ? obs_data_create_from_json_file(path) : NULL;
+	if (!data)
+		return NULL;
+
+	/* type ids can change with the libobs API, just rebuild it then */
+	if (obs_data_get_int(data, "version") != LIBOBS_API_VER) {
+		obs_data_release(data);
+		return NULL;
+	}
+
+	modules = obs_data_get_array(data, "modules");
+
+	for (size_t i = 0; i < obs_data_array_count(modules); i++) {
+		obs_data_t *item = obs_data_array_item(modules, i);
+		struct obs_module_manifest *manifest =
+			bzalloc(sizeof(*manifest));
+
+		manifest->bin_path = bstrdup(obs_data_get_string(item, "path"));
+		manifest->mtime = obs_data_get_int(item, "mtime");
+		manifest->size = obs_data_get_int(item, "size");
+		manifest->deferrable = obs_data_get_bool(item, "deferrable");
+
+		for (size_t j = 0; j < OBS_REGISTRY_COUNT; j++) {
+			obs_data_array_t *ids =
+				obs_data_get_array(item, registry_names[j]);
+
+			for (size_t k = 0; k < obs_data_array_count(ids); k++) {
+				obs_data_t *id = obs_data_array_item(ids, k);
+				char *str =
+					bstrdup(obs_data_get_string(id, "id"));
+				da_push_back(manifest->ids[j], &str);
+				obs_data_release(id);
+			}
+
+			obs_data_array_release(ids);
+		}
+
+		*last = manifest;
+		last = &manifest->next;
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(modules);
+	obs_data_release(data);
+	return first;
+}
+
+static void write_manifest(const char *path,
+			   struct obs_module_manifest *manifest)
+{
+	obs_data_array_t *modules = obs_data_array_create();
+	obs_data_t *data = obs_data_create();
+
+	for (; manifest; manifest = manifest->next) {
+		obs_data_t *item = obs_data_create();
+
+		obs_data_set_string(item, "path", manifest->bin_path);
+		obs_data_set_int(item, "mtime", manifest->mtime);
+		obs_data_set_int(item, "size", manifest->size);
+		obs_data_set_bool(item, "deferrable", manifest->deferrable);
+
+		for (size_t i = 0; i < OBS_REGISTRY_COUNT; i++) {
+			obs_data_array_t *ids = obs_data_array_create();
+
+			for (size_t j = 0; j < manifest->ids[i].num; j++) {
+				obs_data_t *id = obs_data_create();
+				obs_data_set_string(id, "id",
+						    manifest->ids[i].array[j]);
+				obs_data_array_push_back(ids, id);
+				obs_data_release(id);
+			}
+
+			obs_data_set_array(item, registry_names[i], ids);
+			obs_data_array_release(ids);
+		}
+
+		obs_data_array_push_back(modules, item);
+		obs_data_release(item);
+	}
+
+	obs_data_set_int(data, "version", LIBOBS_API_VER);
+	obs_data_set_array(data, "modules", modules);
+
+	os_mkdirs(obs->module_config_path);
+	if (!obs_data_save_json_safe(data, path, "tmp", NULL))
+		blog(LOG_WARNING, "Failed to save module manifest '%s'", path);
+
+	obs_data_array_release(modules);
+	obs_data_release(data);
+}
+
+static struct obs_module_manifest *
+take_manifest(struct obs_module_manifest **list, const char *bin_path)
+{
+	for (; *list; list = &(*list)->next) {
+		struct obs_module_manifest *manifest = *list;
+
+		if (strcmp(manifest->bin_path, bin_path) == 0) {
+			*list = manifest->next;
+			manifest->next = NULL;
+			return manifest;
+		}
+	}
+
+	return NULL;
+}
+
+static inline struct obs_source_info *
+registry_source_types(enum obs_type_registry registry)
+{
+	switch (registry) {
+	case OBS_REGISTRY_INPUTS:
+		return obs->input_types.array;
+	case OBS_REGISTRY_FILTERS:
+		return obs->filter_types.array;
+	case OBS_REGISTRY_TRANSITIONS:
+		return obs->transition_types.array;
+	default:
+		return NULL;
+	}
+}
+
+static inline size_t registry_count(enum obs_type_registry registry)
+{
+	switch (registry) {
+	case OBS_REGISTRY_INPUTS:
+		return obs->input_types.num;
+	case OBS_REGISTRY_FILTERS:
+		return obs->filter_types.num;
+	case OBS_REGISTRY_TRANSITIONS:
+		return obs->transition_types.num;
+	case OBS_REGISTRY_OUTPUTS:
+		return obs->output_types.num;
+	case OBS_REGISTRY_ENCODERS:
+		return obs->encoder_types.num;
+	case OBS_REGISTRY_SERVICES:
+		return obs->service_types.num;
+	case OBS_REGISTRY_COUNT:
+		break;
+	}
+
+	return 0;
+}
+
+static inline const char *registry_id(enum obs_type_registry registry,
+				      size_t idx)
+{
+	switch (registry) {
+	case OBS_REGISTRY_INPUTS:
+	case OBS_REGISTRY_FILTERS:
+	case OBS_REGISTRY_TRANSITIONS:
+		return registry_source_types(registry)[idx].id;
+	case OBS_REGISTRY_OUTPUTS:
+		return obs->output_types.array[idx].id;
+	case OBS_REGISTRY_ENCODERS:
+		return obs->encoder_types.array[idx].id;
+	case OBS_REGISTRY_SERVICES:
+		return obs->service_types.array[idx].id;
+	case OBS_REGISTRY_COUNT:
+		break;
+	}
+
+	return NULL;
+}
+
+static void push_id(struct obs_module_manifest *manifest,
+		    enum obs_type_registry registry, const char *id)
+{
+	char *str = bstrdup(id);
+	da_push_back(manifest->ids[registry], &str);
+}
+
+/* set while a module registers its types, so that the duplicate checks done
+ * by registration don't pull in other deferred modules */
+static THREAD_LOCAL bool initializing_module = false;
+
+static obs_module_t *load_module(const char *bin_path, const char *data_path,
+				 struct obs_module_manifest *manifest)
+{
+	size_t start[OBS_REGISTRY_COUNT];
 	obs_module_t *module;
+	const char *file;
+	const char *profile_name;
+	bool was_initializing = initializing_module;
+	int code;
 
-	if (!os_is_obs_plugin(info->bin_path))
-		blog(LOG_WARNING, "Skipping module '%s', not an OBS plugin",
-		     info->bin_path);
+	file = strrchr(bin_path, '/');
+	file = file ? file + 1 : bin_path;
 
-	int code = obs_open_module(&module, info->bin_path, info->data_path);
+	profile_name = profile_store_name(obs_get_profiler_name_store(),
+					  "obs_load_module(%s)", file);
+	profile_start(profile_name);
+
+	code = obs_open_module(&module, bin_path, data_path);
 	if (code != MODULE_SUCCESS) {
 		blog(LOG_DEBUG, "Failed to load module file '%s': %d",
-		     info->bin_path, code);
-		return;
+		     bin_path, code);
+		profile_end(profile_name);
+		return NULL;
 	}
 
+	for (size_t i = 0; i < OBS_REGISTRY_COUNT; i++)
+		start[i] = registry_count(i);
+
+	initializing_module = true;
 	obs_init_module(module);
+	initializing_module = was_initializing;
+
+	if (manifest) {
+		for (size_t i = 0; i < OBS_REGISTRY_COUNT; i++) {
+			for (size_t j = start[i]; j < registry_count(i); j++)
+				push_id(manifest, i, registry_id(i, j));
+		}
+
+		/* versioned sources are also looked up by unversioned id */
+		for (size_t i = 0; i <= OBS_REGISTRY_TRANSITIONS; i++) {
+			struct obs_source_info *types =
+				registry_source_types(i);
+
+			for (size_t j = start[i]; j < registry_count(i); j++) {
+				if (strcmp(types[j].id,
+					   types[j].unversioned_id) != 0)
+					push_id(manifest, i,
+						types[j].unversioned_id);
+			}
+		}
+
+		manifest->deferrable = module->loaded && module->deferrable &&
+				       module->deferrable();
+	}
+
+	profile_end(profile_name);
+	return module;
+}
+
+static bool manifest_has_types(const struct obs_module_manifest *manifest)
+{
+	for (size_t i = 0; i < OBS_REGISTRY_COUNT; i++) {
+		if (manifest->ids[i].num)
+			return true;
+	}
+
+	return false;
+}
+
+static void defer_module(const struct obs_module_manifest *entry,
+			 const char *data_path)
+{
+	struct obs_module_manifest *deferred = bzalloc(sizeof(*deferred));
+
+	deferred->bin_path = bstrdup(entry->bin_path);
+	deferred->data_path = bstrdup(data_path);
+
+	for (size_t i = 0; i < OBS_REGISTRY_COUNT; i++) {
+		for (size_t j = 0; j < entry->ids[i].num; j++)
+			push_id(deferred, i, entry->ids[i].array[j]);
+	}
+
+	deferred->next = obs->deferred_modules;
+	obs->deferred_modules = deferred;
+	os_atomic_set_bool(&obs->deferred_modules_pending, true);
+
+	blog(LOG_DEBUG, "Deferring module '%s'", entry->bin_path);
+}
+
+static void load_deferred(struct obs_module_manifest *manifest)
+{
+	uint64_t start = os_gettime_ns();
+	obs_module_t *module;
 
+	module = load_module(manifest->bin_path, manifest->data_path, NULL);
+
+	if (module && obs->modules_post_loaded && module->post_load)
+		module->post_load();
+
+	blog(LOG_INFO, "Loaded deferred module '%s' in %.1f ms",
+	     manifest->bin_path,
+	     (double)(os_gettime_ns() - start) / 1000000.0);
+
+	free_manifest(manifest);
+}
+
+static inline bool in_registry(enum obs_type_registry registry,
+			       enum obs_type_registry requested)
+{
+	return registry == requested ||
+	       (requested == OBS_REGISTRY_ANY_SOURCE &&
+		registry <= OBS_REGISTRY_TRANSITIONS);
+}
+
+static bool has_type(const struct obs_module_manifest *manifest,
+		     enum obs_type_registry requested, const char *id)
+{
+	for (size_t i = 0; i < OBS_REGISTRY_COUNT; i++) {
+		if (!in_registry(i, requested))
+			continue;
+
+		for (size_t j = 0; j < manifest->ids[i].num; j++) {
+			if (!id || strcmp(manifest->ids[i].array[j], id) == 0)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static struct obs_module_manifest *
+take_deferred(enum obs_type_registry registry, const char *id)
+{
+	struct obs_module_manifest **list = &obs->deferred_modules;
+
+	for (; *list; list = &(*list)->next) {
+		struct obs_module_manifest *manifest = *list;
+
+		if (has_type(manifest, registry, id)) {
+			*list = manifest->next;
+			return manifest;
+		}
+	}
+
+	return NULL;
+}
+
+static struct obs_module_manifest *take_deferred_by_name(const char *name)
+{
+	struct obs_module_manifest **list = &obs->deferred_modules;
+
+	for (; *list; list = &(*list)->next) {
+		struct obs_module_manifest *manifest = *list;
+		const char *file = strrchr(manifest->bin_path, '/');
+		char *mod_name;
+		bool match;
+
+		mod_name = get_module_name(file ? file + 1
+						: manifest->bin_path);
+		match = strcmp(mod_name, name) == 0;
+		bfree(mod_name);
+
+		if (match) {
+			*list = manifest->next;
+			return manifest;
+		}
+	}
+
+	return NULL;
+}
+
+struct deferred_load {
+	enum obs_type_registry registry;
+	const char *id;
+	const char *name;
+	bool all;
+	bool loaded;
+};
+
+static void deferred_load_task(void *param)
+{
+	struct deferred_load *load = param;
+	struct obs_module_manifest *manifest;
+
+	if (initializing_module)
+		return;
+
+	pthread_mutex_lock(&obs->deferred_modules_mutex);
+
+	for (;;) {
+		manifest = load->name ? take_deferred_by_name(load->name)
+				      : take_deferred(load->registry, load->id);
+		if (!manifest)
+			break;
+
+		load_deferred(manifest);
+		load->loaded = true;
+
+		if (!load->all)
+			break;
+	}
+
+	os_atomic_set_bool(&obs->deferred_modules_pending,
+			   obs->deferred_modules != NULL);
+	pthread_mutex_unlock(&obs->deferred_modules_mutex);
+}
+
+static void deferred_load_all_task(void *param)
+{
 	UNUSED_PARAMETER(param);
+
+	if (!obs)
+		return;
+
+	pthread_mutex_lock(&obs->deferred_modules_mutex);
+
+	while (obs->deferred_modules) {
+		struct obs_module_manifest *manifest = obs->deferred_modules;
+
+		obs->deferred_modules = manifest->next;
+		load_deferred(manifest);
+	}
+
+	os_atomic_set_bool(&obs->deferred_modules_pending, false);
+	os_atomic_set_bool(&obs->deferred_modules_queued, false);
+	pthread_mutex_unlock(&obs->deferred_modules_mutex);
+}
+
+/* Loading a module adds to the type registries, which aren't locked, so like
+ * at startup modules are only ever loaded on the thread that called
+ * obs_load_all_modules (the UI thread).
+ *
+ * Lookups on other threads can't wait for the UI thread, as they may hold
+ * locks the UI thread is waiting on (tick callbacks, scene locks, worker
+ * tasks).  They fail instead, and every deferred module is loaded on the UI
+ * thread as soon as it gets to it. */
+static bool run_deferred_load(struct deferred_load *load)
+{
+	if (!obs || !os_atomic_load_bool(&obs->deferred_modules_pending))
+		return false;
+
+	if (pthread_equal(pthread_self(), obs->module_thread)) {
+		deferred_load_task(load);
+		return load->loaded;
+	}
+
+	if (!os_atomic_set_bool(&obs->deferred_modules_queued, true))
+		obs_queue_task(OBS_TASK_UI, deferred_load_all_task, NULL,
+			       false);
+	return false;
+}
+
+bool obs_load_deferred_module_for(enum obs_type_registry registry,
+				  const char *id)
+{
+	struct deferred_load load = {.registry = registry, .id = id};
+
+	return id && run_deferred_load(&load);
+}
+
+void obs_load_deferred_modules(enum obs_type_registry registry)
+{
+	struct deferred_load load = {.registry = registry, .all = true};
+
+	run_deferred_load(&load);
+}
+
+static bool load_deferred_by_name(const char *name)
+{
+	struct deferred_load load = {.name = name};
+
+	return run_deferred_load(&load);
+}
+
+void obs_free_deferred_modules(void)
+{
+	free_manifest_list(obs->deferred_modules);
+	obs->deferred_modules = NULL;
+	os_atomic_set_bool(&obs->deferred_modules_pending, false);
+}
+
+static void find_module_callback(void *param,
+				 const struct obs_module_info *info)
+{
+	struct darray *candidates = param;
+	struct module_candidate candidate = {
+		.bin_path = bstrdup(info->bin_path),
+		.data_path = bstrdup(info->data_path),
+	};
+
+	darray_push_back(sizeof(candidate), candidates, &candidate);
+}
+
+static void check_module_candidate(void *param)
+{
+	struct module_candidate *candidate = param;
+	struct stat st;
+
+	candidate->is_plugin = os_is_obs_plugin(candidate->bin_path);
+
+	if (os_stat(candidate->bin_path, &st) == 0) {
+		candidate->mtime = (int64_t)st.st_mtime;
+		candidate->size = (int64_t)st.st_size;
+	}
+}
+
+#define PREFETCH_CHUNK_SIZE (1024 * 1024)
+
+/* reads the whole binary of a module that's about to be loaded, so that
+ * loading the modules one at a time afterwards doesn't wait on the disk */
+static void prefetch_module_candidate(void *param)
+{
+	struct module_candidate *candidate = param;
+	uint8_t *buf;
+	FILE *file;
+
+	if (candidate->defer)
+		return;
+
+	file = os_fopen(candidate->bin_path, "rb");
+	if (!file)
+		return;
+
+	buf = bmalloc(PREFETCH_CHUNK_SIZE);
+	while (fread(buf, 1, PREFETCH_CHUNK_SIZE, file) == PREFETCH_CHUNK_SIZE)
+		;
+
+	bfree(buf);
+	fclose(file);
 }
 
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
@@ -301,8 +898,96 @@ static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 
 void obs_load_all_modules(void)
 {
+	DARRAY(struct module_candidate) candidates;
+	struct obs_module_manifest *old_manifest;
+	struct obs_module_manifest *manifest = NULL;
+	struct obs_module_manifest **last = &manifest;
+	char *manifest_path;
+	bool changed = false;
+
+	/* deferred modules are loaded by the UI thread, so without a UI task
+	 * handler every module is loaded now */
+	bool can_defer = obs->ui_task_handler != NULL;
+	obs->module_thread = pthread_self();
+
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules(load_all_callback, NULL);
+
+	da_init(candidates);
+	obs_find_modules(find_module_callback, &candidates.da);
+
+	/* checking binaries can mean reading them, so do that in parallel */
+	obs_run_worker_tasks(check_module_candidate, candidates.array,
+			     sizeof(struct module_candidate), candidates.num);
+
+	manifest_path = get_manifest_path();
+	old_manifest = read_manifest(manifest_path);
+
+	for (size_t i = 0; i < candidates.num; i++) {
+		struct module_candidate *candidate = &candidates.array[i];
+		struct obs_module_manifest *entry;
+
+		entry = take_manifest(&old_manifest, candidate->bin_path);
+		if (entry && (entry->mtime != candidate->mtime ||
+			      entry->size != candidate->size)) {
+			free_manifest(entry);
+			entry = NULL;
+		}
+
+		if (!entry) {
+			/* unknown or changed, load it and record its types */
+			entry = bzalloc(sizeof(*entry));
+			entry->bin_path = bstrdup(candidate->bin_path);
+			entry->mtime = candidate->mtime;
+			entry->size = candidate->size;
+			candidate->record_types = true;
+			changed = true;
+
+		} else if (can_defer && entry->deferrable &&
+			   manifest_has_types(entry)) {
+			candidate->defer = true;
+		}
+
+		candidate->entry = entry;
+		*last = entry;
+		last = &entry->next;
+	}
+
+	/* module init has to stay serial (see load_module), but reading the
+	 * binaries from disk doesn't */
+	obs_run_worker_tasks(prefetch_module_candidate, candidates.array,
+			     sizeof(struct module_candidate), candidates.num);
+
+	for (size_t i = 0; i < candidates.num; i++) {
+		struct module_candidate *candidate = &candidates.array[i];
+
+		if (!candidate->is_plugin)
+			blog(LOG_WARNING,
+			     "Skipping module '%s', not an OBS plugin",
+			     candidate->bin_path);
+
+		if (candidate->defer)
+			defer_module(candidate->entry, candidate->data_path);
+		else
+			load_module(candidate->bin_path, candidate->data_path,
+				    candidate->record_types ? candidate->entry
+							    : NULL);
+
+		bfree(candidate->bin_path);
+		bfree(candidate->data_path);
+	}
+
+	/* modules that were removed since the last run */
+	if (old_manifest)
+		changed = true;
+
+	if (changed && manifest_path)
+		write_manifest(manifest_path, manifest);
+
+	free_manifest_list(old_manifest);
+	free_manifest_list(manifest);
+	bfree(manifest_path);
+	da_free(candidates);
+
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -316,6 +1001,8 @@ void obs_post_load_modules(void)
 	for (obs_module_t *mod = obs->first_module; !!mod; mod = mod->next)
 		if (mod->post_load)
 			mod->post_load();
+
+	obs->modules_post_loaded = true;
 }
 
 static inline void make_data_dir(struct dstr *parsed_data_dir,
@@ -771,10 +1458,19 @@ void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 	CHECK_REQUIRED_VAL_(info, create, obs_register_encoder);
 	CHECK_REQUIRED_VAL_(info, destroy, obs_register_encoder);
 
-	if ((info->caps & OBS_ENCODER_CAP_PASS_TEXTURE) != 0)
-		CHECK_REQUIRED_VAL_(info, encode_texture, obs_register_encoder);
-	else
+	if ((info->caps & OBS_ENCODER_CAP_PASS_TEXTURE) != 0) {
+		bool has_texture2 =
+			offsetof(struct obs_encoder_info, encode_texture2) +
+					sizeof(info->encode_texture2) <=
+				size &&
+			info->encode_texture2;
+
+		if (!has_texture2)
+			CHECK_REQUIRED_VAL_(info, encode_texture,
+					    obs_register_encoder);
+	} else {
 		CHECK_REQUIRED_VAL_(info, encode, obs_register_encoder);
+	}
 
 	if (info->type == OBS_ENCODER_AUDIO)
 		CHECK_REQUIRED_VAL_(info, get_frame_size, obs_register_encoder);
@@ -100,6 +100,16 @@ MODULE_EXPORT void obs_module_unload(void);
 /** Optional: Called when all modules have finished loading */
 MODULE_EXPORT void obs_module_post_load(void);
 
+/**
+ * Optional: Use this macro in a module whose obs_module_load does nothing but
+ * register the same sources/outputs/encoders/services every time.  libobs may
+ * then skip loading the module at startup, and load it once one of its types
+ * is first used.
+ */
+#define OBS_MODULE_DEFERRABLE()                         \
+	MODULE_EXPORT bool obs_module_deferrable(void); \
+	bool obs_module_deferrable(void) { return true; }
+
 /** Called to set the current locale data for the module.  */
 MODULE_EXPORT void obs_module_set_locale(const char *locale);
 
@@ -54,7 +54,7 @@ static inline bool data_capture_ending(const struct obs_output *output)
 	return os_atomic_load_bool(&output->end_data_capture_thread_active);
 }
 
-const struct obs_output_info *find_output(const char *id)
+static const struct obs_output_info *find_output_type(const char *id)
 {
 	size_t i;
 	for (i = 0; i < obs->output_types.num; i++)
@@ -64,6 +64,15 @@ const struct obs_output_info *find_output(const char *id)
 	return NULL;
 }
 
+const struct obs_output_info *find_output(const char *id)
+{
+	const struct obs_output_info *info = find_output_type(id);
+
+	if (!info && obs_load_deferred_module_for(OBS_REGISTRY_OUTPUTS, id))
+		info = find_output_type(id);
+	return info;
+}
+
 const char *obs_output_get_display_name(const char *id)
 {
 	const struct obs_output_info *info = find_output(id);
@@ -955,6 +964,28 @@ int obs_output_get_total_frames(const obs_output_t *output)
 		       : 0;
 }
 
+void obs_output_get_interleave_latency(const obs_output_t *output,
+				       struct obs_latency_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_interleave_latency"))
+		return;
+	if (!obs_ptr_valid(stats, "obs_output_get_interleave_latency"))
+		return;
+
+	obs_get_latency_stats(&output->interleave_latency, stats);
+}
+
+void obs_output_get_send_latency(const obs_output_t *output,
+				 struct obs_latency_stats *stats)
+{
+	if (!obs_output_valid(output, "obs_output_get_send_latency"))
+		return;
+	if (!obs_ptr_valid(stats, "obs_output_get_send_latency"))
+		return;
+
+	obs_get_latency_stats(&output->send_latency, stats);
+}
+
 void obs_output_set_preferred_size(obs_output_t *output, uint32_t width,
 				   uint32_t height)
 {
@@ -1300,6 +1331,22 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	return true;
 }
 
+/* interleave latency is how long after its frame was captured a packet gets
+ * to the output, not counting the stream delay */
+static void send_encoded_packet(struct obs_output *output,
+				struct encoder_packet *packet)
+{
+	uint64_t send_start = os_gettime_ns();
+	int64_t age = (int64_t)(send_start - output->active_delay_ns) -
+		      packet->sys_dts_usec * 1000;
+
+	if (age > 0)
+		histogram_record(&output->interleave_latency, (uint64_t)age);
+
+	output->info.encoded_packet(output->context.data, packet);
+	histogram_record(&output->send_latency, os_gettime_ns() - send_start);
+}
+
 double last_caption_timestamp = 0;
 
 //void SendTestData(struct obs_output *output, uint8_t* data, size_t len) {
@@ -1376,7 +1423,7 @@ static inline void send_interleaved(struct obs_output *output)
 		pthread_mutex_unlock(&output->caption_mutex);
 	}
 
-	output->info.encoded_packet(output->context.data, &out);
+	send_encoded_packet(output, &out);
 	obs_encoder_packet_release(&out);
 }
 
@@ -1791,7 +1838,7 @@ static void default_encoded_callback(void *param, struct encoder_packet *packet)
 		if (packet->type == OBS_ENCODER_AUDIO)
 			packet->track_idx = get_track_index(output, packet);
 
-		output->info.encoded_packet(output->context.data, packet);
+		send_encoded_packet(output, packet);
 
 		if (packet->type == OBS_ENCODER_VIDEO)
 			output->total_frames++;
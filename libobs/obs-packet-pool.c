@@ -0,0 +1,207 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+/*
+ * Size-classed free lists for encoder packet payloads.
+ *
+ * Every packet instance used to be a fresh bmalloc of header + payload, and
+ * with several outputs holding on to packets for different lengths of time
+ * (interleaving, replay buffer, network send buffers) that churns the heap
+ * and fragments it over long sessions.  Freed blocks are instead kept on a
+ * per-class free list and handed out again.  Classes step by 1.5x/2x so a
+ * block wastes at most a third of its size: the smallest classes fit audio
+ * packets, the larger ones fit video packets up to 2 MiB.  Anything bigger
+ * is allocated directly.
+ */
+
+#define POOL_CACHE_BYTES (4 * 1024 * 1024)
+#define POOL_MIN_CACHED_BLOCKS 2
+#define POOL_LARGE_CLASS UINT32_MAX
+
+static const size_t class_sizes[] = {
+	384,     512,     768,     1024,    1536,    2048,    3072,
+	4096,    6144,    8192,    12288,   16384,   24576,   32768,
+	49152,   65536,   98304,   131072,  196608,  262144,  393216,
+	524288,  786432,  1048576, 1572864, 2097152,
+};
+
+#define NUM_CLASSES (sizeof(class_sizes) / sizeof(class_sizes[0]))
+
+struct pool_block {
+	struct pool_block *next;
+};
+
+struct pool_class {
+	pthread_mutex_t mutex;
+	struct pool_block *free_list;
+	size_t cached;
+
+	uint64_t live_packets;
+	uint64_t live_bytes;
+	uint64_t hits;
+	uint64_t misses;
+};
+
+/* the last entry tracks packets too large for any class */
+static struct pool_class classes[NUM_CLASSES + 1];
+static volatile bool classes_initialized = false;
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void init_classes(void)
+{
+	pthread_mutex_lock(&init_mutex);
+	if (!classes_initialized) {
+		for (size_t i = 0; i < NUM_CLASSES + 1; i++)
+			pthread_mutex_init(&classes[i].mutex, NULL);
+		os_atomic_set_bool(&classes_initialized, true);
+	}
+	pthread_mutex_unlock(&init_mutex);
+}
+
+static inline uint32_t find_class(size_t size)
+{
+	for (uint32_t i = 0; i < NUM_CLASSES; i++) {
+		if (size <= class_sizes[i])
+			return i;
+	}
+
+	return POOL_LARGE_CLASS;
+}
+
+static inline struct pool_class *get_class(uint32_t idx)
+{
+	return idx == POOL_LARGE_CLASS ? &classes[NUM_CLASSES] : &classes[idx];
+}
+
+static inline size_t class_cache_limit(uint32_t idx)
+{
+	size_t limit = POOL_CACHE_BYTES / class_sizes[idx];
+	return limit < POOL_MIN_CACHED_BLOCKS ? POOL_MIN_CACHED_BLOCKS : limit;
+}
+
+static inline size_t block_size(const struct obs_packet_header *header)
+{
+	return header->size_class == POOL_LARGE_CLASS
+		       ? header->size
+		       : class_sizes[header->size_class];
+}
+
+struct obs_packet_header *obs_packet_pool_alloc(size_t payload_size)
+{
+	size_t size = payload_size + sizeof(struct obs_packet_header);
+	uint32_t idx = find_class(size);
+	struct pool_class *pc;
+	struct obs_packet_header *header = NULL;
+	size_t alloc_size;
+
+	if (!os_atomic_load_bool(&classes_initialized))
+		init_classes();
+
+	pc = get_class(idx);
+	alloc_size = idx == POOL_LARGE_CLASS ? size : class_sizes[idx];
+
+	pthread_mutex_lock(&pc->mutex);
+	if (pc->free_list) {
+		header = (struct obs_packet_header *)pc->free_list;
+		pc->free_list = pc->free_list->next;
+		pc->cached--;
+		pc->hits++;
+	} else {
+		pc->misses++;
+	}
+	pc->live_packets++;
+	pc->live_bytes += alloc_size;
+	pthread_mutex_unlock(&pc->mutex);
+
+	if (!header)
+		header = bmalloc(alloc_size);
+
+	header->refs = 1;
+	header->size_class = idx;
+	header->size = size;
+	return header;
+}
+
+void obs_packet_pool_free(struct obs_packet_header *header)
+{
+	uint32_t idx = header->size_class;
+	struct pool_class *pc = get_class(idx);
+	bool cached = false;
+
+	pthread_mutex_lock(&pc->mutex);
+	pc->live_packets--;
+	pc->live_bytes -= block_size(header);
+
+	if (idx != POOL_LARGE_CLASS && pc->cached < class_cache_limit(idx)) {
+		struct pool_block *block = (struct pool_block *)header;
+		block->next = pc->free_list;
+		pc->free_list = block;
+		pc->cached++;
+		cached = true;
+	}
+	pthread_mutex_unlock(&pc->mutex);
+
+	if (!cached)
+		bfree(header);
+}
+
+void obs_packet_pool_trim(void)
+{
+	if (!os_atomic_load_bool(&classes_initialized))
+		return;
+
+	for (size_t i = 0; i < NUM_CLASSES; i++) {
+		struct pool_class *pc = &classes[i];
+		struct pool_block *block;
+
+		pthread_mutex_lock(&pc->mutex);
+		block = pc->free_list;
+		pc->free_list = NULL;
+		pc->cached = 0;
+		pthread_mutex_unlock(&pc->mutex);
+
+		while (block) {
+			struct pool_block *next = block->next;
+			bfree(block);
+			block = next;
+		}
+	}
+}
+
+void obs_encoder_get_packet_stats(struct obs_encoder_packet_stats *stats)
+{
+	if (!stats)
+		return;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!os_atomic_load_bool(&classes_initialized))
+		return;
+
+	for (size_t i = 0; i < NUM_CLASSES + 1; i++) {
+		struct pool_class *pc = &classes[i];
+
+		pthread_mutex_lock(&pc->mutex);
+		stats->live_packets += pc->live_packets;
+		stats->live_bytes += pc->live_bytes;
+		stats->pool_hits += pc->hits;
+		stats->pool_misses += pc->misses;
+		if (i < NUM_CLASSES)
+			stats->cached_bytes += pc->cached * class_sizes[i];
+		pthread_mutex_unlock(&pc->mutex);
+	}
+}
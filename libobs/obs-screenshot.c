@@ -0,0 +1,342 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+/*
+ * Source screenshots.
+ *
+ * Requests are queued from any thread and all rendered by the graphics thread
+ * during the next frame, each into a pooled texrender/stage surface pair of
+ * the requested size.  Stage surfaces are only mapped
+ * SCREENSHOT_READBACK_FRAMES frames later, once the GPU is done with the copy,
+ * so taking a screenshot never stalls rendering.  The pixels are then handed
+ * to the callback on a worker thread, where they can be encoded.
+ */
+
+#define SCREENSHOT_READBACK_FRAMES 2
+#define SCREENSHOT_SURFACE_IDLE_NS 10000000000ULL
+
+struct screenshot_surface {
+	uint32_t cx;
+	uint32_t cy;
+	gs_texrender_t *texrender;
+	gs_stagesurf_t *stagesurf;
+	uint64_t last_used;
+};
+
+struct obs_screenshot {
+	obs_source_t *source;
+	uint32_t cx;
+	uint32_t cy;
+
+	obs_source_screenshot_t callback;
+	void *param;
+
+	struct screenshot_surface *surface;
+	uint64_t staged_frame;
+
+	uint8_t *data;
+	uint32_t linesize;
+};
+
+static void screenshot_callback_task(void *param)
+{
+	struct obs_screenshot *ss = param;
+
+	ss->callback(ss->param, ss->data, ss->linesize, ss->cx, ss->cy);
+
+	obs_source_release(ss->source);
+	bfree(ss->data);
+	bfree(ss);
+}
+
+static inline void finish_screenshot(struct obs_screenshot *ss)
+{
+	obs_queue_task(OBS_TASK_WORKER, screenshot_callback_task, ss, false);
+}
+
+extern THREAD_LOCAL bool is_graphics_thread;
+
+static struct screenshot_surface *get_surface(struct obs_core_video *video,
+					      uint32_t cx, uint32_t cy)
+{
+	struct screenshot_surface *surface;
+
+	for (size_t i = 0; i < video->screenshot_surfaces.num; i++) {
+		surface = video->screenshot_surfaces.array[i];
+		if (surface->cx == cx && surface->cy == cy) {
+			da_erase(video->screenshot_surfaces, i);
+			return surface;
+		}
+	}
+
+	surface = bzalloc(sizeof(*surface));
+	surface->cx = cx;
+	surface->cy = cy;
+	surface->texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	surface->stagesurf = gs_stagesurface_create(cx, cy, GS_RGBA);
+	return surface;
+}
+
+static void destroy_surface(struct screenshot_surface *surface)
+{
+	gs_stagesurface_destroy(surface->stagesurf);
+	gs_texrender_destroy(surface->texrender);
+	bfree(surface);
+}
+
+static void release_surface(struct obs_core_video *video,
+			    struct screenshot_surface *surface)
+{
+	surface->last_used = os_gettime_ns();
+	da_push_back(video->screenshot_surfaces, &surface);
+}
+
+static void trim_surfaces(struct obs_core_video *video)
+{
+	uint64_t now = os_gettime_ns();
+
+	for (size_t i = video->screenshot_surfaces.num; i > 0; i--) {
+		struct screenshot_surface *surface =
+			video->screenshot_surfaces.array[i - 1];
+
+		if (now - surface->last_used < SCREENSHOT_SURFACE_IDLE_NS)
+			continue;
+
+		destroy_surface(surface);
+		da_erase(video->screenshot_surfaces, i - 1);
+	}
+}
+
+static bool render_screenshot(struct obs_core_video *video,
+			      struct obs_screenshot *ss)
+{
+	uint32_t source_cx = obs_source_get_base_width(ss->source);
+	uint32_t source_cy = obs_source_get_base_height(ss->source);
+	struct screenshot_surface *surface;
+	struct vec4 clear_color;
+
+	if (!source_cx || !source_cy)
+		return false;
+
+	if (!ss->cx || !ss->cy) {
+		ss->cx = source_cx;
+		ss->cy = source_cy;
+	}
+
+	surface = get_surface(video, ss->cx, ss->cy);
+	if (!surface->texrender || !surface->stagesurf) {
+		destroy_surface(surface);
+		return false;
+	}
+
+	gs_texrender_reset(surface->texrender);
+	if (!gs_texrender_begin(surface->texrender, ss->cx, ss->cy)) {
+		release_surface(video, surface);
+		return false;
+	}
+
+	vec4_zero(&clear_color);
+	gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+	gs_ortho(0.0f, (float)source_cx, 0.0f, (float)source_cy, -100.0f,
+		 100.0f);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	obs_source_inc_showing(ss->source);
+	obs_source_video_render(ss->source);
+	obs_source_dec_showing(ss->source);
+
+	gs_blend_state_pop();
+	gs_texrender_end(surface->texrender);
+
+	gs_stage_texture(surface->stagesurf,
+			 gs_texrender_get_texture(surface->texrender));
+
+	ss->surface = surface;
+	ss->staged_frame = video->screenshot_frame;
+	return true;
+}
+
+static void download_screenshot(struct obs_core_video *video,
+				struct obs_screenshot *ss)
+{
+	struct screenshot_surface *surface = ss->surface;
+	uint32_t linesize = ss->cx * 4;
+	uint8_t *data;
+	uint32_t surface_linesize;
+
+	if (gs_stagesurface_map(surface->stagesurf, &data, &surface_linesize)) {
+		ss->data = bmalloc((size_t)linesize * ss->cy);
+		ss->linesize = linesize;
+
+		if (linesize == surface_linesize) {
+			memcpy(ss->data, data, (size_t)linesize * ss->cy);
+		} else {
+			for (uint32_t y = 0; y < ss->cy; y++)
+				memcpy(ss->data + (size_t)y * linesize,
+				       data + (size_t)y * surface_linesize,
+				       linesize);
+		}
+
+		gs_stagesurface_unmap(surface->stagesurf);
+	}
+
+	ss->surface = NULL;
+	release_surface(video, surface);
+}
+
+static const char *render_screenshots_name = "render_screenshots";
+void obs_render_screenshots(void)
+{
+	struct obs_core_video *video = &obs->video;
+	DARRAY(struct obs_screenshot *) pending;
+	size_t ready = 0;
+
+	video->screenshot_frame++;
+
+	pthread_mutex_lock(&video->screenshots_mutex);
+	da_move(pending, video->screenshots_pending);
+	pthread_mutex_unlock(&video->screenshots_mutex);
+
+	if (!pending.num && !video->screenshots_staged.num &&
+	    !video->screenshot_surfaces.num)
+		return;
+
+	profile_start(render_screenshots_name);
+	gs_enter_context(video->graphics);
+
+	/* staged in order, so the ready ones are all at the front */
+	for (; ready < video->screenshots_staged.num; ready++) {
+		struct obs_screenshot *ss =
+			video->screenshots_staged.array[ready];
+
+		if (video->screenshot_frame - ss->staged_frame <
+		    SCREENSHOT_READBACK_FRAMES)
+			break;
+
+		download_screenshot(video, ss);
+		finish_screenshot(ss);
+	}
+
+	if (ready)
+		da_erase_range(video->screenshots_staged, 0, ready);
+
+	for (size_t i = 0; i < pending.num; i++) {
+		struct obs_screenshot *ss = pending.array[i];
+
+		if (render_screenshot(video, ss))
+			da_push_back(video->screenshots_staged, &ss);
+		else
+			finish_screenshot(ss);
+	}
+
+	trim_surfaces(video);
+
+	gs_leave_context();
+	profile_end(render_screenshots_name);
+
+	da_free(pending);
+}
+
+/* the graphics thread cannot wait for its own next frame, so render and map
+ * right away, stalling on the GPU like screenshots used to */
+static void take_screenshot_now(struct obs_screenshot *ss)
+{
+	struct obs_core_video *video = &obs->video;
+
+	gs_enter_context(video->graphics);
+	if (render_screenshot(video, ss))
+		download_screenshot(video, ss);
+	gs_leave_context();
+
+	screenshot_callback_task(ss);
+}
+
+/* called with the graphics thread stopped, fails anything still queued */
+void obs_free_screenshots(void)
+{
+	struct obs_core_video *video = &obs->video;
+	DARRAY(struct obs_screenshot *) pending;
+
+	pthread_mutex_lock(&video->screenshots_mutex);
+	da_move(pending, video->screenshots_pending);
+	pthread_mutex_unlock(&video->screenshots_mutex);
+
+	gs_enter_context(video->graphics);
+
+	for (size_t i = 0; i < video->screenshots_staged.num; i++) {
+		struct obs_screenshot *ss = video->screenshots_staged.array[i];
+
+		destroy_surface(ss->surface);
+		ss->surface = NULL;
+		finish_screenshot(ss);
+	}
+
+	for (size_t i = 0; i < video->screenshot_surfaces.num; i++)
+		destroy_surface(video->screenshot_surfaces.array[i]);
+
+	gs_leave_context();
+
+	for (size_t i = 0; i < pending.num; i++)
+		finish_screenshot(pending.array[i]);
+
+	da_free(pending);
+	da_free(video->screenshots_staged);
+	da_free(video->screenshot_surfaces);
+}
+
+bool obs_source_screenshot(obs_source_t *source, uint32_t cx, uint32_t cy,
+			   obs_source_screenshot_t callback, void *param)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_screenshot *ss;
+	bool success = false;
+
+	if (!obs_source_valid(source, "obs_source_screenshot"))
+		return false;
+	if (!obs_ptr_valid(callback, "obs_source_screenshot"))
+		return false;
+
+	ss = bzalloc(sizeof(*ss));
+	ss->source = obs_source_get_ref(source);
+	ss->cx = cx;
+	ss->cy = cy;
+	ss->callback = callback;
+	ss->param = param;
+
+	if (ss->source && is_graphics_thread) {
+		take_screenshot_now(ss);
+		return true;
+	}
+
+	if (ss->source) {
+		pthread_mutex_lock(&video->screenshots_mutex);
+		if (video->thread_initialized) {
+			da_push_back(video->screenshots_pending, &ss);
+			success = true;
+		}
+		pthread_mutex_unlock(&video->screenshots_mutex);
+	}
+
+	if (!success) {
+		obs_source_release(ss->source);
+		bfree(ss);
+	}
+
+	return success;
+}
@@ -17,7 +17,7 @@
 
 #include "obs-internal.h"
 
-const struct obs_service_info *find_service(const char *id)
+static const struct obs_service_info *find_service_type(const char *id)
 {
 	size_t i;
 	for (i = 0; i < obs->service_types.num; i++)
@@ -27,6 +27,15 @@ const struct obs_service_info *find_service(const char *id)
 	return NULL;
 }
 
+const struct obs_service_info *find_service(const char *id)
+{
+	const struct obs_service_info *info = find_service_type(id);
+
+	if (!info && obs_load_deferred_module_for(OBS_REGISTRY_SERVICES, id))
+		info = find_service_type(id);
+	return info;
+}
+
 const char *obs_service_get_display_name(const char *id)
 {
 	const struct obs_service_info *info = find_service(id);
@@ -43,7 +43,7 @@ static inline bool deinterlacing_enabled(const struct obs_source *source)
 	return source->deinterlace_mode != OBS_DEINTERLACE_MODE_DISABLE;
 }
 
-struct obs_source_info *get_source_info(const char *id)
+static struct obs_source_info *find_source_info(const char *id)
 {
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
@@ -54,8 +54,8 @@ struct obs_source_info *get_source_info(const char *id)
 	return NULL;
 }
 
-struct obs_source_info *get_source_info2(const char *unversioned_id,
-					 uint32_t ver)
+static struct obs_source_info *find_source_info2(const char *unversioned_id,
+						 uint32_t ver)
 {
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
@@ -67,6 +67,26 @@ struct obs_source_info *get_source_info2(const char *unversioned_id,
 	return NULL;
 }
 
+struct obs_source_info *get_source_info(const char *id)
+{
+	struct obs_source_info *info = find_source_info(id);
+
+	if (!info && obs_load_deferred_module_for(OBS_REGISTRY_ANY_SOURCE, id))
+		info = find_source_info(id);
+	return info;
+}
+
+struct obs_source_info *get_source_info2(const char *unversioned_id,
+					 uint32_t ver)
+{
+	struct obs_source_info *info = find_source_info2(unversioned_id, ver);
+
+	if (!info && obs_load_deferred_module_for(OBS_REGISTRY_ANY_SOURCE,
+						  unversioned_id))
+		info = find_source_info2(unversioned_id, ver);
+	return info;
+}
+
 static const char *source_signals[] = {
 	"void destroy(ptr source)",
 	"void remove(ptr source)",
@@ -331,7 +351,7 @@ static void obs_source_init_audio_hotkeys(struct obs_source *source)
 static obs_source_t *
 obs_source_create_internal(const char *id, const char *name,
 			   obs_data_t *settings, obs_data_t *hotkey_data,
-			   bool private, uint32_t last_obs_ver)
+			   bool private, uint32_t last_obs_ver, bool deferred)
 {
 	struct obs_source *source = bzalloc(sizeof(struct obs_source));
 
@@ -381,14 +401,18 @@ obs_source_create_internal(const char *id, const char *name,
 
 	/* allow the source to be created even if creation fails so that the
 	 * user's data doesn't become lost */
-	if (info && info->create)
-		source->context.data =
-			info->create(source->context.settings, source);
-	if ((!info || info->create) && !source->context.data)
-		blog(LOG_ERROR, "Failed to create source '%s'!", name);
+	if (deferred && info && info->create) {
+		source->create_state = OBS_SOURCE_CREATE_DEFERRED;
+	} else {
+		if (info && info->create)
+			source->context.data =
+				info->create(source->context.settings, source);
+		if ((!info || info->create) && !source->context.data)
+			blog(LOG_ERROR, "Failed to create source '%s'!", name);
+	}
 
-	blog(LOG_DEBUG, "%ssource '%s' (%s) created", private ? "private " : "",
-	     name, id);
+	blog(LOG_DEBUG, "%ssource '%s' (%s) %s", private ? "private " : "",
+	     name, id, source->create_state ? "deferred" : "created");
 
 	source->flags = source->default_flags;
 	source->enabled = true;
@@ -410,7 +434,7 @@ obs_source_t *obs_source_create(const char *id, const char *name,
 				obs_data_t *settings, obs_data_t *hotkey_data)
 {
 	return obs_source_create_internal(id, name, settings, hotkey_data,
-					  false, LIBOBS_API_VER);
+					  false, LIBOBS_API_VER, false);
 }
 
 void *obs_source_get_context_data(obs_source_t *source)
@@ -424,16 +448,129 @@ obs_source_t *obs_source_create_private(const char *id, const char *name,
 					obs_data_t *settings)
 {
 	return obs_source_create_internal(id, name, settings, NULL, true,
-					  LIBOBS_API_VER);
+					  LIBOBS_API_VER, false);
 }
 
 obs_source_t *obs_source_create_set_last_ver(const char *id, const char *name,
 					     obs_data_t *settings,
 					     obs_data_t *hotkey_data,
-					     uint32_t last_obs_ver)
+					     uint32_t last_obs_ver, bool deferred)
 {
 	return obs_source_create_internal(id, name, settings, hotkey_data,
-					  false, last_obs_ver);
+					  false, last_obs_ver, deferred);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Deferred creation
+ *
+ * A deferred source is fully set up except for its implementation data.
+ * The create callback later runs on a worker thread (OBS_SOURCE_ASYNC_CREATE)
+ * or the UI thread, and the result is handed over to the video thread, which
+ * is the only place context.data goes from NULL to valid. */
+
+static inline bool take_pending_load(obs_source_t *source)
+{
+	return os_atomic_set_bool(&source->load_pending, false);
+}
+
+void obs_source_create_deferred_data(obs_source_t *source)
+{
+	uint64_t start = os_gettime_ns();
+	void *data = NULL;
+
+	if (!source->removed) {
+		data = source->info.create(source->context.settings, source);
+		if (!data)
+			blog(LOG_ERROR, "Failed to create source '%s'!",
+			     source->context.name);
+	}
+
+	if (data && take_pending_load(source)) {
+		if (source->info.load)
+			source->info.load(data, source->context.settings);
+		source->load_done = true;
+	}
+
+	blog(LOG_DEBUG, "source '%s' (%s) created on demand in %.1f ms",
+	     source->context.name, source->info.id,
+	     (double)(os_gettime_ns() - start) / 1000000.0);
+
+	source->pending_data = data;
+	os_atomic_set_long(&source->create_state, OBS_SOURCE_CREATE_FINISHED);
+}
+
+bool obs_source_publish_deferred_data(obs_source_t *source)
+{
+	if (!os_atomic_compare_swap_long(&source->create_state,
+					 OBS_SOURCE_CREATE_FINISHED,
+					 OBS_SOURCE_CREATED))
+		return false;
+
+	source->context.data = source->pending_data;
+	source->pending_data = NULL;
+	os_atomic_dec_long(&obs->data.pending_creates);
+
+	/* obs_source_load was called after the creator checked for it */
+	if (source->context.data && take_pending_load(source)) {
+		if (source->info.load)
+			source->info.load(source->context.data,
+					  source->context.settings);
+		source->load_done = true;
+	}
+
+	return true;
+}
+
+static void deferred_create_task(void *param)
+{
+	obs_source_t *source = param;
+
+	obs_source_create_deferred_data(source);
+	obs_source_release(source);
+}
+
+bool obs_source_queue_deferred_create(obs_source_t *source)
+{
+	enum obs_task_type type = OBS_TASK_WORKER;
+
+	if (!os_atomic_compare_swap_long(&source->create_state,
+					 OBS_SOURCE_CREATE_DEFERRED,
+					 OBS_SOURCE_CREATE_QUEUED))
+		return false;
+
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC_CREATE) == 0 &&
+	    obs->ui_task_handler)
+		type = OBS_TASK_UI;
+
+	obs_source_addref(source);
+	os_atomic_inc_long(&obs->data.pending_creates);
+	obs_queue_task(type, deferred_create_task, source, false);
+	return true;
+}
+
+static void tick_deferred_create(obs_source_t *source)
+{
+	long state = os_atomic_load_long(&source->create_state);
+
+	if (state == OBS_SOURCE_CREATE_DEFERRED) {
+		if (os_atomic_load_long(&source->show_refs) ||
+		    os_atomic_load_long(&source->activate_refs))
+			obs_source_queue_deferred_create(source);
+		return;
+	}
+
+	if (state != OBS_SOURCE_CREATE_FINISHED ||
+	    !obs_source_publish_deferred_data(source) || !source->context.data)
+		return;
+
+	if (source->load_done)
+		obs_source_dosignal(source, "source_load", "load");
+
+	/* show/activate already happened while there was no data */
+	if (source->showing && source->info.show)
+		source->info.show(source->context.data);
+	if (source->active && source->info.activate)
+		source->info.activate(source->context.data);
 }
 
 static char *get_new_filter_name(obs_source_t *dst, const char *name)
@@ -646,6 +783,13 @@ void obs_source_destroy(struct obs_source *source)
 
 	obs_context_data_remove(&source->context);
 
+	/* creation finished, but the video thread never picked it up */
+	if (os_atomic_load_long(&source->create_state) ==
+	    OBS_SOURCE_CREATE_FINISHED) {
+		os_atomic_set_bool(&source->load_pending, false);
+		obs_source_publish_deferred_data(source);
+	}
+
 	blog(LOG_DEBUG, "%ssource '%s' destroyed",
 	     source->context.private ? "private " : "", source->context.name);
 
@@ -693,6 +837,7 @@ void obs_source_destroy(struct obs_source *source)
 
 	da_free(source->audio_actions);
 	da_free(source->audio_cb_list);
+	da_free(source->audio_levels_cb_list);
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
@@ -1219,6 +1364,9 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
 
+	if (os_atomic_load_long(&source->create_state) != OBS_SOURCE_CREATED)
+		tick_deferred_create(source);
+
 	if (os_atomic_load_long(&source->defer_update_count) > 0)
 		obs_source_deferred_update(source);
 
@@ -1347,6 +1495,9 @@ static void source_signal_audio_data(obs_source_t *source,
 {
 	pthread_mutex_lock(&source->audio_cb_mutex);
 
+	if (os_atomic_load_long(&source->audio_levels_refs) > 0)
+		obs_source_meter_audio(source, in, muted);
+
 	for (size_t i = source->audio_cb_list.num; i > 0; i--) {
 		struct audio_cb_info info = source->audio_cb_list.array[i - 1];
 		info.callback(info.param, source, in, muted);
@@ -4202,6 +4353,18 @@ void obs_source_save(obs_source_t *source)
 
 void obs_source_load(obs_source_t *source)
 {
+	if (!obs_source_valid(source, "obs_source_load"))
+		return;
+
+	/* not created yet, the load is run right after creation */
+	if (os_atomic_load_long(&source->create_state) != OBS_SOURCE_CREATED) {
+		os_atomic_set_bool(&source->load_pending, true);
+		if (os_atomic_load_long(&source->create_state) !=
+			    OBS_SOURCE_CREATED ||
+		    !take_pending_load(source))
+			return;
+	}
+
 	if (!data_valid(source, "obs_source_load"))
 		return;
 	if (source->info.load)
@@ -4213,7 +4376,10 @@ void obs_source_load(obs_source_t *source)
 
 void obs_source_load2(obs_source_t *source)
 {
-	if (!data_valid(source, "obs_source_load2"))
+	if (!obs_source_valid(source, "obs_source_load2"))
+		return;
+	if (!source->context.data &&
+	    os_atomic_load_long(&source->create_state) == OBS_SOURCE_CREATED)
 		return;
 
 	obs_source_load(source);
@@ -196,6 +196,13 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_SRGB (1 << 15)
 
+/**
+ * Source's create callback can be called from a thread other than the UI
+ * thread, which allows libobs to create it in parallel with other sources
+ * while loading
+ */
+#define OBS_SOURCE_ASYNC_CREATE (1 << 16)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -71,6 +71,7 @@ static void *gpu_encode_thread(void *unused)
 		for (size_t i = 0; i < encoders.num; i++) {
 			struct encoder_packet pkt = {0};
 			bool received = false;
+			uint64_t encode_start;
 			bool success;
 
 			obs_encoder_t *encoder = encoders.array[i];
@@ -104,10 +105,26 @@ static void *gpu_encode_thread(void *unused)
 			else
 				next_key++;
 
-			success = encoder->info.encode_texture(
-				encoder->context.data, tf.handle,
-				encoder->cur_pts, lock_key, &next_key, &pkt,
-				&received);
+			encode_start = os_gettime_ns();
+
+			if (encoder->info.encode_texture2) {
+				struct encoder_texture tex = {
+					.handle = tf.handle,
+					.tex = {tf.tex, tf.tex_uv}};
+
+				success = encoder->info.encode_texture2(
+					encoder->context.data, &tex,
+					encoder->cur_pts, lock_key, &next_key,
+					&pkt, &received);
+			} else {
+				success = encoder->info.encode_texture(
+					encoder->context.data, tf.handle,
+					encoder->cur_pts, lock_key, &next_key,
+					&pkt, &received);
+			}
+
+			histogram_record(&encoder->encode_latency,
+					 os_gettime_ns() - encode_start);
 			send_off_encoder_packet(encoder, success, received,
 						&pkt);
 
@@ -149,11 +166,43 @@ static void *gpu_encode_thread(void *unused)
 	return NULL;
 }
 
-bool init_gpu_encoding(struct obs_core_video *video)
+static bool create_encode_textures(struct obs_core_video *video,
+				   gs_texture_t **tex, gs_texture_t **tex_uv)
 {
-#ifdef _WIN32
 	struct obs_video_info *ovi = &video->ovi;
 
+#ifdef _WIN32
+	if (video->using_nv12_tex) {
+		gs_texture_create_nv12(tex, tex_uv, ovi->output_width,
+				       ovi->output_height,
+				       GS_RENDER_TARGET | GS_SHARED_KM_TEX);
+		return *tex != NULL;
+	}
+#endif
+
+	/* same layout as the NV12 conversion targets so that they can be
+	 * swapped with them rather than copied */
+	*tex = gs_texture_create(ovi->output_width, ovi->output_height, GS_R8,
+				 1, NULL, GS_RENDER_TARGET);
+	*tex_uv = gs_texture_create(ovi->output_width / 2,
+				    ovi->output_height / 2, GS_R8G8, 1, NULL,
+				    GS_RENDER_TARGET);
+	if (!*tex || !*tex_uv) {
+		gs_texture_destroy(*tex);
+		gs_texture_destroy(*tex_uv);
+		*tex = NULL;
+		*tex_uv = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool init_gpu_encoding(struct obs_core_video *video)
+{
+	if (!video->using_nv12_tex && !video->using_nv12_planes)
+		return false;
+
 	video->gpu_encode_stop = false;
 
 	circlebuf_reserve(&video->gpu_encoder_avail_queue, NUM_ENCODE_TEXTURES);
@@ -161,14 +210,14 @@ bool init_gpu_encoding(struct obs_core_video *video)
 		gs_texture_t *tex;
 		gs_texture_t *tex_uv;
 
-		gs_texture_create_nv12(&tex, &tex_uv, ovi->output_width,
-				       ovi->output_height,
-				       GS_RENDER_TARGET | GS_SHARED_KM_TEX);
-		if (!tex) {
+		if (!create_encode_textures(video, &tex, &tex_uv))
 			return false;
-		}
 
+#ifdef _WIN32
 		uint32_t handle = gs_texture_get_shared_handle(tex);
+#else
+		uint32_t handle = GS_INVALID_HANDLE;
+#endif
 
 		struct obs_tex_frame frame = {
 			.tex = tex, .tex_uv = tex_uv, .handle = handle};
@@ -190,10 +239,6 @@ bool init_gpu_encoding(struct obs_core_video *video)
 
 	video->gpu_encode_thread_initialized = true;
 	return true;
-#else
-	UNUSED_PARAMETER(video);
-	return false;
-#endif
 }
 
 void stop_gpu_encoding_thread(struct obs_core_video *video)
@@ -112,14 +112,185 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
-static inline void unmap_last_surface(struct obs_core_video *video)
+/* ------------------------------------------------------------------------- */
+/* Output readback ring
+ *
+ * Each frame is staged into the next slot of a ring of readback_depth staging
+ * surfaces.  Older slots are mapped, oldest first, as soon as the GPU has
+ * finished copying to them, and the mapped planes are handed to the readback
+ * thread, which copies them into the video output.  The graphics thread only
+ * blocks when the ring is full, i.e. when the slot it is about to stage into
+ * still holds a frame that hasn't been read back.
+ *
+ * Renditions each have their own ring of the same depth, read back by the
+ * same thread. */
+
+struct obs_readback_item {
+	struct obs_video_rendition *rendition;
+	int slot;
+};
+
+static inline int next_readback_slot(const struct obs_core_video *video,
+				     int slot)
+{
+	return (slot + 1) % video->readback_depth;
+}
+
+static void unmap_staged_frame(struct obs_readback_slot *rs,
+			       gs_stagesurf_t *const *surfaces)
+{
+	if (!rs->mapped)
+		return;
+
+	/* the readback thread may still be copying from it */
+	os_event_wait(rs->done);
+
+	for (int c = 0; c < NUM_CHANNELS; ++c) {
+		if (surfaces[c])
+			gs_stagesurface_unmap(surfaces[c]);
+	}
+
+	rs->mapped = false;
+}
+
+static bool staged_frame_ready(gs_stagesurf_t *const *surfaces)
+{
+	for (int c = 0; c < NUM_CHANNELS; ++c) {
+		if (surfaces[c] && !gs_stagesurface_ready(surfaces[c]))
+			return false;
+	}
+
+	return true;
+}
+
+static bool map_staged_frame(struct obs_readback_slot *rs,
+			     gs_stagesurf_t *const *surfaces)
 {
+	memset(&rs->frame, 0, sizeof(rs->frame));
+
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
-		if (video->mapped_surfaces[c]) {
-			gs_stagesurface_unmap(video->mapped_surfaces[c]);
-			video->mapped_surfaces[c] = NULL;
+		if (!surfaces[c])
+			continue;
+
+		if (!gs_stagesurface_map(surfaces[c], &rs->frame.data[c],
+					 &rs->frame.linesize[c])) {
+			while (c-- > 0) {
+				if (surfaces[c])
+					gs_stagesurface_unmap(surfaces[c]);
+			}
+			return false;
 		}
 	}
+
+	rs->mapped = true;
+	return true;
+}
+
+static void queue_readback(struct obs_core_video *video,
+			   struct obs_video_rendition *rendition, int slot,
+			   struct obs_readback_slot *rs)
+{
+	struct obs_readback_item item = {rendition, slot};
+
+	os_event_reset(rs->done);
+
+	pthread_mutex_lock(&video->readback_mutex);
+	circlebuf_push_back(&video->readback_queue, &item, sizeof(item));
+	pthread_mutex_unlock(&video->readback_mutex);
+
+	os_sem_post(video->readback_sem);
+}
+
+static inline void unmap_readback_slot(struct obs_core_video *video, int slot)
+{
+	unmap_staged_frame(&video->readback_slots[slot],
+			   video->copy_surfaces[slot]);
+}
+
+static void download_slot(struct obs_core_video *video, int slot)
+{
+	struct obs_readback_slot *rs = &video->readback_slots[slot];
+	struct obs_vframe_info vframe_info;
+	uint64_t latency;
+
+	video->textures_copied[slot] = false;
+
+	if (!video->vframe_info_buffer.size)
+		return;
+	if (!map_staged_frame(rs, video->copy_surfaces[slot]))
+		return;
+
+	circlebuf_pop_front(&video->vframe_info_buffer, &vframe_info,
+			    sizeof(vframe_info));
+	rs->frame.timestamp = vframe_info.timestamp;
+	rs->count = vframe_info.count;
+
+	latency = os_gettime_ns() - rs->stage_ts;
+	video->readback_latency_total += latency;
+	histogram_record(&video->readback_latency, latency);
+	video->readback_frames++;
+
+	queue_readback(video, NULL, slot, rs);
+}
+
+/* reads back every frame staged before slot 'end', in order.  unless 'wait'
+ * is set, stops at the first frame the GPU hasn't finished copying yet. */
+static void download_frames(struct obs_core_video *video, int end, bool wait)
+{
+	while (video->readback_head != end) {
+		int slot = video->readback_head;
+
+		if (video->textures_copied[slot]) {
+			if (!wait &&
+			    !staged_frame_ready(video->copy_surfaces[slot]))
+				break;
+
+			download_slot(video, slot);
+		}
+
+		video->readback_head = next_readback_slot(video, slot);
+	}
+}
+
+static void download_rendition_slot(struct obs_core_video *video,
+				    struct obs_video_rendition *rend, int slot)
+{
+	struct obs_readback_slot *rs = &rend->readback_slots[slot];
+	struct obs_vframe_info vframe_info;
+
+	rend->textures_copied[slot] = false;
+
+	if (!rend->vframe_info_buffer.size)
+		return;
+	if (!map_staged_frame(rs, rend->copy_surfaces[slot]))
+		return;
+
+	circlebuf_pop_front(&rend->vframe_info_buffer, &vframe_info,
+			    sizeof(vframe_info));
+	rs->frame.timestamp = vframe_info.timestamp;
+	rs->count = vframe_info.count;
+
+	queue_readback(video, rend, slot, rs);
+}
+
+/* same as download_frames, for a rendition's ring */
+static void download_rendition_frames(struct obs_core_video *video,
+				      struct obs_video_rendition *rend,
+				      int end, bool wait)
+{
+	while (rend->readback_head != end) {
+		int slot = rend->readback_head;
+
+		if (rend->textures_copied[slot]) {
+			if (!wait &&
+			    !staged_frame_ready(rend->copy_surfaces[slot]))
+				break;
+
+			download_rendition_slot(video, rend, slot);
+		}
+
+		rend->readback_head = next_readback_slot(video, slot);
+	}
 }
 
 static const char *render_main_texture_name = "render_main_texture";
@@ -158,13 +329,14 @@ static inline void render_main_texture(struct obs_core_video *video)
 }
 
 static inline gs_effect_t *
-get_scale_effect_internal(struct obs_core_video *video)
+get_scale_effect_internal(struct obs_core_video *video, uint32_t width,
+			  uint32_t height)
 {
 	/* if the dimension is under half the size of the original image,
 	 * bicubic/lanczos can't sample enough pixels to create an accurate
 	 * image, so use the bilinear low resolution effect instead */
-	if (video->output_width < (video->base_width / 2) &&
-	    video->output_height < (video->base_height / 2)) {
+	if (width < (video->base_width / 2) &&
+	    height < (video->base_height / 2)) {
 		return video->bilinear_lowres_effect;
 	}
 
@@ -199,7 +371,8 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
 	} else {
 		/* if the scale method couldn't be loaded, use either bicubic
 		 * or bilinear by default */
-		gs_effect_t *effect = get_scale_effect_internal(video);
+		gs_effect_t *effect =
+			get_scale_effect_internal(video, width, height);
 		if (!effect)
 			effect = !!video->bicubic_effect
 					 ? video->bicubic_effect
@@ -208,30 +381,13 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
 	}
 }
 
-static const char *render_output_texture_name = "render_output_texture";
-static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
+static void render_scaled_texture(struct obs_core_video *video,
+				  gs_effect_t *effect, gs_technique_t *tech,
+				  gs_texture_t *texture, gs_texture_t *target)
 {
-	gs_texture_t *texture = video->render_texture;
-	gs_texture_t *target = video->output_texture;
 	uint32_t width = gs_texture_get_width(target);
 	uint32_t height = gs_texture_get_height(target);
 
-	gs_effect_t *effect = get_scale_effect(video, width, height);
-	gs_technique_t *tech;
-
-	if (video->ovi.output_format == VIDEO_FORMAT_RGBA) {
-		tech = gs_effect_get_technique(effect, "DrawAlphaDivide");
-	} else {
-		if ((effect == video->default_effect) &&
-		    (width == video->base_width) &&
-		    (height == video->base_height))
-			return texture;
-
-		tech = gs_effect_get_technique(effect, "Draw");
-	}
-
-	profile_start(render_output_texture_name);
-
 	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
 	gs_eparam_t *bres =
 		gs_effect_get_param_by_name(effect, "base_dimension");
@@ -269,7 +425,32 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
 	gs_technique_end(tech);
 	gs_enable_blending(true);
 	gs_enable_framebuffer_srgb(false);
+}
+
+static const char *render_output_texture_name = "render_output_texture";
+static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
+{
+	gs_texture_t *texture = video->render_texture;
+	gs_texture_t *target = video->output_texture;
+	uint32_t width = gs_texture_get_width(target);
+	uint32_t height = gs_texture_get_height(target);
+
+	gs_effect_t *effect = get_scale_effect(video, width, height);
+	gs_technique_t *tech;
+
+	if (video->ovi.output_format == VIDEO_FORMAT_RGBA) {
+		tech = gs_effect_get_technique(effect, "DrawAlphaDivide");
+	} else {
+		if ((effect == video->default_effect) &&
+		    (width == video->base_width) &&
+		    (height == video->base_height))
+			return texture;
 
+		tech = gs_effect_get_technique(effect, "Draw");
+	}
+
+	profile_start(render_output_texture_name);
+	render_scaled_texture(video, effect, tech, texture, target);
 	profile_end(render_output_texture_name);
 
 	return target;
@@ -295,12 +476,10 @@ static void render_convert_plane(gs_effect_t *effect, gs_texture_t *target,
 	gs_technique_end(tech);
 }
 
-static const char *render_convert_texture_name = "render_convert_texture";
-static void render_convert_texture(struct obs_core_video *video,
-				   gs_texture_t *texture)
+static void convert_texture_planes(struct obs_core_video *video,
+				   gs_texture_t *texture,
+				   gs_texture_t *const *targets, float width_i)
 {
-	profile_start(render_convert_texture_name);
-
 	gs_effect_t *effect = video->conversion_effect;
 	gs_eparam_t *color_vec0 =
 		gs_effect_get_param_by_name(effect, "color_vec0");
@@ -309,7 +488,8 @@ static void render_convert_texture(struct obs_core_video *video,
 	gs_eparam_t *color_vec2 =
 		gs_effect_get_param_by_name(effect, "color_vec2");
 	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
-	gs_eparam_t *width_i = gs_effect_get_param_by_name(effect, "width_i");
+	gs_eparam_t *width_i_param =
+		gs_effect_get_param_by_name(effect, "width_i");
 
 	struct vec4 vec0, vec1, vec2;
 	vec4_set(&vec0, video->color_matrix[4], video->color_matrix[5],
@@ -321,47 +501,64 @@ static void render_convert_texture(struct obs_core_video *video,
 
 	gs_enable_blending(false);
 
-	if (video->convert_textures[0]) {
+	if (targets[0]) {
 		gs_effect_set_texture(image, texture);
 		gs_effect_set_vec4(color_vec0, &vec0);
-		render_convert_plane(effect, video->convert_textures[0],
+		render_convert_plane(effect, targets[0],
 				     video->conversion_techs[0]);
 
-		if (video->convert_textures[1]) {
+		if (targets[1]) {
 			gs_effect_set_texture(image, texture);
 			gs_effect_set_vec4(color_vec1, &vec1);
-			if (!video->convert_textures[2])
+			if (!targets[2])
 				gs_effect_set_vec4(color_vec2, &vec2);
-			gs_effect_set_float(width_i, video->conversion_width_i);
-			render_convert_plane(effect, video->convert_textures[1],
+			gs_effect_set_float(width_i_param, width_i);
+			render_convert_plane(effect, targets[1],
 					     video->conversion_techs[1]);
 
-			if (video->convert_textures[2]) {
+			if (targets[2]) {
 				gs_effect_set_texture(image, texture);
 				gs_effect_set_vec4(color_vec2, &vec2);
-				gs_effect_set_float(width_i,
-						    video->conversion_width_i);
+				gs_effect_set_float(width_i_param, width_i);
 				render_convert_plane(
-					effect, video->convert_textures[2],
+					effect, targets[2],
 					video->conversion_techs[2]);
 			}
 		}
 	}
 
 	gs_enable_blending(true);
+}
 
+static const char *render_convert_texture_name = "render_convert_texture";
+static void render_convert_texture(struct obs_core_video *video,
+				   gs_texture_t *texture)
+{
+	profile_start(render_convert_texture_name);
+
+	convert_texture_planes(video, texture, video->convert_textures,
+			       video->conversion_width_i);
 	video->texture_converted = true;
 
 	profile_end(render_convert_texture_name);
 }
 
 static const char *stage_output_texture_name = "stage_output_texture";
+static const char *wait_for_readback_name = "wait_for_readback";
 static inline void stage_output_texture(struct obs_core_video *video,
 					int cur_texture)
 {
 	profile_start(stage_output_texture_name);
 
-	unmap_last_surface(video);
+	if (video->textures_copied[cur_texture]) {
+		profile_start(wait_for_readback_name);
+		download_frames(video, next_readback_slot(video, cur_texture),
+				true);
+		video->readback_stalls++;
+		profile_end(wait_for_readback_name);
+	}
+
+	unmap_readback_slot(video, cur_texture);
 
 	if (!video->gpu_conversion) {
 		gs_stagesurf_t *copy = video->copy_surfaces[cur_texture][0];
@@ -381,10 +578,85 @@ static inline void stage_output_texture(struct obs_core_video *video,
 		video->textures_copied[cur_texture] = true;
 	}
 
+	if (video->textures_copied[cur_texture])
+		video->readback_slots[cur_texture].stage_ts = os_gettime_ns();
+
 	profile_end(stage_output_texture_name);
 }
 
-#ifdef _WIN32
+static inline void render_rendition(struct obs_core_video *video,
+				    struct obs_video_rendition *rend,
+				    int cur_texture)
+{
+	gs_effect_t *effect =
+		get_scale_effect(video, rend->width, rend->height);
+	gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
+
+	/* the ring is full, wait for the oldest frame like the main output */
+	if (rend->textures_copied[cur_texture]) {
+		download_rendition_frames(
+			video, rend, next_readback_slot(video, cur_texture),
+			true);
+	}
+
+	unmap_staged_frame(&rend->readback_slots[cur_texture],
+			   rend->copy_surfaces[cur_texture]);
+
+	render_scaled_texture(video, effect, tech, video->render_texture,
+			      rend->output_texture);
+	convert_texture_planes(video, rend->output_texture,
+			       rend->convert_textures,
+			       rend->conversion_width_i);
+
+	for (int i = 0; i < NUM_CHANNELS; i++) {
+		gs_stagesurf_t *copy = rend->copy_surfaces[cur_texture][i];
+		if (copy)
+			gs_stage_texture(copy, rend->convert_textures[i]);
+	}
+
+	rend->textures_copied[cur_texture] = true;
+}
+
+/* Every rendition is scaled straight from the base canvas in the same pass as
+ * the main output, so the scene itself is only ever rendered once no matter
+ * how many renditions there are.
+ *
+ * The rendition list can change from any thread, so it is only ever looked at
+ * with renditions_mutex held, including to check whether it is empty. */
+static const char *render_renditions_name = "render_video_renditions";
+static void render_renditions(struct obs_core_video *video, int cur_texture)
+{
+	pthread_mutex_lock(&video->renditions_mutex);
+
+	if (!video->renditions.num) {
+		pthread_mutex_unlock(&video->renditions_mutex);
+		return;
+	}
+
+	profile_start(render_renditions_name);
+
+	for (size_t i = 0; i < video->renditions.num; i++) {
+		struct obs_video_rendition *rend = video->renditions.array[i];
+		bool active = video_output_active(rend->video);
+
+		if (active && !rend->was_active) {
+			memset(rend->textures_copied, 0,
+			       sizeof(rend->textures_copied));
+			circlebuf_free(&rend->vframe_info_buffer);
+			rend->readback_head = cur_texture;
+		}
+
+		rend->was_active = active;
+
+		if (active)
+			render_rendition(video, rend, cur_texture);
+	}
+
+	profile_end(render_renditions_name);
+
+	pthread_mutex_unlock(&video->renditions_mutex);
+}
+
 static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
 			       struct obs_vframe_info *vframe_info)
 {
@@ -410,10 +682,12 @@ static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
 	struct obs_tex_frame tf;
 	circlebuf_pop_front(&video->gpu_encoder_avail_queue, &tf, sizeof(tf));
 
+#ifdef _WIN32
 	if (tf.released) {
 		gs_texture_acquire_sync(tf.tex, tf.lock_key, GS_WAIT_INFINITE);
 		tf.released = false;
 	}
+#endif
 
 	/* the vframe_info->count > 1 case causing a copy can only happen if by
 	 * some chance the very first frame has to be duplicated for whatever
@@ -421,6 +695,8 @@ static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
 	 * will ensure better performance. */
 	if (raw_active || vframe_info->count > 1) {
 		gs_copy_texture(tf.tex, video->convert_textures[0]);
+		if (video->using_nv12_planes)
+			gs_copy_texture(tf.tex_uv, video->convert_textures[1]);
 	} else {
 		gs_texture_t *tex = video->convert_textures[0];
 		gs_texture_t *tex_uv = video->convert_textures[1];
@@ -434,9 +710,17 @@ static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
 
 	tf.count = 1;
 	tf.timestamp = vframe_info->timestamp;
-	tf.released = true;
-	tf.handle = gs_texture_get_shared_handle(tf.tex);
-	gs_texture_release_sync(tf.tex, ++tf.lock_key);
+#ifdef _WIN32
+	if (video->using_nv12_tex) {
+		tf.released = true;
+		tf.handle = gs_texture_get_shared_handle(tf.tex);
+		gs_texture_release_sync(tf.tex, ++tf.lock_key);
+	} else {
+		tf.handle = GS_INVALID_HANDLE;
+	}
+#else
+	tf.handle = GS_INVALID_HANDLE;
+#endif
 	circlebuf_push_back(&video->gpu_encoder_queue, &tf, sizeof(tf));
 
 	os_sem_post(video->gpu_encode_semaphore);
@@ -475,7 +759,6 @@ static void output_gpu_encoders(struct obs_core_video *video, bool raw_active)
 end:
 	profile_end(output_gpu_encoders_name);
 }
-#endif
 
 static inline void render_video(struct obs_core_video *video, bool raw_active,
 				const bool gpu_active, int cur_texture)
@@ -498,41 +781,39 @@ static inline void render_video(struct obs_core_video *video, bool raw_active,
 		if (video->gpu_conversion)
 			render_convert_texture(video, texture);
 
-#ifdef _WIN32
 		if (gpu_active) {
+#ifdef _WIN32
 			gs_flush();
+#endif
 			output_gpu_encoders(video, raw_active);
 		}
-#endif
 
 		if (raw_active)
 			stage_output_texture(video, cur_texture);
 	}
 
+	if (raw_active)
+		render_renditions(video, cur_texture);
+
 	gs_set_render_target(NULL, NULL);
 	gs_enable_blending(true);
 
 	gs_end_scene();
 }
 
-static inline bool download_frame(struct obs_core_video *video,
-				  int prev_texture, struct video_data *frame)
+static void download_renditions(struct obs_core_video *video,
+				int cur_texture)
 {
-	if (!video->textures_copied[prev_texture])
-		return false;
-
-	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
-		gs_stagesurf_t *surface =
-			video->copy_surfaces[prev_texture][channel];
-		if (surface) {
-			if (!gs_stagesurface_map(surface, &frame->data[channel],
-						 &frame->linesize[channel]))
-				return false;
-
-			video->mapped_surfaces[channel] = surface;
-		}
+	pthread_mutex_lock(&video->renditions_mutex);
+
+	for (size_t i = 0; i < video->renditions.num; i++) {
+		struct obs_video_rendition *rend = video->renditions.array[i];
+		if (rend->was_active)
+			download_rendition_frames(video, rend, cur_texture,
+						  false);
 	}
-	return true;
+
+	pthread_mutex_unlock(&video->renditions_mutex);
 }
 
 static const uint8_t *set_gpu_converted_plane(uint32_t width, uint32_t height,
@@ -555,6 +836,85 @@ static const uint8_t *set_gpu_converted_plane(uint32_t width, uint32_t height,
 	return in;
 }
 
+static void set_gpu_converted_planes(struct video_frame *output,
+				     const struct video_data *input,
+				     const struct video_output_info *info)
+{
+	switch (info->format) {
+	case VIDEO_FORMAT_I420: {
+		const uint32_t width = info->width;
+		const uint32_t height = info->height;
+
+		set_gpu_converted_plane(width, height, input->linesize[0],
+					output->linesize[0], input->data[0],
+					output->data[0]);
+
+		const uint32_t width_d2 = width / 2;
+		const uint32_t height_d2 = height / 2;
+
+		set_gpu_converted_plane(width_d2, height_d2, input->linesize[1],
+					output->linesize[1], input->data[1],
+					output->data[1]);
+
+		set_gpu_converted_plane(width_d2, height_d2, input->linesize[2],
+					output->linesize[2], input->data[2],
+					output->data[2]);
+
+		break;
+	}
+	case VIDEO_FORMAT_NV12: {
+		const uint32_t width = info->width;
+		const uint32_t height = info->height;
+
+		set_gpu_converted_plane(width, height, input->linesize[0],
+					output->linesize[0], input->data[0],
+					output->data[0]);
+
+		const uint32_t height_d2 = height / 2;
+		set_gpu_converted_plane(width, height_d2, input->linesize[1],
+					output->linesize[1], input->data[1],
+					output->data[1]);
+
+		break;
+	}
+	case VIDEO_FORMAT_I444: {
+		const uint32_t width = info->width;
+		const uint32_t height = info->height;
+
+		set_gpu_converted_plane(width, height, input->linesize[0],
+					output->linesize[0], input->data[0],
+					output->data[0]);
+
+		set_gpu_converted_plane(width, height, input->linesize[1],
+					output->linesize[1], input->data[1],
+					output->data[1]);
+
+		set_gpu_converted_plane(width, height, input->linesize[2],
+					output->linesize[2], input->data[2],
+					output->data[2]);
+
+		break;
+	}
+
+	case VIDEO_FORMAT_NONE:
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_Y800:
+	case VIDEO_FORMAT_BGR3:
+	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_I40A:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+	case VIDEO_FORMAT_AYUV:
+		/* unimplemented */
+		;
+	}
+}
+
 static void set_gpu_converted_data(struct obs_core_video *video,
 				   struct video_frame *output,
 				   const struct video_data *input,
@@ -573,95 +933,7 @@ static void set_gpu_converted_data(struct obs_core_video *video,
 					output->linesize[1], in_uv,
 					output->data[1]);
 	} else {
-		switch (info->format) {
-		case VIDEO_FORMAT_I420: {
-			const uint32_t width = info->width;
-			const uint32_t height = info->height;
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[0],
-						output->linesize[0],
-						input->data[0],
-						output->data[0]);
-
-			const uint32_t width_d2 = width / 2;
-			const uint32_t height_d2 = height / 2;
-
-			set_gpu_converted_plane(width_d2, height_d2,
-						input->linesize[1],
-						output->linesize[1],
-						input->data[1],
-						output->data[1]);
-
-			set_gpu_converted_plane(width_d2, height_d2,
-						input->linesize[2],
-						output->linesize[2],
-						input->data[2],
-						output->data[2]);
-
-			break;
-		}
-		case VIDEO_FORMAT_NV12: {
-			const uint32_t width = info->width;
-			const uint32_t height = info->height;
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[0],
-						output->linesize[0],
-						input->data[0],
-						output->data[0]);
-
-			const uint32_t height_d2 = height / 2;
-			set_gpu_converted_plane(width, height_d2,
-						input->linesize[1],
-						output->linesize[1],
-						input->data[1],
-						output->data[1]);
-
-			break;
-		}
-		case VIDEO_FORMAT_I444: {
-			const uint32_t width = info->width;
-			const uint32_t height = info->height;
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[0],
-						output->linesize[0],
-						input->data[0],
-						output->data[0]);
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[1],
-						output->linesize[1],
-						input->data[1],
-						output->data[1]);
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[2],
-						output->linesize[2],
-						input->data[2],
-						output->data[2]);
-
-			break;
-		}
-
-		case VIDEO_FORMAT_NONE:
-		case VIDEO_FORMAT_YVYU:
-		case VIDEO_FORMAT_YUY2:
-		case VIDEO_FORMAT_UYVY:
-		case VIDEO_FORMAT_RGBA:
-		case VIDEO_FORMAT_BGRA:
-		case VIDEO_FORMAT_BGRX:
-		case VIDEO_FORMAT_Y800:
-		case VIDEO_FORMAT_BGR3:
-		case VIDEO_FORMAT_I422:
-		case VIDEO_FORMAT_I40A:
-		case VIDEO_FORMAT_I42A:
-		case VIDEO_FORMAT_YUVA:
-		case VIDEO_FORMAT_AYUV:
-			/* unimplemented */
-			;
-		}
+		set_gpu_converted_planes(output, input, info);
 	}
 }
 
@@ -709,6 +981,93 @@ static inline void output_video_data(struct obs_core_video *video,
 	}
 }
 
+static inline void output_rendition_data(struct obs_video_rendition *rend,
+					 struct video_data *input_frame,
+					 int count)
+{
+	const struct video_output_info *info;
+	struct video_frame output_frame;
+
+	info = video_output_get_info(rend->video);
+
+	if (video_output_lock_frame(rend->video, &output_frame, count,
+				    input_frame->timestamp)) {
+		set_gpu_converted_planes(&output_frame, input_frame, info);
+		video_output_unlock_frame(rend->video);
+	}
+}
+
+static const char *readback_thread_name = "obs_video_readback_thread";
+static const char *output_video_data_name = "output_video_data";
+static const char *output_rendition_data_name = "output_rendition_data";
+
+void *obs_video_readback_thread(void *param)
+{
+	struct obs_core_video *video = &obs->video;
+
+	UNUSED_PARAMETER(param);
+
+	os_set_thread_name("libobs: video readback thread");
+	profile_register_root(readback_thread_name,
+			      video_output_get_frame_time(video->video));
+
+	while (os_sem_wait(video->readback_sem) == 0) {
+		struct obs_readback_item item;
+		struct obs_readback_slot *rs;
+
+		pthread_mutex_lock(&video->readback_mutex);
+		if (!video->readback_queue.size) {
+			pthread_mutex_unlock(&video->readback_mutex);
+			if (os_atomic_load_bool(&video->readback_stop))
+				break;
+			continue;
+		}
+		circlebuf_pop_front(&video->readback_queue, &item,
+				    sizeof(item));
+		pthread_mutex_unlock(&video->readback_mutex);
+
+		profile_start(readback_thread_name);
+
+		if (item.rendition) {
+			rs = &item.rendition->readback_slots[item.slot];
+
+			profile_start(output_rendition_data_name);
+			output_rendition_data(item.rendition, &rs->frame,
+					      rs->count);
+			profile_end(output_rendition_data_name);
+		} else {
+			rs = &video->readback_slots[item.slot];
+
+			profile_start(output_video_data_name);
+			output_video_data(video, &rs->frame, rs->count);
+			profile_end(output_video_data_name);
+		}
+
+		profile_end(readback_thread_name);
+
+		os_event_signal(rs->done);
+
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static inline void queue_rendition_frames(struct obs_core_video *video,
+					  const struct obs_vframe_info *info)
+{
+	pthread_mutex_lock(&video->renditions_mutex);
+
+	for (size_t i = 0; i < video->renditions.num; i++) {
+		struct obs_video_rendition *rend = video->renditions.array[i];
+		if (rend->was_active)
+			circlebuf_push_back(&rend->vframe_info_buffer, info,
+					    sizeof(*info));
+	}
+
+	pthread_mutex_unlock(&video->renditions_mutex);
+}
+
 static inline void video_sleep(struct obs_core_video *video, bool raw_active,
 			       const bool gpu_active, uint64_t *p_time,
 			       uint64_t interval_ns)
@@ -735,6 +1094,8 @@ static inline void video_sleep(struct obs_core_video *video, bool raw_active,
 	if (raw_active)
 		circlebuf_push_back(&video->vframe_info_buffer, &vframe_info,
 				    sizeof(vframe_info));
+	if (raw_active)
+		queue_rendition_frames(video, &vframe_info);
 	if (gpu_active)
 		circlebuf_push_back(&video->vframe_info_buffer_gpu,
 				    &vframe_info, sizeof(vframe_info));
@@ -744,17 +1105,10 @@ static const char *output_frame_gs_context_name = "gs_context(video->graphics)";
 static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
-static const char *output_frame_output_video_data_name = "output_video_data";
 static inline void output_frame(bool raw_active, const bool gpu_active)
 {
 	struct obs_core_video *video = &obs->video;
 	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1
-					    : cur_texture - 1;
-	struct video_data frame;
-	bool frame_ready = 0;
-
-	memset(&frame, 0, sizeof(struct video_data));
 
 	profile_start(output_frame_gs_context_name);
 	gs_enter_context(video->graphics);
@@ -768,7 +1122,8 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 
 	if (raw_active) {
 		profile_start(output_frame_download_frame_name);
-		frame_ready = download_frame(video, prev_texture, &frame);
+		download_frames(video, cur_texture, false);
+		download_renditions(video, cur_texture);
 		profile_end(output_frame_download_frame_name);
 	}
 
@@ -779,18 +1134,7 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 	gs_leave_context();
 	profile_end(output_frame_gs_context_name);
 
-	if (raw_active && frame_ready) {
-		struct obs_vframe_info vframe_info;
-		circlebuf_pop_front(&video->vframe_info_buffer, &vframe_info,
-				    sizeof(vframe_info));
-
-		frame.timestamp = vframe_info.timestamp;
-		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
-		profile_end(output_frame_output_video_data_name);
-	}
-
-	if (++video->cur_texture == NUM_TEXTURES)
+	if (++video->cur_texture == video->readback_depth)
 		video->cur_texture = 0;
 }
 
@@ -803,6 +1147,7 @@ static void clear_base_frame_data(void)
 	video->texture_converted = false;
 	circlebuf_free(&video->vframe_info_buffer);
 	video->cur_texture = 0;
+	video->readback_head = 0;
 }
 
 static void clear_raw_frame_data(void)
@@ -810,15 +1155,14 @@ static void clear_raw_frame_data(void)
 	struct obs_core_video *video = &obs->video;
 	memset(video->textures_copied, 0, sizeof(video->textures_copied));
 	circlebuf_free(&video->vframe_info_buffer);
+	video->readback_head = video->cur_texture;
 }
 
-#ifdef _WIN32
 static void clear_gpu_frame_data(void)
 {
 	struct obs_core_video *video = &obs->video;
 	circlebuf_free(&video->vframe_info_buffer_gpu);
 }
-#endif
 
 extern THREAD_LOCAL bool is_graphics_thread;
 
@@ -920,6 +1264,36 @@ static void uninit_winrt_state(struct winrt_state *winrt)
 
 #endif // #ifdef _WIN32
 
+/* logs the time from obs_load_sources to the first frame in which the main
+ * output is showing and every shown source has been created */
+static void check_load_complete(void)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_view *view = &data->main_view;
+	bool ready;
+
+	if (!os_atomic_load_bool(&data->load_in_progress))
+		return;
+
+	pthread_mutex_lock(&view->channels_mutex);
+	ready = view->channels[0] && view->channels[0]->showing &&
+		!os_atomic_load_long(&data->pending_creates);
+	pthread_mutex_unlock(&view->channels_mutex);
+
+	/* wait one more frame so sources that were just shown get a chance
+	 * to queue their creation */
+	if (!ready || !data->load_frame_ready) {
+		data->load_frame_ready = ready;
+		return;
+	}
+
+	os_atomic_set_bool(&data->load_in_progress, false);
+
+	blog(LOG_INFO, "First frame %.1f ms after loading sources (%s)",
+	     (double)(os_gettime_ns() - data->load_start_ns) / 1000000.0,
+	     data->lazy_source_loading ? "lazy" : "parallel");
+}
+
 static const char *tick_sources_name = "tick_sources";
 static const char *render_displays_name = "render_displays";
 static const char *output_frame_name = "output_frame";
@@ -931,24 +1305,17 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	uint64_t frame_start = os_gettime_ns();
 	uint64_t frame_time_ns;
 	bool raw_active = obs->video.raw_active > 0;
-#ifdef _WIN32
 	const bool gpu_active = obs->video.gpu_encoder_active > 0;
 	const bool active = raw_active || gpu_active;
-#else
-	const bool gpu_active = 0;
-	const bool active = raw_active;
-#endif
 
 	if (!context->was_active && active)
 		clear_base_frame_data();
 	if (!context->raw_was_active && raw_active)
 		clear_raw_frame_data();
-#ifdef _WIN32
 	if (!context->gpu_was_active && gpu_active)
 		clear_gpu_frame_data();
 
 	context->gpu_was_active = gpu_active;
-#endif
 	context->raw_was_active = raw_active;
 	context->was_active = active;
 
@@ -977,10 +1344,14 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	output_frame(raw_active, gpu_active);
 	profile_end(output_frame_name);
 
+	obs_render_screenshots();
+
 	profile_start(render_displays_name);
 	render_displays();
 	profile_end(render_displays_name);
 
+	check_load_complete();
+
 	frame_time_ns = os_gettime_ns() - frame_start;
 
 	profile_end(context->video_thread_name);
@@ -991,6 +1362,7 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 		    context->interval);
 
 	context->frame_time_total_ns += frame_time_ns;
+	histogram_record(&obs->video.render_latency, frame_time_ns);
 	context->fps_total_ns += (obs->video.video_time - context->last_time);
 	context->fps_total_frames++;
 
@@ -1039,9 +1411,7 @@ void *obs_graphics_thread(void *param)
 	context.fps_total_ns = 0;
 	context.fps_total_frames = 0;
 	context.last_time = 0;
-#ifdef _WIN32
 	context.gpu_was_active = false;
-#endif
 	context.raw_was_active = false;
 	context.was_active = false;
 	context.video_thread_name = video_thread_name;
@@ -75,6 +75,41 @@ static inline void calc_gpu_conversion_sizes(const struct obs_video_info *ovi)
 	}
 }
 
+static bool create_gpu_convert_textures(gs_texture_t **textures,
+					uint32_t width, uint32_t height,
+					enum video_format format)
+{
+	textures[0] = gs_texture_create(width, height, GS_R8, 1, NULL,
+					GS_RENDER_TARGET);
+
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+		textures[1] = gs_texture_create(width / 2, height / 2, GS_R8, 1,
+						NULL, GS_RENDER_TARGET);
+		textures[2] = gs_texture_create(width / 2, height / 2, GS_R8, 1,
+						NULL, GS_RENDER_TARGET);
+		if (!textures[2])
+			return false;
+		break;
+	case VIDEO_FORMAT_NV12:
+		textures[1] = gs_texture_create(width / 2, height / 2, GS_R8G8,
+						1, NULL, GS_RENDER_TARGET);
+		break;
+	case VIDEO_FORMAT_I444:
+		textures[1] = gs_texture_create(width, height, GS_R8, 1, NULL,
+						GS_RENDER_TARGET);
+		textures[2] = gs_texture_create(width, height, GS_R8, 1, NULL,
+						GS_RENDER_TARGET);
+		if (!textures[2])
+			return false;
+		break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
 static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -85,17 +120,27 @@ static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 					? gs_nv12_available()
 					: false;
 
+	/* without native NV12 textures, the Y and UV planes are rendered to
+	 * separate textures which texture encoders can still consume on
+	 * OpenGL (e.g. by importing their own surfaces via DMA-BUF) */
+	video->using_nv12_planes = ovi->output_format == VIDEO_FORMAT_NV12 &&
+				   !video->using_nv12_tex &&
+				   gs_get_device_type() == GS_DEVICE_OPENGL;
+
 	if (!video->conversion_needed) {
 		blog(LOG_INFO, "GPU conversion not available for format: %u",
 		     (unsigned int)ovi->output_format);
 		video->gpu_conversion = false;
 		video->using_nv12_tex = false;
+		video->using_nv12_planes = false;
 		blog(LOG_INFO, "NV12 texture support not available");
 		return true;
 	}
 
 	if (video->using_nv12_tex)
 		blog(LOG_INFO, "NV12 texture support enabled");
+	else if (video->using_nv12_planes)
+		blog(LOG_INFO, "NV12 plane texture support enabled");
 	else
 		blog(LOG_INFO, "NV12 texture support not available");
 
@@ -107,41 +152,13 @@ static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 				       GS_RENDER_TARGET | GS_SHARED_KM_TEX);
 	} else {
 #endif
-		video->convert_textures[0] =
-			gs_texture_create(ovi->output_width, ovi->output_height,
-					  GS_R8, 1, NULL, GS_RENDER_TARGET);
-
 		const struct video_output_info *info =
 			video_output_get_info(video->video);
-		switch (info->format) {
-		case VIDEO_FORMAT_I420:
-			video->convert_textures[1] = gs_texture_create(
-				ovi->output_width / 2, ovi->output_height / 2,
-				GS_R8, 1, NULL, GS_RENDER_TARGET);
-			video->convert_textures[2] = gs_texture_create(
-				ovi->output_width / 2, ovi->output_height / 2,
-				GS_R8, 1, NULL, GS_RENDER_TARGET);
-			if (!video->convert_textures[2])
-				return false;
-			break;
-		case VIDEO_FORMAT_NV12:
-			video->convert_textures[1] = gs_texture_create(
-				ovi->output_width / 2, ovi->output_height / 2,
-				GS_R8G8, 1, NULL, GS_RENDER_TARGET);
-			break;
-		case VIDEO_FORMAT_I444:
-			video->convert_textures[1] = gs_texture_create(
-				ovi->output_width, ovi->output_height, GS_R8, 1,
-				NULL, GS_RENDER_TARGET);
-			video->convert_textures[2] = gs_texture_create(
-				ovi->output_width, ovi->output_height, GS_R8, 1,
-				NULL, GS_RENDER_TARGET);
-			if (!video->convert_textures[2])
-				return false;
-			break;
-		default:
-			break;
-		}
+		if (!create_gpu_convert_textures(video->convert_textures,
+						 ovi->output_width,
+						 ovi->output_height,
+						 info->format))
+			return false;
 #ifdef _WIN32
 	}
 #endif
@@ -154,42 +171,36 @@ static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 	return true;
 }
 
-static bool obs_init_gpu_copy_surfaces(struct obs_video_info *ovi, size_t i)
+static bool create_gpu_copy_surfaces(gs_stagesurf_t **surfaces, uint32_t width,
+				     uint32_t height, enum video_format format)
 {
-	struct obs_core_video *video = &obs->video;
-
-	video->copy_surfaces[i][0] = gs_stagesurface_create(
-		ovi->output_width, ovi->output_height, GS_R8);
-	if (!video->copy_surfaces[i][0])
+	surfaces[0] = gs_stagesurface_create(width, height, GS_R8);
+	if (!surfaces[0])
 		return false;
 
-	const struct video_output_info *info =
-		video_output_get_info(video->video);
-	switch (info->format) {
+	switch (format) {
 	case VIDEO_FORMAT_I420:
-		video->copy_surfaces[i][1] = gs_stagesurface_create(
-			ovi->output_width / 2, ovi->output_height / 2, GS_R8);
-		if (!video->copy_surfaces[i][1])
+		surfaces[1] =
+			gs_stagesurface_create(width / 2, height / 2, GS_R8);
+		if (!surfaces[1])
 			return false;
-		video->copy_surfaces[i][2] = gs_stagesurface_create(
-			ovi->output_width / 2, ovi->output_height / 2, GS_R8);
-		if (!video->copy_surfaces[i][2])
+		surfaces[2] =
+			gs_stagesurface_create(width / 2, height / 2, GS_R8);
+		if (!surfaces[2])
 			return false;
 		break;
 	case VIDEO_FORMAT_NV12:
-		video->copy_surfaces[i][1] = gs_stagesurface_create(
-			ovi->output_width / 2, ovi->output_height / 2, GS_R8G8);
-		if (!video->copy_surfaces[i][1])
+		surfaces[1] =
+			gs_stagesurface_create(width / 2, height / 2, GS_R8G8);
+		if (!surfaces[1])
 			return false;
 		break;
 	case VIDEO_FORMAT_I444:
-		video->copy_surfaces[i][1] = gs_stagesurface_create(
-			ovi->output_width, ovi->output_height, GS_R8);
-		if (!video->copy_surfaces[i][1])
+		surfaces[1] = gs_stagesurface_create(width, height, GS_R8);
+		if (!surfaces[1])
 			return false;
-		video->copy_surfaces[i][2] = gs_stagesurface_create(
-			ovi->output_width, ovi->output_height, GS_R8);
-		if (!video->copy_surfaces[i][2])
+		surfaces[2] = gs_stagesurface_create(width, height, GS_R8);
+		if (!surfaces[2])
 			return false;
 		break;
 	default:
@@ -199,11 +210,25 @@ static bool obs_init_gpu_copy_surfaces(struct obs_video_info *ovi, size_t i)
 	return true;
 }
 
+static bool obs_init_gpu_copy_surfaces(struct obs_video_info *ovi, size_t i)
+{
+	struct obs_core_video *video = &obs->video;
+	const struct video_output_info *info =
+		video_output_get_info(video->video);
+
+	if (!create_gpu_copy_surfaces(video->copy_surfaces[i],
+				      ovi->output_width, ovi->output_height,
+				      info->format))
+		return false;
+
+	return true;
+}
+
 static bool obs_init_textures(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (int i = 0; i < video->readback_depth; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces[i][0] =
@@ -382,6 +407,60 @@ static inline void set_video_matrix(struct obs_core_video *video,
 	memcpy(video->color_matrix, &mat, sizeof(float) * 16);
 }
 
+static bool obs_init_video_readback(struct obs_core_video *video)
+{
+	video->readback_stop = false;
+	video->readback_head = 0;
+	video->readback_latency_total = 0;
+	video->readback_frames = 0;
+	video->readback_stalls = 0;
+
+	if (pthread_mutex_init(&video->readback_mutex, NULL) < 0)
+		return false;
+	if (os_sem_init(&video->readback_sem, 0) != 0)
+		return false;
+
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
+		struct obs_readback_slot *rs = &video->readback_slots[i];
+		if (os_event_init(&rs->done, OS_EVENT_TYPE_MANUAL) != 0)
+			return false;
+		os_event_signal(rs->done);
+	}
+
+	if (pthread_create(&video->readback_thread, NULL,
+			   obs_video_readback_thread, NULL) != 0)
+		return false;
+
+	video->readback_thread_initialized = true;
+	return true;
+}
+
+static void obs_free_video_readback(struct obs_core_video *video)
+{
+	if (video->readback_frames) {
+		double avg_ms = (double)video->readback_latency_total /
+				(double)video->readback_frames / 1000000.0;
+
+		blog(LOG_INFO,
+		     "Video readback: depth %d, average latency %.2f ms, "
+		     "%" PRIu32 " stalls out of %" PRIu32 " frames",
+		     video->readback_depth, avg_ms, video->readback_stalls,
+		     video->readback_frames);
+	}
+
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
+		os_event_destroy(video->readback_slots[i].done);
+		video->readback_slots[i].done = NULL;
+	}
+
+	os_sem_destroy(video->readback_sem);
+	video->readback_sem = NULL;
+
+	pthread_mutex_destroy(&video->readback_mutex);
+	pthread_mutex_init_value(&video->readback_mutex);
+	circlebuf_free(&video->readback_queue);
+}
+
 static int obs_init_video(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -396,6 +475,10 @@ static int obs_init_video(struct obs_video_info *ovi)
 	video->gpu_conversion = ovi->gpu_conversion;
 	video->scale_type = ovi->scale_type;
 
+	video->readback_depth = video->requested_readback_depth
+					? video->requested_readback_depth
+					: NUM_TEXTURES;
+
 	set_video_matrix(video, ovi);
 
 	errorcode = video_output_open(&video->video, &vi);
@@ -423,6 +506,10 @@ static int obs_init_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 	if (pthread_mutex_init(&video->task_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
+	if (pthread_mutex_init(&video->renditions_mutex, NULL) < 0)
+		return OBS_VIDEO_FAIL;
+	if (!obs_init_video_readback(video))
+		return OBS_VIDEO_FAIL;
 
 #ifdef __APPLE__
 	errorcode = pthread_create(&video->video_thread, NULL,
@@ -434,7 +521,9 @@ static int obs_init_video(struct obs_video_info *ovi)
 	if (errorcode != 0)
 		return OBS_VIDEO_FAIL;
 
+	pthread_mutex_lock(&video->screenshots_mutex);
 	video->thread_initialized = true;
+	pthread_mutex_unlock(&video->screenshots_mutex);
 	video->ovi = *ovi;
 	return OBS_VIDEO_SUCCESS;
 }
@@ -448,11 +537,82 @@ static void stop_video(void)
 		video_output_stop(video->video);
 		if (video->thread_initialized) {
 			pthread_join(video->video_thread, &thread_retval);
+			pthread_mutex_lock(&video->screenshots_mutex);
 			video->thread_initialized = false;
+			pthread_mutex_unlock(&video->screenshots_mutex);
 		}
+
+		/* before sources are freed on shutdown */
+		obs_free_screenshots();
+	}
+
+	/* after the graphics thread, which queues frames for it */
+	if (video->readback_thread_initialized) {
+		os_atomic_set_bool(&video->readback_stop, true);
+		os_sem_post(video->readback_sem);
+		pthread_join(video->readback_thread, &thread_retval);
+		video->readback_thread_initialized = false;
 	}
 }
 
+/* the readback thread may still be copying frames into the rendition's
+ * video output, so wait for it before closing it */
+static void video_rendition_wait_readback(struct obs_video_rendition *rendition)
+{
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
+		struct obs_readback_slot *rs = &rendition->readback_slots[i];
+		if (rs->mapped)
+			os_event_wait(rs->done);
+	}
+}
+
+static void video_rendition_destroy(struct obs_video_rendition *rendition)
+{
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
+		struct obs_readback_slot *rs = &rendition->readback_slots[i];
+
+		if (rs->mapped) {
+			for (size_t c = 0; c < NUM_CHANNELS; c++) {
+				if (rendition->copy_surfaces[i][c])
+					gs_stagesurface_unmap(
+						rendition->copy_surfaces[i][c]);
+			}
+		}
+
+		os_event_destroy(rs->done);
+	}
+
+	for (size_t c = 0; c < NUM_CHANNELS; c++)
+		gs_texture_destroy(rendition->convert_textures[c]);
+
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++)
+		for (size_t c = 0; c < NUM_CHANNELS; c++)
+			gs_stagesurface_destroy(rendition->copy_surfaces[i][c]);
+
+	gs_texture_destroy(rendition->output_texture);
+	circlebuf_free(&rendition->vframe_info_buffer);
+	bfree(rendition);
+}
+
+static void obs_free_video_renditions(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	for (size_t i = 0; i < video->renditions.num; i++) {
+		video_rendition_wait_readback(video->renditions.array[i]);
+		video_output_close(video->renditions.array[i]->video);
+	}
+
+	gs_enter_context(video->graphics);
+	for (size_t i = 0; i < video->renditions.num; i++)
+		video_rendition_destroy(video->renditions.array[i]);
+	gs_leave_context();
+
+	da_free(video->renditions);
+	pthread_mutex_destroy(&video->renditions_mutex);
+	pthread_mutex_init_value(&video->renditions_mutex);
+}
+
 static void obs_free_video(void)
 {
 	struct obs_core_video *video = &obs->video;
@@ -461,20 +621,27 @@ static void obs_free_video(void)
 		video_output_close(video->video);
 		video->video = NULL;
 
+		if (video->graphics)
+			obs_free_video_renditions();
+
 		if (!video->graphics)
 			return;
 
 		gs_enter_context(video->graphics);
 
-		for (size_t c = 0; c < NUM_CHANNELS; c++) {
-			if (video->mapped_surfaces[c]) {
-				gs_stagesurface_unmap(
-					video->mapped_surfaces[c]);
-				video->mapped_surfaces[c] = NULL;
+		for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
+			if (!video->readback_slots[i].mapped)
+				continue;
+
+			for (size_t c = 0; c < NUM_CHANNELS; c++) {
+				if (video->copy_surfaces[i][c])
+					gs_stagesurface_unmap(
+						video->copy_surfaces[i][c]);
 			}
+			video->readback_slots[i].mapped = false;
 		}
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(
@@ -493,7 +660,7 @@ static void obs_free_video(void)
 			}
 		}
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(
@@ -525,6 +692,8 @@ static void obs_free_video(void)
 		pthread_mutex_init_value(&video->task_mutex);
 		circlebuf_free(&video->tasks);
 
+		obs_free_video_readback(video);
+
 		video->gpu_encoder_active = 0;
 		video->cur_texture = 0;
 	}
@@ -829,6 +998,85 @@ static inline void obs_free_hotkeys(void)
 	pthread_mutex_destroy(&hotkeys->mutex);
 }
 
+#define MIN_WORKER_THREADS 2
+#define MAX_WORKER_THREADS 8
+
+static THREAD_LOCAL bool is_worker_thread = false;
+
+static void *obs_worker_thread(void *param)
+{
+	struct obs_core_workers *workers = param;
+
+	is_worker_thread = true;
+	os_set_thread_name("libobs: worker thread");
+
+	/* every task posts the semaphore once, and so does the shutdown for
+	 * each thread, so an empty queue means it's time to stop */
+	while (os_sem_wait(workers->sem) == 0) {
+		struct obs_task_info info;
+
+		pthread_mutex_lock(&workers->mutex);
+		if (!workers->tasks.size) {
+			pthread_mutex_unlock(&workers->mutex);
+			break;
+		}
+		circlebuf_pop_front(&workers->tasks, &info, sizeof(info));
+		pthread_mutex_unlock(&workers->mutex);
+
+		info.task(info.param);
+	}
+
+	return NULL;
+}
+
+static bool obs_init_workers(void)
+{
+	struct obs_core_workers *workers = &obs->workers;
+	int count = os_get_logical_cores();
+
+	if (count < MIN_WORKER_THREADS)
+		count = MIN_WORKER_THREADS;
+	else if (count > MAX_WORKER_THREADS)
+		count = MAX_WORKER_THREADS;
+
+	if (pthread_mutex_init(&workers->mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&workers->sem, 0) != 0)
+		return false;
+
+	for (int i = 0; i < count; i++) {
+		pthread_t thread;
+
+		if (pthread_create(&thread, NULL, obs_worker_thread,
+				   workers) != 0)
+			break;
+		da_push_back(workers->threads, &thread);
+	}
+
+	workers->running = workers->threads.num > 0;
+	return workers->running;
+}
+
+static void obs_free_workers(void)
+{
+	struct obs_core_workers *workers = &obs->workers;
+
+	pthread_mutex_lock(&workers->mutex);
+	workers->running = false;
+	pthread_mutex_unlock(&workers->mutex);
+
+	/* queued tasks still run before the threads exit */
+	for (size_t i = 0; i < workers->threads.num; i++)
+		os_sem_post(workers->sem);
+	for (size_t i = 0; i < workers->threads.num; i++)
+		pthread_join(workers->threads.array[i], NULL);
+
+	da_free(workers->threads);
+	circlebuf_free(&workers->tasks);
+	os_sem_destroy(workers->sem);
+	pthread_mutex_destroy(&workers->mutex);
+}
+
 extern const struct obs_source_info scene_info;
 extern const struct obs_source_info group_info;
 
@@ -856,6 +1104,11 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	pthread_mutex_init_value(&obs->audio.monitoring_mutex);
 	pthread_mutex_init_value(&obs->video.gpu_encoder_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
+	pthread_mutex_init_value(&obs->video.renditions_mutex);
+	pthread_mutex_init_value(&obs->video.screenshots_mutex);
+	pthread_mutex_init_value(&obs->video.readback_mutex);
+	pthread_mutex_init_value(&obs->workers.mutex);
+	pthread_mutex_init_value(&obs->deferred_modules_mutex);
 
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
@@ -872,6 +1125,14 @@ static bool obs_init(const char *locale, const char *module_config_path,
 		return false;
 	if (!obs_init_hotkeys())
 		return false;
+	if (!obs_init_workers())
+		return false;
+	if (!obs_init_file_watcher())
+		return false;
+	if (pthread_mutex_init(&obs->video.screenshots_mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init_recursive(&obs->deferred_modules_mutex) != 0)
+		return false;
 
 	if (module_config_path)
 		obs->module_config_path = bstrdup(module_config_path);
@@ -997,6 +1258,14 @@ void obs_shutdown(void)
 {
 	struct obs_module *module;
 
+	/* traced names may belong to modules which are about to be unloaded */
+	profiler_trace_stop();
+
+	/* worker tasks and file watch callbacks may still be using
+	 * registered types */
+	obs_stop_file_watcher();
+	obs_free_workers();
+
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *item = &obs->source_types.array[i];
 		if (item->type_data && item->free_type_data)
@@ -1040,11 +1309,17 @@ void obs_shutdown(void)
 	}
 	obs->first_module = NULL;
 
+	obs_free_deferred_modules();
+	pthread_mutex_destroy(&obs->deferred_modules_mutex);
+
 	obs_free_data();
+	obs_free_file_watcher();
 	obs_free_audio();
 	obs_free_video();
+	pthread_mutex_destroy(&obs->video.screenshots_mutex);
 	obs_free_hotkeys();
 	obs_free_graphics();
+	obs_packet_pool_trim();
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
 	obs->procs = NULL;
@@ -1217,6 +1492,27 @@ bool obs_reset_audio(const struct obs_audio_info *oai)
 	return obs_init_audio(&ai);
 }
 
+void obs_set_video_readback_depth(uint32_t depth)
+{
+	if (!obs)
+		return;
+
+	if (depth < NUM_TEXTURES)
+		depth = NUM_TEXTURES;
+	else if (depth > MAX_READBACK_DEPTH)
+		depth = MAX_READBACK_DEPTH;
+
+	obs->video.requested_readback_depth = (int)depth;
+}
+
+uint32_t obs_get_video_readback_depth(void)
+{
+	if (!obs)
+		return 0;
+
+	return (uint32_t)obs->video.readback_depth;
+}
+
 bool obs_get_video_info(struct obs_video_info *ovi)
 {
 	struct obs_core_video *video = &obs->video;
@@ -1245,6 +1541,8 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 
 bool obs_enum_source_types(size_t idx, const char **id)
 {
+	if (!idx)
+		obs_load_deferred_modules(OBS_REGISTRY_ANY_SOURCE);
 	if (idx >= obs->source_types.num)
 		return false;
 	*id = obs->source_types.array[idx].id;
@@ -1253,6 +1551,8 @@ bool obs_enum_source_types(size_t idx, const char **id)
 
 bool obs_enum_input_types(size_t idx, const char **id)
 {
+	if (!idx)
+		obs_load_deferred_modules(OBS_REGISTRY_INPUTS);
 	if (idx >= obs->input_types.num)
 		return false;
 	*id = obs->input_types.array[idx].id;
@@ -1262,6 +1562,8 @@ bool obs_enum_input_types(size_t idx, const char **id)
 bool obs_enum_input_types2(size_t idx, const char **id,
 			   const char **unversioned_id)
 {
+	if (!idx)
+		obs_load_deferred_modules(OBS_REGISTRY_INPUTS);
 	if (idx >= obs->input_types.num)
 		return false;
 	if (id)
@@ -1279,6 +1581,8 @@ const char *obs_get_latest_input_type_id(const char *unversioned_id)
 	if (!unversioned_id)
 		return NULL;
 
+	obs_load_deferred_module_for(OBS_REGISTRY_INPUTS, unversioned_id);
+
 	for (size_t i = 0; i < obs->source_types.num; i++) {
 		struct obs_source_info *info = &obs->source_types.array[i];
 		if (strcmp(info->unversioned_id, unversioned_id) == 0 &&
@@ -1297,6 +1601,8 @@ const char *obs_get_latest_input_type_id(const char *unversioned_id)
 
 bool obs_enum_filter_types(size_t idx, const char **id)
 {
+	if (!idx)
+		obs_load_deferred_modules(OBS_REGISTRY_FILTERS);
 	if (idx >= obs->filter_types.num)
 		return false;
 	*id = obs->filter_types.array[idx].id;
@@ -1305,6 +1611,8 @@ bool obs_enum_filter_types(size_t idx, const char **id)
 
 bool obs_enum_transition_types(size_t idx, const char **id)
 {
+	if (!idx)
+		obs_load_deferred_modules(OBS_REGISTRY_TRANSITIONS);
 	if (idx >= obs->transition_types.num)
 		return false;
 	*id = obs->transition_types.array[idx].id;
@@ -1313,6 +1621,8 @@ bool obs_enum_transition_types(size_t idx, const char **id)
 
 bool obs_enum_output_types(size_t idx, const char **id)
 {
+	if (!idx)
+		obs_load_deferred_modules(OBS_REGISTRY_OUTPUTS);
 	if (idx >= obs->output_types.num)
 		return false;
 	*id = obs->output_types.array[idx].id;
@@ -1321,6 +1631,8 @@ bool obs_enum_output_types(size_t idx, const char **id)
 
 bool obs_enum_encoder_types(size_t idx, const char **id)
 {
+	if (!idx)
+		obs_load_deferred_modules(OBS_REGISTRY_ENCODERS);
 	if (idx >= obs->encoder_types.num)
 		return false;
 	*id = obs->encoder_types.array[idx].id;
@@ -1329,6 +1641,8 @@ bool obs_enum_encoder_types(size_t idx, const char **id)
 
 bool obs_enum_service_types(size_t idx, const char **id)
 {
+	if (!idx)
+		obs_load_deferred_modules(OBS_REGISTRY_SERVICES);
 	if (idx >= obs->service_types.num)
 		return false;
 	*id = obs->service_types.array[idx].id;
@@ -1748,7 +2062,19 @@ float obs_get_master_volume(void)
 	return obs->audio.user_volume;
 }
 
-static obs_source_t *obs_load_source_type(obs_data_t *source_data)
+static bool should_defer_create(const char *id, bool parallel)
+{
+	const struct obs_source_info *info = get_source_info(id);
+
+	if (!info || !info->create || info->type != OBS_SOURCE_TYPE_INPUT)
+		return false;
+	if (obs->data.lazy_source_loading)
+		return true;
+	return parallel && (info->output_flags & OBS_SOURCE_ASYNC_CREATE);
+}
+
+static obs_source_t *obs_load_source_type(obs_data_t *source_data,
+					  bool top_level, bool parallel)
 {
 	obs_data_array_t *filters = obs_data_get_array(source_data, "filters");
 	obs_source_t *source;
@@ -1781,8 +2107,9 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 
 	// 在load过程中，添加一个字段，表示loading过程，很多素材需要区分load和非load，干不同的活
 	obs_data_set_bool(settings, "dy_loading", true);
-	source = obs_source_create_set_last_ver(v_id, name, settings, hotkeys,
-						prev_ver);
+	source = obs_source_create_set_last_ver(
+		v_id, name, settings, hotkeys, prev_ver,
+		top_level && should_defer_create(v_id, parallel));
 	if (source->owns_info_id) {
 		bfree((void *)source->info.unversioned_id);
 		source->info.unversioned_id = bstrdup(id);
@@ -1870,7 +2197,7 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 				obs_data_array_item(filters, i);
 
 			obs_source_t *filter =
-				obs_load_source_type(filter_data);
+				obs_load_source_type(filter_data, false, false);
 			if (filter) {
 				obs_source_filter_add(source, filter);
 				obs_source_release(filter);
@@ -1891,7 +2218,42 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 
 obs_source_t *obs_load_source(obs_data_t *source_data)
 {
-	return obs_load_source_type(source_data);
+	return obs_load_source_type(source_data, true, false);
+}
+
+static void create_source_task(void *param)
+{
+	obs_source_t **source = param;
+	obs_source_create_deferred_data(*source);
+}
+
+/* runs the create callbacks of OBS_SOURCE_ASYNC_CREATE sources in parallel
+ * on the worker threads, and waits for all of them */
+static void create_sources_parallel(obs_source_t **sources, size_t count)
+{
+	DARRAY(obs_source_t *) pending;
+
+	da_init(pending);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_source_t *source = sources[i];
+
+		if (source && os_atomic_compare_swap_long(
+				      &source->create_state,
+				      OBS_SOURCE_CREATE_DEFERRED,
+				      OBS_SOURCE_CREATE_QUEUED)) {
+			os_atomic_inc_long(&obs->data.pending_creates);
+			da_push_back(pending, &source);
+		}
+	}
+
+	obs_run_worker_tasks(create_source_task, pending.array,
+			     sizeof(obs_source_t *), pending.num);
+
+	for (size_t i = 0; i < pending.num; i++)
+		obs_source_publish_deferred_data(pending.array[i]);
+
+	da_free(pending);
 }
 
 void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
@@ -1907,17 +2269,30 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 	count = obs_data_array_count(array);
 	da_reserve(sources, count);
 
+	data->load_start_ns = os_gettime_ns();
+	data->load_frame_ready = false;
+	os_atomic_set_bool(&data->load_in_progress, true);
+
 	pthread_mutex_lock(&data->sources_mutex);
 
 	for (i = 0; i < count; i++) {
 		obs_data_t *source_data = obs_data_array_item(array, i);
-		obs_source_t *source = obs_load_source(source_data);
+		obs_source_t *source =
+			obs_load_source_type(source_data, true, true);
 
 		da_push_back(sources, &source);
 
 		obs_data_release(source_data);
 	}
 
+	/* create callbacks may need the sources mutex or the graphics thread,
+	 * so don't hold it while waiting on them */
+	if (!data->lazy_source_loading) {
+		pthread_mutex_unlock(&data->sources_mutex);
+		create_sources_parallel(sources.array, sources.num);
+		pthread_mutex_lock(&data->sources_mutex);
+	}
+
 	/* tell sources that we want to load */
 	for (i = 0; i < sources.num; i++) {
 		obs_source_t *source = sources.array[i];
@@ -1940,6 +2315,19 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 	da_free(sources);
 }
 
+void obs_set_lazy_source_loading(bool lazy)
+{
+	if (!obs)
+		return;
+
+	obs->data.lazy_source_loading = lazy;
+}
+
+bool obs_get_lazy_source_loading(void)
+{
+	return obs ? obs->data.lazy_source_loading : false;
+}
+
 obs_data_t *obs_save_source(obs_source_t *source)
 {
 	obs_data_array_t *filters = obs_data_array_create();
@@ -2360,6 +2748,39 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+void obs_get_latency_stats(const struct histogram *histogram,
+			   struct obs_latency_stats *stats)
+{
+	static const double percentiles[] = {50.0, 90.0, 99.0, 99.9, 100.0};
+	uint64_t values[5];
+
+	stats->count = histogram_get_percentiles(histogram, percentiles, values,
+						 5);
+	stats->p50_ns = values[0];
+	stats->p90_ns = values[1];
+	stats->p99_ns = values[2];
+	stats->p999_ns = values[3];
+	stats->max_ns = values[4];
+}
+
+void obs_get_render_latency(struct obs_latency_stats *stats)
+{
+	if (obs_ptr_valid(stats, "obs_get_render_latency"))
+		obs_get_latency_stats(&obs->video.render_latency, stats);
+}
+
+void obs_get_readback_latency(struct obs_latency_stats *stats)
+{
+	if (obs_ptr_valid(stats, "obs_get_readback_latency"))
+		obs_get_latency_stats(&obs->video.readback_latency, stats);
+}
+
+void obs_get_audio_callback_latency(struct obs_latency_stats *stats)
+{
+	if (obs_ptr_valid(stats, "obs_get_audio_callback_latency"))
+		obs_get_latency_stats(&obs->audio.callback_latency, stats);
+}
+
 void start_raw_video(video_t *v, const struct video_scale_info *conversion,
 		     void (*callback)(void *param, struct video_data *frame),
 		     void *param)
@@ -2395,6 +2816,135 @@ void obs_remove_raw_video_callback(void (*callback)(void *param,
 	stop_raw_video(video->video, callback, param);
 }
 
+static bool video_rendition_init(struct obs_video_rendition *rendition,
+				 enum video_format format)
+{
+	rendition->output_texture =
+		gs_texture_create(rendition->width, rendition->height, GS_RGBA,
+				  1, NULL, GS_RENDER_TARGET);
+	if (!rendition->output_texture)
+		return false;
+
+	if (!create_gpu_convert_textures(rendition->convert_textures,
+					 rendition->width, rendition->height,
+					 format))
+		return false;
+	if (!rendition->convert_textures[0] || !rendition->convert_textures[1])
+		return false;
+
+	for (int i = 0; i < obs->video.readback_depth; i++) {
+		if (!create_gpu_copy_surfaces(rendition->copy_surfaces[i],
+					      rendition->width,
+					      rendition->height, format))
+			return false;
+	}
+
+	for (size_t i = 0; i < MAX_READBACK_DEPTH; i++) {
+		struct obs_readback_slot *rs = &rendition->readback_slots[i];
+		if (os_event_init(&rs->done, OS_EVENT_TYPE_MANUAL) != 0)
+			return false;
+		os_event_signal(rs->done);
+	}
+
+	if (format == VIDEO_FORMAT_I420 || format == VIDEO_FORMAT_NV12)
+		rendition->conversion_width_i = 1.f / (float)rendition->width;
+
+	return true;
+}
+
+video_t *obs_add_video_rendition(uint32_t width, uint32_t height)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_video_rendition *rendition;
+	struct video_output_info vi;
+
+	if (!video->video || !video->graphics)
+		return NULL;
+	if (!video->gpu_conversion) {
+		blog(LOG_WARNING, "obs_add_video_rendition: renditions "
+				  "require GPU conversion");
+		return NULL;
+	}
+	if (!width || !height || (width & 1) || (height & 1)) {
+		blog(LOG_WARNING,
+		     "obs_add_video_rendition: invalid size %" PRIu32
+		     "x%" PRIu32,
+		     width, height);
+		return NULL;
+	}
+
+	vi = *video_output_get_info(video->video);
+	vi.name = "rendition";
+	vi.width = width;
+	vi.height = height;
+
+	rendition = bzalloc(sizeof(struct obs_video_rendition));
+	rendition->width = width;
+	rendition->height = height;
+
+	if (video_output_open(&rendition->video, &vi) != VIDEO_OUTPUT_SUCCESS) {
+		blog(LOG_WARNING, "obs_add_video_rendition: could not open "
+				  "video output");
+		bfree(rendition);
+		return NULL;
+	}
+
+	gs_enter_context(video->graphics);
+	if (!video_rendition_init(rendition, vi.format)) {
+		video_output_close(rendition->video);
+		video_rendition_destroy(rendition);
+		gs_leave_context();
+		blog(LOG_WARNING, "obs_add_video_rendition: failed to create "
+				  "textures");
+		return NULL;
+	}
+	gs_leave_context();
+
+	pthread_mutex_lock(&video->renditions_mutex);
+	da_push_back(video->renditions, &rendition);
+	pthread_mutex_unlock(&video->renditions_mutex);
+
+	blog(LOG_INFO, "Added video rendition: %" PRIu32 "x%" PRIu32, width,
+	     height);
+	return rendition->video;
+}
+
+bool obs_remove_video_rendition(video_t *v)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_video_rendition *rendition = NULL;
+
+	if (!v || !video->graphics)
+		return false;
+	if (video_output_active(v)) {
+		blog(LOG_WARNING, "obs_remove_video_rendition: rendition "
+				  "still has active encoders");
+		return false;
+	}
+
+	gs_enter_context(video->graphics);
+	pthread_mutex_lock(&video->renditions_mutex);
+
+	for (size_t i = 0; i < video->renditions.num; i++) {
+		if (video->renditions.array[i]->video == v) {
+			rendition = video->renditions.array[i];
+			da_erase(video->renditions, i);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&video->renditions_mutex);
+
+	if (rendition) {
+		video_rendition_wait_readback(rendition);
+		video_output_close(rendition->video);
+		video_rendition_destroy(rendition);
+	}
+
+	gs_leave_context();
+	return rendition != NULL;
+}
+
 void obs_apply_private_data(obs_data_t *settings)
 {
 	if (!settings)
@@ -2488,6 +3038,12 @@ bool obs_nv12_tex_active(void)
 	return video->using_nv12_tex;
 }
 
+bool obs_nv12_planes_active(void)
+{
+	struct obs_core_video *video = &obs->video;
+	return video->using_nv12_planes;
+}
+
 /* ------------------------------------------------------------------------- */
 /* task stuff                                                                */
 
@@ -2512,6 +3068,8 @@ static bool in_task_thread(enum obs_task_type type)
 
 	if (type == OBS_TASK_GRAPHICS)
 		return is_graphics_thread;
+	if (type == OBS_TASK_WORKER)
+		return is_worker_thread;
 
 	assert(false);
 	return false;
@@ -2540,6 +3098,24 @@ void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param,
 			obs_queue_task(type, task_wait_callback, &info, false);
 			os_event_wait(info.event);
 			os_event_destroy(info.event);
+		} else if (type == OBS_TASK_WORKER) {
+			struct obs_core_workers *workers = &obs->workers;
+			struct obs_task_info info = {task, param};
+			bool queued = false;
+
+			pthread_mutex_lock(&workers->mutex);
+			if (workers->running) {
+				circlebuf_push_back(&workers->tasks, &info,
+						    sizeof(info));
+				queued = true;
+			}
+			pthread_mutex_unlock(&workers->mutex);
+
+			/* during shutdown, just run the task here */
+			if (queued)
+				os_sem_post(workers->sem);
+			else
+				task(param);
 		} else {
 			struct obs_core_video *video = &obs->video;
 			struct obs_task_info info = {task, param};
@@ -2551,6 +3127,56 @@ void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param,
 	}
 }
 
+struct worker_batch {
+	obs_task_t task;
+	os_event_t *event;
+	volatile long remaining;
+};
+
+struct worker_batch_item {
+	struct worker_batch *batch;
+	void *param;
+};
+
+static void worker_batch_task(void *param)
+{
+	struct worker_batch_item *item = param;
+	struct worker_batch *batch = item->batch;
+
+	batch->task(item->param);
+	if (os_atomic_dec_long(&batch->remaining) == 0)
+		os_event_signal(batch->event);
+}
+
+void obs_run_worker_tasks(obs_task_t task, void *array, size_t element_size,
+			  size_t count)
+{
+	struct worker_batch batch = {task, NULL, (long)count};
+	struct worker_batch_item *items;
+	uint8_t *params = array;
+
+	if (!count)
+		return;
+
+	if (count == 1 || os_event_init(&batch.event, OS_EVENT_TYPE_MANUAL)) {
+		for (size_t i = 0; i < count; i++)
+			task(params + i * element_size);
+		return;
+	}
+
+	items = bmalloc(count * sizeof(*items));
+	for (size_t i = 0; i < count; i++) {
+		items[i].batch = &batch;
+		items[i].param = params + i * element_size;
+		obs_queue_task(OBS_TASK_WORKER, worker_batch_task, &items[i],
+			       false);
+	}
+
+	os_event_wait(batch.event);
+	os_event_destroy(batch.event);
+	bfree(items);
+}
+
 void obs_set_ui_task_handler(obs_task_handler_t handler)
 {
 	obs->ui_task_handler = handler;
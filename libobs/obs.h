@@ -397,6 +397,17 @@ EXPORT bool obs_reset_audio(const struct obs_audio_info *oai);
 /** Gets the current video settings, returns false if no video */
 EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
 
+/**
+ * Sets how many frames can be in flight between rendering and CPU readback
+ * of the output (2 to 8, default 2).  Higher values avoid stalling the
+ * graphics thread on slow readbacks at the cost of latency.  Takes effect
+ * on the next obs_reset_video.
+ */
+EXPORT void obs_set_video_readback_depth(uint32_t depth);
+
+/** Gets the readback depth currently in use, 0 if no video */
+EXPORT uint32_t obs_get_video_readback_depth(void);
+
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
@@ -716,6 +727,14 @@ typedef void (*obs_load_source_cb)(void *private_data, obs_source_t *source);
 EXPORT void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 			     void *private_data);
 
+/**
+ * Enables or disables lazy loading.  When enabled, input sources loaded with
+ * obs_load_source/obs_load_sources are not created until they are first
+ * shown or activated.
+ */
+EXPORT void obs_set_lazy_source_loading(bool lazy);
+EXPORT bool obs_get_lazy_source_loading(void);
+
 /** Saves sources to a data array */
 EXPORT obs_data_array_t *obs_save_sources(void);
 
@@ -763,6 +782,24 @@ EXPORT void obs_add_raw_video_callback(
 EXPORT void obs_remove_raw_video_callback(
 	void (*callback)(void *param, struct video_data *frame), void *param);
 
+/**
+ * Adds a scaled rendition of the main output (an encoding ladder step).
+ *
+ *   Renditions are scaled from the base canvas and converted to the output
+ * format on the GPU in the same render pass as the main output, and each one
+ * gets its own video output thread, so encoders attached to different
+ * renditions encode in parallel.  Attach encoders to a rendition with
+ * obs_encoder_set_video.  Requires GPU conversion, and renditions are removed
+ * when video is reset.
+ *
+ * @return  The video output of the rendition, or NULL on failure
+ */
+EXPORT video_t *obs_add_video_rendition(uint32_t width, uint32_t height);
+
+/** Removes a rendition added with obs_add_video_rendition.  The rendition must
+ * not have any active encoders. */
+EXPORT bool obs_remove_video_rendition(video_t *video);
+
 EXPORT uint64_t obs_get_video_frame_time(void);
 
 EXPORT double obs_get_active_fps(void);
@@ -772,8 +809,40 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/**
+ * Latency percentiles over the last 10 to 20 seconds.  Percentiles are
+ * rounded up and accurate to within ~3%.  All values are zero if nothing was
+ * measured in that time.
+ */
+struct obs_latency_stats {
+	uint64_t count;
+	uint64_t p50_ns;
+	uint64_t p90_ns;
+	uint64_t p99_ns;
+	uint64_t p999_ns;
+	uint64_t max_ns;
+};
+
+/** Gets how long the graphics thread takes to render each frame */
+EXPORT void obs_get_render_latency(struct obs_latency_stats *stats);
+
+/**
+ * Gets how long it takes for output frames to be read back from the GPU,
+ * from when their conversion is staged to when they're mapped
+ */
+EXPORT void obs_get_readback_latency(struct obs_latency_stats *stats);
+
+/** Gets how long the audio thread takes to mix each audio tick */
+EXPORT void obs_get_audio_callback_latency(struct obs_latency_stats *stats);
+
 EXPORT bool obs_nv12_tex_active(void);
 
+/**
+ * Returns whether NV12 output is rendered to separate Y (R8) and UV (R8G8)
+ * textures that texture encoders can consume through encode_texture2.
+ */
+EXPORT bool obs_nv12_planes_active(void);
+
 EXPORT void obs_apply_private_data(obs_data_t *settings);
 EXPORT void obs_set_private_data(obs_data_t *settings);
 EXPORT obs_data_t *obs_get_private_data(void);
@@ -783,6 +852,7 @@ typedef void (*obs_task_t)(void *param);
 enum obs_task_type {
 	OBS_TASK_UI,
 	OBS_TASK_GRAPHICS,
+	OBS_TASK_WORKER,
 };
 
 EXPORT void obs_queue_task(enum obs_task_type type, obs_task_t task,
@@ -791,6 +861,52 @@ EXPORT void obs_queue_task(enum obs_task_type type, obs_task_t task,
 typedef void (*obs_task_handler_t)(obs_task_t task, void *param, bool wait);
 EXPORT void obs_set_ui_task_handler(obs_task_handler_t handler);
 
+/* ------------------------------------------------------------------------- */
+/* Screenshots */
+
+/**
+ * Called with the RGBA pixels of a screenshot, or with NULL data if it could
+ * not be taken.  The data is only valid for the duration of the callback.
+ */
+typedef void (*obs_source_screenshot_t)(void *param, const uint8_t *data,
+					uint32_t linesize, uint32_t cx,
+					uint32_t cy);
+
+/**
+ * Takes a screenshot of a source, scaled to cx by cy (0 for the source's own
+ * size).  Screenshots are rendered together during the next frame and read
+ * back without stalling the graphics thread; the callback is called from a
+ * worker thread.  Returns false, without calling the callback, if the
+ * screenshot could not be queued.
+ */
+EXPORT bool obs_source_screenshot(obs_source_t *source, uint32_t cx,
+				  uint32_t cy, obs_source_screenshot_t callback,
+				  void *param);
+
+/* ------------------------------------------------------------------------- */
+/* File watching */
+
+typedef struct obs_file_watch obs_file_watch_t;
+typedef void (*obs_file_watch_cb)(void *param, const char *path);
+
+/**
+ * Watches a file or directory for changes.  The callback is called from the
+ * file watch thread after the file is created, written, replaced or removed;
+ * bursts of changes are reported once.  For a directory, the callback is
+ * called with the path of each entry that changed, or with the directory
+ * itself when changed entries aren't known.
+ */
+EXPORT obs_file_watch_t *obs_file_watch_add(const char *path,
+					    obs_file_watch_cb callback,
+					    void *param);
+
+/**
+ * Stops watching.  Once this returns the callback is no longer being called,
+ * so it is safe to free whatever it uses.  Only waits for this watch's own
+ * callback.  May be called from the callback.
+ */
+EXPORT void obs_file_watch_remove(obs_file_watch_t *watch);
+
 /* ------------------------------------------------------------------------- */
 /* View context */
 
@@ -1173,6 +1289,41 @@ EXPORT void obs_source_add_audio_capture_callback(
 EXPORT void obs_source_remove_audio_capture_callback(
 	obs_source_t *source, obs_source_audio_capture_t callback, void *param);
 
+/**
+ * Audio levels of a source, measured once per audio chunk it outputs and
+ * shared by everything metering it.  Values are linear and do not include
+ * the source's volume.
+ */
+struct obs_audio_levels {
+	int channels;
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float peak[MAX_AUDIO_CHANNELS];
+	float true_peak[MAX_AUDIO_CHANNELS];
+	bool muted;
+	uint64_t timestamp;
+};
+
+typedef void (*obs_source_audio_levels_t)(
+	void *param, obs_source_t *source,
+	const struct obs_audio_levels *levels);
+
+/** Adds a callback receiving the levels each time they are measured */
+EXPORT void obs_source_add_audio_levels_callback(
+	obs_source_t *source, obs_source_audio_levels_t callback, void *param);
+EXPORT void obs_source_remove_audio_levels_callback(
+	obs_source_t *source, obs_source_audio_levels_t callback, void *param);
+
+/** Keeps the levels of a source measured, for polling them */
+EXPORT void obs_source_inc_audio_levels(obs_source_t *source);
+EXPORT void obs_source_dec_audio_levels(obs_source_t *source);
+
+/**
+ * Gets the most recently measured levels of a source without locking.
+ * Returns false if they have not been measured yet.
+ */
+EXPORT bool obs_source_get_audio_levels(obs_source_t *source,
+					struct obs_audio_levels *levels);
+
 typedef void (*obs_source_caption_t)(void *param, obs_source_t *source,
 				     const struct obs_source_cea_708 *captions);
 
@@ -2007,6 +2158,17 @@ EXPORT uint64_t obs_output_get_total_bytes(const obs_output_t *output);
 EXPORT int obs_output_get_frames_dropped(const obs_output_t *output);
 EXPORT int obs_output_get_total_frames(const obs_output_t *output);
 
+/**
+ * Gets how long after their frame was captured packets are handed to the
+ * output, which includes encoding and interleaving but not the stream delay
+ */
+EXPORT void obs_output_get_interleave_latency(const obs_output_t *output,
+					      struct obs_latency_stats *stats);
+
+/** Gets how long the output takes to accept each packet */
+EXPORT void obs_output_get_send_latency(const obs_output_t *output,
+					struct obs_latency_stats *stats);
+
 /**
  * Sets the preferred scaled resolution for this output.  Set width and height
  * to 0 to disable scaling.
@@ -2222,6 +2384,14 @@ EXPORT bool obs_encoder_get_extra_data(const obs_encoder_t *encoder,
 /** Returns the current settings for this encoder */
 EXPORT obs_data_t *obs_encoder_get_settings(const obs_encoder_t *encoder);
 
+/** Returns the signal handler for an encoder */
+EXPORT signal_handler_t *
+obs_encoder_get_signal_handler(const obs_encoder_t *encoder);
+
+/** Returns the procedure handler for an encoder */
+EXPORT proc_handler_t *
+obs_encoder_get_proc_handler(const obs_encoder_t *encoder);
+
 /** Sets the video output context to be used with this encoder */
 EXPORT void obs_encoder_set_video(obs_encoder_t *encoder, video_t *video);
 
@@ -2243,6 +2413,10 @@ EXPORT audio_t *obs_encoder_audio(const obs_encoder_t *encoder);
 /** Returns true if encoder is active, false otherwise */
 EXPORT bool obs_encoder_active(const obs_encoder_t *encoder);
 
+/** Gets how long each call to the encoder's encode function takes */
+EXPORT void obs_encoder_get_encode_latency(const obs_encoder_t *encoder,
+					   struct obs_latency_stats *stats);
+
 EXPORT void *obs_encoder_get_type_data(obs_encoder_t *encoder);
 
 EXPORT const char *obs_encoder_get_id(const obs_encoder_t *encoder);
@@ -2264,6 +2438,17 @@ EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst,
 				   struct encoder_packet *src);
 EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
 
+struct obs_encoder_packet_stats {
+	uint64_t live_packets;
+	uint64_t live_bytes;
+	uint64_t cached_bytes;
+	uint64_t pool_hits;
+	uint64_t pool_misses;
+};
+
+/** Gets allocation statistics for encoder packet payloads */
+EXPORT void obs_encoder_get_packet_stats(struct obs_encoder_packet_stats *stats);
+
 EXPORT void *obs_encoder_create_rerouted(obs_encoder_t *encoder,
 					 const char *reroute_id);
 
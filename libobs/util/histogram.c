@@ -0,0 +1,112 @@
+#include "histogram.h"
+#include "platform.h"
+#include "threading.h"
+
+#include <string.h>
+
+#define HALF_SUB_BUCKETS (1ULL << (HISTOGRAM_SUB_BUCKET_BITS - 1))
+#define MAX_VALUE ((1ULL << HISTOGRAM_MAX_BITS) - 1)
+
+static inline int highest_bit(uint64_t value)
+{
+	int bit = 0;
+	while (value >>= 1)
+		bit++;
+	return bit;
+}
+
+static size_t bucket_index(uint64_t value)
+{
+	int shift;
+
+	if (value > MAX_VALUE)
+		value = MAX_VALUE;
+	if (value < HALF_SUB_BUCKETS * 2)
+		return (size_t)value;
+
+	shift = highest_bit(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+	return (size_t)((shift + 1) * HALF_SUB_BUCKETS +
+			((value >> shift) - HALF_SUB_BUCKETS));
+}
+
+static uint64_t bucket_highest_value(size_t idx)
+{
+	uint64_t shift;
+
+	if (idx < HALF_SUB_BUCKETS * 2)
+		return idx;
+
+	shift = idx / HALF_SUB_BUCKETS - 1;
+	return ((HALF_SUB_BUCKETS + idx % HALF_SUB_BUCKETS + 1) << shift) - 1;
+}
+
+/* window ids start at 1 so that a zeroed histogram has no valid window */
+static inline long current_window_id(void)
+{
+	return (long)(os_gettime_ns() / HISTOGRAM_WINDOW_NS) + 1;
+}
+
+void histogram_record(struct histogram *h, uint64_t value)
+{
+	long id = current_window_id();
+	size_t slot = (size_t)id & 1;
+	long prev = os_atomic_load_long(&h->window_ids[slot]);
+
+	if (prev != id &&
+	    os_atomic_compare_swap_long(&h->window_ids[slot], prev, id)) {
+		for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+			os_atomic_set_long(&h->counts[slot][i], 0);
+	}
+
+	os_atomic_inc_long(&h->counts[slot][bucket_index(value)]);
+}
+
+uint64_t histogram_get_percentiles(const struct histogram *h,
+				   const double *percentiles, uint64_t *values,
+				   size_t num)
+{
+	uint64_t counts[HISTOGRAM_BUCKETS] = {0};
+	long id = current_window_id();
+	uint64_t total = 0;
+
+	/* counts keep changing while they're read, so take a copy first */
+	for (size_t slot = 0; slot < 2; slot++) {
+		long slot_id = os_atomic_load_long(&h->window_ids[slot]);
+		if (slot_id != id && slot_id != id - 1)
+			continue;
+
+		for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+			uint64_t count = (uint64_t)os_atomic_load_long(
+				&h->counts[slot][i]);
+			counts[i] += count;
+			total += count;
+		}
+	}
+
+	memset(values, 0, num * sizeof(*values));
+	if (!total)
+		return 0;
+
+	for (size_t p = 0; p < num; p++) {
+		double rank = percentiles[p] / 100.0 * (double)total;
+		uint64_t target = (uint64_t)rank;
+		uint64_t seen = 0;
+
+		if ((double)target < rank)
+			target++;
+		if (target < 1)
+			target = 1;
+		if (target > total)
+			target = total;
+
+		for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+			seen += counts[i];
+			if (seen >= target) {
+				values[p] = bucket_highest_value(i);
+				break;
+			}
+		}
+	}
+
+	return total;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "c99defs.h"
+
+/*
+ *   Rolling latency histogram.
+ *
+ *   Values are counted in log-linear buckets: exact below
+ * 2^HISTOGRAM_SUB_BUCKET_BITS, then each power of two is split into
+ * 2^(HISTOGRAM_SUB_BUCKET_BITS - 1) linear buckets, so any percentile read
+ * back is within ~3% of the recorded value.  Values from
+ * 2^HISTOGRAM_MAX_BITS upwards are clamped.
+ *
+ *   Counts go into one of two alternating windows of HISTOGRAM_WINDOW_NS
+ * each, and a window is cleared when it's reused, so the percentiles cover
+ * the last one to two windows.  Recording is lock-free and may be done from
+ * any thread; a value recorded while a window is being cleared may be lost.
+ * A zeroed histogram is ready to use.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTOGRAM_SUB_BUCKET_BITS 6
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_WINDOW_NS 10000000000ULL
+
+#define HISTOGRAM_BUCKETS                                      \
+	((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS + 2) \
+	 << (HISTOGRAM_SUB_BUCKET_BITS - 1))
+
+struct histogram {
+	volatile long window_ids[2];
+	volatile long counts[2][HISTOGRAM_BUCKETS];
+};
+
+EXPORT void histogram_record(struct histogram *h, uint64_t value);
+
+/* Fills values with the given percentiles (0.0-100.0, 100.0 being the
+ * maximum) and returns the number of values they were taken from.  Values
+ * are the highest value of the bucket each percentile falls in, and are all
+ * zero if nothing was recorded. */
+EXPORT uint64_t histogram_get_percentiles(const struct histogram *h,
+					  const double *percentiles,
+					  uint64_t *values, size_t num);
+
+#ifdef __cplusplus
+}
+#endif
@@ -365,8 +365,412 @@ static void merge_context(profile_call *context)
 	free_call_context(prev_call);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Tracing */
+
+/*
+ * While a trace is running every profile_start/profile_end is also recorded
+ * as an event into a ring buffer owned by the calling thread.  Each ring has
+ * exactly one writer (its thread) and one reader (the trace thread), so
+ * recording an event takes no locks.  The trace thread drains all rings
+ * every TRACE_FLUSH_INTERVAL_MS and appends the events to the trace file in
+ * the Chrome trace event format.
+ *
+ * Rings are never freed while the profiler is alive.  Once the thread owning
+ * one has exited and its events have been written, it's handed to the next
+ * thread which starts recording.
+ */
+
+#define TRACE_BUFFER_EVENTS 16384
+#define TRACE_FLUSH_INTERVAL_MS 250
+
+struct trace_event {
+	const char *name;
+	uint64_t ts;
+	bool end;
+};
+
+struct trace_buffer {
+	struct trace_buffer *next;
+
+	/* written by the owning thread */
+	volatile long write_pos;
+	long generation;
+	long open_depth;
+	long dropped_depth;
+
+	/* written by the trace thread */
+	volatile long read_pos;
+	long depth;
+	bool named;
+
+	volatile bool exited;
+	volatile bool available;
+	uint32_t tid;
+
+	struct trace_event events[TRACE_BUFFER_EVENTS];
+};
+
+static volatile bool trace_enabled = false;
+static volatile long trace_generation = 0;
+static volatile long trace_dropped = 0;
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_buffer *trace_buffers = NULL;
+static uint32_t trace_next_tid = 1;
+static bool trace_key_created = false;
+static pthread_key_t trace_key;
+
+static FILE *trace_file = NULL;
+static pthread_t trace_thread;
+static os_event_t *trace_stop_event = NULL;
+static uint64_t trace_start_time = 0;
+static uint64_t trace_written = 0;
+static bool trace_first_event = true;
+
+static THREAD_LOCAL struct trace_buffer *thread_trace_buffer = NULL;
+
+static void trace_thread_exited(void *param)
+{
+	struct trace_buffer *buffer = param;
+	os_atomic_set_bool(&buffer->exited, true);
+}
+
+static struct trace_buffer *trace_register_thread(void)
+{
+	struct trace_buffer *buffer = NULL;
+
+	pthread_mutex_lock(&trace_mutex);
+
+	for (struct trace_buffer *cur = trace_buffers; cur; cur = cur->next) {
+		if (os_atomic_load_bool(&cur->available)) {
+			buffer = cur;
+			break;
+		}
+	}
+
+	if (!buffer) {
+		buffer = bzalloc(sizeof(*buffer));
+		buffer->next = trace_buffers;
+		trace_buffers = buffer;
+	}
+
+	buffer->tid = trace_next_tid++;
+	buffer->open_depth = 0;
+	buffer->dropped_depth = 0;
+	buffer->generation = os_atomic_load_long(&trace_generation);
+	os_atomic_set_bool(&buffer->exited, false);
+	os_atomic_set_bool(&buffer->available, false);
+
+	if (trace_key_created)
+		pthread_setspecific(trace_key, buffer);
+
+	pthread_mutex_unlock(&trace_mutex);
+
+	return buffer;
+}
+
+static void trace_event(const char *name, uint64_t ts, bool end)
+{
+	struct trace_buffer *buffer = thread_trace_buffer;
+	long generation = os_atomic_load_long(&trace_generation);
+	unsigned long write_pos, read_pos, used;
+
+	if (!buffer)
+		buffer = thread_trace_buffer = trace_register_thread();
+
+	/* scopes still open from an earlier trace aren't tracked */
+	if (buffer->generation != generation) {
+		buffer->generation = generation;
+		buffer->open_depth = 0;
+		buffer->dropped_depth = 0;
+	}
+
+	if (end) {
+		if (buffer->dropped_depth) {
+			buffer->dropped_depth--;
+			return;
+		}
+		if (!buffer->open_depth)
+			return;
+	}
+
+	write_pos = (unsigned long)os_atomic_load_long(&buffer->write_pos);
+	read_pos = (unsigned long)os_atomic_load_long(&buffer->read_pos);
+	used = write_pos - read_pos;
+
+	/* drop whole scopes: a begin is only recorded if its end, and the
+	 * ends of all enclosing scopes, are guaranteed to fit as well */
+	if (!end && (buffer->dropped_depth ||
+		     used + (unsigned long)buffer->open_depth + 2 >
+			     TRACE_BUFFER_EVENTS)) {
+		buffer->dropped_depth++;
+		os_atomic_inc_long(&trace_dropped);
+		return;
+	}
+
+	struct trace_event *event =
+		&buffer->events[write_pos % TRACE_BUFFER_EVENTS];
+	event->name = name;
+	event->ts = ts;
+	event->end = end;
+
+	if (end)
+		buffer->open_depth--;
+	else
+		buffer->open_depth++;
+
+	os_atomic_set_long(&buffer->write_pos, (long)(write_pos + 1));
+}
+
+static void trace_write_string(struct dstr *out, const char *str)
+{
+	dstr_cat_ch(out, '"');
+
+	for (; *str; str++) {
+		unsigned char ch = (unsigned char)*str;
+
+		if (ch == '"' || ch == '\\') {
+			dstr_cat_ch(out, '\\');
+			dstr_cat_ch(out, (char)ch);
+		} else if (ch < 0x20) {
+			dstr_catf(out, "\\u%04x", ch);
+		} else {
+			dstr_cat_ch(out, (char)ch);
+		}
+	}
+
+	dstr_cat_ch(out, '"');
+}
+
+static void trace_write_separator(struct dstr *out)
+{
+	if (!trace_first_event)
+		dstr_cat(out, ",\n");
+	trace_first_event = false;
+}
+
+static void trace_drain_buffer(struct trace_buffer *buffer, struct dstr *out)
+{
+	unsigned long write_pos =
+		(unsigned long)os_atomic_load_long(&buffer->write_pos);
+	unsigned long read_pos =
+		(unsigned long)os_atomic_load_long(&buffer->read_pos);
+
+	for (; read_pos != write_pos; read_pos++) {
+		struct trace_event *event =
+			&buffer->events[read_pos % TRACE_BUFFER_EVENTS];
+
+		/* events recorded before the trace started */
+		if (event->ts < trace_start_time)
+			continue;
+
+		if (event->end) {
+			if (!buffer->depth)
+				continue;
+			buffer->depth--;
+		} else {
+			/* threads are named after their outermost scope */
+			if (!buffer->depth && !buffer->named) {
+				trace_write_separator(out);
+				dstr_catf(out,
+					  "{\"name\":\"thread_name\","
+					  "\"ph\":\"M\",\"pid\":1,"
+					  "\"tid\":%" PRIu32 ","
+					  "\"args\":{\"name\":",
+					  buffer->tid);
+				trace_write_string(out, event->name);
+				dstr_cat(out, "}}");
+				buffer->named = true;
+			}
+			buffer->depth++;
+		}
+
+		trace_write_separator(out);
+		dstr_cat(out, "{\"name\":");
+		trace_write_string(out, event->name);
+		dstr_catf(out,
+			  ",\"ph\":\"%c\",\"ts\":%.3f,"
+			  "\"pid\":1,\"tid\":%" PRIu32 "}",
+			  event->end ? 'E' : 'B',
+			  (double)(event->ts - trace_start_time) / 1000.0,
+			  buffer->tid);
+		trace_written++;
+	}
+
+	os_atomic_set_long(&buffer->read_pos, (long)read_pos);
+}
+
+static void trace_flush(void)
+{
+	struct trace_buffer *buffers;
+	struct dstr out = {0};
+
+	/* the list only ever grows at the head */
+	pthread_mutex_lock(&trace_mutex);
+	buffers = trace_buffers;
+	pthread_mutex_unlock(&trace_mutex);
+
+	for (struct trace_buffer *cur = buffers; cur; cur = cur->next) {
+		if (os_atomic_load_bool(&cur->available))
+			continue;
+
+		bool exited = os_atomic_load_bool(&cur->exited);
+
+		trace_drain_buffer(cur, &out);
+
+		if (exited) {
+			pthread_mutex_lock(&trace_mutex);
+			cur->depth = 0;
+			cur->named = false;
+			os_atomic_set_bool(&cur->available, true);
+			pthread_mutex_unlock(&trace_mutex);
+		}
+	}
+
+	if (out.len) {
+		fwrite(out.array, 1, out.len, trace_file);
+		fflush(trace_file);
+	}
+
+	dstr_free(&out);
+}
+
+static void *trace_thread_func(void *unused)
+{
+	os_set_thread_name("profiler: trace");
+
+	while (os_event_timedwait(trace_stop_event, TRACE_FLUSH_INTERVAL_MS) ==
+	       ETIMEDOUT)
+		trace_flush();
+
+	trace_flush();
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+bool profiler_trace_start(const char *filename)
+{
+	bool success = false;
+
+	pthread_mutex_lock(&trace_mutex);
+
+	if (trace_file)
+		goto out;
+
+	if (!trace_key_created) {
+		if (pthread_key_create(&trace_key, trace_thread_exited) != 0)
+			goto out;
+		trace_key_created = true;
+	}
+
+	trace_file = os_fopen(filename, "wb");
+	if (!trace_file) {
+		blog(LOG_WARNING, "Failed to open profiler trace file '%s'",
+		     filename);
+		goto out;
+	}
+
+	if (os_event_init(&trace_stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+
+	/* skip whatever is left over from the last trace */
+	for (struct trace_buffer *cur = trace_buffers; cur; cur = cur->next) {
+		os_atomic_set_long(&cur->read_pos,
+				   os_atomic_load_long(&cur->write_pos));
+		cur->depth = 0;
+		cur->named = false;
+	}
+
+	fputs("[\n", trace_file);
+	trace_first_event = true;
+	trace_written = 0;
+	trace_start_time = os_gettime_ns();
+	os_atomic_set_long(&trace_dropped, 0);
+
+	if (pthread_create(&trace_thread, NULL, trace_thread_func, NULL) != 0)
+		goto fail;
+
+	os_atomic_inc_long(&trace_generation);
+	os_atomic_set_bool(&trace_enabled, true);
+
+	blog(LOG_INFO, "Started profiler trace to '%s'", filename);
+	success = true;
+	goto out;
+
+fail:
+	os_event_destroy(trace_stop_event);
+	trace_stop_event = NULL;
+	fclose(trace_file);
+	trace_file = NULL;
+out:
+	pthread_mutex_unlock(&trace_mutex);
+	return success;
+}
+
+void profiler_trace_stop(void)
+{
+	pthread_mutex_lock(&trace_mutex);
+	if (!trace_file) {
+		pthread_mutex_unlock(&trace_mutex);
+		return;
+	}
+
+	os_atomic_set_bool(&trace_enabled, false);
+	pthread_mutex_unlock(&trace_mutex);
+
+	/* the trace thread takes trace_mutex while flushing */
+	os_event_signal(trace_stop_event);
+	pthread_join(trace_thread, NULL);
+
+	pthread_mutex_lock(&trace_mutex);
+	fputs("\n]\n", trace_file);
+	fclose(trace_file);
+	trace_file = NULL;
+
+	os_event_destroy(trace_stop_event);
+	trace_stop_event = NULL;
+
+	blog(LOG_INFO,
+	     "Stopped profiler trace, %" PRIu64 " events written, %ld dropped",
+	     trace_written, os_atomic_load_long(&trace_dropped));
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+bool profiler_trace_active(void)
+{
+	return os_atomic_load_bool(&trace_enabled);
+}
+
+static void trace_free(void)
+{
+	profiler_trace_stop();
+
+	pthread_mutex_lock(&trace_mutex);
+
+	while (trace_buffers) {
+		struct trace_buffer *next = trace_buffers->next;
+		bfree(trace_buffers);
+		trace_buffers = next;
+	}
+
+	if (trace_key_created) {
+		pthread_key_delete(trace_key);
+		trace_key_created = false;
+	}
+
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Profiling */
+
 void profile_start(const char *name)
 {
+	if (os_atomic_load_bool(&trace_enabled))
+		trace_event(name, os_gettime_ns(), false);
+
 	if (!thread_enabled)
 		return;
 
@@ -395,6 +799,10 @@ void profile_start(const char *name)
 void profile_end(const char *name)
 {
 	uint64_t end = os_gettime_ns();
+
+	if (os_atomic_load_bool(&trace_enabled))
+		trace_event(name, end, true);
+
 	if (!thread_enabled)
 		return;
 
@@ -827,6 +1235,8 @@ void profiler_free(void)
 	da_free(old_root_entries);
 
 	pthread_mutex_destroy(&root_mutex);
+
+	trace_free();
 }
 
 /* ------------------------------------------------------------------------- */
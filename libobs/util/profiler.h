@@ -33,6 +33,16 @@ EXPORT void profiler_print_time_between_calls(profiler_snapshot_t *snap);
 
 EXPORT void profiler_free(void);
 
+/* ------------------------------------------------------------------------- */
+/* Tracing */
+
+/* Records every profiled call on every thread until stopped, and writes
+ * them to a Chrome trace event file (chrome://tracing, ui.perfetto.dev).
+ * Names passed to profile_start must stay valid until the trace stops. */
+EXPORT bool profiler_trace_start(const char *filename);
+EXPORT void profiler_trace_stop(void);
+EXPORT bool profiler_trace_active(void);
+
 /* ------------------------------------------------------------------------- */
 /* Profiler name storage */
 
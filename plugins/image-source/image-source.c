@@ -1,8 +1,8 @@
 #include <obs-module.h>
 #include <graphics/image-file.h>
 #include <util/platform.h>
+#include <util/threading.h>
 #include <util/dstr.h>
-#include <sys/stat.h>
 
 #define blog(log_level, format, ...)                    \
 	blog(log_level, "[image_source: '%s'] " format, \
@@ -12,28 +12,42 @@
 #define info(format, ...) blog(LOG_INFO, format, ##__VA_ARGS__)
 #define warn(format, ...) blog(LOG_WARNING, format, ##__VA_ARGS__)
 
+/*
+ * Images are decoded on the libobs worker pool; the finished image is picked
+ * up in video_tick and only the texture upload happens in the graphics
+ * context.  The previous texture stays up until the new one is ready.
+ */
+struct image_decode {
+	volatile long refs;
+	volatile bool done;
+	volatile bool cancelled;
+
+	char *file;
+	enum gs_image_alpha_mode alpha_mode;
+	uint64_t gif_memory_limit;
+	gs_image_file4_t if4;
+};
+
 struct image_source {
 	obs_source_t *source;
 
 	char *file;
 	bool persistent;
+	bool on_demand;
 	bool linear_alpha;
-	time_t file_timestamp;
-	float update_time_elapsed;
+	uint64_t gif_memory_limit;
+	obs_file_watch_t *watch;
+	volatile bool file_changed;
 	uint64_t last_time;
 	bool active;
 	bool restart_gif;
 
-	gs_image_file3_t if3;
-};
+	pthread_mutex_t mutex;
+	struct image_decode *decode;
+	bool requested;
 
-static time_t get_modified_timestamp(const char *filename)
-{
-	struct stat stats;
-	if (os_stat(filename, &stats) != 0)
-		return -1;
-	return stats.st_mtime;
-}
+	gs_image_file4_t if4;
+};
 
 static const char *image_source_get_name(void *unused)
 {
@@ -41,39 +55,145 @@ static const char *image_source_get_name(void *unused)
 	return obs_module_text("ImageInput");
 }
 
+static void image_decode_release(struct image_decode *decode)
+{
+	if (decode && os_atomic_dec_long(&decode->refs) == 0) {
+		obs_enter_graphics();
+		gs_image_file4_free(&decode->if4);
+		obs_leave_graphics();
+
+		bfree(decode->file);
+		bfree(decode);
+	}
+}
+
+static void image_decode_task(void *param)
+{
+	struct image_decode *decode = param;
+
+	if (!os_atomic_load_bool(&decode->cancelled))
+		gs_image_file4_init(&decode->if4, decode->file,
+				    decode->alpha_mode,
+				    decode->gif_memory_limit);
+
+	os_atomic_set_bool(&decode->done, true);
+	image_decode_release(decode);
+}
+
+static void cancel_decode(struct image_decode *decode)
+{
+	if (decode) {
+		os_atomic_set_bool(&decode->cancelled, true);
+		image_decode_release(decode);
+	}
+}
+
 static void image_source_load(struct image_source *context)
 {
+	struct image_decode *decode = NULL;
+	struct image_decode *old_decode;
 	char *file = context->file;
 
-	obs_enter_graphics();
-	gs_image_file3_free(&context->if3);
-	obs_leave_graphics();
-
 	if (file && *file) {
 		debug("loading texture '%s'", file);
-		context->file_timestamp = get_modified_timestamp(file);
-		gs_image_file3_init(&context->if3, file,
-				    context->linear_alpha
-					    ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
-					    : GS_IMAGE_ALPHA_PREMULTIPLY);
-		context->update_time_elapsed = 0;
 
+		decode = bzalloc(sizeof(*decode));
+		decode->refs = 2;
+		decode->file = bstrdup(file);
+		decode->alpha_mode = context->linear_alpha
+					     ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
+					     : GS_IMAGE_ALPHA_PREMULTIPLY;
+		decode->gif_memory_limit = context->gif_memory_limit;
+	}
+
+	pthread_mutex_lock(&context->mutex);
+	old_decode = context->decode;
+	context->decode = decode;
+	context->requested = true;
+	pthread_mutex_unlock(&context->mutex);
+
+	cancel_decode(old_decode);
+
+	if (decode) {
+		obs_queue_task(OBS_TASK_WORKER, image_decode_task, decode,
+			       false);
+	} else {
 		obs_enter_graphics();
-		gs_image_file3_init_texture(&context->if3);
+		gs_image_file4_free(&context->if4);
 		obs_leave_graphics();
-
-		if (!context->if3.image2.image.loaded)
-			warn("failed to load texture '%s'", file);
 	}
 }
 
+static void log_gif_stats(struct image_source *context)
+{
+	struct gs_image_file_gif_stats stats;
+
+	gs_image_file4_get_gif_stats(&context->if4, &stats);
+	if (stats.frames_decoded)
+		debug("gif: %u frames buffered, %llu decoded, %llu missed",
+		      stats.buffered_frames,
+		      (unsigned long long)stats.frames_decoded,
+		      (unsigned long long)stats.decode_misses);
+}
+
 static void image_source_unload(struct image_source *context)
 {
+	struct image_decode *decode;
+
+	pthread_mutex_lock(&context->mutex);
+	decode = context->decode;
+	context->decode = NULL;
+	context->requested = false;
+	pthread_mutex_unlock(&context->mutex);
+
+	cancel_decode(decode);
+	log_gif_stats(context);
+
 	obs_enter_graphics();
-	gs_image_file3_free(&context->if3);
+	gs_image_file4_free(&context->if4);
 	obs_leave_graphics();
 }
 
+/* swaps in a finished decode, called from video_tick */
+static void image_source_finish_decode(struct image_source *context)
+{
+	struct image_decode *decode = NULL;
+
+	pthread_mutex_lock(&context->mutex);
+	if (context->decode && os_atomic_load_bool(&context->decode->done)) {
+		decode = context->decode;
+		context->decode = NULL;
+	}
+	pthread_mutex_unlock(&context->mutex);
+
+	if (!decode)
+		return;
+
+	log_gif_stats(context);
+
+	obs_enter_graphics();
+	gs_image_file4_free(&context->if4);
+	context->if4 = decode->if4;
+	memset(&decode->if4, 0, sizeof(decode->if4));
+	gs_image_file4_init_texture(&context->if4);
+	obs_leave_graphics();
+
+	if (!context->if4.image3.image2.image.loaded)
+		warn("failed to load texture '%s'", decode->file);
+
+	context->last_time = 0;
+	image_decode_release(decode);
+}
+
+/* called from the file watch thread, the reload happens in video_tick */
+static void image_source_file_changed(void *data, const char *path)
+{
+	struct image_source *context = data;
+
+	os_atomic_set_bool(&context->file_changed, true);
+	UNUSED_PARAMETER(path);
+}
+
 static void image_source_update(void *data, obs_data_t *settings)
 {
 	struct image_source *context = data;
@@ -85,26 +205,48 @@ static void image_source_update(void *data, obs_data_t *settings)
 		bfree(context->file);
 	context->file = bstrdup(file);
 	context->persistent = !unload;
-	context->linear_alpha = linear_alpha;
 
-	/* Load the image if the source is persistent or showing */
-	if (context->persistent || obs_source_showing(context->source))
+	obs_file_watch_remove(context->watch);
+	context->watch = NULL;
+	os_atomic_set_bool(&context->file_changed, false);
+	if (file && *file)
+		context->watch = obs_file_watch_add(
+			file, image_source_file_changed, context);
+
+	context->on_demand = obs_data_get_bool(settings, "on_demand");
+	context->linear_alpha = linear_alpha;
+	context->gif_memory_limit =
+		(uint64_t)obs_data_get_int(settings, "gif_memory_limit") *
+		1024 * 1024;
+
+	/* Load the image if the source is persistent or showing.  On demand
+	 * sources (slideshow slides) only reload if they were loaded. */
+	if (context->on_demand) {
+		if (context->requested || obs_source_showing(context->source))
+			image_source_load(data);
+	} else if (context->persistent || obs_source_showing(context->source)) {
 		image_source_load(data);
-	else
+	} else {
 		image_source_unload(data);
+	}
 }
 
 static void image_source_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_bool(settings, "unload", false);
 	obs_data_set_default_bool(settings, "linear_alpha", false);
+	obs_data_set_default_int(
+		settings, "gif_memory_limit",
+		GS_IMAGE_FILE_GIF_MEMORY_LIMIT / (1024 * 1024));
 }
 
 static void image_source_show(void *data)
 {
 	struct image_source *context = data;
 
-	if (!context->persistent)
+	if (context->on_demand && !context->requested)
+		image_source_load(context);
+	else if (!context->persistent)
 		image_source_load(context);
 }
 
@@ -120,13 +262,13 @@ static void restart_gif(void *data)
 {
 	struct image_source *context = data;
 
-	if (context->if3.image2.image.is_animated_gif) {
-		context->if3.image2.image.cur_frame = 0;
-		context->if3.image2.image.cur_loop = 0;
-		context->if3.image2.image.cur_time = 0;
+	if (context->if4.image3.image2.image.is_animated_gif) {
+		context->if4.image3.image2.image.cur_frame = 0;
+		context->if4.image3.image2.image.cur_loop = 0;
+		context->if4.image3.image2.image.cur_time = 0;
 
 		obs_enter_graphics();
-		gs_image_file3_update_texture(&context->if3);
+		gs_image_file4_update_texture(&context->if4);
 		obs_leave_graphics();
 
 		context->restart_gif = false;
@@ -144,6 +286,12 @@ static void *image_source_create(obs_data_t *settings, obs_source_t *source)
 	struct image_source *context = bzalloc(sizeof(struct image_source));
 	context->source = source;
 
+	pthread_mutex_init_value(&context->mutex);
+	if (pthread_mutex_init(&context->mutex, NULL) != 0) {
+		bfree(context);
+		return NULL;
+	}
+
 	image_source_update(context, settings);
 	return context;
 }
@@ -152,30 +300,32 @@ static void image_source_destroy(void *data)
 {
 	struct image_source *context = data;
 
+	obs_file_watch_remove(context->watch);
 	image_source_unload(context);
 
 	if (context->file)
 		bfree(context->file);
+	pthread_mutex_destroy(&context->mutex);
 	bfree(context);
 }
 
 static uint32_t image_source_getwidth(void *data)
 {
 	struct image_source *context = data;
-	return context->if3.image2.image.cx;
+	return context->if4.image3.image2.image.cx;
 }
 
 static uint32_t image_source_getheight(void *data)
 {
 	struct image_source *context = data;
-	return context->if3.image2.image.cy;
+	return context->if4.image3.image2.image.cy;
 }
 
 static void image_source_render(void *data, gs_effect_t *effect)
 {
 	struct image_source *context = data;
 
-	if (!context->if3.image2.image.texture)
+	if (!context->if4.image3.image2.image.texture)
 		return;
 
 	const bool previous = gs_framebuffer_srgb_enabled();
@@ -185,11 +335,12 @@ static void image_source_render(void *data, gs_effect_t *effect)
 	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
 	gs_eparam_t *const param = gs_effect_get_param_by_name(effect, "image");
-	gs_effect_set_texture_srgb(param, context->if3.image2.image.texture);
+	gs_effect_set_texture_srgb(param,
+				   context->if4.image3.image2.image.texture);
 
-	gs_draw_sprite(context->if3.image2.image.texture, 0,
-		       context->if3.image2.image.cx,
-		       context->if3.image2.image.cy);
+	gs_draw_sprite(context->if4.image3.image2.image.texture, 0,
+		       context->if4.image3.image2.image.cx,
+		       context->if4.image3.image2.image.cy);
 
 	gs_blend_state_pop();
 
@@ -201,22 +352,17 @@ static void image_source_tick(void *data, float seconds)
 	struct image_source *context = data;
 	uint64_t frame_time = obs_get_video_frame_time();
 
-	context->update_time_elapsed += seconds;
+	UNUSED_PARAMETER(seconds);
 
-	if (obs_source_showing(context->source)) {
-		if (context->update_time_elapsed >= 1.0f) {
-			time_t t = get_modified_timestamp(context->file);
-			context->update_time_elapsed = 0.0f;
+	image_source_finish_decode(context);
 
-			if (context->file_timestamp != t) {
-				image_source_load(context);
-			}
-		}
-	}
+	if (obs_source_showing(context->source) &&
+	    os_atomic_set_bool(&context->file_changed, false))
+		image_source_load(context);
 
 	if (obs_source_showing(context->source)) {
 		if (!context->active) {
-			if (context->if3.image2.image.is_animated_gif)
+			if (context->if4.image3.image2.image.is_animated_gif)
 				context->last_time = frame_time;
 			context->active = true;
 		}
@@ -233,13 +379,14 @@ static void image_source_tick(void *data, float seconds)
 		return;
 	}
 
-	if (context->last_time && context->if3.image2.image.is_animated_gif) {
+	if (context->last_time &&
+	    context->if4.image3.image2.image.is_animated_gif) {
 		uint64_t elapsed = frame_time - context->last_time;
-		bool updated = gs_image_file3_tick(&context->if3, elapsed);
+		bool updated = gs_image_file4_tick(&context->if4, elapsed);
 
 		if (updated) {
 			obs_enter_graphics();
-			gs_image_file3_update_texture(&context->if3);
+			gs_image_file4_update_texture(&context->if4);
 			obs_leave_graphics();
 		}
 	}
@@ -281,6 +428,8 @@ static obs_properties_t *image_source_properties(void *data)
 				obs_module_text("UnloadWhenNotShowing"));
 	obs_properties_add_bool(props, "linear_alpha",
 				obs_module_text("LinearAlpha"));
+	obs_properties_add_int(props, "gif_memory_limit",
+			       obs_module_text("GifMemoryLimit"), 8, 4096, 8);
 	dstr_free(&path);
 
 	return props;
@@ -289,7 +438,38 @@ static obs_properties_t *image_source_properties(void *data)
 uint64_t image_source_get_memory_usage(void *data)
 {
 	struct image_source *s = data;
-	return s->if3.image2.mem_usage;
+	return s->if4.image3.image2.mem_usage;
+}
+
+/* used by the slideshow to keep only a window of slides decoded */
+void image_source_preload(void *data)
+{
+	struct image_source *s = data;
+	bool requested;
+
+	pthread_mutex_lock(&s->mutex);
+	requested = s->requested;
+	pthread_mutex_unlock(&s->mutex);
+
+	if (!requested)
+		image_source_load(s);
+}
+
+void image_source_evict(void *data)
+{
+	image_source_unload(data);
+}
+
+bool image_source_loading(void *data)
+{
+	struct image_source *s = data;
+	bool loading;
+
+	pthread_mutex_lock(&s->mutex);
+	loading = s->decode != NULL;
+	pthread_mutex_unlock(&s->mutex);
+
+	return loading;
 }
 
 static void missing_file_callback(void *src, const char *new_path, void *data)
@@ -326,7 +506,8 @@ static obs_missing_files_t *image_source_missingfiles(void *data)
 static struct obs_source_info image_source_info = {
 	.id = "image_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_ASYNC_CREATE,
 	.get_name = image_source_get_name,
 	.create = image_source_create,
 	.destroy = image_source_destroy,
@@ -62,13 +62,32 @@
 /* ------------------------------------------------------------------------- */
 
 extern uint64_t image_source_get_memory_usage(void *data);
+extern void image_source_preload(void *data);
+extern void image_source_evict(void *data);
+extern bool image_source_loading(void *data);
 
+/* Slides are decoded on demand.  The current, previous and next slides are
+ * always kept decoded; other slides stay cached until the decoded slides
+ * exceed CACHE_MEM_USAGE, then the least recently used are evicted. */
 #define BYTES_TO_MBYTES (1024 * 1024)
-#define MAX_MEM_USAGE (400 * BYTES_TO_MBYTES)
+#define CACHE_MEM_USAGE (256 * BYTES_TO_MBYTES)
 
 struct image_file_data {
 	char *path;
 	obs_source_t *source;
+
+	uint64_t last_used;
+	bool cached;
+	bool measured;
+	uint32_t cx;
+	uint32_t cy;
+};
+
+/* directories are watched so added or removed images show up */
+struct slide_dir {
+	struct slideshow *ss;
+	char *path;
+	obs_file_watch_t *watch;
 };
 
 enum behavior {
@@ -97,14 +116,24 @@ struct slideshow {
 
 	float elapsed;
 	size_t cur_item;
+	size_t next_item;
 
 	uint32_t cx;
 	uint32_t cy;
-	uint64_t mem_usage;
+	bool use_auto;
+	bool aspect_only;
+	int cx_in;
+	int cy_in;
+
+	uint64_t use_counter;
+	bool sizes_pending;
 
 	pthread_mutex_t mutex;
 	DARRAY(struct image_file_data) files;
 
+	DARRAY(struct slide_dir *) dirs;
+	volatile bool rescan;
+
 	enum behavior behavior;
 
 	obs_hotkey_id play_pause_hotkey;
@@ -140,10 +169,10 @@ static obs_source_t *get_transition(struct slideshow *ss)
 	return tr;
 }
 
-static obs_source_t *get_source(struct darray *array, const char *path)
+static bool get_file(struct darray *array, const char *path,
+		     struct image_file_data *data)
 {
 	DARRAY(struct image_file_data) files;
-	obs_source_t *source = NULL;
 
 	files.da = *array;
 
@@ -151,13 +180,13 @@ static obs_source_t *get_source(struct darray *array, const char *path)
 		const char *cur_path = files.array[i].path;
 
 		if (strcmp(path, cur_path) == 0) {
-			source = files.array[i].source;
-			obs_source_addref(source);
-			break;
+			*data = files.array[i];
+			obs_source_addref(data->source);
+			return true;
 		}
 	}
 
-	return source;
+	return false;
 }
 
 static obs_source_t *create_source_from_file(const char *file)
@@ -167,6 +196,7 @@ static obs_source_t *create_source_from_file(const char *file)
 
 	obs_data_set_string(settings, "file", file);
 	obs_data_set_bool(settings, "unload", false);
+	obs_data_set_bool(settings, "on_demand", true);
 	source = obs_source_create_private("image_source", NULL, settings);
 
 	obs_data_release(settings);
@@ -191,6 +221,109 @@ static inline size_t random_file(struct slideshow *ss)
 	return (size_t)rand() % ss->files.num;
 }
 
+static void pick_next_item(struct slideshow *ss)
+{
+	size_t next = ss->cur_item;
+
+	if (ss->randomize) {
+		if (ss->files.num > 1) {
+			while (next == ss->cur_item)
+				next = random_file(ss);
+		}
+	} else if (++next >= ss->files.num) {
+		next = 0;
+	}
+
+	ss->next_item = next;
+}
+
+static void touch_slide(struct slideshow *ss, size_t idx)
+{
+	struct image_file_data *file = &ss->files.array[idx];
+
+	file->last_used = ++ss->use_counter;
+
+	if (!file->cached) {
+		image_source_preload(obs_obj_get_data(file->source));
+		file->cached = true;
+
+		if (!file->measured)
+			ss->sizes_pending = true;
+	}
+}
+
+static void trim_cache(struct slideshow *ss, uint64_t window_start,
+		       struct darray *evicted)
+{
+	DARRAY(obs_source_t *) sources;
+
+	sources.da = *evicted;
+
+	for (;;) {
+		struct image_file_data *oldest = NULL;
+		uint64_t mem_usage = 0;
+
+		for (size_t i = 0; i < ss->files.num; i++) {
+			struct image_file_data *file = &ss->files.array[i];
+			void *source_data = obs_obj_get_data(file->source);
+
+			if (!file->cached)
+				continue;
+
+			mem_usage += image_source_get_memory_usage(source_data);
+
+			if (file->last_used >= window_start)
+				continue;
+			if (!oldest || file->last_used < oldest->last_used)
+				oldest = file;
+		}
+
+		if (!oldest || mem_usage <= CACHE_MEM_USAGE)
+			break;
+
+		obs_source_addref(oldest->source);
+		da_push_back(sources, &oldest->source);
+		oldest->cached = false;
+	}
+
+	*evicted = sources.da;
+}
+
+/* keeps the slides around the current one decoded */
+static void update_cache(struct slideshow *ss)
+{
+	DARRAY(obs_source_t *) evicted;
+	uint64_t window_start;
+
+	da_init(evicted);
+
+	pthread_mutex_lock(&ss->mutex);
+
+	if (ss->files.num && ss->cur_item < ss->files.num) {
+		size_t prev = ss->cur_item ? ss->cur_item - 1
+					   : ss->files.num - 1;
+
+		window_start = ss->use_counter + 1;
+		pick_next_item(ss);
+
+		touch_slide(ss, ss->cur_item);
+		touch_slide(ss, ss->next_item);
+		touch_slide(ss, prev);
+		trim_cache(ss, window_start, &evicted.da);
+	}
+
+	pthread_mutex_unlock(&ss->mutex);
+
+	/* evicting frees textures, which can't be done with the mutex held
+	 * (video_render locks it inside the graphics context) */
+	for (size_t i = 0; i < evicted.num; i++) {
+		image_source_evict(obs_obj_get_data(evicted.array[i]));
+		obs_source_release(evicted.array[i]);
+	}
+
+	da_free(evicted);
+}
+
 /* ------------------------------------------------------------------------- */
 
 static const char *ss_getname(void *unused)
@@ -200,41 +333,105 @@ static const char *ss_getname(void *unused)
 }
 
 static void add_file(struct slideshow *ss, struct darray *array,
-		     const char *path, uint32_t *cx, uint32_t *cy)
+		     const char *path)
 {
 	DARRAY(struct image_file_data) new_files;
-	struct image_file_data data;
-	obs_source_t *new_source;
+	struct image_file_data data = {0};
+	bool found;
 
 	new_files.da = *array;
 
 	pthread_mutex_lock(&ss->mutex);
-	new_source = get_source(&ss->files.da, path);
+	found = get_file(&ss->files.da, path, &data);
 	pthread_mutex_unlock(&ss->mutex);
 
-	if (!new_source)
-		new_source = get_source(&new_files.da, path);
-	if (!new_source)
-		new_source = create_source_from_file(path);
-
-	if (new_source) {
-		uint32_t new_cx = obs_source_get_width(new_source);
-		uint32_t new_cy = obs_source_get_height(new_source);
+	if (!found)
+		found = get_file(&new_files.da, path, &data);
+	if (!found)
+		data.source = create_source_from_file(path);
 
+	if (data.source) {
 		data.path = bstrdup(path);
-		data.source = new_source;
 		da_push_back(new_files, &data);
+	}
 
-		if (new_cx > *cx)
-			*cx = new_cx;
-		if (new_cy > *cy)
-			*cy = new_cy;
+	*array = new_files.da;
+}
 
-		void *source_data = obs_obj_get_data(new_source);
-		ss->mem_usage += image_source_get_memory_usage(source_data);
+static void update_size(struct slideshow *ss)
+{
+	uint32_t cx = 0;
+	uint32_t cy = 0;
+
+	for (size_t i = 0; i < ss->files.num; i++) {
+		struct image_file_data *file = &ss->files.array[i];
+
+		if (file->cx > cx)
+			cx = file->cx;
+		if (file->cy > cy)
+			cy = file->cy;
 	}
 
-	*array = new_files.da;
+	if (!ss->use_auto) {
+		double cx_f = (double)cx;
+		double cy_f = (double)cy;
+
+		double old_aspect = cx_f / cy_f;
+		double new_aspect = (double)ss->cx_in / (double)ss->cy_in;
+
+		if (ss->aspect_only) {
+			if (fabs(old_aspect - new_aspect) > EPSILON) {
+				if (new_aspect > old_aspect)
+					cx = (uint32_t)(cy_f * new_aspect);
+				else
+					cy = (uint32_t)(cx_f / new_aspect);
+			}
+		} else {
+			cx = (uint32_t)ss->cx_in;
+			cy = (uint32_t)ss->cy_in;
+		}
+	}
+
+	ss->cx = cx;
+	ss->cy = cy;
+}
+
+/* slide sizes are only known once they've been decoded */
+static void check_slide_sizes(struct slideshow *ss)
+{
+	bool changed = false;
+
+	pthread_mutex_lock(&ss->mutex);
+
+	ss->sizes_pending = false;
+
+	for (size_t i = 0; i < ss->files.num; i++) {
+		struct image_file_data *file = &ss->files.array[i];
+		void *source_data = obs_obj_get_data(file->source);
+
+		if (!file->cached || file->measured)
+			continue;
+
+		if (image_source_loading(source_data)) {
+			ss->sizes_pending = true;
+			continue;
+		}
+
+		file->cx = obs_source_get_width(file->source);
+		file->cy = obs_source_get_height(file->source);
+		file->measured = true;
+
+		if (file->cx > ss->cx || file->cy > ss->cy)
+			changed = true;
+	}
+
+	if (changed)
+		update_size(ss);
+
+	pthread_mutex_unlock(&ss->mutex);
+
+	if (changed)
+		obs_transition_set_size(ss->transition, ss->cx, ss->cy);
 }
 
 static bool valid_extension(const char *ext)
@@ -251,11 +448,76 @@ static inline bool item_valid(struct slideshow *ss)
 	return ss->files.num && ss->cur_item < ss->files.num;
 }
 
+/* called from the file watch thread.  Only images appearing or disappearing
+ * (or the directory itself) cause a rescan, changed images reload on their
+ * own. */
+static void dir_changed(void *param, const char *path)
+{
+	struct slide_dir *dir = param;
+	struct slideshow *ss = dir->ss;
+
+	if (strcmp(path, dir->path) != 0) {
+		bool listed = false;
+
+		if (!valid_extension(os_get_path_extension(path)))
+			return;
+
+		pthread_mutex_lock(&ss->mutex);
+		for (size_t i = 0; i < ss->files.num; i++) {
+			if (strcmp(ss->files.array[i].path, path) == 0) {
+				listed = true;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&ss->mutex);
+
+		if (listed == os_file_exists(path))
+			return;
+	}
+
+	os_atomic_set_bool(&ss->rescan, true);
+	obs_source_update(ss->source, NULL);
+}
+
+static struct slide_dir *add_dir(struct slideshow *ss, const char *path)
+{
+	struct slide_dir *dir = bzalloc(sizeof(*dir));
+	struct dstr dir_path = {0};
+
+	/* same form as the paths the file watch reports */
+	dstr_copy(&dir_path, path);
+	dstr_replace(&dir_path, "\\", "/");
+	while (dir_path.len > 1 && dstr_end(&dir_path) == '/')
+		dstr_resize(&dir_path, dir_path.len - 1);
+
+	dir->ss = ss;
+	dir->path = dir_path.array;
+	dir->watch = obs_file_watch_add(dir->path, dir_changed, dir);
+	da_push_back(ss->dirs, &dir);
+	return dir;
+}
+
+static void remove_dirs(struct slideshow *ss)
+{
+	for (size_t i = 0; i < ss->dirs.num; i++) {
+		struct slide_dir *dir = ss->dirs.array[i];
+
+		obs_file_watch_remove(dir->watch);
+		bfree(dir->path);
+		bfree(dir);
+	}
+
+	da_free(ss->dirs);
+}
+
 static void do_transition(void *data, bool to_null)
 {
 	struct slideshow *ss = data;
 	bool valid = item_valid(ss);
 
+	if (valid)
+		update_cache(ss);
+
 	if (valid && ss->use_cut) {
 		obs_transition_set(ss->transition,
 				   ss->files.array[ss->cur_item].source);
@@ -279,21 +541,24 @@ static void ss_update(void *data, obs_data_t *settings)
 	DARRAY(struct image_file_data) old_files;
 	obs_source_t *new_tr = NULL;
 	obs_source_t *old_tr = NULL;
+	obs_source_t *cur_source = NULL;
 	struct slideshow *ss = data;
 	obs_data_array_t *array;
 	const char *tr_name;
 	uint32_t new_duration;
 	uint32_t new_speed;
-	uint32_t cx = 0;
-	uint32_t cy = 0;
 	size_t count;
 	const char *behavior;
 	const char *mode;
+	bool rescan = os_atomic_set_bool(&ss->rescan, false);
+	bool keep_item = false;
+	size_t cur_item = 0;
 
 	/* ------------------------------------- */
 	/* get settings data */
 
 	da_init(new_files);
+	remove_dirs(ss);
 
 	behavior = obs_data_get_string(settings, S_BEHAVIOR);
 
@@ -334,14 +599,13 @@ static void ss_update(void *data, obs_data_t *settings)
 	/* ------------------------------------- */
 	/* create new list of sources */
 
-	ss->mem_usage = 0;
-
 	for (size_t i = 0; i < count; i++) {
 		obs_data_t *item = obs_data_array_item(array, i);
 		const char *path = obs_data_get_string(item, "value");
 		os_dir_t *dir = os_opendir(path);
 
 		if (dir) {
+			struct slide_dir *watched = add_dir(ss, path);
 			struct dstr dir_path = {0};
 			struct os_dirent *ent;
 
@@ -358,26 +622,19 @@ static void ss_update(void *data, obs_data_t *settings)
 				if (!valid_extension(ext))
 					continue;
 
-				dstr_copy(&dir_path, path);
+				dstr_copy(&dir_path, watched->path);
 				dstr_cat_ch(&dir_path, '/');
 				dstr_cat(&dir_path, ent->d_name);
-				add_file(ss, &new_files.da, dir_path.array, &cx,
-					 &cy);
-
-				if (ss->mem_usage >= MAX_MEM_USAGE)
-					break;
+				add_file(ss, &new_files.da, dir_path.array);
 			}
 
 			dstr_free(&dir_path);
 			os_closedir(dir);
 		} else {
-			add_file(ss, &new_files.da, path, &cx, &cy);
+			add_file(ss, &new_files.da, path);
 		}
 
 		obs_data_release(item);
-
-		if (ss->mem_usage >= MAX_MEM_USAGE)
-			break;
 	}
 
 	/* ------------------------------------- */
@@ -386,7 +643,21 @@ static void ss_update(void *data, obs_data_t *settings)
 	pthread_mutex_lock(&ss->mutex);
 
 	old_files.da = ss->files.da;
+	if (rescan && item_valid(ss))
+		cur_source = ss->files.array[ss->cur_item].source;
+
 	ss->files.da = new_files.da;
+
+	/* sources are reused by path, so the current slide is still there if
+	 * its source is */
+	for (size_t i = 0; cur_source && !new_tr && i < new_files.num; i++) {
+		if (new_files.array[i].source == cur_source) {
+			cur_item = i;
+			keep_item = true;
+			break;
+		}
+	}
+
 	if (new_tr) {
 		old_tr = ss->transition;
 		ss->transition = new_tr;
@@ -435,41 +706,37 @@ static void ss_update(void *data, obs_data_t *settings)
 		}
 	}
 
-	if (!use_auto) {
-		double cx_f = (double)cx;
-		double cy_f = (double)cy;
+	/* ------------------------- */
 
-		double old_aspect = cx_f / cy_f;
-		double new_aspect = (double)cx_in / (double)cy_in;
+	pthread_mutex_lock(&ss->mutex);
+	ss->use_auto = use_auto;
+	ss->aspect_only = aspect_only;
+	ss->cx_in = cx_in;
+	ss->cy_in = cy_in;
+	update_size(ss);
+	pthread_mutex_unlock(&ss->mutex);
 
-		if (aspect_only) {
-			if (fabs(old_aspect - new_aspect) > EPSILON) {
-				if (new_aspect > old_aspect)
-					cx = (uint32_t)(cy_f * new_aspect);
-				else
-					cy = (uint32_t)(cx_f / new_aspect);
-			}
-		} else {
-			cx = (uint32_t)cx_in;
-			cy = (uint32_t)cy_in;
-		}
-	}
+	obs_transition_set_size(ss->transition, ss->cx, ss->cy);
+	obs_transition_set_alignment(ss->transition, OBS_ALIGN_CENTER);
+	obs_transition_set_scale_type(ss->transition,
+				      OBS_TRANSITION_SCALE_ASPECT);
 
-	/* ------------------------- */
+	if (new_tr)
+		obs_source_add_active_child(ss->source, new_tr);
+
+	/* a rescan keeps showing the current slide if it still exists */
+	if (keep_item) {
+		ss->cur_item = cur_item;
+		update_cache(ss);
+		obs_data_array_release(array);
+		return;
+	}
 
-	ss->cx = cx;
-	ss->cy = cy;
 	ss->cur_item = 0;
 	ss->elapsed = 0.0f;
-	obs_transition_set_size(ss->transition, cx, cy);
-	obs_transition_set_alignment(ss->transition, OBS_ALIGN_CENTER);
-	obs_transition_set_scale_type(ss->transition,
-				      OBS_TRANSITION_SCALE_ASPECT);
 
 	if (ss->randomize && ss->files.num)
 		ss->cur_item = random_file(ss);
-	if (new_tr)
-		obs_source_add_active_child(ss->source, new_tr);
 	if (ss->files.num) {
 		do_transition(ss, false);
 
@@ -628,6 +895,7 @@ static void ss_destroy(void *data)
 {
 	struct slideshow *ss = data;
 
+	remove_dirs(ss);
 	obs_source_release(ss->transition);
 	free_files(&ss->files.da);
 	pthread_mutex_destroy(&ss->mutex);
@@ -699,6 +967,9 @@ static void ss_video_tick(void *data, float seconds)
 	if (!ss->transition || !ss->slide_time)
 		return;
 
+	if (ss->sizes_pending)
+		check_slide_sizes(ss);
+
 	if (ss->restart_on_activate && ss->use_cut) {
 		ss->elapsed = 0.0f;
 		ss->cur_item = ss->randomize ? random_file(ss) : 0;
@@ -740,17 +1011,12 @@ static void ss_video_tick(void *data, float seconds)
 			return;
 		}
 
-		if (ss->randomize) {
-			size_t next = ss->cur_item;
-			if (ss->files.num > 1) {
-				while (next == ss->cur_item)
-					next = random_file(ss);
-			}
-			ss->cur_item = next;
-
-		} else if (++ss->cur_item >= ss->files.num) {
+		/* the next slide was picked (and preloaded) on the last
+		 * transition */
+		if (ss->next_item < ss->files.num)
+			ss->cur_item = ss->next_item;
+		else
 			ss->cur_item = 0;
-		}
 
 		if (ss->files.num)
 			do_transition(ss, false);
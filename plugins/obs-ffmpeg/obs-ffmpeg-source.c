@@ -66,6 +66,12 @@ struct ffmpeg_source {
     bool close_when_inactive;
     bool seekable;
 
+	/* media opened ahead of activation while closed when inactive */
+	volatile bool preload_requested;
+	volatile bool preloading;
+	volatile bool preloaded;
+	bool close_preload;
+
 	pthread_t reconnect_thread;
 	bool stop_reconnect;
 	bool reconnect_thread_valid;
@@ -265,12 +271,14 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
     struct ffmpeg_source *s = opaque;
-    if (s->close_when_inactive)
+    if (s->close_when_inactive && !os_atomic_load_bool(&s->preloading))
         return;
 	s->sws_width = f->width;
     s->sws_height = f->height;
     if (s->is_clear_on_media_end || s->is_looping)
         obs_source_preload_video(s->source, f);
+	if (os_atomic_load_bool(&s->preloading))
+		os_atomic_set_bool(&s->preloaded, true);
 
 	if (!s->is_local_file && os_atomic_set_bool(&s->reconnecting, false))
 		FF_BLOG(LOG_INFO, "Reconnected.");
@@ -330,8 +338,44 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
     }
 }
 
+/* Opens media that is closed while inactive ahead of time, so that the first
+ * frames are already decoded when it's activated.  Media that stays open is
+ * already preloaded by its media thread whenever it isn't playing. */
+static void ffmpeg_source_preload(struct ffmpeg_source *s)
+{
+	/* shown again before the next tick closed it, keep it open */
+	if (s->close_preload) {
+		s->close_preload = false;
+		s->destroy_media = false;
+		os_atomic_set_bool(&s->preloading, true);
+		return;
+	}
+
+	if (!s->close_when_inactive || s->media_valid ||
+	    obs_source_active(s->source))
+		return;
+
+	os_atomic_set_bool(&s->preloaded, false);
+	os_atomic_set_bool(&s->preloading, true);
+
+	ffmpeg_source_open(s);
+	if (!s->media_valid)
+		os_atomic_set_bool(&s->preloading, false);
+}
+
 static void ffmpeg_source_start(struct ffmpeg_source *s)
 {
+	bool preloaded;
+
+	os_atomic_set_bool(&s->preloading, false);
+	preloaded = os_atomic_set_bool(&s->preloaded, false);
+
+	/* activated again before the next tick closed the preloaded media */
+	if (s->close_preload) {
+		s->close_preload = false;
+		s->destroy_media = false;
+	}
+
 	if (!s->media_valid)
 		ffmpeg_source_open(s);
 
@@ -339,7 +383,8 @@ static void ffmpeg_source_start(struct ffmpeg_source *s)
 		return;
 
 	mp_media_play(&s->media, s->is_looping, s->reconnecting);
-	if (s->is_local_file && (s->is_clear_on_media_end || s->is_looping))
+	if (s->is_local_file && (s->is_clear_on_media_end || s->is_looping) &&
+	    (!s->close_when_inactive || preloaded))
 		obs_source_show_preloaded_video(s->source);
 	else
 		obs_source_output_video(s->source, NULL);
@@ -382,6 +427,9 @@ static void ffmpeg_source_tick(void *data, float seconds)
     //}
 }*/
 	struct ffmpeg_source *s = data;
+	if (os_atomic_set_bool(&s->preload_requested, false))
+		ffmpeg_source_preload(s);
+
 	if (s->destroy_media) {
 		if (s->media_valid) {
 			mp_media_free(&s->media);
@@ -390,7 +438,11 @@ static void ffmpeg_source_tick(void *data, float seconds)
 
 		s->destroy_media = false;
 
-		if (!s->is_local_file) {
+		/* preloaded media closed after being hidden didn't stop, so
+		 * there's nothing to reconnect to */
+		if (s->close_preload) {
+			s->close_preload = false;
+		} else if (!s->is_local_file) {
 			if (!os_atomic_set_bool(&s->reconnecting, true)) {
 				FF_BLOG(LOG_WARNING, "Disconnected. "
 						     "Reconnecting...");
@@ -465,10 +517,13 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
         mp_media_free(&s->media);
         s->media_valid = false;
     }
+	os_atomic_set_bool(&s->preloading, false);
 
     bool active = obs_source_active(s->source);
     if (!s->close_when_inactive || active)
         ffmpeg_source_open(s);
+	else if (obs_source_showing(s->source))
+		ffmpeg_source_preload(s);
 
     dump_source_info(s, input, input_format);
     if (!s->restart_on_activate || active)
@@ -517,6 +572,36 @@ static void get_duration(void *data, calldata_t *cd)
     calldata_set_int(cd, "duration", dur * 1000);
 }
 
+static void preload_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_source *s = data;
+	os_atomic_set_bool(&s->preload_requested, true);
+	UNUSED_PARAMETER(cd);
+}
+
+static inline double ns_to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+static void get_startup_stats(void *data, calldata_t *cd)
+{
+	struct ffmpeg_source *s = data;
+	struct mp_media_stats stats = {0};
+
+	if (s->media_valid)
+		mp_media_get_stats(&s->media, &stats);
+
+	calldata_set_float(cd, "open_ms", ns_to_ms(stats.open_ns));
+	calldata_set_float(cd, "stream_info_ms",
+			   ns_to_ms(stats.stream_info_ns));
+	calldata_set_float(cd, "decoders_ms", ns_to_ms(stats.decoder_init_ns));
+	calldata_set_float(cd, "ready_ms", ns_to_ms(stats.ready_ns));
+	calldata_set_float(cd, "start_ms", ns_to_ms(stats.start_ns));
+	calldata_set_int(cd, "video_threads", stats.video_threads);
+	calldata_set_bool(cd, "ready", stats.ready);
+}
+
 static void get_nb_frames(void *data, calldata_t *cd)
 {
     struct ffmpeg_source *s = data;
@@ -634,6 +719,13 @@ static void *ffmpeg_source_create(obs_data_t *settings, obs_source_t *source)
         get_duration, s);
     proc_handler_add(ph, "void get_nb_frames(out int num_frames)",
         get_nb_frames, s);
+	proc_handler_add(ph, "void preload()", preload_proc, s);
+	proc_handler_add(ph,
+			 "void get_startup_stats(out float open_ms, "
+			 "out float stream_info_ms, out float decoders_ms, "
+			 "out float ready_ms, out float start_ms, "
+			 "out int video_threads, out bool ready)",
+			 get_startup_stats, s);
 
     //ffmpeg_source_update(s, settings);
     return s;
@@ -683,6 +775,25 @@ static void ffmpeg_source_deactivate(void *data)
     }
 }
 
+static void ffmpeg_source_show(void *data)
+{
+	ffmpeg_source_preload(data);
+}
+
+static void ffmpeg_source_hide(void *data)
+{
+	struct ffmpeg_source *s = data;
+
+	/* shown in the preview but never activated, close it again on the
+	 * next tick */
+	if (os_atomic_load_bool(&s->preloading) &&
+	    !obs_source_active(s->source)) {
+		os_atomic_set_bool(&s->preloading, false);
+		s->close_preload = true;
+		s->destroy_media = true;
+	}
+}
+
 static void ffmpeg_source_play_pause(void *data, bool pause)
 {
     struct ffmpeg_source *s = data;
@@ -816,6 +927,8 @@ struct obs_source_info ffmpeg_source = {
 	.get_properties = ffmpeg_source_getproperties,
 	.activate = ffmpeg_source_activate,
 	.deactivate = ffmpeg_source_deactivate,
+	.show = ffmpeg_source_show,
+	.hide = ffmpeg_source_hide,
 	.get_width = ffmpeg_source_get_width,
 	.get_height = ffmpeg_source_get_height,
 	.video_tick = ffmpeg_source_tick,
@@ -35,6 +35,11 @@
 #include <libavformat/avformat.h>
 #include <libavfilter/avfilter.h>
 
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(55, 78, 100)
+#define VAAPI_TEXTURE_ENCODE
+#include <libavutil/hwcontext_drm.h>
+#endif
+
 #include "obs-ffmpeg-formats.h"
 
 #define do_log(level, format, ...)                          \
@@ -75,6 +80,14 @@ static const char *vaapi_getname(void *unused)
 	return "FFMPEG VAAPI";
 }
 
+#ifdef VAAPI_TEXTURE_ENCODE
+static const char *vaapi_getname_tex(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "FFMPEG VAAPI (GPU Texture)";
+}
+#endif
+
 static inline bool valid_format(enum video_format format)
 {
 	return format == VIDEO_FORMAT_NV12;
@@ -397,49 +410,14 @@ static inline void copy_data(AVFrame *pic, const struct encoder_frame *frame,
 	}
 }
 
-static bool vaapi_encode(void *data, struct encoder_frame *frame,
-			 struct encoder_packet *packet, bool *received_packet)
+static bool vaapi_encode_hwframe(struct vaapi_encoder *enc, AVFrame *hwframe,
+				 struct encoder_packet *packet,
+				 bool *received_packet)
 {
-	struct vaapi_encoder *enc = data;
-	AVFrame *hwframe = NULL;
 	AVPacket av_pkt;
 	int got_packet;
 	int ret;
 
-	hwframe = av_frame_alloc();
-	if (!hwframe) {
-		warn("vaapi_encode: failed to allocate hw frame");
-		return false;
-	}
-
-	ret = av_hwframe_get_buffer(enc->vaframes_ref, hwframe, 0);
-	if (ret < 0) {
-		warn("vaapi_encode: failed to get buffer for hw frame: %s",
-		     av_err2str(ret));
-		goto fail;
-	}
-
-	copy_data(enc->vframe, frame, enc->height, enc->context->pix_fmt);
-
-	enc->vframe->pts = frame->pts;
-	hwframe->pts = frame->pts;
-	hwframe->width = enc->vframe->width;
-	hwframe->height = enc->vframe->height;
-
-	ret = av_hwframe_transfer_data(hwframe, enc->vframe, 0);
-	if (ret < 0) {
-		warn("vaapi_encode: failed to upload hw frame: %s",
-		     av_err2str(ret));
-		goto fail;
-	}
-
-	ret = av_frame_copy_props(hwframe, enc->vframe);
-	if (ret < 0) {
-		warn("vaapi_encode: failed to copy props to hw frame: %s",
-		     av_err2str(ret));
-		goto fail;
-	}
-
 	av_init_packet(&av_pkt);
 
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 40, 101)
@@ -457,7 +435,7 @@ static bool vaapi_encode(void *data, struct encoder_frame *frame,
 #endif
 	if (ret < 0) {
 		warn("vaapi_encode: Error encoding: %s", av_err2str(ret));
-		goto fail;
+		return false;
 	}
 
 	if (got_packet && av_pkt.size) {
@@ -489,13 +467,269 @@ static bool vaapi_encode(void *data, struct encoder_frame *frame,
 	}
 
 	av_packet_unref(&av_pkt);
+	return true;
+}
+
+static bool vaapi_encode(void *data, struct encoder_frame *frame,
+			 struct encoder_packet *packet, bool *received_packet)
+{
+	struct vaapi_encoder *enc = data;
+	AVFrame *hwframe = NULL;
+	bool success = false;
+	int ret;
+
+	hwframe = av_frame_alloc();
+	if (!hwframe) {
+		warn("vaapi_encode: failed to allocate hw frame");
+		return false;
+	}
+
+	ret = av_hwframe_get_buffer(enc->vaframes_ref, hwframe, 0);
+	if (ret < 0) {
+		warn("vaapi_encode: failed to get buffer for hw frame: %s",
+		     av_err2str(ret));
+		goto fail;
+	}
+
+	copy_data(enc->vframe, frame, enc->height, enc->context->pix_fmt);
+
+	enc->vframe->pts = frame->pts;
+	hwframe->pts = frame->pts;
+	hwframe->width = enc->vframe->width;
+	hwframe->height = enc->vframe->height;
+
+	ret = av_hwframe_transfer_data(hwframe, enc->vframe, 0);
+	if (ret < 0) {
+		warn("vaapi_encode: failed to upload hw frame: %s",
+		     av_err2str(ret));
+		goto fail;
+	}
+
+	ret = av_frame_copy_props(hwframe, enc->vframe);
+	if (ret < 0) {
+		warn("vaapi_encode: failed to copy props to hw frame: %s",
+		     av_err2str(ret));
+		goto fail;
+	}
+
+	success = vaapi_encode_hwframe(enc, hwframe, packet, received_packet);
+
+fail:
 	av_frame_free(&hwframe);
+	return success;
+}
+
+#ifdef VAAPI_TEXTURE_ENCODE
+/* Exports the VA surface of a frame as DMA-BUF and imports its Y and UV
+ * layers as textures.  The returned mapping owns the exported file
+ * descriptors and has to be freed after the textures are destroyed. */
+static AVFrame *vaapi_import_surface(struct vaapi_encoder *enc,
+				     AVFrame *hwframe, gs_texture_t *planes[2])
+{
+	const AVDRMFrameDescriptor *desc;
+	AVFrame *drm_frame;
+	int ret;
+
+	planes[0] = NULL;
+	planes[1] = NULL;
+
+	drm_frame = av_frame_alloc();
+	if (!drm_frame)
+		return NULL;
+
+	drm_frame->format = AV_PIX_FMT_DRM_PRIME;
+	ret = av_hwframe_map(drm_frame, hwframe,
+			     AV_HWFRAME_MAP_WRITE | AV_HWFRAME_MAP_OVERWRITE);
+	if (ret < 0) {
+		warn("vaapi_import_surface: failed to export surface: %s",
+		     av_err2str(ret));
+		goto fail;
+	}
+
+	desc = (const AVDRMFrameDescriptor *)drm_frame->data[0];
+	if (desc->nb_layers != 2) {
+		warn("vaapi_import_surface: expected 2 layers, got %d",
+		     desc->nb_layers);
+		goto fail;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		const AVDRMLayerDescriptor *layer = &desc->layers[i];
+		int fds[AV_DRM_MAX_PLANES];
+		uint32_t strides[AV_DRM_MAX_PLANES];
+		uint32_t offsets[AV_DRM_MAX_PLANES];
+		uint64_t modifiers[AV_DRM_MAX_PLANES];
+
+		for (int p = 0; p < layer->nb_planes; p++) {
+			const AVDRMPlaneDescriptor *plane = &layer->planes[p];
+			const AVDRMObjectDescriptor *obj =
+				&desc->objects[plane->object_index];
+
+			fds[p] = obj->fd;
+			strides[p] = (uint32_t)plane->pitch;
+			offsets[p] = (uint32_t)plane->offset;
+			modifiers[p] = obj->format_modifier;
+		}
+
+		planes[i] = gs_texture_create_from_dmabuf(
+			enc->context->width >> i, enc->context->height >> i,
+			layer->format, i ? GS_R8G8 : GS_R8, layer->nb_planes,
+			fds, strides, offsets, modifiers);
+		if (!planes[i]) {
+			warn("vaapi_import_surface: failed to import layer %d",
+			     i);
+			goto fail;
+		}
+	}
+
+	return drm_frame;
+
+fail:
+	gs_texture_destroy(planes[0]);
+	gs_texture_destroy(planes[1]);
+	planes[0] = NULL;
+	planes[1] = NULL;
+	av_frame_free(&drm_frame);
+	return NULL;
+}
+
+static bool vaapi_copy_textures(struct vaapi_encoder *enc, AVFrame *hwframe,
+				struct encoder_texture *texture)
+{
+	gs_texture_t *planes[2];
+	AVFrame *drm_frame;
+
+	obs_enter_graphics();
+
+	drm_frame = vaapi_import_surface(enc, hwframe, planes);
+	if (drm_frame) {
+		gs_copy_texture(planes[0], texture->tex[0]);
+		gs_copy_texture(planes[1], texture->tex[1]);
+
+		/* the encoder waits on the implicit fences of the DMA-BUFs,
+		 * so the copies only have to be submitted, not finished */
+		gs_flush();
+
+		gs_texture_destroy(planes[0]);
+		gs_texture_destroy(planes[1]);
+	}
+
+	obs_leave_graphics();
+
+	if (!drm_frame)
+		return false;
+
+	av_frame_free(&drm_frame);
 	return true;
+}
+
+/* Some drivers or GL setups (e.g. GLX) can't import VA surfaces, so try once
+ * at creation rather than failing on the first frame. */
+static bool vaapi_texture_import_supported(struct vaapi_encoder *enc)
+{
+	gs_texture_t *planes[2];
+	AVFrame *hwframe;
+	AVFrame *drm_frame = NULL;
+	bool supported;
+
+	hwframe = av_frame_alloc();
+	if (!hwframe)
+		return false;
+
+	if (av_hwframe_get_buffer(enc->vaframes_ref, hwframe, 0) == 0) {
+		obs_enter_graphics();
+		drm_frame = vaapi_import_surface(enc, hwframe, planes);
+		if (drm_frame) {
+			gs_texture_destroy(planes[0]);
+			gs_texture_destroy(planes[1]);
+		}
+		obs_leave_graphics();
+	}
+
+	supported = drm_frame != NULL;
+
+	av_frame_free(&drm_frame);
+	av_frame_free(&hwframe);
+	return supported;
+}
+
+static bool vaapi_encode_tex(void *data, struct encoder_texture *texture,
+			     int64_t pts, uint64_t lock_key,
+			     uint64_t *next_key, struct encoder_packet *packet,
+			     bool *received_packet)
+{
+	struct vaapi_encoder *enc = data;
+	AVFrame *hwframe = NULL;
+	bool success = false;
+	int ret;
+
+	*next_key = lock_key;
+
+	hwframe = av_frame_alloc();
+	if (!hwframe) {
+		warn("vaapi_encode_tex: failed to allocate hw frame");
+		return false;
+	}
+
+	ret = av_hwframe_get_buffer(enc->vaframes_ref, hwframe, 0);
+	if (ret < 0) {
+		warn("vaapi_encode_tex: failed to get buffer for hw frame: %s",
+		     av_err2str(ret));
+		goto fail;
+	}
+
+	if (!vaapi_copy_textures(enc, hwframe, texture))
+		goto fail;
+
+	ret = av_frame_copy_props(hwframe, enc->vframe);
+	if (ret < 0) {
+		warn("vaapi_encode_tex: failed to copy props to hw frame: %s",
+		     av_err2str(ret));
+		goto fail;
+	}
+
+	hwframe->pts = pts;
+	hwframe->width = enc->vframe->width;
+	hwframe->height = enc->vframe->height;
+
+	success = vaapi_encode_hwframe(enc, hwframe, packet, received_packet);
 
 fail:
 	av_frame_free(&hwframe);
-	return false;
+	return success;
+}
+
+static void *vaapi_create_tex(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct vaapi_encoder *enc;
+
+	if (obs_encoder_scaling_enabled(encoder)) {
+		blog(LOG_INFO, "[FFMPEG VAAPI encoder] scaling enabled, "
+			       "falling back to frame upload");
+		goto reroute;
+	}
+
+	if (!obs_nv12_planes_active()) {
+		blog(LOG_INFO, "[FFMPEG VAAPI encoder] nv12 planes not active, "
+			       "falling back to frame upload");
+		goto reroute;
+	}
+
+	enc = vaapi_create(settings, encoder);
+	if (!enc)
+		goto reroute;
+
+	if (vaapi_texture_import_supported(enc))
+		return enc;
+
+	blog(LOG_INFO, "[FFMPEG VAAPI encoder] surface import not supported, "
+		       "falling back to frame upload");
+	vaapi_destroy(enc);
+
+reroute:
+	return obs_encoder_create_rerouted(encoder, "ffmpeg_vaapi");
 }
+#endif
 
 static void set_visible(obs_properties_t *ppts, const char *name, bool visible)
 {
@@ -652,4 +886,22 @@ struct obs_encoder_info vaapi_encoder_info = {
 	.get_video_info = vaapi_video_info,
 };
 
+#ifdef VAAPI_TEXTURE_ENCODE
+struct obs_encoder_info vaapi_encoder_tex_info = {
+	.id = "ffmpeg_vaapi_tex",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.caps = OBS_ENCODER_CAP_PASS_TEXTURE,
+	.get_name = vaapi_getname_tex,
+	.create = vaapi_create_tex,
+	.destroy = vaapi_destroy,
+	.encode_texture2 = vaapi_encode_tex,
+	.get_defaults = vaapi_defaults,
+	.get_properties = vaapi_properties,
+	.get_extra_data = vaapi_extra_data,
+	.get_sei_data = vaapi_sei_data,
+	.get_video_info = vaapi_video_info,
+};
+#endif
+
 #endif
@@ -40,6 +40,11 @@ extern struct obs_encoder_info nvenc_encoder_info;
 extern struct obs_encoder_info vaapi_encoder_info;
 #endif
 
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(55, 78, 100)
+#define LIBAVUTIL_VAAPI_TEXTURE_AVAILABLE
+extern struct obs_encoder_info vaapi_encoder_tex_info;
+#endif
+
 #ifndef __APPLE__
 
 static const char *nvenc_check_name = "nvenc_check";
@@ -331,6 +336,9 @@ bool obs_module_load(void)
 	if (vaapi_supported()) {
 		blog(LOG_INFO, "FFMPEG VAAPI supported");
 		obs_register_encoder(&vaapi_encoder_info);
+#ifdef LIBAVUTIL_VAAPI_TEXTURE_AVAILABLE
+		obs_register_encoder(&vaapi_encoder_tex_info);
+#endif
 	}
 #endif
 #endif
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("obs-vst", "en-US")
+OBS_MODULE_DEFERRABLE()
 MODULE_EXPORT const char *obs_module_description(void)
 {
 	return "VST 2.x Plug-in filter";
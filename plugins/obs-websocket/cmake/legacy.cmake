@@ -120,9 +120,10 @@ target_sources(
           src/utils/Obs_SearchHelper.cpp
           src/utils/Obs_ActionHelper.cpp
           src/utils/Obs.h
+          src/utils/Obs_VideoFeed.cpp
+          src/utils/Obs_VideoFeed.h
           src/utils/Obs_VolumeMeter.cpp
           src/utils/Obs_VolumeMeter.h
-          src/utils/Obs_VolumeMeter_Helpers.h
           src/utils/Platform.cpp
           src/utils/Platform.h
           src/utils/Compat.cpp
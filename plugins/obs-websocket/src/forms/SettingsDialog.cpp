@@ -223,6 +223,7 @@ void SettingsDialog::FillSessionTable()
 
 	// Todo: Make a util for translations so that we don't need to import a bunch of obs libraries in order to use them.
 	QString kickButtonText = obs_module_text("OBSWebSocket.SessionTable.KickButtonText");
+	QString queueToolTipText = obs_module_text("OBSWebSocket.SessionTable.OutgoingQueueToolTip");
 
 	ui->websocketSessionTable->setRowCount(rowCount);
 	size_t i = 0;
@@ -236,6 +237,10 @@ void SettingsDialog::FillSessionTable()
 
 		QTableWidgetItem *statsItem =
 			new QTableWidgetItem(QString("%1/%2").arg(session.incomingMessages).arg(session.outgoingMessages));
+		statsItem->setToolTip(queueToolTipText.arg(session.outgoingQueueDepth)
+					      .arg(session.outgoingQueuePeak)
+					      .arg(session.droppedMessages)
+					      .arg(session.coalescedMessages));
 		ui->websocketSessionTable->setItem(i, 2, statsItem);
 
 		QLabel *identifiedLabel = new QLabel();
@@ -16,7 +16,9 @@ You should have received a copy of the GNU General Public License along
 with this program. If not, see <https://www.gnu.org/licenses/>
 */
 
+#include <algorithm>
 #include <queue>
+#include <set>
 #include <condition_variable>
 #include <util/profiler.hpp>
 
@@ -52,6 +54,53 @@ struct ParallelBatchResults {
 	ParallelBatchResults(RequestHandler &requestHandler) : requestHandler(requestHandler) {}
 };
 
+struct TransactionalBatch {
+	RequestHandler &requestHandler;
+	std::vector<RequestBatchRequest> &requests;
+	std::vector<RequestResult> results;
+	json &variables;
+	bool haltOnFailure;
+
+	size_t nextRequest = 0;
+	size_t runEnd = 0;
+	std::vector<obs_scene_t *> lockedScenes;
+	std::vector<OBSSceneItemAutoRelease> deferredSceneItems;
+
+	bool finished = false;
+	std::mutex conditionMutex;
+	std::condition_variable condition;
+
+	TransactionalBatch(RequestHandler &requestHandler, std::vector<RequestBatchRequest> &requests, json &variables,
+			   bool haltOnFailure)
+		: requestHandler(requestHandler), requests(requests), variables(variables), haltOnFailure(haltOnFailure)
+	{
+	}
+};
+
+// Requests which only write scene item state, and can run with transform updates still deferred and scenes locked.
+// Nothing else may run with a scene locked, as it might wait on the UI thread, which can be waiting on the lock.
+// Creating inputs or updating their settings can look up (and load) source types, so they aren't deferrable.
+static const std::set<std::string> transactionalDeferrableRequests = {
+	"CreateSceneItem",    "SetSceneItemTransform", "SetSceneItemEnabled",
+	"SetSceneItemLocked", "SetSceneItemIndex",     "SetSceneItemBlendMode",
+};
+
+static inline bool IsTransactionalDeferrable(const RequestBatchRequest &request)
+{
+	return transactionalDeferrableRequests.count(request.RequestType) > 0;
+}
+
+// Loads the source kinds the batch may look up before the graphics thread runs it
+static void LoadDeferredSourceKinds(const std::vector<RequestBatchRequest> &requests)
+{
+	for (auto &request : requests) {
+		if (RequestHandler::LooksUpSourceKinds(request.RequestType)) {
+			Utils::Obs::ActionHelper::LoadDeferredSourceKinds();
+			return;
+		}
+	}
+}
+
 // `{"inputName": "inputNameVariable"}` is essentially `inputName = inputNameVariable`
 static void PreProcessVariables(const json &variables, RequestBatchRequest &request)
 {
@@ -158,6 +207,129 @@ static void ObsTickCallback(void *param, float)
 		serialFrameBatch->condition.notify_one();
 }
 
+// Scene (or group) named by the `sceneName` field of the request, if any. Does not increment the reference.
+static obs_scene_t *GetTransactionalRequestScene(const RequestBatchRequest &request)
+{
+	if (!request.RequestData.is_object() || !request.RequestData.contains("sceneName") ||
+	    !request.RequestData["sceneName"].is_string())
+		return nullptr;
+
+	std::string sceneName = request.RequestData["sceneName"];
+	OBSSourceAutoRelease sceneSource = obs_get_source_by_name(sceneName.c_str());
+	if (!sceneSource || obs_source_get_type(sceneSource) != OBS_SOURCE_TYPE_SCENE)
+		return nullptr;
+
+	return obs_source_is_group(sceneSource) ? obs_group_from_source(sceneSource) : obs_scene_from_source(sceneSource);
+}
+
+static void FlushDeferredUpdates(TransactionalBatch *batch)
+{
+	for (auto &sceneItem : batch->deferredSceneItems)
+		obs_sceneitem_defer_update_end(sceneItem);
+
+	batch->deferredSceneItems.clear();
+}
+
+static void DeferSceneItemUpdate(TransactionalBatch *batch, obs_scene_t *scene, const RequestBatchRequest &request)
+{
+	if (!scene || !request.RequestData.contains("sceneItemId") || !request.RequestData["sceneItemId"].is_number_integer())
+		return;
+
+	obs_sceneitem_t *sceneItem = obs_scene_find_sceneitem_by_id(scene, request.RequestData["sceneItemId"]);
+	if (!sceneItem)
+		return;
+
+	for (auto &deferredSceneItem : batch->deferredSceneItems)
+		if (deferredSceneItem == sceneItem)
+			return;
+
+	obs_sceneitem_addref(sceneItem);
+	obs_sceneitem_defer_update_begin(sceneItem);
+	batch->deferredSceneItems.emplace_back(sceneItem);
+}
+
+static void ProcessTransactionalRequest(TransactionalBatch *batch, RequestBatchRequest &request)
+{
+	RequestResult requestResult = batch->requestHandler.ProcessRequest(request);
+
+	PostProcessVariables(batch->variables, request, requestResult);
+
+	batch->results.push_back(requestResult);
+	batch->nextRequest++;
+
+	if (batch->haltOnFailure && requestResult.StatusCode != RequestStatus::Success)
+		batch->nextRequest = batch->requests.size();
+}
+
+static void ProcessTransactionalRun(TransactionalBatch *batch);
+
+static void TransactionalSceneLocked(void *param, obs_scene_t *)
+{
+	ProcessTransactionalRun(static_cast<TransactionalBatch *>(param));
+}
+
+// Processes the deferrable requests up to `runEnd`. When a request uses a scene which isn't locked yet, the rest of the
+// run is processed from inside `obs_scene_atomic_update()`, so every scene stays locked until the run is done.
+static void ProcessTransactionalRun(TransactionalBatch *batch)
+{
+	while (batch->nextRequest < batch->runEnd) {
+		RequestBatchRequest &request = batch->requests[batch->nextRequest];
+
+		PreProcessVariables(batch->variables, request);
+
+		obs_scene_t *scene = GetTransactionalRequestScene(request);
+		if (scene && std::find(batch->lockedScenes.begin(), batch->lockedScenes.end(), scene) == batch->lockedScenes.end()) {
+			batch->lockedScenes.push_back(scene);
+			obs_scene_atomic_update(scene, TransactionalSceneLocked, batch);
+			return;
+		}
+
+		DeferSceneItemUpdate(batch, scene, request);
+		ProcessTransactionalRequest(batch, request);
+	}
+
+	// Only does anything in the innermost call, while all of the scenes are still locked
+	FlushDeferredUpdates(batch);
+}
+
+// Runs of deferrable requests are processed with their scenes locked, and every other request with no locks held
+static void ProcessTransactionalRequests(TransactionalBatch *batch)
+{
+	auto &requests = batch->requests;
+
+	while (batch->nextRequest < requests.size()) {
+		if (!IsTransactionalDeferrable(requests[batch->nextRequest])) {
+			RequestBatchRequest &request = requests[batch->nextRequest];
+			PreProcessVariables(batch->variables, request);
+			ProcessTransactionalRequest(batch, request);
+			continue;
+		}
+
+		batch->runEnd = batch->nextRequest;
+		while (batch->runEnd < requests.size() && IsTransactionalDeferrable(requests[batch->runEnd]))
+			batch->runEnd++;
+
+		ProcessTransactionalRun(batch);
+		batch->lockedScenes.clear();
+	}
+}
+
+static void ObsTransactionalTickCallback(void *param, float)
+{
+	ScopeProfiler prof{"obs_websocket_request_batch_transaction"};
+
+	auto transactionalBatch = static_cast<TransactionalBatch *>(param);
+
+	std::unique_lock<std::mutex> lock(transactionalBatch->conditionMutex);
+	if (transactionalBatch->finished)
+		return;
+
+	ProcessTransactionalRequests(transactionalBatch);
+
+	transactionalBatch->finished = true;
+	transactionalBatch->condition.notify_one();
+}
+
 std::vector<RequestResult>
 RequestBatchHandler::ProcessRequestBatch(QThreadPool &threadPool, SessionPtr session,
 					 RequestBatchExecutionType::RequestBatchExecutionType executionType,
@@ -189,6 +361,8 @@ RequestBatchHandler::ProcessRequestBatch(QThreadPool &threadPool, SessionPtr ses
 		for (auto &request : requests)
 			serialFrameBatch.requests.push(request);
 
+		LoadDeferredSourceKinds(requests);
+
 		// Create a callback entry for the graphics thread to execute on each video frame
 		obs_add_tick_callback(ObsTickCallback, &serialFrameBatch);
 
@@ -225,6 +399,21 @@ RequestBatchHandler::ProcessRequestBatch(QThreadPool &threadPool, SessionPtr ses
 		});
 
 		return parallelResults.results;
+	} else if (executionType == RequestBatchExecutionType::Transactional) {
+		TransactionalBatch transactionalBatch(requestHandler, requests, variables, haltOnFailure);
+
+		LoadDeferredSourceKinds(requests);
+
+		// The whole batch is processed by the graphics thread in between two frames
+		obs_add_tick_callback(ObsTransactionalTickCallback, &transactionalBatch);
+
+		std::unique_lock<std::mutex> lock(transactionalBatch.conditionMutex);
+		transactionalBatch.condition.wait(lock, [&transactionalBatch] { return transactionalBatch.finished; });
+		lock.unlock();
+
+		obs_remove_tick_callback(ObsTransactionalTickCallback, &transactionalBatch);
+
+		return transactionalBatch.results;
 	}
 
 	// Return empty vector if not a batch somehow
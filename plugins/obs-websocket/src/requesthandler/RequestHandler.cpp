@@ -21,6 +21,8 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include <util/profiler.hpp>
 #endif
 
+#include <set>
+
 #include "RequestHandler.h"
 
 const std::unordered_map<std::string, RequestMethodHandler> RequestHandler::_handlerMap{
@@ -57,6 +59,8 @@ const std::unordered_map<std::string, RequestMethodHandler> RequestHandler::_han
 	{"GetSourceActive", &RequestHandler::GetSourceActive},
 	{"GetSourceScreenshot", &RequestHandler::GetSourceScreenshot},
 	{"SaveSourceScreenshot", &RequestHandler::SaveSourceScreenshot},
+	{"StartVideoFeed", &RequestHandler::StartVideoFeed},
+	{"StopVideoFeed", &RequestHandler::StopVideoFeed},
 	{"GetSourcePrivateSettings", &RequestHandler::GetSourcePrivateSettings},
 	{"SetSourcePrivateSettings", &RequestHandler::SetSourcePrivateSettings},
 
@@ -195,6 +199,18 @@ const std::unordered_map<std::string, RequestMethodHandler> RequestHandler::_han
 
 RequestHandler::RequestHandler(SessionPtr session) : _session(session) {}
 
+// Requests which look up input, filter or transition kinds. The plugins providing some kinds may not be loaded yet, and libobs
+// only loads them on the UI thread, without waiting for it anywhere else.
+static const std::set<std::string> sourceKindRequests = {
+	"GetInputKindList",   "CreateInput",           "GetInputDefaultSettings", "GetSourceFilterDefaultSettings",
+	"CreateSourceFilter", "GetTransitionKindList",
+};
+
+bool RequestHandler::LooksUpSourceKinds(const std::string &requestType)
+{
+	return sourceKindRequests.count(requestType) > 0;
+}
+
 RequestResult RequestHandler::ProcessRequest(const Request &request)
 {
 #ifdef PLUGIN_TESTS
@@ -215,6 +231,11 @@ RequestResult RequestHandler::ProcessRequest(const Request &request)
 		return RequestResult::Error(RequestStatus::UnknownRequestType, "Your request type is not valid.");
 	}
 
+	// Graphics thread batches load the kinds before they start, as the graphics thread must never wait for the UI thread
+	if (LooksUpSourceKinds(request.RequestType) && request.ExecutionType != RequestBatchExecutionType::SerialFrame &&
+	    request.ExecutionType != RequestBatchExecutionType::Transactional)
+		Utils::Obs::ActionHelper::LoadDeferredSourceKinds();
+
 	return std::bind(handler, this, std::placeholders::_1)(request);
 }
 
@@ -42,6 +42,8 @@ public:
 	RequestResult ProcessRequest(const Request &request);
 	std::vector<std::string> GetRequestList();
 
+	static bool LooksUpSourceKinds(const std::string &requestType);
+
 private:
 	// General
 	RequestResult GetVersion(const Request &);
@@ -76,6 +78,8 @@ private:
 	RequestResult GetSourceActive(const Request &);
 	RequestResult GetSourceScreenshot(const Request &);
 	RequestResult SaveSourceScreenshot(const Request &);
+	RequestResult StartVideoFeed(const Request &);
+	RequestResult StopVideoFeed(const Request &);
 	RequestResult GetSourcePrivateSettings(const Request &);
 	RequestResult SetSourcePrivateSettings(const Request &);
 
@@ -68,6 +68,11 @@ RequestResult RequestHandler::GetVersion(const Request &)
 /**
  * Gets statistics about OBS, obs-websocket, and the current session.
  *
+ * Latencies are percentiles over the last 10 to 20 seconds, as objects of `count` and the `p50`, `p90`, `p99`, `p999`
+ * and `max` times in milliseconds. Each `outputLatencies` entry has the `outputName`, its `interleaveLatency` (from
+ * frame capture to the packet reaching the output), `sendLatency`, and the `videoEncodeLatency` and
+ * `audioEncodeLatency` of its encoders (null if it has none).
+ *
  * @responseField cpuUsage                         | Number | Current CPU usage in percent
  * @responseField memoryUsage                      | Number | Amount of memory in MB currently being used by OBS
  * @responseField availableDiskSpace               | Number | Available disk space on the device being used for recording storage
@@ -77,6 +82,10 @@ RequestResult RequestHandler::GetVersion(const Request &)
  * @responseField renderTotalFrames                | Number | Total number of frames outputted by the render thread
  * @responseField outputSkippedFrames              | Number | Number of frames skipped by OBS in the output thread
  * @responseField outputTotalFrames                | Number | Total number of frames outputted by the output thread
+ * @responseField renderLatency                    | Object | Time taken to render each frame
+ * @responseField readbackLatency                  | Object | Time taken to read each output frame back from the GPU
+ * @responseField audioCallbackLatency             | Object | Time taken to mix each audio tick
+ * @responseField outputLatencies                  | Array<Object> | Latencies of each active output
  * @responseField webSocketSessionIncomingMessages | Number | Total number of messages received by obs-websocket from the client
  * @responseField webSocketSessionOutgoingMessages | Number | Total number of messages sent by obs-websocket to the client
  *
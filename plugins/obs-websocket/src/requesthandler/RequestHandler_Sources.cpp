@@ -22,10 +22,48 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include <QFileInfo>
 #include <QImage>
 #include <QDir>
+#include <algorithm>
+#include <future>
 
 #include "RequestHandler.h"
+#include "../websocketserver/WebSocketServer.h"
+
+struct ScreenshotJob {
+	std::string imageFormat;
+	int compressionQuality;
+	QString filePath; // Encoded to `encodedImage` if empty
+
+	bool rendered = false;
+	bool encoded = false;
+	QByteArray encodedImage;
+	std::promise<void> done;
+};
+
+// Called by libobs on a worker thread, so encoding doesn't hold up the request or render threads (or right away when requested
+// from the graphics thread)
+static void ScreenshotCallback(void *param, const uint8_t *data, uint32_t linesize, uint32_t cx, uint32_t cy)
+{
+	auto job = static_cast<ScreenshotJob *>(param);
+
+	if (data) {
+		QImage image(data, cx, cy, linesize, QImage::Format::Format_RGBA8888);
+		job->rendered = true;
+
+		if (job->filePath.isEmpty()) {
+			QBuffer buffer(&job->encodedImage);
+			buffer.open(QBuffer::WriteOnly);
+			job->encoded = image.save(&buffer, job->imageFormat.c_str(), job->compressionQuality);
+			buffer.close();
+		} else {
+			job->encoded = image.save(job->filePath, job->imageFormat.c_str(), job->compressionQuality);
+		}
+	}
 
-QImage TakeSourceScreenshot(obs_source_t *source, bool &success, uint32_t requestedWidth = 0, uint32_t requestedHeight = 0)
+	job->done.set_value();
+}
+
+// Renders and encodes a screenshot through the libobs screenshot service, waiting for it to complete
+bool TakeSourceScreenshot(obs_source_t *source, ScreenshotJob &job, uint32_t requestedWidth = 0, uint32_t requestedHeight = 0)
 {
 	// Get info about the requested source
 	const uint32_t sourceWidth = obs_source_get_base_width(source);
@@ -51,56 +89,15 @@ QImage TakeSourceScreenshot(obs_source_t *source, bool &success, uint32_t reques
 			imgWidth = ((double)imgHeight * sourceAspectRatio);
 	}
 
-	// Create final image texture
-	QImage ret(imgWidth, imgHeight, QImage::Format::Format_RGBA8888);
-	ret.fill(0);
-
-	// Video image buffer
-	uint8_t *videoData = nullptr;
-	uint32_t videoLinesize = 0;
-
-	// Enter graphics context
-	obs_enter_graphics();
-
-	gs_texrender_t *texRender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-	gs_stagesurf_t *stageSurface = gs_stagesurface_create(imgWidth, imgHeight, GS_RGBA);
-
-	success = false;
-	gs_texrender_reset(texRender);
-	if (gs_texrender_begin(texRender, imgWidth, imgHeight)) {
-		vec4 background;
-		vec4_zero(&background);
-
-		gs_clear(GS_CLEAR_COLOR, &background, 0.0f, 0);
-		gs_ortho(0.0f, (float)sourceWidth, 0.0f, (float)sourceHeight, -100.0f, 100.0f);
-
-		gs_blend_state_push();
-		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-
-		obs_source_inc_showing(source);
-		obs_source_video_render(source);
-		obs_source_dec_showing(source);
-
-		gs_blend_state_pop();
-		gs_texrender_end(texRender);
-
-		gs_stage_texture(stageSurface, gs_texrender_get_texture(texRender));
-		if (gs_stagesurface_map(stageSurface, &videoData, &videoLinesize)) {
-			int lineSize = ret.bytesPerLine();
-			for (uint y = 0; y < imgHeight; y++) {
-				memcpy(ret.scanLine(y), videoData + (y * videoLinesize), lineSize);
-			}
-			gs_stagesurface_unmap(stageSurface);
-			success = true;
-		}
-	}
-
-	gs_stagesurface_destroy(stageSurface);
-	gs_texrender_destroy(texRender);
+	if (!imgWidth || !imgHeight)
+		return false;
 
-	obs_leave_graphics();
+	std::future<void> done = job.done.get_future();
+	if (!obs_source_screenshot(source, imgWidth, imgHeight, ScreenshotCallback, &job))
+		return false;
 
-	return ret;
+	done.wait();
+	return job.rendered;
 }
 
 bool IsImageFormatValid(std::string format)
@@ -208,22 +205,17 @@ RequestResult RequestHandler::GetSourceScreenshot(const Request &request)
 		compressionQuality = request.RequestData["imageCompressionQuality"];
 	}
 
-	bool success;
-	QImage renderedImage = TakeSourceScreenshot(source, success, requestedWidth, requestedHeight);
+	ScreenshotJob job;
+	job.imageFormat = imageFormat;
+	job.compressionQuality = compressionQuality;
 
-	if (!success)
+	if (!TakeSourceScreenshot(source, job, requestedWidth, requestedHeight))
 		return RequestResult::Error(RequestStatus::RequestProcessingFailed, "Failed to render screenshot.");
 
-	QByteArray encodedImgBytes;
-	QBuffer buffer(&encodedImgBytes);
-	buffer.open(QBuffer::WriteOnly);
-
-	if (!renderedImage.save(&buffer, imageFormat.c_str(), compressionQuality))
+	if (!job.encoded)
 		return RequestResult::Error(RequestStatus::RequestProcessingFailed, "Failed to encode screenshot.");
 
-	buffer.close();
-
-	QString encodedPicture = QString("data:image/%1;base64,").arg(imageFormat.c_str()).append(encodedImgBytes.toBase64());
+	QString encodedPicture = QString("data:image/%1;base64,").arg(imageFormat.c_str()).append(job.encodedImage.toBase64());
 
 	json responseData;
 	responseData["imageData"] = encodedPicture.toStdString();
@@ -302,20 +294,166 @@ RequestResult RequestHandler::SaveSourceScreenshot(const Request &request)
 		compressionQuality = request.RequestData["imageCompressionQuality"];
 	}
 
-	bool success;
-	QImage renderedImage = TakeSourceScreenshot(source, success, requestedWidth, requestedHeight);
+	ScreenshotJob job;
+	job.imageFormat = imageFormat;
+	job.compressionQuality = compressionQuality;
+	job.filePath = filePathInfo.absoluteFilePath();
 
-	if (!success)
+	if (!TakeSourceScreenshot(source, job, requestedWidth, requestedHeight))
 		return RequestResult::Error(RequestStatus::RequestProcessingFailed, "Failed to render screenshot.");
 
-	QString absoluteFilePath = filePathInfo.absoluteFilePath();
-
-	if (!renderedImage.save(absoluteFilePath, imageFormat.c_str(), compressionQuality))
+	if (!job.encoded)
 		return RequestResult::Error(RequestStatus::RequestProcessingFailed, "Failed to save screenshot.");
 
 	return RequestResult::Success();
 }
 
+/**
+ * Starts streaming a downscaled video feed of a source, or of the program, to this session.
+ *
+ * Frames are sent as binary WebSocket messages, regardless of the session's encoding. See [Video Feed Frames](#video-feed-frames) for their format.
+ *
+ * Sessions subscribing to the same source with the same size and format share the same feed, which is rendered once per frame. If a session can't keep up, frames it hasn't received yet are replaced by newer ones.
+ *
+ * Subscribing again to a feed this session is already subscribed to changes its frame rate.
+ *
+ * **Compatible with inputs and scenes.**
+ *
+ * @requestField ?sourceName              | String | Name of the source to stream                                                | None          | The program is streamed
+ * @requestField imageWidth               | Number | Width of the feed                                                           | >= 8, <= 4096 | N/A
+ * @requestField ?imageHeight             | Number | Height of the feed                                                          | >= 8, <= 4096 | Keeps the aspect ratio of the source
+ * @requestField ?imageFormat             | String | `jpeg` or `nv12`. NV12 feeds have their size rounded down to even numbers | None          | `jpeg`
+ * @requestField ?imageCompressionQuality | Number | JPEG compression quality to use                                             | >= -1, <= 100 | -1
+ * @requestField ?fps                     | Number | Frames per second to send                                                   | >= 1, <= 60   | 10
+ *
+ * @responseField feedId | Number | Id of the feed, found in the header of its frames
+ *
+ * @requestType StartVideoFeed
+ * @complexity 4
+ * @rpcVersion -1
+ * @initialVersion 5.4.0
+ * @api requests
+ * @category sources
+ */
+RequestResult RequestHandler::StartVideoFeed(const Request &request)
+{
+	RequestStatus::RequestStatus statusCode;
+	std::string comment;
+
+	if (!_session)
+		return RequestResult::Error(RequestStatus::CannotAct, "Video feeds can only be started by WebSocket sessions.");
+
+	OBSSourceAutoRelease source;
+	if (request.Contains("sourceName")) {
+		source = request.ValidateSource("sourceName", statusCode, comment);
+		if (!source)
+			return RequestResult::Error(statusCode, comment);
+
+		if (obs_source_get_type(source) != OBS_SOURCE_TYPE_INPUT && obs_source_get_type(source) != OBS_SOURCE_TYPE_SCENE)
+			return RequestResult::Error(RequestStatus::InvalidResourceType,
+						    "The specified source is not an input or a scene.");
+	}
+
+	if (!request.ValidateNumber("imageWidth", statusCode, comment, 8, 4096))
+		return RequestResult::Error(statusCode, comment);
+
+	uint32_t imageWidth = request.RequestData["imageWidth"];
+	uint32_t imageHeight{0};
+	std::string imageFormat = "jpeg";
+	int compressionQuality{-1};
+	uint32_t fps{10};
+
+	if (request.Contains("imageHeight")) {
+		if (!request.ValidateOptionalNumber("imageHeight", statusCode, comment, 8, 4096))
+			return RequestResult::Error(statusCode, comment);
+
+		imageHeight = request.RequestData["imageHeight"];
+	} else {
+		uint32_t sourceWidth, sourceHeight;
+		if (source) {
+			sourceWidth = obs_source_get_base_width(source);
+			sourceHeight = obs_source_get_base_height(source);
+		} else {
+			obs_video_info ovi;
+			obs_get_video_info(&ovi);
+			sourceWidth = ovi.base_width;
+			sourceHeight = ovi.base_height;
+		}
+
+		if (!sourceWidth || !sourceHeight)
+			return RequestResult::Error(RequestStatus::InvalidResourceState,
+						    "The specified source has no size, so `imageHeight` is required.");
+
+		imageHeight = std::clamp((uint32_t)((double)imageWidth * sourceHeight / sourceWidth), 8u, 4096u);
+	}
+
+	if (request.Contains("imageFormat")) {
+		if (!request.ValidateOptionalString("imageFormat", statusCode, comment))
+			return RequestResult::Error(statusCode, comment);
+
+		imageFormat = request.RequestData["imageFormat"];
+		if (imageFormat != "jpeg" && imageFormat != "nv12")
+			return RequestResult::Error(RequestStatus::InvalidRequestField,
+						    "The field `imageFormat` must be either `jpeg` or `nv12`.");
+	}
+
+	if (request.Contains("imageCompressionQuality")) {
+		if (!request.ValidateOptionalNumber("imageCompressionQuality", statusCode, comment, -1, 100))
+			return RequestResult::Error(statusCode, comment);
+
+		compressionQuality = request.RequestData["imageCompressionQuality"];
+	}
+
+	if (request.Contains("fps")) {
+		if (!request.ValidateOptionalNumber("fps", statusCode, comment, 1, 60))
+			return RequestResult::Error(statusCode, comment);
+
+		fps = request.RequestData["fps"];
+	}
+
+	auto webSocketServer = GetWebSocketServer();
+	if (!webSocketServer)
+		return RequestResult::Error(RequestStatus::RequestProcessingFailed, "Unable to start feed due to internal error.");
+
+	auto format = imageFormat == "nv12" ? Utils::Obs::VideoFeed::Nv12 : Utils::Obs::VideoFeed::Jpeg;
+	uint32_t feedId = webSocketServer->GetVideoFeeds()->Subscribe(_session, source, imageWidth, imageHeight, format,
+								      compressionQuality, fps);
+
+	json responseData;
+	responseData["feedId"] = feedId;
+	return RequestResult::Success(responseData);
+}
+
+/**
+ * Stops streaming a video feed to this session.
+ *
+ * @requestField feedId | Number | Id of the feed to stop, as returned by `StartVideoFeed` | >= 1 | N/A
+ *
+ * @requestType StopVideoFeed
+ * @complexity 2
+ * @rpcVersion -1
+ * @initialVersion 5.4.0
+ * @api requests
+ * @category sources
+ */
+RequestResult RequestHandler::StopVideoFeed(const Request &request)
+{
+	RequestStatus::RequestStatus statusCode;
+	std::string comment;
+	if (!request.ValidateNumber("feedId", statusCode, comment, 1))
+		return RequestResult::Error(statusCode, comment);
+
+	auto webSocketServer = GetWebSocketServer();
+	if (!_session || !webSocketServer)
+		return RequestResult::Error(RequestStatus::CannotAct, "Video feeds can only be stopped by WebSocket sessions.");
+
+	uint32_t feedId = request.RequestData["feedId"];
+	if (!webSocketServer->GetVideoFeeds()->Unsubscribe(_session, feedId))
+		return RequestResult::Error(RequestStatus::ResourceNotFound, "This session isn't subscribed to that feed.");
+
+	return RequestResult::Success();
+}
+
 // Intentionally undocumented
 RequestResult RequestHandler::GetSourcePrivateSettings(const Request &request)
 {
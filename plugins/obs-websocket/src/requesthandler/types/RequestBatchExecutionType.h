@@ -75,7 +75,24 @@ namespace RequestBatchExecutionType {
 		* @api enums
 		*/
 		Parallel = 2,
+		/**
+		* A request batch type which processes all requests serially and atomically on the graphics thread, in between
+		* two frames, so a frame never shows a partially applied batch. Consecutive scene item writes (`CreateSceneItem`,
+		* `SetSceneItemTransform`, `SetSceneItemEnabled`, `SetSceneItemLocked`, `SetSceneItemIndex` and
+		* `SetSceneItemBlendMode`) run with their scenes locked and their transform updates deferred until the next
+		* other request. Designed for building or rearranging scenes with many requests.
+		*
+		* Note: The batch holds up rendering while it runs, and the `Sleep` request is not available.
+		*
+		* @enumIdentifier Transactional
+		* @enumValue 3
+		* @enumType RequestBatchExecutionType
+		* @rpcVersion -1
+		* @initialVersion 5.4.0
+		* @api enums
+		*/
+		Transactional = 3,
 	};
 
-	inline bool IsValid(int8_t executionType) { return executionType >= None && executionType <= Parallel; }
+	inline bool IsValid(int8_t executionType) { return executionType >= None && executionType <= Transactional; }
 }
@@ -118,3 +118,17 @@ void Utils::Obs::ActionHelper::SetSourceFilterIndex(obs_source_t *source, obs_so
 			currentIndex--;
 	}
 }
+
+// Enumerating the kinds on the UI thread makes libobs load any plugins still deferred for them
+void Utils::Obs::ActionHelper::LoadDeferredSourceKinds()
+{
+	obs_queue_task(
+		OBS_TASK_UI,
+		[](void *) {
+			const char *kind;
+			obs_enum_input_types(0, &kind);
+			obs_enum_filter_types(0, &kind);
+			obs_enum_transition_types(0, &kind);
+		},
+		nullptr, true);
+}
@@ -23,6 +23,62 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include "../obs-websocket.h"
 #include "plugin-macros.generated.h"
 
+static json GetLatencyStats(const obs_latency_stats &stats)
+{
+	json ret;
+	ret["count"] = stats.count;
+	ret["p50"] = (double)stats.p50_ns / 1000000.0;
+	ret["p90"] = (double)stats.p90_ns / 1000000.0;
+	ret["p99"] = (double)stats.p99_ns / 1000000.0;
+	ret["p999"] = (double)stats.p999_ns / 1000000.0;
+	ret["max"] = (double)stats.max_ns / 1000000.0;
+	return ret;
+}
+
+static std::vector<json> GetOutputLatencies()
+{
+	std::vector<json> outputs;
+
+	auto cb = [](void *param, obs_output_t *output) {
+		auto outputs = reinterpret_cast<std::vector<json> *>(param);
+
+		if (!obs_output_active(output))
+			return true;
+
+		obs_latency_stats stats = {};
+		json outputJson;
+		outputJson["outputName"] = obs_output_get_name(output);
+
+		obs_output_get_interleave_latency(output, &stats);
+		outputJson["interleaveLatency"] = GetLatencyStats(stats);
+		obs_output_get_send_latency(output, &stats);
+		outputJson["sendLatency"] = GetLatencyStats(stats);
+
+		obs_encoder_t *encoder = obs_output_get_video_encoder(output);
+		if (encoder) {
+			obs_encoder_get_encode_latency(encoder, &stats);
+			outputJson["videoEncodeLatency"] = GetLatencyStats(stats);
+		} else {
+			outputJson["videoEncodeLatency"] = nullptr;
+		}
+
+		encoder = obs_output_get_audio_encoder(output, 0);
+		if (encoder) {
+			obs_encoder_get_encode_latency(encoder, &stats);
+			outputJson["audioEncodeLatency"] = GetLatencyStats(stats);
+		} else {
+			outputJson["audioEncodeLatency"] = nullptr;
+		}
+
+		outputs->push_back(outputJson);
+		return true;
+	};
+
+	obs_enum_outputs(cb, &outputs);
+
+	return outputs;
+}
+
 json Utils::Obs::ObjectHelper::GetStats()
 {
 	json ret;
@@ -41,6 +97,15 @@ json Utils::Obs::ObjectHelper::GetStats()
 	ret["outputSkippedFrames"] = video_output_get_skipped_frames(video);
 	ret["outputTotalFrames"] = video_output_get_total_frames(video);
 
+	obs_latency_stats stats = {};
+	obs_get_render_latency(&stats);
+	ret["renderLatency"] = GetLatencyStats(stats);
+	obs_get_readback_latency(&stats);
+	ret["readbackLatency"] = GetLatencyStats(stats);
+	obs_get_audio_callback_latency(&stats);
+	ret["audioCallbackLatency"] = GetLatencyStats(stats);
+	ret["outputLatencies"] = GetOutputLatencies();
+
 	return ret;
 }
 
@@ -0,0 +1,323 @@
+/*
+obs-websocket
+Copyright (C) 2016-2021 Stephane Lepin <stephane.lepin@gmail.com>
+Copyright (C) 2020-2021 Kyle Manning <tt2468@gmail.com>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <algorithm>
+#include <QBuffer>
+#include <QImage>
+
+#include "Obs_VideoFeed.h"
+#include "../obs-websocket.h"
+
+// Longest the render thread sleeps for, so that feeds of closed sessions get cleaned up
+#define MAX_WAKE_INTERVAL_NS 1000000000ULL
+
+static void WriteUInt32(std::string &out, size_t offset, uint32_t value)
+{
+	for (size_t i = 0; i < 4; i++)
+		out[offset + i] = (char)((value >> (i * 8)) & 0xFF);
+}
+
+static void WriteUInt64(std::string &out, size_t offset, uint64_t value)
+{
+	for (size_t i = 0; i < 8; i++)
+		out[offset + i] = (char)((value >> (i * 8)) & 0xFF);
+}
+
+// BT.709 limited range, with chroma averaged over each 2x2 block. Width and height must be even.
+static void ConvertToNv12(char *out, const uint8_t *data, uint32_t linesize, uint32_t cx, uint32_t cy)
+{
+	uint8_t *yPlane = (uint8_t *)out;
+	uint8_t *uvPlane = yPlane + (size_t)cx * cy;
+
+	for (uint32_t y = 0; y < cy; y++) {
+		const uint8_t *row = data + (size_t)y * linesize;
+		uint8_t *yRow = yPlane + (size_t)y * cx;
+
+		for (uint32_t x = 0; x < cx; x++) {
+			const uint8_t *px = row + x * 4;
+			yRow[x] = (uint8_t)(((47 * px[0] + 157 * px[1] + 16 * px[2] + 128) >> 8) + 16);
+		}
+	}
+
+	for (uint32_t y = 0; y < cy; y += 2) {
+		const uint8_t *row0 = data + (size_t)y * linesize;
+		const uint8_t *row1 = row0 + linesize;
+		uint8_t *uvRow = uvPlane + (size_t)(y / 2) * cx;
+
+		for (uint32_t x = 0; x < cx; x += 2) {
+			int r = row0[x * 4] + row0[x * 4 + 4] + row1[x * 4] + row1[x * 4 + 4];
+			int g = row0[x * 4 + 1] + row0[x * 4 + 5] + row1[x * 4 + 1] + row1[x * 4 + 5];
+			int b = row0[x * 4 + 2] + row0[x * 4 + 6] + row1[x * 4 + 2] + row1[x * 4 + 6];
+
+			uvRow[x] = (uint8_t)(((-26 * r - 87 * g + 112 * b + 512) >> 10) + 128);
+			uvRow[x + 1] = (uint8_t)(((112 * r - 102 * g - 10 * b + 512) >> 10) + 128);
+		}
+	}
+}
+
+static bool EncodeFrame(std::string &out, uint32_t feedId, uint64_t timestamp, Utils::Obs::VideoFeed::Format format,
+			int quality, const uint8_t *data, uint32_t linesize, uint32_t cx, uint32_t cy)
+{
+	const size_t headerSize = Utils::Obs::VideoFeed::FrameHeaderSize;
+
+	if (format == Utils::Obs::VideoFeed::Nv12) {
+		out.resize(headerSize + (size_t)cx * cy * 3 / 2);
+		ConvertToNv12(&out[headerSize], data, linesize, cx, cy);
+	} else {
+		QImage image(data, cx, cy, linesize, QImage::Format::Format_RGBA8888);
+		QByteArray encodedImage;
+		QBuffer buffer(&encodedImage);
+		buffer.open(QBuffer::WriteOnly);
+		if (!image.save(&buffer, "JPEG", quality))
+			return false;
+		buffer.close();
+
+		out.resize(headerSize);
+		out.append(encodedImage.constData(), encodedImage.size());
+	}
+
+	out.replace(0, 4, "OBSV");
+	WriteUInt32(out, 4, feedId);
+	WriteUInt32(out, 8, format);
+	WriteUInt32(out, 12, cx);
+	WriteUInt32(out, 16, cy);
+	WriteUInt64(out, 20, timestamp);
+	return true;
+}
+
+Utils::Obs::VideoFeed::Handler::Handler(SendCallback cb) : _sendCallback(cb)
+{
+	_renderThread = std::thread(&Handler::RenderThread, this);
+
+	blog_debug("[Utils::Obs::VideoFeed::Handler::Handler] Handler created.");
+}
+
+Utils::Obs::VideoFeed::Handler::~Handler()
+{
+	std::unique_lock<std::mutex> l(_mutex);
+	_running = false;
+	_cond.notify_all();
+	l.unlock();
+
+	if (_renderThread.joinable())
+		_renderThread.join();
+
+	// libobs calls back for every screenshot it accepted, even if it couldn't take it
+	l.lock();
+	_cond.wait(l, [this] { return _framesInFlight == 0; });
+
+	blog_debug("[Utils::Obs::VideoFeed::Handler::~Handler] Handler destroyed.");
+}
+
+uint32_t Utils::Obs::VideoFeed::Handler::Subscribe(SessionPtr session, obs_source_t *source, uint32_t width, uint32_t height,
+						   Format format, int quality, uint32_t fps)
+{
+	// NV12 chroma is subsampled in both directions
+	if (format == Nv12) {
+		width &= ~1;
+		height &= ~1;
+	}
+
+	std::unique_lock<std::mutex> l(_mutex);
+
+	FeedPtr feed;
+	for (auto &f : _feeds) {
+		bool sameSource = source ? obs_weak_source_references_source(f->source, source) : !f->source;
+		if (sameSource && f->width == width && f->height == height && f->format == format &&
+		    (format != Jpeg || f->quality == quality)) {
+			feed = f;
+			break;
+		}
+	}
+
+	if (!feed) {
+		feed = std::make_shared<Feed>();
+		feed->id = _nextFeedId++;
+		if (source)
+			feed->source = obs_source_get_weak_source(source);
+		feed->width = width;
+		feed->height = height;
+		feed->format = format;
+		feed->quality = quality;
+		_feeds.push_back(feed);
+	}
+
+	Subscriber subscriber;
+	subscriber.session = session;
+	subscriber.interval = 1000000000ULL / fps;
+	subscriber.nextFrame = 0;
+
+	// Subscribing again to the same feed only changes the frame rate
+	auto it = std::find_if(feed->subscribers.begin(), feed->subscribers.end(),
+			       [&session](const Subscriber &s) { return s.session.lock() == session; });
+	if (it != feed->subscribers.end())
+		*it = subscriber;
+	else
+		feed->subscribers.push_back(subscriber);
+
+	_cond.notify_all();
+
+	blog_debug("[Utils::Obs::VideoFeed::Handler::Subscribe] Session subscribed to feed %u (%ux%u, %u fps)", feed->id, width,
+		   height, fps);
+
+	return feed->id;
+}
+
+bool Utils::Obs::VideoFeed::Handler::Unsubscribe(SessionPtr session, uint32_t feedId)
+{
+	std::unique_lock<std::mutex> l(_mutex);
+
+	for (auto &feed : _feeds) {
+		if (feed->id != feedId)
+			continue;
+
+		auto it = std::find_if(feed->subscribers.begin(), feed->subscribers.end(),
+				       [&session](const Subscriber &s) { return s.session.lock() == session; });
+		if (it == feed->subscribers.end())
+			return false;
+
+		feed->subscribers.erase(it);
+		return true;
+	}
+
+	return false;
+}
+
+void Utils::Obs::VideoFeed::Handler::RemoveSession(SessionPtr session)
+{
+	std::unique_lock<std::mutex> l(_mutex);
+
+	for (auto &feed : _feeds) {
+		auto &subscribers = feed->subscribers;
+		subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+						 [&session](const Subscriber &s) {
+							 auto subscriberSession = s.session.lock();
+							 return !subscriberSession || subscriberSession == session;
+						 }),
+				  subscribers.end());
+	}
+}
+
+void Utils::Obs::VideoFeed::Handler::RenderThread()
+{
+	blog_debug("[Utils::Obs::VideoFeed::Handler::RenderThread] Thread started.");
+
+	std::unique_lock<std::mutex> l(_mutex);
+	while (_running) {
+		uint64_t now = os_gettime_ns();
+		uint64_t nextWake = now + MAX_WAKE_INTERVAL_NS;
+
+		for (auto it = _feeds.begin(); it != _feeds.end();) {
+			FeedPtr feed = *it;
+
+			auto &subscribers = feed->subscribers;
+			subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+							 [](const Subscriber &s) { return s.session.expired(); }),
+					  subscribers.end());
+
+			if (subscribers.empty() && !feed->busy) {
+				blog_debug("[Utils::Obs::VideoFeed::Handler::RenderThread] Feed %u has no subscribers left.", feed->id);
+				it = _feeds.erase(it);
+				continue;
+			}
+
+			RenderFeed(feed, now, nextWake);
+			++it;
+		}
+
+		// Woken up early by new subscriptions and finished frames
+		_cond.wait_for(l, std::chrono::nanoseconds(nextWake - now));
+	}
+
+	blog_debug("[Utils::Obs::VideoFeed::Handler::RenderThread] Thread stopped.");
+}
+
+// MUST HOLD LOCK
+bool Utils::Obs::VideoFeed::Handler::RenderFeed(FeedPtr feed, uint64_t now, uint64_t &nextWake)
+{
+	// Only one frame per feed is rendered at a time, later frames are dropped until it's done
+	if (feed->busy)
+		return false;
+
+	std::vector<std::weak_ptr<WebSocketSession>> recipients;
+	for (auto &subscriber : feed->subscribers) {
+		if (now >= subscriber.nextFrame) {
+			recipients.push_back(subscriber.session);
+
+			subscriber.nextFrame += subscriber.interval;
+			if (subscriber.nextFrame <= now)
+				subscriber.nextFrame = now + subscriber.interval;
+		}
+
+		nextWake = std::min(nextWake, subscriber.nextFrame);
+	}
+
+	if (recipients.empty())
+		return false;
+
+	OBSSourceAutoRelease source = feed->source ? obs_weak_source_get_source(feed->source) : obs_get_output_source(0);
+	if (!source)
+		return false;
+
+	auto job = new FrameJob();
+	job->handler = this;
+	job->feed = feed;
+	job->recipients = std::move(recipients);
+	job->timestamp = now;
+
+	if (!obs_source_screenshot(source, feed->width, feed->height, Handler::ScreenshotCallback, job)) {
+		delete job;
+		return false;
+	}
+
+	feed->busy = true;
+	_framesInFlight++;
+	return true;
+}
+
+// Called by libobs on a worker thread
+void Utils::Obs::VideoFeed::Handler::ScreenshotCallback(void *param, const uint8_t *data, uint32_t linesize, uint32_t cx,
+							 uint32_t cy)
+{
+	auto job = static_cast<FrameJob *>(param);
+	auto c = job->handler;
+	FeedPtr feed = job->feed;
+
+	auto payload = std::make_shared<std::string>();
+	if (data && EncodeFrame(*payload, feed->id, job->timestamp, feed->format, feed->quality, data, linesize, cx, cy)) {
+		OutgoingMessage message;
+		message.payload = payload;
+		message.coalesceKey = "VideoFeed:" + std::to_string(feed->id);
+		message.droppable = true;
+		message.binary = true;
+
+		for (auto &recipient : job->recipients) {
+			SessionPtr session = recipient.lock();
+			if (session)
+				c->_sendCallback(session, message);
+		}
+	}
+
+	delete job;
+
+	std::unique_lock<std::mutex> l(c->_mutex);
+	feed->busy = false;
+	c->_framesInFlight--;
+	c->_cond.notify_all();
+}
@@ -0,0 +1,104 @@
+/*
+obs-websocket
+Copyright (C) 2016-2021 Stephane Lepin <stephane.lepin@gmail.com>
+Copyright (C) 2020-2021 Kyle Manning <tt2468@gmail.com>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <obs.hpp>
+
+#include "Obs.h"
+#include "../websocketserver/rpc/WebSocketSession.h"
+
+namespace Utils {
+	namespace Obs {
+		namespace VideoFeed {
+			enum Format : uint32_t {
+				Jpeg = 0,
+				Nv12 = 1,
+			};
+
+			// Size of the header in front of every binary frame message
+			const size_t FrameHeaderSize = 28;
+
+			// Renders each feed (a source or the program at a given size and format) once per frame, at the rate of its
+			// fastest subscriber, and shares the encoded frame between all of its subscribers
+			class Handler {
+				typedef std::function<void(SessionPtr, OutgoingMessage)> SendCallback;
+
+			public:
+				Handler(SendCallback cb);
+				~Handler();
+
+				// Subscribes the session to the matching feed, creating it if needed. `source` is null for the
+				// program. Returns the id of the feed.
+				uint32_t Subscribe(SessionPtr session, obs_source_t *source, uint32_t width, uint32_t height,
+						   Format format, int quality, uint32_t fps);
+				bool Unsubscribe(SessionPtr session, uint32_t feedId);
+				void RemoveSession(SessionPtr session);
+
+			private:
+				struct Subscriber {
+					std::weak_ptr<WebSocketSession> session;
+					uint64_t interval;
+					uint64_t nextFrame;
+				};
+
+				struct Feed {
+					uint32_t id;
+					OBSWeakSourceAutoRelease source; // Null for the program
+					uint32_t width;
+					uint32_t height;
+					Format format;
+					int quality;
+					std::vector<Subscriber> subscribers;
+					bool busy = false;
+				};
+				typedef std::shared_ptr<Feed> FeedPtr;
+
+				struct FrameJob {
+					Handler *handler;
+					FeedPtr feed;
+					std::vector<std::weak_ptr<WebSocketSession>> recipients;
+					uint64_t timestamp;
+				};
+
+				SendCallback _sendCallback;
+
+				std::mutex _mutex;
+				std::condition_variable _cond;
+				std::vector<FeedPtr> _feeds;
+				uint32_t _nextFeedId = 1;
+				size_t _framesInFlight = 0;
+				bool _running = true;
+				std::thread _renderThread;
+
+				void RenderThread();
+				bool RenderFeed(FeedPtr feed, uint64_t now, uint64_t &nextWake);
+				static void ScreenshotCallback(void *param, const uint8_t *data, uint32_t linesize, uint32_t cx,
+							       uint32_t cy);
+			};
+		}
+	}
+}
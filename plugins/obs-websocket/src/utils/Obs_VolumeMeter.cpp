@@ -18,25 +18,19 @@ You should have received a copy of the GNU General Public License along
 with this program. If not, see <https://www.gnu.org/licenses/>
 */
 
-#include <cmath>
-#include <algorithm>
-
 #include "Obs.h"
 #include "Obs_VolumeMeter.h"
-#include "Obs_VolumeMeter_Helpers.h"
 #include "../obs-websocket.h"
 
 Utils::Obs::VolumeMeter::Meter::Meter(obs_source_t *input)
 	: PeakMeterType(SAMPLE_PEAK_METER),
 	  _input(obs_source_get_weak_source(input)),
-	  _channels(0),
-	  _lastUpdate(0),
 	  _volume(obs_source_get_volume(input))
 {
 	signal_handler_t *sh = obs_source_get_signal_handler(input);
 	signal_handler_connect(sh, "volume", Meter::InputVolumeCallback, this);
 
-	obs_source_add_audio_capture_callback(input, Meter::InputAudioCaptureCallback, this);
+	obs_source_inc_audio_levels(input);
 
 	blog_debug("[Utils::Obs::VolumeMeter::Meter::Meter] Meter created for input: %s", obs_source_get_name(input));
 }
@@ -53,7 +47,7 @@ Utils::Obs::VolumeMeter::Meter::~Meter()
 	signal_handler_t *sh = obs_source_get_signal_handler(input);
 	signal_handler_disconnect(sh, "volume", Meter::InputVolumeCallback, this);
 
-	obs_source_remove_audio_capture_callback(input, Meter::InputAudioCaptureCallback, this);
+	obs_source_dec_audio_levels(input);
 
 	blog_debug("[Utils::Obs::VolumeMeter::Meter::~Meter] Meter destroyed for input: %s", obs_source_get_name(input));
 }
@@ -74,23 +68,23 @@ json Utils::Obs::VolumeMeter::Meter::GetMeterData()
 		return ret;
 	}
 
-	std::vector<std::vector<float>> levels;
-	const float volume = _muted ? 0.0f : _volume.load();
-
-	std::unique_lock<std::mutex> l(_mutex);
+	struct obs_audio_levels audioLevels = {};
+	obs_source_get_audio_levels(input, &audioLevels);
 
-	if (_lastUpdate != 0 && (os_gettime_ns() - _lastUpdate) * 0.000000001 > 0.3)
-		ResetAudioLevels();
+	// Levels which haven't been updated for a while are reported as silence
+	bool stale = (os_gettime_ns() - audioLevels.timestamp) * 0.000000001 > 0.3;
+	const float volume = (audioLevels.muted || stale) ? 0.0f : _volume.load();
+	const float *peak = PeakMeterType == TRUE_PEAK_METER ? audioLevels.true_peak : audioLevels.peak;
 
-	for (int channel = 0; channel < _channels; channel++) {
+	std::vector<std::vector<float>> levels;
+	for (int channel = 0; channel < audioLevels.channels; channel++) {
 		std::vector<float> level;
-		level.push_back(_magnitude[channel] * volume);
-		level.push_back(_peak[channel] * volume);
-		level.push_back(_peak[channel]);
+		level.push_back(audioLevels.magnitude[channel] * volume);
+		level.push_back(peak[channel] * volume);
+		level.push_back(stale ? 0.0f : peak[channel]);
 
 		levels.push_back(level);
 	}
-	l.unlock();
 
 	ret["inputName"] = obs_source_get_name(input);
 	ret["inputLevelsMul"] = levels;
@@ -98,137 +92,6 @@ json Utils::Obs::VolumeMeter::Meter::GetMeterData()
 	return ret;
 }
 
-// MUST HOLD LOCK
-void Utils::Obs::VolumeMeter::Meter::ResetAudioLevels()
-{
-	_lastUpdate = 0;
-	for (int channelNumber = 0; channelNumber < MAX_AUDIO_CHANNELS; channelNumber++) {
-		_magnitude[channelNumber] = 0;
-		_peak[channelNumber] = 0;
-	}
-}
-
-// MUST HOLD LOCK
-void Utils::Obs::VolumeMeter::Meter::ProcessAudioChannels(const struct audio_data *data)
-{
-	int channels = 0;
-	for (int i = 0; i < MAX_AV_PLANES; i++) {
-		if (data->data[i])
-			channels++;
-	}
-
-	bool channelsChanged = _channels != channels;
-	_channels = std::clamp(channels, 0, MAX_AUDIO_CHANNELS);
-
-	if (channelsChanged)
-		ResetAudioLevels();
-}
-
-// MUST HOLD LOCK
-void Utils::Obs::VolumeMeter::Meter::ProcessPeak(const struct audio_data *data)
-{
-	size_t sampleCount = data->frames;
-	int channelNumber = 0;
-
-	for (int planeNumber = 0; channelNumber < _channels; planeNumber++) {
-		float *samples = (float *)data->data[planeNumber];
-		if (!samples)
-			continue;
-
-		if (((uintptr_t)samples & 0xf) > 0) {
-			_peak[channelNumber] = 1.0f;
-			channelNumber++;
-			continue;
-		}
-
-		__m128 previousSamples = _mm_loadu_ps(_previousSamples[channelNumber]);
-
-		float peak;
-		switch (PeakMeterType) {
-		default:
-		case SAMPLE_PEAK_METER:
-			peak = GetSamplePeak(previousSamples, samples, sampleCount);
-			break;
-		case TRUE_PEAK_METER:
-			peak = GetTruePeak(previousSamples, samples, sampleCount);
-			break;
-		}
-
-		switch (sampleCount) {
-		case 0:
-			break;
-		case 1:
-			_previousSamples[channelNumber][0] = _previousSamples[channelNumber][1];
-			_previousSamples[channelNumber][1] = _previousSamples[channelNumber][2];
-			_previousSamples[channelNumber][2] = _previousSamples[channelNumber][3];
-			_previousSamples[channelNumber][3] = samples[sampleCount - 1];
-			break;
-		case 2:
-			_previousSamples[channelNumber][0] = _previousSamples[channelNumber][2];
-			_previousSamples[channelNumber][1] = _previousSamples[channelNumber][3];
-			_previousSamples[channelNumber][2] = samples[sampleCount - 2];
-			_previousSamples[channelNumber][3] = samples[sampleCount - 1];
-			break;
-		case 3:
-			_previousSamples[channelNumber][0] = _previousSamples[channelNumber][3];
-			_previousSamples[channelNumber][1] = samples[sampleCount - 3];
-			_previousSamples[channelNumber][2] = samples[sampleCount - 2];
-			_previousSamples[channelNumber][3] = samples[sampleCount - 1];
-			break;
-		default:
-			_previousSamples[channelNumber][0] = samples[sampleCount - 4];
-			_previousSamples[channelNumber][1] = samples[sampleCount - 3];
-			_previousSamples[channelNumber][2] = samples[sampleCount - 2];
-			_previousSamples[channelNumber][3] = samples[sampleCount - 1];
-		}
-
-		_peak[channelNumber] = peak;
-
-		channelNumber++;
-	}
-
-	for (; channelNumber < MAX_AUDIO_CHANNELS; channelNumber++)
-		_peak[channelNumber] = 0.0;
-}
-
-// MUST HOLD LOCK
-void Utils::Obs::VolumeMeter::Meter::ProcessMagnitude(const struct audio_data *data)
-{
-	size_t sampleCount = data->frames;
-
-	int channelNumber = 0;
-	for (int planeNumber = 0; channelNumber < _channels; planeNumber++) {
-		float *samples = (float *)data->data[planeNumber];
-		if (!samples)
-			continue;
-
-		float sum = 0.0;
-		for (size_t i = 0; i < sampleCount; i++) {
-			float sample = samples[i];
-			sum += sample * sample;
-		}
-
-		_magnitude[channelNumber] = std::sqrt(sum / sampleCount);
-
-		channelNumber++;
-	}
-}
-
-void Utils::Obs::VolumeMeter::Meter::InputAudioCaptureCallback(void *priv_data, obs_source_t *, const struct audio_data *data,
-							       bool muted)
-{
-	auto c = static_cast<Meter *>(priv_data);
-
-	std::unique_lock<std::mutex> l(c->_mutex);
-
-	c->_muted = muted;
-	c->ProcessAudioChannels(data);
-	c->ProcessPeak(data);
-	c->ProcessMagnitude(data);
-
-	c->_lastUpdate = os_gettime_ns();
-}
-
 void Utils::Obs::VolumeMeter::Meter::InputVolumeCallback(void *priv_data, calldata_t *cd)
 {
 	auto c = static_cast<Meter *>(priv_data);
@@ -33,8 +33,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 namespace Utils {
 	namespace Obs {
 		namespace VolumeMeter {
-			// Some code copied from https://github.com/obsproject/obs-studio/blob/master/libobs/obs-audio-controls.c
-			// Keeps a running tally of the current audio levels, for a specific input
+			// Reads the current audio levels of a specific input, which libobs measures once for every meter of that input
 			class Meter {
 			public:
 				Meter(obs_source_t *input);
@@ -49,24 +48,8 @@ namespace Utils {
 			private:
 				OBSWeakSourceAutoRelease _input;
 
-				// All values in mul
-				std::mutex _mutex;
-				bool _muted;
-				int _channels;
-				float _magnitude[MAX_AUDIO_CHANNELS];
-				float _peak[MAX_AUDIO_CHANNELS];
-				float _previousSamples[MAX_AUDIO_CHANNELS][4];
-
-				std::atomic<uint64_t> _lastUpdate;
 				std::atomic<float> _volume;
 
-				void ResetAudioLevels();
-				void ProcessAudioChannels(const struct audio_data *data);
-				void ProcessPeak(const struct audio_data *data);
-				void ProcessMagnitude(const struct audio_data *data);
-
-				static void InputAudioCaptureCallback(void *priv_data, obs_source_t *source,
-								      const struct audio_data *data, bool muted);
 				static void InputVolumeCallback(void *priv_data, calldata_t *cd);
 			};
 
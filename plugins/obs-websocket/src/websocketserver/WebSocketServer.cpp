@@ -53,10 +53,16 @@ WebSocketServer::WebSocketServer() : QObject(nullptr)
 						     std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
 
 	eventHandler->SetObsReadyCallback(std::bind(&WebSocketServer::onObsReady, this, std::placeholders::_1));
+
+	_videoFeeds = std::make_unique<Utils::Obs::VideoFeed::Handler>(
+		std::bind(&WebSocketServer::SendToSession, this, std::placeholders::_1, std::placeholders::_2));
 }
 
 WebSocketServer::~WebSocketServer()
 {
+	// Waits for frames which are still being rendered
+	_videoFeeds.reset();
+
 	if (_server.is_listening())
 		Stop();
 }
@@ -199,9 +205,14 @@ std::vector<WebSocketServer::WebSocketSessionState> WebSocketServer::GetWebSocke
 		uint64_t outgoingMessages = session->OutgoingMessages();
 		std::string remoteAddress = session->RemoteAddress();
 		bool isIdentified = session->IsIdentified();
-
-		webSocketSessions.emplace_back(
-			WebSocketSessionState{hdl, remoteAddress, connectedAt, incomingMessages, outgoingMessages, isIdentified});
+		uint64_t outgoingQueueDepth = session->OutgoingQueueDepth();
+		uint64_t outgoingQueuePeak = session->OutgoingQueuePeak();
+		uint64_t droppedMessages = session->DroppedMessages();
+		uint64_t coalescedMessages = session->CoalescedMessages();
+
+		webSocketSessions.emplace_back(WebSocketSessionState{hdl, remoteAddress, connectedAt, incomingMessages,
+								     outgoingMessages, isIdentified, outgoingQueueDepth,
+								     outgoingQueuePeak, droppedMessages, coalescedMessages});
 	}
 	lock.unlock();
 
@@ -320,6 +331,8 @@ void WebSocketServer::onClose(websocketpp::connection_hdl hdl)
 	_sessions.erase(hdl);
 	lock.unlock();
 
+	_videoFeeds->RemoveSession(session);
+
 	// If client was identified, decrement appropriate refs in eventhandler.
 	if (isIdentified) {
 		auto eventHandler = GetEventHandler();
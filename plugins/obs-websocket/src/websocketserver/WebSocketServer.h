@@ -32,6 +32,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include "types/WebSocketOpCode.h"
 #include "../utils/Json.h"
 #include "../requesthandler/rpc/Request.h"
+#include "../utils/Obs_VideoFeed.h"
 #include "plugin-macros.generated.h"
 
 class WebSocketServer : QObject {
@@ -47,6 +48,10 @@ public:
 		uint64_t incomingMessages;
 		uint64_t outgoingMessages;
 		bool isIdentified;
+		uint64_t outgoingQueueDepth = 0;
+		uint64_t outgoingQueuePeak = 0;
+		uint64_t droppedMessages = 0;
+		uint64_t coalescedMessages = 0;
 	};
 
 	WebSocketServer();
@@ -64,6 +69,8 @@ public:
 
 	QThreadPool *GetThreadPool() { return &_threadPool; }
 
+	Utils::Obs::VideoFeed::Handler *GetVideoFeeds() { return _videoFeeds.get(); }
+
 signals:
 	void ClientConnected(WebSocketSessionState state);
 	void ClientDisconnected(WebSocketSessionState state, uint16_t closeCode);
@@ -85,6 +92,8 @@ private:
 
 	static void SetSessionParameters(SessionPtr session, WebSocketServer::ProcessResult &ret, const json &payloadData);
 	void ProcessMessage(SessionPtr session, ProcessResult &ret, WebSocketOpCode::WebSocketOpCode opCode, json &payloadData);
+	void FlushSession(websocketpp::connection_hdl hdl, SessionPtr session);
+	void SendToSession(SessionPtr session, OutgoingMessage message);
 
 	QThreadPool _threadPool;
 
@@ -98,4 +107,6 @@ private:
 	std::map<websocketpp::connection_hdl, SessionPtr, std::owner_less<websocketpp::connection_hdl>> _sessions;
 
 	std::atomic<bool> _obsReady = false;
+
+	std::unique_ptr<Utils::Obs::VideoFeed::Handler> _videoFeeds;
 };
@@ -17,6 +17,7 @@ You should have received a copy of the GNU General Public License along
 with this program. If not, see <https://www.gnu.org/licenses/>
 */
 
+#include <algorithm>
 #include <obs-module.h>
 #include <util/profiler.hpp>
 
@@ -30,6 +31,10 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include "../utils/Platform.h"
 #include "../utils/Compat.h"
 
+// Unsent data websocketpp may buffer for a session before its events wait in the session's own queue
+#define MAX_BUFFERED_AMOUNT (4 * 1024 * 1024)
+#define FLUSH_RETRY_MS 10
+
 static bool IsSupportedRpcVersion(uint8_t requestedVersion)
 {
 	return (requestedVersion == 1);
@@ -352,6 +357,24 @@ void WebSocketServer::ProcessMessage(SessionPtr session, WebSocketServer::Proces
 	}
 }
 
+// Events outside of `All` are high-volume and only ever describe the latest value of something,
+// so a newer one makes a still queued older one for the same scene item or input obsolete.
+static std::string GetCoalesceKey(uint64_t requiredIntent, const std::string &eventType, const json &eventData)
+{
+	if ((requiredIntent & EventSubscription::All) != 0)
+		return "";
+
+	std::string coalesceKey = eventType;
+	if (eventData.is_object()) {
+		for (auto field : {"sceneName", "sceneItemId", "inputName"}) {
+			if (eventData.contains(field))
+				coalesceKey += "\n" + eventData[field].dump();
+		}
+	}
+
+	return coalesceKey;
+}
+
 // It isn't consistent to directly call the WebSocketServer from the events system, but it would also be dumb to make it unnecessarily complicated.
 void WebSocketServer::BroadcastEvent(uint64_t requiredIntent, const std::string &eventType, const json &eventData,
 				     uint8_t rpcVersion)
@@ -369,10 +392,15 @@ void WebSocketServer::BroadcastEvent(uint64_t requiredIntent, const std::string
 			eventMessage["d"]["eventData"] = eventData;
 
 		// Initialize objects. The broadcast process only dumps the data when its needed.
-		std::string messageJson;
-		std::string messageMsgPack;
+		std::shared_ptr<const std::string> messageJson;
+		std::shared_ptr<const std::string> messageMsgPack;
 
-		// Recurse connected sessions and send the event to suitable sessions.
+		// High-volume events are coalesced and dropped before any other event when a session's queue is full
+		std::string coalesceKey = GetCoalesceKey(requiredIntent, eventType, eventData);
+		bool droppable = !coalesceKey.empty();
+
+		// Queue the event for suitable sessions. Sending happens outside of the session lock.
+		std::vector<std::pair<websocketpp::connection_hdl, SessionPtr>> flushSessions;
 		std::unique_lock<std::mutex> lock(_sessionMutex);
 		for (auto &it : _sessions) {
 			if (!it.second->IsIdentified())
@@ -380,32 +408,82 @@ void WebSocketServer::BroadcastEvent(uint64_t requiredIntent, const std::string
 			if (rpcVersion && it.second->RpcVersion() != rpcVersion)
 				continue;
 			if ((it.second->EventSubscriptions() & requiredIntent) != 0) {
-				websocketpp::lib::error_code errorCode;
+				OutgoingMessage message;
 				switch (it.second->Encoding()) {
 				case WebSocketEncoding::Json:
-					if (messageJson.empty())
-						messageJson = eventMessage.dump();
-					_server.send((websocketpp::connection_hdl)it.first, messageJson,
-						     websocketpp::frame::opcode::text, errorCode);
-					it.second->IncrementOutgoingMessages();
+					if (!messageJson)
+						messageJson = std::make_shared<const std::string>(eventMessage.dump());
+					message.payload = messageJson;
 					break;
 				case WebSocketEncoding::MsgPack:
-					if (messageMsgPack.empty()) {
+					if (!messageMsgPack) {
 						auto msgPackData = json::to_msgpack(eventMessage);
-						messageMsgPack = std::string(msgPackData.begin(), msgPackData.end());
+						messageMsgPack =
+							std::make_shared<const std::string>(msgPackData.begin(), msgPackData.end());
 					}
-					_server.send((websocketpp::connection_hdl)it.first, messageMsgPack,
-						     websocketpp::frame::opcode::binary, errorCode);
-					it.second->IncrementOutgoingMessages();
+					message.payload = messageMsgPack;
 					break;
 				}
-				if (errorCode)
-					blog(LOG_ERROR, "[WebSocketServer::BroadcastEvent] Error sending event message: %s",
-					     errorCode.message().c_str());
+				message.coalesceKey = coalesceKey;
+				message.droppable = droppable;
+				if (it.second->QueueOutgoingMessage(std::move(message)))
+					flushSessions.emplace_back(it.first, it.second);
 			}
 		}
 		lock.unlock();
+
+		for (auto &[hdl, session] : flushSessions)
+			FlushSession(hdl, session);
+
 		if (IsDebugEnabled() && (EventSubscription::All & requiredIntent) != 0) // Don't log high volume events
 			blog(LOG_INFO, "[WebSocketServer::BroadcastEvent] Outgoing event:\n%s", eventMessage.dump(2).c_str());
 	}));
 }
+
+// Queues a message for a single session, like video feed frames
+void WebSocketServer::SendToSession(SessionPtr session, OutgoingMessage message)
+{
+	websocketpp::connection_hdl hdl;
+
+	std::unique_lock<std::mutex> lock(_sessionMutex);
+	auto it = std::find_if(_sessions.begin(), _sessions.end(), [&session](const auto &s) { return s.second == session; });
+	if (it == _sessions.end())
+		return;
+	hdl = it->first;
+	bool flush = session->QueueOutgoingMessage(std::move(message));
+	lock.unlock();
+
+	if (flush)
+		FlushSession(hdl, session);
+}
+
+// Hands queued messages to websocketpp until the connection has too much unsent data buffered, then retries
+// once the client had some time to read. Only one flush runs per session at a time.
+void WebSocketServer::FlushSession(websocketpp::connection_hdl hdl, SessionPtr session)
+{
+	websocketpp::lib::error_code errorCode;
+	auto conn = _server.get_con_from_hdl(hdl, errorCode);
+	if (errorCode || conn->get_state() != websocketpp::session::state::open) {
+		session->ClearOutgoingMessages();
+		return;
+	}
+
+	auto sessionOpCode = session->Encoding() == WebSocketEncoding::MsgPack ? websocketpp::frame::opcode::binary
+										 : websocketpp::frame::opcode::text;
+
+	while (conn->get_buffered_amount() < MAX_BUFFERED_AMOUNT) {
+		OutgoingMessage message;
+		if (!session->PopOutgoingMessage(message))
+			return;
+
+		errorCode = conn->send(*message.payload, message.binary ? websocketpp::frame::opcode::binary : sessionOpCode);
+		if (errorCode)
+			blog(LOG_ERROR, "[WebSocketServer::FlushSession] Error sending event message: %s",
+			     errorCode.message().c_str());
+		else
+			session->IncrementOutgoingMessages();
+	}
+
+	_server.set_timer(FLUSH_RETRY_MS,
+			  [this, hdl, session](const websocketpp::lib::error_code &) { FlushSession(hdl, session); });
+}
@@ -0,0 +1,99 @@
+/*
+obs-websocket
+Copyright (C) 2016-2021 Stephane Lepin <stephane.lepin@gmail.com>
+Copyright (C) 2020-2021 Kyle Manning <tt2468@gmail.com>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <algorithm>
+#include <obs-module.h>
+
+#include "WebSocketSession.h"
+
+// Events are queued per session, so a client that reads slowly only holds up its own events
+#define MAX_OUTGOING_QUEUE_SIZE 1024
+
+bool WebSocketSession::QueueOutgoingMessage(OutgoingMessage message)
+{
+	std::lock_guard<std::mutex> lock(_outgoingMutex);
+
+	// A queued message is always followed by a flush, so nothing has to be scheduled for a coalesced or dropped one
+	if (!message.coalesceKey.empty()) {
+		for (auto &queuedMessage : _outgoingQueue) {
+			if (queuedMessage.coalesceKey == message.coalesceKey) {
+				queuedMessage.payload = std::move(message.payload);
+				_coalescedMessages++;
+				return false;
+			}
+		}
+	}
+
+	if (_outgoingQueue.size() >= MAX_OUTGOING_QUEUE_SIZE) {
+		if (message.droppable) {
+			_droppedMessages++;
+			return false;
+		}
+
+		// Make room by dropping the oldest droppable message, only drop this one if there is none
+		auto it = std::find_if(_outgoingQueue.begin(), _outgoingQueue.end(),
+				       [](const OutgoingMessage &queuedMessage) { return queuedMessage.droppable; });
+		_droppedMessages++;
+		if (it == _outgoingQueue.end()) {
+			if (!_warnedDroppedMessages) {
+				blog(LOG_WARNING,
+				     "[WebSocketSession::QueueOutgoingMessage] Client `%s` is not keeping up with events, dropping events.",
+				     RemoteAddress().c_str());
+				_warnedDroppedMessages = true;
+			}
+			return false;
+		}
+		_outgoingQueue.erase(it);
+	}
+
+	_outgoingQueue.push_back(std::move(message));
+
+	_outgoingQueueDepth = _outgoingQueue.size();
+	if (_outgoingQueueDepth > _outgoingQueuePeak)
+		_outgoingQueuePeak = _outgoingQueueDepth.load();
+
+	if (_flushPending)
+		return false;
+	_flushPending = true;
+	return true;
+}
+
+bool WebSocketSession::PopOutgoingMessage(OutgoingMessage &message)
+{
+	std::lock_guard<std::mutex> lock(_outgoingMutex);
+
+	if (_outgoingQueue.empty()) {
+		_flushPending = false;
+		return false;
+	}
+
+	message = std::move(_outgoingQueue.front());
+	_outgoingQueue.pop_front();
+	_outgoingQueueDepth = _outgoingQueue.size();
+	return true;
+}
+
+void WebSocketSession::ClearOutgoingMessages()
+{
+	std::lock_guard<std::mutex> lock(_outgoingMutex);
+
+	_outgoingQueue.clear();
+	_outgoingQueueDepth = 0;
+	_flushPending = false;
+}
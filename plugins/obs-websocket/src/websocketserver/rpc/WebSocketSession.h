@@ -23,6 +23,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include <string>
 #include <atomic>
 #include <memory>
+#include <deque>
 
 #include "../../eventhandler/types/EventSubscription.h"
 #include "plugin-macros.generated.h"
@@ -30,6 +31,17 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 class WebSocketSession;
 typedef std::shared_ptr<WebSocketSession> SessionPtr;
 
+struct OutgoingMessage {
+	// Shared between every session with the same encoding
+	std::shared_ptr<const std::string> payload;
+	// Messages with the same non-empty key only ever keep the latest value queued
+	std::string coalesceKey;
+	// May be dropped to make room for other messages when the queue is full
+	bool droppable = false;
+	// Sent as a binary frame regardless of the session's encoding (video feed frames)
+	bool binary = false;
+};
+
 class WebSocketSession {
 public:
 	inline std::string RemoteAddress()
@@ -89,6 +101,17 @@ public:
 	inline uint64_t EventSubscriptions() { return _eventSubscriptions; }
 	inline void SetEventSubscriptions(uint64_t subscriptions) { _eventSubscriptions = subscriptions; }
 
+	// Returns true if the caller has to flush the queue, false if a flush is already pending
+	bool QueueOutgoingMessage(OutgoingMessage message);
+	// Returns false and ends the pending flush once the queue is empty
+	bool PopOutgoingMessage(OutgoingMessage &message);
+	void ClearOutgoingMessages();
+
+	inline uint64_t OutgoingQueueDepth() { return _outgoingQueueDepth; }
+	inline uint64_t OutgoingQueuePeak() { return _outgoingQueuePeak; }
+	inline uint64_t DroppedMessages() { return _droppedMessages; }
+	inline uint64_t CoalescedMessages() { return _coalescedMessages; }
+
 	std::mutex OperationMutex;
 
 private:
@@ -106,4 +129,12 @@ private:
 	std::atomic<uint8_t> _rpcVersion = OBS_WEBSOCKET_RPC_VERSION;
 	std::atomic<bool> _isIdentified = false;
 	std::atomic<uint64_t> _eventSubscriptions = EventSubscription::All;
+	std::mutex _outgoingMutex;
+	std::deque<OutgoingMessage> _outgoingQueue;
+	bool _flushPending = false;
+	bool _warnedDroppedMessages = false;
+	std::atomic<uint64_t> _outgoingQueueDepth = 0;
+	std::atomic<uint64_t> _outgoingQueuePeak = 0;
+	std::atomic<uint64_t> _droppedMessages = 0;
+	std::atomic<uint64_t> _coalescedMessages = 0;
 };
@@ -111,6 +111,12 @@ static void obs_x264_defaults(obs_data_t *settings)
 	obs_data_set_default_string(settings, "tune", "");
 	obs_data_set_default_string(settings, "x264opts", "");
 	obs_data_set_default_bool(settings, "repeat_headers", false);
+
+	obs_data_set_default_bool(settings, "latency_mode", false);
+	obs_data_set_default_int(settings, "target_latency_ms", 100);
+	obs_data_set_default_int(settings, "threads", 0);
+	obs_data_set_default_bool(settings, "sliced_threads", false);
+	obs_data_set_default_int(settings, "lookahead_threads", 0);
 }
 
 static inline void add_strings(obs_property_t *list, const char *const *strings)
@@ -133,6 +139,11 @@ static inline void add_strings(obs_property_t *list, const char *const *strings)
 #define TEXT_TUNE obs_module_text("Tune")
 #define TEXT_NONE obs_module_text("None")
 #define TEXT_X264_OPTS obs_module_text("EncoderOptions")
+#define TEXT_LATENCY_MODE obs_module_text("LatencyMode")
+#define TEXT_TARGET_LATENCY obs_module_text("TargetLatency")
+#define TEXT_THREADS obs_module_text("Threads")
+#define TEXT_SLICED_THREADS obs_module_text("SlicedThreads")
+#define TEXT_LOOKAHEAD_THREADS obs_module_text("LookaheadThreads")
 
 static const int g_defaultGopIntervalInSec = 3;
 
@@ -168,6 +179,20 @@ static bool rate_control_modified(obs_properties_t *ppts, obs_property_t *p,
 	return true;
 }
 
+static bool latency_mode_modified(obs_properties_t *ppts, obs_property_t *p,
+				  obs_data_t *settings)
+{
+	bool latency_mode = obs_data_get_bool(settings, "latency_mode");
+
+	p = obs_properties_get(ppts, "target_latency_ms");
+	obs_property_set_visible(p, latency_mode);
+	p = obs_properties_get(ppts, "sliced_threads");
+	obs_property_set_visible(p, !latency_mode);
+	p = obs_properties_get(ppts, "lookahead_threads");
+	obs_property_set_visible(p, !latency_mode);
+	return true;
+}
+
 static obs_properties_t *obs_x264_props(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -223,6 +248,17 @@ static obs_properties_t *obs_x264_props(void *unused)
 	obs_properties_add_bool(props, "vfr", TEXT_VFR);
 #endif
 
+	p = obs_properties_add_bool(props, "latency_mode", TEXT_LATENCY_MODE);
+	obs_property_set_modified_callback(p, latency_mode_modified);
+	p = obs_properties_add_int(props, "target_latency_ms",
+				   TEXT_TARGET_LATENCY, 16, 1000, 1);
+	obs_property_int_set_suffix(p, " ms");
+
+	obs_properties_add_int(props, "threads", TEXT_THREADS, 0, 64, 1);
+	obs_properties_add_bool(props, "sliced_threads", TEXT_SLICED_THREADS);
+	obs_properties_add_int(props, "lookahead_threads",
+			       TEXT_LOOKAHEAD_THREADS, 0, 16, 1);
+
 	obs_properties_add_text(props, "x264opts", TEXT_X264_OPTS,
 				OBS_TEXT_DEFAULT);
 
@@ -385,6 +421,62 @@ enum rate_control {
 	RATE_CONTROL_CRF
 };
 
+/* x264 adds one frame of delay for every frame thread beyond the first, plus
+ * one for each frame of lookahead or b-frames.  Lookahead and b-frames are
+ * always disabled here; what is left of the latency budget (minus the frame
+ * currently being encoded) decides whether frame threads fit at all.  If they
+ * don't, sliced threads split each frame across cores instead. */
+static void apply_latency_params(struct obs_x264 *obsx264,
+				 const struct video_output_info *voi,
+				 int target_latency_ms, int threads)
+{
+	double frame_ms = 1000.0 * (double)voi->fps_den / (double)voi->fps_num;
+	int delay_frames = (int)((double)target_latency_ms / frame_ms) - 1;
+	int cores = os_get_logical_cores();
+	x264_param_t *params = &obsx264->params;
+
+	params->i_bframe = 0;
+	params->i_sync_lookahead = 0;
+	params->rc.i_lookahead = 0;
+	params->rc.b_mb_tree = 0;
+	params->b_vfr_input = 0;
+	params->i_lookahead_threads = 1;
+
+	if (delay_frames < 2) {
+		params->b_sliced_threads = 1;
+		params->i_threads = threads ? threads : X264_THREADS_AUTO;
+	} else {
+		int frame_threads = delay_frames + 1;
+
+		if (threads && threads < frame_threads)
+			frame_threads = threads;
+		if (cores > 0 && cores < frame_threads)
+			frame_threads = cores;
+
+		params->b_sliced_threads = 0;
+		params->i_threads = frame_threads;
+	}
+
+	info("latency mode:\n"
+	     "\ttarget latency: %d ms\n"
+	     "\tframe time:     %.2f ms\n"
+	     "\tthreads:        %d (%s)\n",
+	     target_latency_ms, frame_ms, params->i_threads,
+	     params->b_sliced_threads ? "sliced" : "frame");
+}
+
+static inline void apply_thread_params(struct obs_x264 *obsx264, int threads,
+				       bool sliced_threads,
+				       int lookahead_threads)
+{
+	if (threads)
+		obsx264->params.i_threads = threads;
+	if (sliced_threads)
+		obsx264->params.b_sliced_threads = 1;
+	if (lookahead_threads)
+		obsx264->params.i_lookahead_threads = lookahead_threads;
+}
+
 static void update_params(struct obs_x264 *obsx264, obs_data_t *settings,
 			  const struct obs_x264_options *options, bool update)
 {
@@ -410,6 +502,13 @@ static void update_params(struct obs_x264 *obsx264, obs_data_t *settings,
 	int bf = (int)obs_data_get_int(settings, "bf");
 	bool use_bufsize = obs_data_get_bool(settings, "use_bufsize");
 	bool cbr_override = obs_data_get_bool(settings, "cbr");
+	bool latency_mode = obs_data_get_bool(settings, "latency_mode");
+	int target_latency_ms =
+		(int)obs_data_get_int(settings, "target_latency_ms");
+	int threads = (int)obs_data_get_int(settings, "threads");
+	bool sliced_threads = obs_data_get_bool(settings, "sliced_threads");
+	int lookahead_threads =
+		(int)obs_data_get_int(settings, "lookahead_threads");
 	enum rate_control rc;
 
 #ifdef ENABLE_VFR
@@ -479,6 +578,16 @@ static void update_params(struct obs_x264 *obsx264, obs_data_t *settings,
 	if (obs_data_has_user_value(settings, "bf"))
 		obsx264->params.i_bframe = bf;
 
+	/* the thread layout can only be chosen before the encoder is opened */
+	if (!obsx264->context) {
+		if (latency_mode)
+			apply_latency_params(obsx264, voi, target_latency_ms,
+					     threads);
+		else
+			apply_thread_params(obsx264, threads, sliced_threads,
+					    lookahead_threads);
+	}
+
 	static const char *const smpte170m = "smpte170m";
 	static const char *const bt709 = "bt709";
 	static const char *const iec61966_2_1 = "iec61966-2-1";
@@ -762,6 +871,21 @@ static inline void init_pic_data(struct obs_x264 *obsx264, x264_picture_t *pic,
 	}
 }
 
+static inline void signal_encode_stats(struct obs_x264 *obsx264,
+				       uint64_t encode_ns)
+{
+	signal_handler_t *sh = obs_encoder_get_signal_handler(obsx264->encoder);
+	uint8_t stack[128];
+	calldata_t params;
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
+	calldata_set_ptr(&params, "encoder", obsx264->encoder);
+	calldata_set_int(&params, "encode_ns", (long long)encode_ns);
+	calldata_set_int(&params, "queue_depth",
+			 x264_encoder_delayed_frames(obsx264->context));
+	signal_handler_signal(sh, "encode_stats", &params);
+}
+
 static bool obs_x264_encode(void *data, struct encoder_frame *frame,
 			    struct encoder_packet *packet,
 			    bool *received_packet)
@@ -771,6 +895,7 @@ static bool obs_x264_encode(void *data, struct encoder_frame *frame,
 	int nal_count;
 	int ret;
 	x264_picture_t pic, pic_out;
+	uint64_t start_ns;
 
 	if (!frame || !packet || !received_packet)
 		return false;
@@ -778,6 +903,7 @@ static bool obs_x264_encode(void *data, struct encoder_frame *frame,
 	if (frame)
 		init_pic_data(obsx264, &pic, frame);
 
+	start_ns = os_gettime_ns();
 	ret = x264_encoder_encode(obsx264->context, &nals, &nal_count,
 				  (frame ? &pic : NULL), &pic_out);
 	if (ret < 0) {
@@ -785,6 +911,8 @@ static bool obs_x264_encode(void *data, struct encoder_frame *frame,
 		return false;
 	}
 
+	signal_encode_stats(obsx264, os_gettime_ns() - start_ns);
+
 	*received_packet = (nal_count != 0);
 	parse_packet(obsx264, packet, nals, nal_count, &pic_out);
 
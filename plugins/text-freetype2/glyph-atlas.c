@@ -0,0 +1,305 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <obs-module.h>
+#include <util/threading.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include "text-freetype2.h"
+
+/*
+ * Glyph atlases are shared by every text source using the same font file,
+ * face, size and antialiasing, so each glyph is rasterized and uploaded once
+ * no matter how many sources draw it.  Glyphs are never removed from an
+ * atlas, so glyph pointers stay valid for as long as the atlas is held.
+ *
+ * Sources update on the graphics thread but are created from the UI thread,
+ * and FreeType faces aren't thread safe, so everything that touches a face
+ * or the atlas list happens under atlas_mutex.
+ */
+
+extern uint32_t texbuf_w, texbuf_h;
+
+static pthread_mutex_t atlas_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct glyph_atlas *first_atlas = NULL;
+
+static const wchar_t *standard_glyphs =
+	L"abcdefghijklmnopqrstuvwxyz"
+	L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
+	L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"";
+
+static inline FT_Render_Mode get_render_mode(struct glyph_atlas *atlas)
+{
+	return atlas->antialiasing ? FT_RENDER_MODE_NORMAL
+				   : FT_RENDER_MODE_MONO;
+}
+
+static void load_glyph(struct glyph_atlas *atlas, const FT_UInt glyph_index,
+		       const FT_Render_Mode render_mode)
+{
+	const FT_Int32 load_mode = render_mode == FT_RENDER_MODE_MONO
+					   ? FT_LOAD_TARGET_MONO
+					   : FT_LOAD_DEFAULT;
+	FT_Load_Glyph(atlas->face, glyph_index, load_mode);
+}
+
+static struct glyph_info *init_glyph(FT_GlyphSlot slot, const uint32_t dx,
+				     const uint32_t dy, const uint32_t g_w,
+				     const uint32_t g_h)
+{
+	struct glyph_info *glyph = bzalloc(sizeof(struct glyph_info));
+	glyph->u = (float)dx / (float)texbuf_w;
+	glyph->u2 = (float)(dx + g_w) / (float)texbuf_w;
+	glyph->v = (float)dy / (float)texbuf_h;
+	glyph->v2 = (float)(dy + g_h) / (float)texbuf_h;
+	glyph->w = g_w;
+	glyph->h = g_h;
+	glyph->yoff = slot->bitmap_top;
+	glyph->xoff = slot->bitmap_left;
+	glyph->xadv = slot->advance.x >> 6;
+
+	return glyph;
+}
+
+static uint8_t get_pixel_value(const unsigned char *buf_row,
+			       FT_Render_Mode render_mode, const uint32_t x)
+{
+	if (render_mode == FT_RENDER_MODE_NORMAL) {
+		return buf_row[x];
+	}
+
+	const uint32_t byte_index = x / 8;
+	const uint8_t bit_index = x % 8;
+	const bool pixel_set = (buf_row[byte_index] >> (7 - bit_index)) & 1;
+	return pixel_set ? 255 : 0;
+}
+
+static void rasterize(struct glyph_atlas *atlas, FT_GlyphSlot slot,
+		      const FT_Render_Mode render_mode, const uint32_t dx,
+		      const uint32_t dy)
+{
+	/**
+	 * The pitch's absolute value is the number of bytes taken by one bitmap
+	 * row, including padding.
+	 *
+	 * Source: https://www.freetype.org/freetype2/docs/reference/ft2-basic_types.html
+	 */
+	const int pitch = abs(slot->bitmap.pitch);
+
+	for (uint32_t y = 0; y < slot->bitmap.rows; y++) {
+		const uint32_t row_start = y * pitch;
+		const uint32_t row = (dy + y) * texbuf_w;
+
+		for (uint32_t x = 0; x < slot->bitmap.width; x++) {
+			const uint32_t row_pixel_position = dx + x;
+			const uint8_t pixel_value =
+				get_pixel_value(&slot->bitmap.buffer[row_start],
+						render_mode, x);
+			atlas->texbuf[row_pixel_position + row] = pixel_value;
+		}
+	}
+}
+
+static struct glyph_info *cache_glyph(struct glyph_atlas *atlas,
+				      FT_UInt glyph_index)
+{
+	FT_GlyphSlot slot = atlas->face->glyph;
+	const FT_Render_Mode render_mode = get_render_mode(atlas);
+	uint32_t dx = atlas->texbuf_x;
+	uint32_t dy = atlas->texbuf_y;
+	struct glyph_info *glyph;
+
+	if (atlas->full)
+		return NULL;
+
+	load_glyph(atlas, glyph_index, render_mode);
+	FT_Render_Glyph(slot, render_mode);
+
+	const uint32_t g_w = slot->bitmap.width;
+	const uint32_t g_h = slot->bitmap.rows;
+
+	if (atlas->max_h < g_h) {
+		atlas->max_h = g_h;
+	}
+
+	if (dx + g_w >= texbuf_w) {
+		dx = 0;
+		dy += atlas->max_h + 1;
+	}
+
+	if (dy + g_h >= texbuf_h) {
+		blog(LOG_WARNING, "Out of space trying to render glyphs");
+		atlas->full = true;
+		return NULL;
+	}
+
+	glyph = init_glyph(slot, dx, dy, g_w, g_h);
+	rasterize(atlas, slot, render_mode, dx, dy);
+
+	dx += (g_w + 1);
+	if (dx >= texbuf_w) {
+		dx = 0;
+		dy += atlas->max_h;
+	}
+
+	atlas->texbuf_x = dx;
+	atlas->texbuf_y = dy;
+	atlas->glyphs[glyph_index] = glyph;
+	atlas->dirty = true;
+	return glyph;
+}
+
+static inline const struct glyph_info *get_glyph(struct glyph_atlas *atlas,
+						 wchar_t ch)
+{
+	const FT_UInt glyph_index = FT_Get_Char_Index(atlas->face, ch);
+
+	if (glyph_index >= num_cache_slots)
+		return NULL;
+	if (atlas->glyphs[glyph_index])
+		return atlas->glyphs[glyph_index];
+
+	return cache_glyph(atlas, glyph_index);
+}
+
+static void upload_atlas(struct glyph_atlas *atlas)
+{
+	if (!atlas->dirty)
+		return;
+
+	obs_enter_graphics();
+
+	if (!atlas->tex)
+		atlas->tex = gs_texture_create(
+			texbuf_w, texbuf_h, GS_A8, 1,
+			(const uint8_t **)&atlas->texbuf, GS_DYNAMIC);
+	else
+		gs_texture_set_image(atlas->tex, atlas->texbuf, texbuf_w,
+				     false);
+
+	obs_leave_graphics();
+
+	atlas->dirty = false;
+}
+
+static struct glyph_atlas *create_atlas(const char *path, FT_Long index,
+					uint16_t size, bool antialiasing)
+{
+	struct glyph_atlas *atlas = bzalloc(sizeof(*atlas));
+
+	if (FT_New_Face(ft2_lib, path, index, &atlas->face) != 0) {
+		bfree(atlas);
+		return NULL;
+	}
+
+	FT_Set_Pixel_Sizes(atlas->face, 0, size);
+	FT_Select_Charmap(atlas->face, FT_ENCODING_UNICODE);
+
+	atlas->refs = 1;
+	atlas->font_path = bstrdup(path);
+	atlas->face_index = index;
+	atlas->size = size;
+	atlas->antialiasing = antialiasing;
+	atlas->texbuf = bzalloc((size_t)texbuf_w * (size_t)texbuf_h);
+
+	for (const wchar_t *ch = standard_glyphs; *ch; ch++)
+		get_glyph(atlas, *ch);
+	upload_atlas(atlas);
+
+	return atlas;
+}
+
+struct glyph_atlas *glyph_atlas_get(const char *path, FT_Long index,
+				    uint16_t size, bool antialiasing)
+{
+	struct glyph_atlas *atlas;
+
+	pthread_mutex_lock(&atlas_mutex);
+
+	for (atlas = first_atlas; atlas; atlas = atlas->next) {
+		if (atlas->face_index == index && atlas->size == size &&
+		    atlas->antialiasing == antialiasing &&
+		    strcmp(atlas->font_path, path) == 0) {
+			atlas->refs++;
+			break;
+		}
+	}
+
+	if (!atlas) {
+		atlas = create_atlas(path, index, size, antialiasing);
+		if (atlas) {
+			atlas->next = first_atlas;
+			first_atlas = atlas;
+		}
+	}
+
+	pthread_mutex_unlock(&atlas_mutex);
+	return atlas;
+}
+
+void glyph_atlas_release(struct glyph_atlas *atlas)
+{
+	struct glyph_atlas **prev;
+
+	if (!atlas)
+		return;
+
+	pthread_mutex_lock(&atlas_mutex);
+
+	if (--atlas->refs > 0) {
+		pthread_mutex_unlock(&atlas_mutex);
+		return;
+	}
+
+	for (prev = &first_atlas; *prev; prev = &(*prev)->next) {
+		if (*prev == atlas) {
+			*prev = atlas->next;
+			break;
+		}
+	}
+
+	FT_Done_Face(atlas->face);
+	pthread_mutex_unlock(&atlas_mutex);
+
+	for (uint32_t i = 0; i < num_cache_slots; i++)
+		bfree(atlas->glyphs[i]);
+
+	obs_enter_graphics();
+	gs_texture_destroy(atlas->tex);
+	obs_leave_graphics();
+
+	bfree(atlas->texbuf);
+	bfree(atlas->font_path);
+	bfree(atlas);
+}
+
+/* looks up (caching if needed) the glyph of each character, and returns the
+ * atlas line height, which can grow as glyphs are added */
+uint32_t glyph_atlas_map(struct glyph_atlas *atlas, const wchar_t *text,
+			 size_t len, const struct glyph_info **glyphs)
+{
+	uint32_t max_h;
+
+	pthread_mutex_lock(&atlas_mutex);
+
+	for (size_t i = 0; i < len; i++)
+		glyphs[i] = get_glyph(atlas, text[i]);
+
+	upload_atlas(atlas);
+	max_h = atlas->max_h;
+
+	pthread_mutex_unlock(&atlas_mutex);
+	return max_h;
+}
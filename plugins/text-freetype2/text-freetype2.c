@@ -19,7 +19,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <util/platform.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include <sys/stat.h>
 #include "text-freetype2.h"
 #include "obs-convenience.h"
 #include "find-font.h"
@@ -194,17 +193,9 @@ static void ft2_source_destroy(void *data)
 {
 	struct ft2_source *srcdata = data;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
-
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
+	obs_file_watch_remove(srcdata->watch);
+	text_tail_destroy(srcdata->tail);
+	glyph_atlas_release(srcdata->atlas);
 
 	if (srcdata->font_name != NULL)
 		bfree(srcdata->font_name);
@@ -212,19 +203,18 @@ static void ft2_source_destroy(void *data)
 		bfree(srcdata->font_style);
 	if (srcdata->text != NULL)
 		bfree(srcdata->text);
-	if (srcdata->texbuf != NULL)
-		bfree(srcdata->texbuf);
 	if (srcdata->colorbuf != NULL)
 		bfree(srcdata->colorbuf);
+	bfree(srcdata->glyphs);
+	bfree(srcdata->layout_text);
+	bfree(srcdata->layout_pos);
 	if (srcdata->text_file != NULL)
 		bfree(srcdata->text_file);
+	bfree(srcdata->pending_text);
+	pthread_mutex_destroy(&srcdata->pending_mutex);
 
 	obs_enter_graphics();
 
-	if (srcdata->tex != NULL) {
-		gs_texture_destroy(srcdata->tex);
-		srcdata->tex = NULL;
-	}
 	if (srcdata->vbuf != NULL) {
 		gs_vertexbuffer_destroy(srcdata->vbuf);
 		srcdata->vbuf = NULL;
@@ -245,9 +235,9 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata == NULL)
 		return;
 
-	if (srcdata->tex == NULL || srcdata->vbuf == NULL)
+	if (srcdata->atlas == NULL || srcdata->vbuf == NULL)
 		return;
-	if (srcdata->text == NULL || *srcdata->text == 0)
+	if (srcdata->text == NULL || srcdata->num_glyphs == 0)
 		return;
 
 	gs_reset_blend_state();
@@ -256,39 +246,57 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata->drop_shadow)
 		draw_drop_shadow(srcdata);
 
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6);
+	draw_uv_vbuffer(srcdata->vbuf, srcdata->atlas->tex, srcdata->draw_effect,
+			srcdata->num_glyphs * 6);
 
 	UNUSED_PARAMETER(effect);
 }
 
+static wchar_t *read_text_file(struct ft2_source *srcdata, const char *path)
+{
+	if (!srcdata->log_mode)
+		return load_text_from_file(srcdata, path);
+
+	if (!srcdata->tail)
+		srcdata->tail = text_tail_create(path, srcdata->log_lines);
+	return text_tail_read(srcdata, srcdata->tail);
+}
+
+/* called from the file watch thread, so the file is read there and only the
+ * glyph/vertex update is left for video_tick */
+static void ft2_file_changed(void *data, const char *path)
+{
+	struct ft2_source *srcdata = data;
+	wchar_t *text = read_text_file(srcdata, path);
+
+	if (!text)
+		return;
+
+	pthread_mutex_lock(&srcdata->pending_mutex);
+	bfree(srcdata->pending_text);
+	srcdata->pending_text = text;
+	pthread_mutex_unlock(&srcdata->pending_mutex);
+}
+
 static void ft2_video_tick(void *data, float seconds)
 {
 	struct ft2_source *srcdata = data;
+	wchar_t *text;
+
 	if (srcdata == NULL)
 		return;
-	if (!srcdata->from_file || !srcdata->text_file)
-		return;
 
-	if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
-		time_t t = get_modified_timestamp(srcdata->text_file);
-		srcdata->last_checked = os_gettime_ns();
-
-		if (srcdata->update_file) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata,
-						    srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
-			set_up_vertex_buffer(srcdata);
-			srcdata->update_file = false;
-		}
+	pthread_mutex_lock(&srcdata->pending_mutex);
+	text = srcdata->pending_text;
+	srcdata->pending_text = NULL;
+	pthread_mutex_unlock(&srcdata->pending_mutex);
 
-		if (srcdata->m_timestamp != t) {
-			srcdata->m_timestamp = t;
-			srcdata->update_file = true;
-		}
+	if (text) {
+		bfree(srcdata->text);
+		srcdata->text = text;
+
+		if (srcdata->atlas)
+			set_up_vertex_buffer(srcdata);
 	}
 
 	UNUSED_PARAMETER(seconds);
@@ -300,15 +308,17 @@ static bool init_font(struct ft2_source *srcdata)
 	const char *path = get_font_path(srcdata->font_name, srcdata->font_size,
 					 srcdata->font_style,
 					 srcdata->font_flags, &index);
+	struct glyph_atlas *atlas;
+
 	if (!path)
 		return false;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
+	atlas = glyph_atlas_get(path, index, srcdata->font_size,
+				srcdata->antialiasing);
+	glyph_atlas_release(srcdata->atlas);
+	srcdata->atlas = atlas;
 
-	return FT_New_Face(ft2_lib, path, index, &srcdata->font_face) == 0;
+	return atlas != NULL;
 }
 
 static void ft2_source_update(void *data, obs_data_t *settings)
@@ -328,6 +338,18 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	if (!font_obj)
 		return;
 
+	obs_file_watch_remove(srcdata->watch);
+	srcdata->watch = NULL;
+
+	/* the file, line count or mode may change, the end is read again */
+	text_tail_destroy(srcdata->tail);
+	srcdata->tail = NULL;
+
+	pthread_mutex_lock(&srcdata->pending_mutex);
+	bfree(srcdata->pending_text);
+	srcdata->pending_text = NULL;
+	pthread_mutex_unlock(&srcdata->pending_mutex);
+
 	srcdata->outline_width = 0;
 
 	srcdata->drop_shadow = obs_data_get_bool(settings, "drop_shadow");
@@ -379,8 +401,6 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	if (ft2_lib == NULL)
 		goto error;
 
-	const size_t texbuf_size = (size_t)texbuf_w * (size_t)texbuf_h;
-
 	if (srcdata->draw_effect == NULL) {
 		char *effect_file = NULL;
 		char *error_string = NULL;
@@ -402,15 +422,10 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	if (srcdata->font_size != font_size || srcdata->from_file != from_file)
 		vbuf_needs_update = true;
 
+	/* antialiased and aliased glyphs live in different atlases */
 	const bool new_aa_setting = obs_data_get_bool(settings, "antialiasing");
 	const bool aa_changed = srcdata->antialiasing != new_aa_setting;
-	if (aa_changed) {
-		srcdata->antialiasing = new_aa_setting;
-		if (srcdata->texbuf != NULL) {
-			memset(srcdata->texbuf, 0, texbuf_size);
-		}
-		cache_standard_glyphs(srcdata);
-	}
+	srcdata->antialiasing = new_aa_setting;
 
 	srcdata->file_load_failed = false;
 	srcdata->from_file = from_file;
@@ -419,14 +434,13 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 		if (strcmp(font_name, srcdata->font_name) == 0 &&
 		    strcmp(font_style, srcdata->font_style) == 0 &&
 		    font_flags == srcdata->font_flags &&
-		    font_size == srcdata->font_size)
+		    font_size == srcdata->font_size && !aa_changed)
 			goto skip_font_load;
 
 		bfree(srcdata->font_name);
 		bfree(srcdata->font_style);
 		srcdata->font_name = NULL;
 		srcdata->font_style = NULL;
-		srcdata->max_h = 0;
 		vbuf_needs_update = true;
 	}
 
@@ -435,23 +449,11 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	srcdata->font_size = font_size;
 	srcdata->font_flags = font_flags;
 
-	if (!init_font(srcdata) || srcdata->font_face == NULL) {
+	if (!init_font(srcdata)) {
 		blog(LOG_WARNING, "FT2-text: Failed to load font %s",
 		     srcdata->font_name);
 		goto error;
-	} else {
-		FT_Set_Pixel_Sizes(srcdata->font_face, 0, srcdata->font_size);
-		FT_Select_Charmap(srcdata->font_face, FT_ENCODING_UNICODE);
-	}
-
-	if (srcdata->texbuf != NULL) {
-		bfree(srcdata->texbuf);
-		srcdata->texbuf = NULL;
 	}
-	srcdata->texbuf = bzalloc(texbuf_size);
-
-	if (srcdata->font_face)
-		cache_standard_glyphs(srcdata);
 
 skip_font_load:
 	if (from_file) {
@@ -478,11 +480,12 @@ skip_font_load:
 			bfree(srcdata->text_file);
 
 			srcdata->text_file = bstrdup(tmp);
-			if (chat_log_mode)
-				read_from_end(srcdata, tmp);
-			else
-				load_text_from_file(srcdata, tmp);
-			srcdata->last_checked = os_gettime_ns();
+
+			wchar_t *text = read_text_file(srcdata, tmp);
+			if (text) {
+				bfree(srcdata->text);
+				srcdata->text = text;
+			}
 		}
 	} else {
 		const char *tmp = obs_data_get_string(settings, "text");
@@ -497,12 +500,17 @@ skip_font_load:
 		os_utf8_to_wcs_ptr(tmp, strlen(tmp), &srcdata->text);
 	}
 
-	if (srcdata->font_face) {
-		cache_glyphs(srcdata, srcdata->text);
+	if (srcdata->atlas)
 		set_up_vertex_buffer(srcdata);
-	}
 
 error:
+	if (from_file) {
+		const char *path = obs_data_get_string(settings, "text_file");
+		if (path && *path)
+			srcdata->watch = obs_file_watch_add(
+				path, ft2_file_changed, srcdata);
+	}
+
 	obs_data_release(font_obj);
 }
 
@@ -521,6 +529,9 @@ static void *ft2_source_create(obs_data_t *settings, obs_source_t *source,
 	obs_data_t *font_obj = obs_data_create();
 	srcdata->src = source;
 
+	pthread_mutex_init_value(&srcdata->pending_mutex);
+	pthread_mutex_init(&srcdata->pending_mutex, NULL);
+
 	init_plugin();
 
 	const uint16_t font_size = ver == 1 ? 32 : 256;
@@ -18,10 +18,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <obs-module.h>
+#include <util/threading.h>
 #include <ft2build.h>
 
 #define num_cache_slots 65535
-#define src_glyph srcdata->cacheglyphs[glyph_index]
 
 struct glyph_info {
 	float u, v, u2, v2;
@@ -29,6 +29,36 @@ struct glyph_info {
 	int32_t xadv;
 };
 
+/* shared by all sources using the same font file, size and antialiasing */
+struct glyph_atlas {
+	struct glyph_atlas *next;
+	long refs;
+
+	char *font_path;
+	FT_Long face_index;
+	uint16_t size;
+	bool antialiasing;
+
+	FT_Face face;
+	struct glyph_info *glyphs[num_cache_slots];
+
+	uint8_t *texbuf;
+	uint32_t texbuf_x, texbuf_y;
+	uint32_t max_h;
+	bool dirty;
+	bool full;
+
+	gs_texture_t *tex;
+};
+
+/* layout state before each character, so layout can resume mid-text */
+struct layout_state {
+	uint32_t dx, dy;
+	uint32_t max_y;
+	uint32_t line_w, max_w;
+	uint32_t glyph;
+};
+
 struct ft2_source {
 	char *font_name;
 	char *font_style;
@@ -40,26 +70,39 @@ struct ft2_source {
 	bool antialiasing;
 	char *text_file;
 	wchar_t *text;
-	time_t m_timestamp;
-	bool update_file;
-	uint64_t last_checked;
+	struct text_tail *tail;
+
+	/* text read by the file watch callback, swapped in on tick */
+	obs_file_watch_t *watch;
+	pthread_mutex_t pending_mutex;
+	wchar_t *pending_text;
 
 	uint32_t cx, cy, max_h, custom_width;
 	uint32_t outline_width;
-	uint32_t texbuf_x, texbuf_y;
 	uint32_t color[2];
 	uint32_t *colorbuf;
 
 	int32_t cur_scroll, scroll_speed;
 
-	gs_texture_t *tex;
-
-	struct glyph_info *cacheglyphs[num_cache_slots];
+	struct glyph_atlas *atlas;
 
-	FT_Face font_face;
+	/* atlas glyph of each character in text */
+	const struct glyph_info **glyphs;
+	size_t glyphs_size;
 
-	uint8_t *texbuf;
 	gs_vertbuffer_t *vbuf;
+	uint32_t vbuf_glyphs;
+	uint32_t num_glyphs;
+
+	/* what the vertex buffer currently holds */
+	wchar_t *layout_text;
+	size_t layout_len;
+	struct layout_state *layout_pos;
+	struct glyph_atlas *layout_atlas;
+	uint32_t layout_max_h;
+	uint32_t layout_custom_width;
+	uint32_t layout_color[2];
+	bool layout_outline;
 
 	gs_effect_t *draw_effect;
 	bool outline_text, drop_shadow;
@@ -90,14 +133,18 @@ static const char *ft2_source_get_name(void *unused);
 
 static obs_missing_files_t *ft2_missing_files(void *data);
 
-uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata);
+wchar_t *load_text_from_file(struct ft2_source *srcdata, const char *filename);
+wchar_t *read_from_end(struct ft2_source *srcdata, const char *filename);
 
-time_t get_modified_timestamp(char *filename);
-void load_text_from_file(struct ft2_source *srcdata, const char *filename);
-void read_from_end(struct ft2_source *srcdata, const char *filename);
+struct text_tail *text_tail_create(const char *path, uint32_t lines);
+void text_tail_destroy(struct text_tail *tail);
+wchar_t *text_tail_read(struct ft2_source *srcdata, struct text_tail *tail);
 
-void cache_standard_glyphs(struct ft2_source *srcdata);
-void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs);
+struct glyph_atlas *glyph_atlas_get(const char *path, FT_Long index,
+				    uint16_t size, bool antialiasing);
+void glyph_atlas_release(struct glyph_atlas *atlas);
+uint32_t glyph_atlas_map(struct glyph_atlas *atlas, const wchar_t *text,
+			 size_t len, const struct glyph_info **glyphs);
 
 void set_up_vertex_buffer(struct ft2_source *srcdata);
-void fill_vertex_buffer(struct ft2_source *srcdata);
+void fill_vertex_buffer(struct ft2_source *srcdata, size_t start, size_t len);
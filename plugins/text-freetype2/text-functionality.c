@@ -17,17 +17,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/platform.h>
+#include <util/dstr.h>
+#include <sys/stat.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include <sys/stat.h>
 #include "text-freetype2.h"
 #include "obs-convenience.h"
 
 float offsets[16] = {-2.0f, 0.0f, 0.0f, -2.0f, 2.0f,  0.0f, 2.0f,  0.0f,
 		     0.0f,  2.0f, 0.0f, 2.0f,  -2.0f, 0.0f, -2.0f, 0.0f};
 
-extern uint32_t texbuf_w, texbuf_h;
-
 void draw_outlines(struct ft2_source *srcdata)
 {
 	// Horrible (hopefully temporary) solution for outlines.
@@ -45,9 +44,8 @@ void draw_outlines(struct ft2_source *srcdata)
 	for (int32_t i = 0; i < 8; i++) {
 		gs_matrix_translate3f(offsets[i * 2], offsets[(i * 2) + 1],
 				      0.0f);
-		draw_uv_vbuffer(srcdata->vbuf, srcdata->tex,
-				srcdata->draw_effect,
-				(uint32_t)wcslen(srcdata->text) * 6);
+		draw_uv_vbuffer(srcdata->vbuf, srcdata->atlas->tex,
+				srcdata->draw_effect, srcdata->num_glyphs * 6);
 	}
 	gs_matrix_identity();
 	gs_matrix_pop();
@@ -70,53 +68,56 @@ void draw_drop_shadow(struct ft2_source *srcdata)
 
 	gs_matrix_push();
 	gs_matrix_translate3f(4.0f, 4.0f, 0.0f);
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6);
+	draw_uv_vbuffer(srcdata->vbuf, srcdata->atlas->tex,
+			srcdata->draw_effect, srcdata->num_glyphs * 6);
 	gs_matrix_identity();
 	gs_matrix_pop();
 
 	vdata->colors = tmp;
 }
 
-void set_up_vertex_buffer(struct ft2_source *srcdata)
+static size_t common_prefix(const wchar_t *a, size_t a_len, const wchar_t *b,
+			    size_t b_len)
 {
-	FT_UInt glyph_index = 0;
-	uint32_t x = 0, space_pos = 0, word_width = 0;
-	size_t len;
-
-	if (!srcdata->text)
-		return;
-
-	if (srcdata->custom_width >= 100)
-		srcdata->cx = srcdata->custom_width;
-	else
-		srcdata->cx = get_ft2_text_width(srcdata->text, srcdata);
-	srcdata->cy = srcdata->max_h;
-
-	obs_enter_graphics();
-	if (srcdata->vbuf != NULL) {
-		gs_vertbuffer_t *tmpvbuf = srcdata->vbuf;
-		srcdata->vbuf = NULL;
-		gs_vertexbuffer_destroy(tmpvbuf);
-	}
+	size_t len = a_len < b_len ? a_len : b_len;
+	size_t i = 0;
 
-	if (*srcdata->text == 0) {
-		obs_leave_graphics();
-		return;
-	}
+	while (i < len && a[i] == b[i])
+		i++;
+	return i;
+}
 
-	srcdata->vbuf =
-		create_uv_vbuffer((uint32_t)wcslen(srcdata->text) * 6, true);
+static bool layout_matches(struct ft2_source *srcdata)
+{
+	return srcdata->layout_text && srcdata->layout_atlas == srcdata->atlas &&
+	       srcdata->layout_max_h == srcdata->max_h &&
+	       srcdata->layout_custom_width == srcdata->custom_width &&
+	       srcdata->layout_color[0] == srcdata->color[0] &&
+	       srcdata->layout_color[1] == srcdata->color[1] &&
+	       srcdata->layout_outline == srcdata->outline_text;
+}
 
-	if (srcdata->custom_width <= 100)
-		goto skip_word_wrap;
-	if (!srcdata->word_wrap)
-		goto skip_word_wrap;
+static void save_layout(struct ft2_source *srcdata, size_t len)
+{
+	srcdata->layout_text = brealloc(srcdata->layout_text,
+					(len + 1) * sizeof(wchar_t));
+	memcpy(srcdata->layout_text, srcdata->text,
+	       (len + 1) * sizeof(wchar_t));
+	srcdata->layout_len = len;
+	srcdata->layout_atlas = srcdata->atlas;
+	srcdata->layout_max_h = srcdata->max_h;
+	srcdata->layout_custom_width = srcdata->custom_width;
+	srcdata->layout_color[0] = srcdata->color[0];
+	srcdata->layout_color[1] = srcdata->color[1];
+	srcdata->layout_outline = srcdata->outline_text;
+}
 
-	len = wcslen(srcdata->text);
+static void word_wrap(struct ft2_source *srcdata, size_t len)
+{
+	uint32_t x = 0, space_pos = 0, word_width = 0;
 
 	for (uint32_t i = 0; i <= len; i++) {
-		if (i == wcslen(srcdata->text))
+		if (i == len)
 			goto eos_check;
 
 		if (srcdata->text[i] != L' ' && srcdata->text[i] != L'\n')
@@ -128,7 +129,7 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 				srcdata->text[space_pos] = L'\n';
 			x = 0;
 		}
-		if (i == wcslen(srcdata->text))
+		if (i == len)
 			goto eos_skip;
 
 		x += word_width;
@@ -138,273 +139,164 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 		if (srcdata->text[i] == L' ')
 			space_pos = i;
 	next_char:;
-		glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
-		word_width += src_glyph->xadv;
+		if (srcdata->glyphs[i])
+			word_width += srcdata->glyphs[i]->xadv;
 	eos_skip:;
 	}
-
-skip_word_wrap:;
-	fill_vertex_buffer(srcdata);
-	obs_leave_graphics();
 }
 
-void fill_vertex_buffer(struct ft2_source *srcdata)
+/* makes sure the vertex buffer can hold len glyphs, returns false if it had
+ * to be recreated */
+static bool reserve_vertex_buffer(struct ft2_source *srcdata, size_t len)
 {
-	struct gs_vb_data *vdata = gs_vertexbuffer_get_data(srcdata->vbuf);
-	if (vdata == NULL || !srcdata->text)
-		return;
-
-	struct vec2 *tvarray = (struct vec2 *)vdata->tvarray[0].array;
-	uint32_t *col = (uint32_t *)vdata->colors;
-
-	FT_UInt glyph_index = 0;
-
-	uint32_t dx = 0, dy = srcdata->max_h, max_y = dy;
-	uint32_t cur_glyph = 0;
-	uint32_t offset = 0;
-	size_t len = wcslen(srcdata->text);
-
-	if (srcdata->outline_text) {
-		offset = 2;
-		dx = offset;
-	}
-
-	if (srcdata->colorbuf != NULL) {
-		bfree(srcdata->colorbuf);
-		srcdata->colorbuf = NULL;
-	}
-	srcdata->colorbuf =
-		bzalloc(sizeof(uint32_t) * wcslen(srcdata->text) * 6);
-	for (size_t i = 0; i < len * 6; i++) {
-		srcdata->colorbuf[i] = 0xFF000000;
-	}
-
-	for (size_t i = 0; i < len; i++) {
-	add_linebreak:;
-		if (srcdata->text[i] != L'\n')
-			goto draw_glyph;
-		dx = offset;
-		i++;
-		dy += srcdata->max_h + 4;
-		if (i == wcslen(srcdata->text))
-			goto skip_glyph;
-		if (srcdata->text[i] == L'\n')
-			goto add_linebreak;
-	draw_glyph:;
-		// Skip filthy dual byte Windows line breaks
-		if (srcdata->text[i] == L'\r')
-			goto skip_glyph;
-
-		glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
-		if (src_glyph == NULL)
-			goto skip_glyph;
-
-		if (srcdata->custom_width < 100)
-			goto skip_custom_width;
-
-		if (dx + src_glyph->xadv > srcdata->custom_width) {
-			dx = offset;
-			dy += srcdata->max_h + 4;
-		}
+	uint32_t size = srcdata->vbuf_glyphs ? srcdata->vbuf_glyphs : 16;
 
-	skip_custom_width:;
-
-		set_v3_rect(vdata->points + (cur_glyph * 6),
-			    (float)dx + (float)src_glyph->xoff,
-			    (float)dy - (float)src_glyph->yoff,
-			    (float)src_glyph->w, (float)src_glyph->h);
-		set_v2_uv(tvarray + (cur_glyph * 6), src_glyph->u, src_glyph->v,
-			  src_glyph->u2, src_glyph->v2);
-		set_rect_colors2(col + (cur_glyph * 6), srcdata->color[0],
-				 srcdata->color[1]);
-		dx += src_glyph->xadv;
-		if (dy - (float)src_glyph->yoff + src_glyph->h > max_y)
-			max_y = dy - src_glyph->yoff + src_glyph->h;
-		cur_glyph++;
-	skip_glyph:;
-	}
+	if (srcdata->vbuf && len <= srcdata->vbuf_glyphs)
+		return true;
 
-	srcdata->cy = max_y;
-}
+	while (size < len)
+		size *= 2;
 
-void cache_standard_glyphs(struct ft2_source *srcdata)
-{
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
+	if (srcdata->vbuf != NULL) {
+		gs_vertbuffer_t *tmpvbuf = srcdata->vbuf;
+		srcdata->vbuf = NULL;
+		gs_vertexbuffer_destroy(tmpvbuf);
 	}
 
-	srcdata->texbuf_x = 0;
-	srcdata->texbuf_y = 0;
+	srcdata->vbuf = create_uv_vbuffer(size * 6, true);
+	srcdata->vbuf_glyphs = srcdata->vbuf ? size : 0;
 
-	cache_glyphs(srcdata, L"abcdefghijklmnopqrstuvwxyz"
-			      L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
-			      L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"\0");
-}
-
-FT_Render_Mode get_render_mode(struct ft2_source *srcdata)
-{
-	return srcdata->antialiasing ? FT_RENDER_MODE_NORMAL
-				     : FT_RENDER_MODE_MONO;
-}
+	srcdata->colorbuf = brealloc(srcdata->colorbuf,
+				     sizeof(uint32_t) * size * 6);
+	for (size_t i = 0; i < (size_t)size * 6; i++)
+		srcdata->colorbuf[i] = 0xFF000000;
 
-void load_glyph(struct ft2_source *srcdata, const FT_UInt glyph_index,
-		const FT_Render_Mode render_mode)
-{
-	const FT_Int32 load_mode = render_mode == FT_RENDER_MODE_MONO
-					   ? FT_LOAD_TARGET_MONO
-					   : FT_LOAD_DEFAULT;
-	FT_Load_Glyph(srcdata->font_face, glyph_index, load_mode);
+	return false;
 }
 
-struct glyph_info *init_glyph(FT_GlyphSlot slot, const uint32_t dx,
-			      const uint32_t dy, const uint32_t g_w,
-			      const uint32_t g_h)
+/*
+ * Counters and chat logs mostly change at the end of the text, so layout
+ * starts from the first character that differs from what the vertex buffer
+ * already holds, using the state saved before that character last time.
+ * Word wrap can move earlier line breaks, so it always lays out everything.
+ */
+void set_up_vertex_buffer(struct ft2_source *srcdata)
 {
-	struct glyph_info *glyph = bzalloc(sizeof(struct glyph_info));
-	glyph->u = (float)dx / (float)texbuf_w;
-	glyph->u2 = (float)(dx + g_w) / (float)texbuf_w;
-	glyph->v = (float)dy / (float)texbuf_h;
-	glyph->v2 = (float)(dy + g_h) / (float)texbuf_h;
-	glyph->w = g_w;
-	glyph->h = g_h;
-	glyph->yoff = slot->bitmap_top;
-	glyph->xoff = slot->bitmap_left;
-	glyph->xadv = slot->advance.x >> 6;
-
-	return glyph;
-}
+	size_t len, start = 0;
 
-uint8_t get_pixel_value(const unsigned char *buf_row,
-			FT_Render_Mode render_mode, const uint32_t x)
-{
-	if (render_mode == FT_RENDER_MODE_NORMAL) {
-		return buf_row[x];
-	}
+	if (!srcdata->text || !srcdata->atlas)
+		return;
 
-	const uint32_t byte_index = x / 8;
-	const uint8_t bit_index = x % 8;
-	const bool pixel_set = (buf_row[byte_index] >> (7 - bit_index)) & 1;
-	return pixel_set ? 255 : 0;
-}
+	len = wcslen(srcdata->text);
 
-void rasterize(struct ft2_source *srcdata, FT_GlyphSlot slot,
-	       const FT_Render_Mode render_mode, const uint32_t dx,
-	       const uint32_t dy)
-{
-	/**
-	 * The pitch's absolute value is the number of bytes taken by one bitmap
-	 * row, including padding.
-	 *
-	 * Source: https://www.freetype.org/freetype2/docs/reference/ft2-basic_types.html
-	 */
-	const int pitch = abs(slot->bitmap.pitch);
-
-	for (uint32_t y = 0; y < slot->bitmap.rows; y++) {
-		const uint32_t row_start = y * pitch;
-		const uint32_t row = (dy + y) * texbuf_w;
-
-		for (uint32_t x = 0; x < slot->bitmap.width; x++) {
-			const uint32_t row_pixel_position = dx + x;
-			const uint8_t pixel_value =
-				get_pixel_value(&slot->bitmap.buffer[row_start],
-						render_mode, x);
-			srcdata->texbuf[row_pixel_position + row] = pixel_value;
-		}
+	/* glyphs before start are reused, so they must be from this atlas */
+	if (srcdata->layout_text && !srcdata->word_wrap &&
+	    srcdata->layout_atlas == srcdata->atlas)
+		start = common_prefix(srcdata->text, len, srcdata->layout_text,
+				      srcdata->layout_len);
+
+	if (srcdata->glyphs_size < len + 1) {
+		srcdata->glyphs_size = len + 1;
+		srcdata->glyphs = brealloc(
+			srcdata->glyphs,
+			srcdata->glyphs_size * sizeof(*srcdata->glyphs));
+		srcdata->layout_pos = brealloc(
+			srcdata->layout_pos,
+			srcdata->glyphs_size * sizeof(*srcdata->layout_pos));
 	}
-}
 
-void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs)
-{
-	if (!srcdata->font_face || !cache_glyphs)
-		return;
-
-	FT_GlyphSlot slot = srcdata->font_face->glyph;
-
-	uint32_t dx = srcdata->texbuf_x;
-	uint32_t dy = srcdata->texbuf_y;
+	/* done outside of the graphics context, the atlas enters it itself */
+	srcdata->max_h = glyph_atlas_map(srcdata->atlas, srcdata->text + start,
+					 len - start, srcdata->glyphs + start);
 
-	int32_t cached_glyphs = 0;
-	const size_t len = wcslen(cache_glyphs);
+	if (srcdata->custom_width > 100 && srcdata->word_wrap)
+		word_wrap(srcdata, len);
 
-	const FT_Render_Mode render_mode = get_render_mode(srcdata);
+	if (!layout_matches(srcdata))
+		start = 0;
 
-	for (size_t i = 0; i < len; i++) {
-		const FT_UInt glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, cache_glyphs[i]);
+	obs_enter_graphics();
 
-		if (src_glyph != NULL) {
-			continue;
-		}
+	if (!reserve_vertex_buffer(srcdata, len))
+		start = 0;
 
-		load_glyph(srcdata, glyph_index, render_mode);
-		FT_Render_Glyph(slot, render_mode);
+	fill_vertex_buffer(srcdata, start, len);
 
-		const uint32_t g_w = slot->bitmap.width;
-		const uint32_t g_h = slot->bitmap.rows;
+	obs_leave_graphics();
 
-		if (srcdata->max_h < g_h) {
-			srcdata->max_h = g_h;
-		}
+	save_layout(srcdata, len);
+}
 
-		if (dx + g_w >= texbuf_w) {
-			dx = 0;
-			dy += srcdata->max_h + 1;
-		}
+static inline void layout_char(struct ft2_source *srcdata,
+			       struct gs_vb_data *vdata, size_t i,
+			       struct layout_state *st, uint32_t offset)
+{
+	const struct glyph_info *glyph = srcdata->glyphs[i];
+	struct vec2 *tvarray = (struct vec2 *)vdata->tvarray[0].array;
+	uint32_t *col = (uint32_t *)vdata->colors;
+	const uint32_t idx = st->glyph * 6;
 
-		if (dy + g_h >= texbuf_h) {
-			blog(LOG_WARNING,
-			     "Out of space trying to render glyphs");
-			break;
-		}
+	if (srcdata->text[i] == L'\n') {
+		st->dx = offset;
+		st->dy += srcdata->max_h + 4;
+		st->line_w = 0;
+		return;
+	}
 
-		src_glyph = init_glyph(slot, dx, dy, g_w, g_h);
-		rasterize(srcdata, slot, render_mode, dx, dy);
+	// Skip filthy dual byte Windows line breaks
+	if (srcdata->text[i] == L'\r' || glyph == NULL)
+		return;
 
-		dx += (g_w + 1);
-		if (dx >= texbuf_w) {
-			dx = 0;
-			dy += srcdata->max_h;
-		}
+	st->line_w += glyph->xadv;
+	if (st->line_w > st->max_w)
+		st->max_w = st->line_w;
 
-		cached_glyphs++;
+	if (srcdata->custom_width >= 100 &&
+	    st->dx + glyph->xadv > srcdata->custom_width) {
+		st->dx = offset;
+		st->dy += srcdata->max_h + 4;
 	}
 
-	srcdata->texbuf_x = dx;
-	srcdata->texbuf_y = dy;
-
-	if (cached_glyphs > 0) {
+	set_v3_rect(vdata->points + idx, (float)st->dx + (float)glyph->xoff,
+		    (float)st->dy - (float)glyph->yoff, (float)glyph->w,
+		    (float)glyph->h);
+	set_v2_uv(tvarray + idx, glyph->u, glyph->v, glyph->u2, glyph->v2);
+	set_rect_colors2(col + idx, srcdata->color[0], srcdata->color[1]);
 
-		obs_enter_graphics();
+	st->dx += glyph->xadv;
+	if (st->dy - (float)glyph->yoff + glyph->h > st->max_y)
+		st->max_y = st->dy - glyph->yoff + glyph->h;
+	st->glyph++;
+}
 
-		if (srcdata->tex != NULL) {
-			gs_texture_t *tmp_texture = srcdata->tex;
-			srcdata->tex = NULL;
-			gs_texture_destroy(tmp_texture);
-		}
+void fill_vertex_buffer(struct ft2_source *srcdata, size_t start, size_t len)
+{
+	struct gs_vb_data *vdata = gs_vertexbuffer_get_data(srcdata->vbuf);
+	struct layout_state st;
+	uint32_t offset = srcdata->outline_text ? 2 : 0;
 
-		srcdata->tex = gs_texture_create(
-			texbuf_w, texbuf_h, GS_A8, 1,
-			(const uint8_t **)&srcdata->texbuf, 0);
+	if (vdata == NULL || !srcdata->text)
+		return;
 
-		obs_leave_graphics();
+	if (start) {
+		st = srcdata->layout_pos[start];
+	} else {
+		memset(&st, 0, sizeof(st));
+		st.dx = offset;
+		st.dy = srcdata->max_h;
+		st.max_y = st.dy;
 	}
-}
-
-time_t get_modified_timestamp(char *filename)
-{
-	struct stat stats;
 
-	// stat is apparently terrifying and horrible, but we only call it once
-	// every second at most.
-	if (os_stat(filename, &stats) != 0)
-		return -1;
+	for (size_t i = start; i < len; i++) {
+		srcdata->layout_pos[i] = st;
+		layout_char(srcdata, vdata, i, &st, offset);
+	}
+	srcdata->layout_pos[len] = st;
 
-	return stats.st_mtime;
+	srcdata->num_glyphs = st.glyph;
+	srcdata->cx = srcdata->custom_width >= 100 ? srcdata->custom_width
+						   : st.max_w;
+	srcdata->cy = st.max_y;
 }
 
 static void remove_cr(wchar_t *source)
@@ -418,11 +310,12 @@ static void remove_cr(wchar_t *source)
 	source[j] = '\0';
 }
 
-void load_text_from_file(struct ft2_source *srcdata, const char *filename)
+wchar_t *load_text_from_file(struct ft2_source *srcdata, const char *filename)
 {
 	FILE *tmp_file = NULL;
 	uint32_t filesize = 0;
 	char *tmp_read = NULL;
+	wchar_t *text;
 	uint16_t header = 0;
 	size_t bytes_read;
 
@@ -432,7 +325,7 @@ void load_text_from_file(struct ft2_source *srcdata, const char *filename)
 			blog(LOG_WARNING, "Failed to open file %s", filename);
 			srcdata->file_load_failed = true;
 		}
-		return;
+		return NULL;
 	}
 	fseek(tmp_file, 0, SEEK_END);
 	filesize = (uint32_t)ftell(tmp_file);
@@ -441,17 +334,13 @@ void load_text_from_file(struct ft2_source *srcdata, const char *filename)
 
 	if (bytes_read == 2 && header == 0xFEFF) {
 		// File is already in UTF-16 format
-		if (srcdata->text != NULL) {
-			bfree(srcdata->text);
-			srcdata->text = NULL;
-		}
-		srcdata->text = bzalloc(filesize);
-		bytes_read = fread(srcdata->text, filesize - 2, 1, tmp_file);
+		text = bzalloc(filesize);
+		bytes_read = fread(text, filesize - 2, 1, tmp_file);
 
 		bfree(tmp_read);
 		fclose(tmp_file);
 
-		return;
+		return text;
 	}
 
 	fseek(tmp_file, 0, SEEK_SET);
@@ -460,23 +349,21 @@ void load_text_from_file(struct ft2_source *srcdata, const char *filename)
 	bytes_read = fread(tmp_read, filesize, 1, tmp_file);
 	fclose(tmp_file);
 
-	if (srcdata->text != NULL) {
-		bfree(srcdata->text);
-		srcdata->text = NULL;
-	}
-	srcdata->text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
-	os_utf8_to_wcs(tmp_read, strlen(tmp_read), srcdata->text,
+	text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
+	os_utf8_to_wcs(tmp_read, strlen(tmp_read), text,
 		       (strlen(tmp_read) + 1));
 
-	remove_cr(srcdata->text);
+	remove_cr(text);
 	bfree(tmp_read);
+	return text;
 }
 
-void read_from_end(struct ft2_source *srcdata, const char *filename)
+wchar_t *read_from_end(struct ft2_source *srcdata, const char *filename)
 {
 	FILE *tmp_file = NULL;
 	uint32_t filesize = 0, cur_pos = 0, log_lines = 0;
 	char *tmp_read = NULL;
+	wchar_t *text;
 	uint16_t value = 0, line_breaks = 0;
 	size_t bytes_read;
 	char bvalue;
@@ -489,7 +376,7 @@ void read_from_end(struct ft2_source *srcdata, const char *filename)
 			blog(LOG_WARNING, "Failed to open file %s", filename);
 			srcdata->file_load_failed = true;
 		}
-		return;
+		return NULL;
 	}
 	bytes_read = fread(&value, 2, 1, tmp_file);
 
@@ -525,60 +412,278 @@ void read_from_end(struct ft2_source *srcdata, const char *filename)
 	fseek(tmp_file, cur_pos, SEEK_SET);
 
 	if (utf16) {
-		if (srcdata->text != NULL) {
-			bfree(srcdata->text);
-			srcdata->text = NULL;
-		}
-		srcdata->text = bzalloc(filesize - cur_pos);
-		bytes_read =
-			fread(srcdata->text, (filesize - cur_pos), 1, tmp_file);
+		text = bzalloc(filesize - cur_pos);
+		bytes_read = fread(text, (filesize - cur_pos), 1, tmp_file);
 
-		remove_cr(srcdata->text);
+		remove_cr(text);
 		bfree(tmp_read);
 		fclose(tmp_file);
 
-		return;
+		return text;
 	}
 
 	tmp_read = bzalloc((filesize - cur_pos) + 1);
 	bytes_read = fread(tmp_read, filesize - cur_pos, 1, tmp_file);
 	fclose(tmp_file);
 
-	if (srcdata->text != NULL) {
-		bfree(srcdata->text);
-		srcdata->text = NULL;
-	}
-	srcdata->text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
-	os_utf8_to_wcs(tmp_read, strlen(tmp_read), srcdata->text,
+	text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
+	os_utf8_to_wcs(tmp_read, strlen(tmp_read), text,
 		       (strlen(tmp_read) + 1));
 
-	remove_cr(srcdata->text);
+	remove_cr(text);
 	bfree(tmp_read);
+	return text;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Chat log mode: follows the end of the file */
+
+/*
+ * Only bytes appended since the last read are read, split into lines and
+ * pushed into a ring of the last log_lines lines.  The text is the same as
+ * read_from_end gives: the last log_lines complete lines followed by
+ * whatever comes after the last line break.  If the file shrinks or is
+ * replaced, its end is read again.
+ *
+ * The file is only open while it's being read, so it can still be rotated
+ * or deleted on Windows.  Where there are no inode numbers (Windows), a
+ * replaced file is noticed by its size or modification time going back, or
+ * by the last bytes read no longer being there.
+ */
+
+#define TAIL_CHUNK_SIZE 4096
+#define TAIL_CHECK_SIZE 64
+
+struct text_tail {
+	char *path;
+	bool started;
+	int64_t offset;
+	uint64_t ino;
+	time_t mtime;
+	bool utf16;
+
+	char check[TAIL_CHECK_SIZE];
+	size_t check_len;
+
+	char **lines;
+	uint32_t max_lines;
+	uint32_t first_line;
+	uint32_t num_lines;
+	struct dstr partial;
+};
+
+static void tail_clear_lines(struct text_tail *tail)
+{
+	for (uint32_t i = 0; i < tail->num_lines; i++)
+		bfree(tail->lines[(tail->first_line + i) % tail->max_lines]);
+
+	tail->first_line = 0;
+	tail->num_lines = 0;
+	dstr_free(&tail->partial);
+}
+
+static void tail_push_line(struct text_tail *tail)
+{
+	char *line = tail->partial.array ? tail->partial.array : bstrdup("");
+	uint32_t idx;
+
+	dstr_init(&tail->partial);
+
+	if (tail->num_lines == tail->max_lines) {
+		bfree(tail->lines[tail->first_line]);
+		tail->lines[tail->first_line] = line;
+		tail->first_line = (tail->first_line + 1) % tail->max_lines;
+		return;
+	}
+
+	idx = (tail->first_line + tail->num_lines++) % tail->max_lines;
+	tail->lines[idx] = line;
 }
 
-uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata)
+static void tail_add_data(struct text_tail *tail, const char *data, size_t size)
 {
-	if (!text) {
-		return 0;
+	while (size) {
+		const char *lf = memchr(data, '\n', size);
+		size_t len = lf ? (size_t)(lf - data) : size;
+
+		dstr_ncat(&tail->partial, data, len);
+		if (!lf)
+			break;
+
+		tail_push_line(tail);
+		data += len + 1;
+		size -= len + 1;
 	}
+}
 
-	FT_GlyphSlot slot = srcdata->font_face->glyph;
-	uint32_t w = 0, max_w = 0;
-	const size_t len = wcslen(text);
-	for (size_t i = 0; i < len; i++) {
-		const FT_UInt glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, text[i]);
-
-		load_glyph(srcdata, glyph_index, get_render_mode(srcdata));
-
-		if (text[i] == L'\n')
-			w = 0;
-		else {
-			w += slot->advance.x >> 6;
-			if (w > max_w)
-				max_w = w;
+/* finds where the last max_lines lines start, reading back a chunk at a time
+ * rather than a byte at a time */
+static int64_t tail_find_start(struct text_tail *tail, FILE *file,
+			       int64_t size)
+{
+	char buf[TAIL_CHUNK_SIZE];
+	uint32_t line_breaks = 0;
+	int64_t pos = size;
+
+	while (pos > 0) {
+		size_t chunk = pos < TAIL_CHUNK_SIZE ? (size_t)pos
+						     : TAIL_CHUNK_SIZE;
+		pos -= chunk;
+
+		if (os_fseeki64(file, pos, SEEK_SET) != 0 ||
+		    fread(buf, 1, chunk, file) != chunk)
+			return 0;
+
+		for (size_t i = chunk; i > 0; i--) {
+			if (buf[i - 1] == '\n' &&
+			    ++line_breaks > tail->max_lines)
+				return pos + (int64_t)i;
 		}
 	}
 
-	return max_w;
+	return 0;
+}
+
+static void tail_start(struct text_tail *tail, FILE *file)
+{
+	uint16_t header = 0;
+	int64_t size;
+
+	tail->utf16 = fread(&header, 2, 1, file) == 1 && header == 0xFEFF;
+
+	size = os_fgetsize(file);
+	tail->offset = tail->utf16 ? size : tail_find_start(tail, file, size);
+	tail->check_len = 0;
+	tail->started = true;
+
+	tail_clear_lines(tail);
+}
+
+/* the file was truncated or replaced (log rotation, rewritten from scratch) */
+static bool tail_replaced(struct text_tail *tail, FILE *file,
+			  const struct stat *st)
+{
+	char buf[TAIL_CHECK_SIZE];
+
+	if ((int64_t)st->st_size < tail->offset)
+		return true;
+	if (tail->ino || st->st_ino)
+		return (uint64_t)st->st_ino != tail->ino;
+	if (st->st_mtime < tail->mtime)
+		return true;
+
+	if (!tail->check_len)
+		return false;
+
+	return os_fseeki64(file, tail->offset - (int64_t)tail->check_len,
+			   SEEK_SET) != 0 ||
+	       fread(buf, 1, tail->check_len, file) != tail->check_len ||
+	       memcmp(buf, tail->check, tail->check_len) != 0;
+}
+
+/* keeps the last bytes read to compare against on the next read */
+static void tail_update_check(struct text_tail *tail, FILE *file)
+{
+	int64_t len = tail->offset < TAIL_CHECK_SIZE ? tail->offset
+						     : TAIL_CHECK_SIZE;
+
+	tail->check_len = 0;
+	if (len && os_fseeki64(file, tail->offset - len, SEEK_SET) == 0 &&
+	    fread(tail->check, 1, (size_t)len, file) == (size_t)len)
+		tail->check_len = (size_t)len;
+}
+
+static wchar_t *tail_get_text(struct text_tail *tail)
+{
+	struct dstr text = {0};
+	wchar_t *wtext = NULL;
+
+	for (uint32_t i = 0; i < tail->num_lines; i++) {
+		dstr_cat(&text,
+			 tail->lines[(tail->first_line + i) % tail->max_lines]);
+		dstr_cat_ch(&text, '\n');
+	}
+	dstr_cat_dstr(&text, &tail->partial);
+
+	if (text.len)
+		os_utf8_to_wcs_ptr(text.array, text.len, &wtext);
+	if (!wtext)
+		wtext = bzalloc(sizeof(wchar_t));
+
+	remove_cr(wtext);
+	dstr_free(&text);
+	return wtext;
+}
+
+struct text_tail *text_tail_create(const char *path, uint32_t lines)
+{
+	struct text_tail *tail = bzalloc(sizeof(*tail));
+
+	tail->path = bstrdup(path);
+	tail->max_lines = lines ? lines : 1;
+	tail->lines = bzalloc(tail->max_lines * sizeof(char *));
+	return tail;
+}
+
+void text_tail_destroy(struct text_tail *tail)
+{
+	if (!tail)
+		return;
+
+	tail_clear_lines(tail);
+	bfree(tail->lines);
+	bfree(tail->path);
+	bfree(tail);
+}
+
+/* returns the new text, or NULL if nothing was appended */
+wchar_t *text_tail_read(struct ft2_source *srcdata, struct text_tail *tail)
+{
+	char buf[TAIL_CHUNK_SIZE];
+	bool changed = false;
+	struct stat st;
+	FILE *file;
+	size_t size;
+
+	file = os_fopen(tail->path, "rb");
+	if (!file) {
+		if (!srcdata->file_load_failed) {
+			blog(LOG_WARNING, "Failed to open file %s", tail->path);
+			srcdata->file_load_failed = true;
+		}
+		return NULL;
+	}
+
+	if (os_stat(tail->path, &st) != 0) {
+		fclose(file);
+		return NULL;
+	}
+
+	if (!tail->started || tail_replaced(tail, file, &st)) {
+		os_fseeki64(file, 0, SEEK_SET);
+		tail_start(tail, file);
+		changed = true;
+	}
+
+	tail->ino = (uint64_t)st.st_ino;
+	tail->mtime = st.st_mtime;
+
+	if (tail->utf16) {
+		fclose(file);
+		return read_from_end(srcdata, tail->path);
+	}
+
+	os_fseeki64(file, tail->offset, SEEK_SET);
+
+	while ((size = fread(buf, 1, sizeof(buf), file)) > 0) {
+		tail_add_data(tail, buf, size);
+		tail->offset += (int64_t)size;
+		changed = true;
+	}
+
+	if (changed)
+		tail_update_check(tail, file);
+
+	fclose(file);
+	return changed ? tail_get_text(tail) : NULL;
 }
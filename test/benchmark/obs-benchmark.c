@@ -0,0 +1,696 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/base.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/histogram.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+#include <obs-nix-platform.h>
+#include <X11/Xlib.h>
+#endif
+
+/* Headless benchmark: builds a synthetic scene out of the test-input
+ * sources, encodes it to null outputs, and writes frame counts, latency
+ * percentiles and profiler stage times as JSON.
+ *
+ * Everything in the report is diffed against a snapshot taken after the
+ * warmup, except latencies: libobs only keeps them for its rolling window
+ * (the last one to two HISTOGRAM_WINDOW_NS), so they cover the end of the
+ * measured period, and only that once the duration is at least two windows.
+ *
+ * On Linux it needs an X display, but not a GPU, e.g.:
+ *   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run obs-benchmark --sources 16 */
+
+#ifdef _WIN32
+#define GRAPHICS_MODULE DL_D3D11
+#else
+#define GRAPHICS_MODULE DL_OPENGL
+#endif
+
+#define RANDOM_SOURCE_SIZE 20.0f
+
+struct bench_config {
+	int sources;
+	int filters;
+	int audio_sources;
+	int outputs;
+	uint32_t width;
+	uint32_t height;
+	uint32_t fps;
+	int warmup;
+	int duration;
+	const char *video_encoder;
+	const char *audio_encoder;
+	const char *report_file;
+	bool verbose;
+};
+
+struct stage {
+	char *path;
+	uint64_t calls;
+	uint64_t total_us;
+};
+
+typedef DARRAY(struct stage) stage_array_t;
+
+struct stage_walk {
+	stage_array_t *stages;
+	struct dstr path;
+};
+
+struct frame_counts {
+	uint32_t rendered;
+	uint32_t lagged;
+	uint32_t output;
+	uint32_t skipped;
+};
+
+struct output_counts {
+	int total;
+	int dropped;
+};
+
+static bool verbose = false;
+
+static void do_log(int log_level, const char *msg, va_list args, void *param)
+{
+	if (log_level > LOG_WARNING && !verbose)
+		return;
+
+	vfprintf(stderr, msg, args);
+	fputc('\n', stderr);
+
+	UNUSED_PARAMETER(param);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  --sources N        video sources (default 16)\n"
+		"  --filters M        filters per video source (default 1)\n"
+		"  --audio K          audio sources (default 4)\n"
+		"  --outputs O        null outputs, each with its own\n"
+		"                     encoders (default 1)\n"
+		"  --size WxH         canvas size (default 1920x1080)\n"
+		"  --fps N            frame rate (default 60)\n"
+		"  --warmup S         seconds before measuring (default 5)\n"
+		"  --duration S       seconds to measure, at least 20 for\n"
+		"                     latencies to exclude the warmup\n"
+		"                     (default 30)\n"
+		"  --video-encoder ID (default obs_x264)\n"
+		"  --audio-encoder ID (default ffmpeg_aac)\n"
+		"  --report FILE      write the report to FILE, not stdout\n"
+		"  --verbose          show the libobs log\n",
+		name);
+}
+
+static bool parse_args(struct bench_config *config, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(arg, "--verbose") == 0) {
+			config->verbose = true;
+			continue;
+		}
+		if (!val)
+			return false;
+
+		if (strcmp(arg, "--sources") == 0)
+			config->sources = atoi(val);
+		else if (strcmp(arg, "--filters") == 0)
+			config->filters = atoi(val);
+		else if (strcmp(arg, "--audio") == 0)
+			config->audio_sources = atoi(val);
+		else if (strcmp(arg, "--outputs") == 0)
+			config->outputs = atoi(val);
+		else if (strcmp(arg, "--size") == 0) {
+			if (sscanf(val, "%ux%u", &config->width,
+				   &config->height) != 2)
+				return false;
+		} else if (strcmp(arg, "--fps") == 0)
+			config->fps = (uint32_t)atoi(val);
+		else if (strcmp(arg, "--warmup") == 0)
+			config->warmup = atoi(val);
+		else if (strcmp(arg, "--duration") == 0)
+			config->duration = atoi(val);
+		else if (strcmp(arg, "--video-encoder") == 0)
+			config->video_encoder = val;
+		else if (strcmp(arg, "--audio-encoder") == 0)
+			config->audio_encoder = val;
+		else if (strcmp(arg, "--report") == 0)
+			config->report_file = val;
+		else
+			return false;
+
+		i++;
+	}
+
+	return config->sources >= 0 && config->filters >= 0 &&
+	       config->audio_sources >= 0 && config->outputs >= 0 &&
+	       config->width && config->height && config->fps &&
+	       config->warmup >= 0 && config->duration > 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool reset_video(const struct bench_config *config)
+{
+	struct obs_video_info ovi = {0};
+	struct obs_audio_info oai = {0};
+
+	ovi.graphics_module = GRAPHICS_MODULE;
+	ovi.fps_num = config->fps;
+	ovi.fps_den = 1;
+	ovi.base_width = config->width;
+	ovi.base_height = config->height;
+	ovi.output_width = config->width;
+	ovi.output_height = config->height;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.gpu_conversion = true;
+	ovi.colorspace = VIDEO_CS_709;
+	ovi.range = VIDEO_RANGE_PARTIAL;
+	ovi.scale_type = OBS_SCALE_BICUBIC;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		blog(LOG_ERROR, "Couldn't initialize video");
+		return false;
+	}
+
+	oai.samples_per_sec = 48000;
+	oai.speakers = SPEAKERS_STEREO;
+
+	if (!obs_reset_audio(&oai)) {
+		blog(LOG_ERROR, "Couldn't initialize audio");
+		return false;
+	}
+
+	return true;
+}
+
+static obs_scene_t *create_scene(const struct bench_config *config)
+{
+	obs_scene_t *scene = obs_scene_create("benchmark scene");
+	int cols = 1;
+	int rows;
+
+	while (cols * cols < config->sources)
+		cols++;
+	rows = (config->sources + cols - 1) / cols;
+
+	for (int i = 0; i < config->sources; i++) {
+		struct dstr name = {0};
+		obs_source_t *source;
+		obs_sceneitem_t *item;
+		struct vec2 pos;
+		struct vec2 scale;
+
+		dstr_printf(&name, "video source %d", i);
+		source = obs_source_create("random", name.array, NULL, NULL);
+		dstr_free(&name);
+
+		if (!source) {
+			blog(LOG_ERROR, "Couldn't create the 'random' source, "
+					"is test-input loaded?");
+			obs_scene_release(scene);
+			return NULL;
+		}
+
+		for (int j = 0; j < config->filters; j++) {
+			obs_source_t *filter = obs_source_create_private(
+				"test_filter", "filter", NULL);
+			if (filter) {
+				obs_source_filter_add(source, filter);
+				obs_source_release(filter);
+			}
+		}
+
+		vec2_set(&pos, (float)(config->width * (i % cols) / cols),
+			 (float)(config->height * (i / cols) / rows));
+		vec2_set(&scale,
+			 (float)config->width / cols / RANDOM_SOURCE_SIZE,
+			 (float)config->height / rows / RANDOM_SOURCE_SIZE);
+
+		item = obs_scene_add(scene, source);
+		obs_sceneitem_set_pos(item, &pos);
+		obs_sceneitem_set_scale(item, &scale);
+		obs_source_release(source);
+	}
+
+	for (int i = 0; i < config->audio_sources; i++) {
+		struct dstr name = {0};
+		obs_source_t *source;
+
+		dstr_printf(&name, "audio source %d", i);
+		source = obs_source_create("test_sinewave", name.array, NULL,
+					   NULL);
+		dstr_free(&name);
+
+		if (!source) {
+			blog(LOG_ERROR, "Couldn't create the 'test_sinewave' "
+					"source, is test-input loaded?");
+			obs_scene_release(scene);
+			return NULL;
+		}
+
+		obs_scene_add(scene, source);
+		obs_source_release(source);
+	}
+
+	return scene;
+}
+
+static obs_output_t *create_output(const struct bench_config *config, int idx)
+{
+	struct dstr name = {0};
+	obs_output_t *output;
+	obs_encoder_t *venc;
+	obs_encoder_t *aenc;
+
+	dstr_printf(&name, "benchmark output %d", idx);
+	output = obs_output_create("null_output", name.array, NULL, NULL);
+	venc = obs_video_encoder_create(config->video_encoder, name.array,
+					NULL, NULL);
+	aenc = obs_audio_encoder_create(config->audio_encoder, name.array,
+					NULL, 0, NULL);
+	dstr_free(&name);
+
+	if (!output || !venc || !aenc) {
+		blog(LOG_ERROR, "Couldn't create output %d (is obs-outputs "
+				"loaded and are both encoders available?)",
+		     idx);
+		obs_encoder_release(venc);
+		obs_encoder_release(aenc);
+		obs_output_release(output);
+		return NULL;
+	}
+
+	obs_encoder_set_video(venc, obs_get_video());
+	obs_encoder_set_audio(aenc, obs_get_audio());
+	obs_output_set_video_encoder(output, venc);
+	obs_output_set_audio_encoder(output, aenc, 0);
+
+	/* the output holds on to its encoders */
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+
+	if (!obs_output_start(output)) {
+		blog(LOG_ERROR, "Couldn't start output %d: %s", idx,
+		     obs_output_get_last_error(output));
+		obs_output_release(output);
+		return NULL;
+	}
+
+	return output;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool collect_stage(void *param, profiler_snapshot_entry_t *entry)
+{
+	struct stage_walk *walk = param;
+	struct stage_walk child = {walk->stages};
+	profiler_time_entries_t *times = profiler_snapshot_entry_times(entry);
+	struct stage *stage;
+
+	dstr_copy_dstr(&child.path, &walk->path);
+	if (child.path.len)
+		dstr_cat_ch(&child.path, '/');
+	dstr_cat(&child.path, profiler_snapshot_entry_name(entry));
+
+	stage = da_push_back_new((*walk->stages));
+	stage->path = bstrdup(child.path.array);
+	stage->calls = profiler_snapshot_entry_overall_count(entry);
+
+	for (size_t i = 0; i < times->num; i++)
+		stage->total_us += times->array[i].time_delta *
+				   times->array[i].count;
+
+	profiler_snapshot_enumerate_children(entry, collect_stage, &child);
+	dstr_free(&child.path);
+	return true;
+}
+
+static void collect_stages(stage_array_t *stages)
+{
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	struct stage_walk walk = {stages};
+
+	profiler_snapshot_enumerate_roots(snap, collect_stage, &walk);
+	profile_snapshot_free(snap);
+}
+
+static void free_stages(stage_array_t *stages)
+{
+	for (size_t i = 0; i < stages->num; i++)
+		bfree(stages->array[i].path);
+	da_free((*stages));
+}
+
+static const struct stage *find_stage(const stage_array_t *stages,
+				      const char *path)
+{
+	for (size_t i = 0; i < stages->num; i++) {
+		if (strcmp(stages->array[i].path, path) == 0)
+			return &stages->array[i];
+	}
+
+	return NULL;
+}
+
+static void get_frame_counts(struct frame_counts *counts)
+{
+	video_t *video = obs_get_video();
+
+	counts->rendered = obs_get_total_frames();
+	counts->lagged = obs_get_lagged_frames();
+	counts->output = video_output_get_total_frames(video);
+	counts->skipped = video_output_get_skipped_frames(video);
+}
+
+static void get_output_counts(struct output_counts *counts,
+			      obs_output_t **outputs, size_t num)
+{
+	for (size_t i = 0; i < num; i++) {
+		counts[i].total = obs_output_get_total_frames(outputs[i]);
+		counts[i].dropped = obs_output_get_frames_dropped(outputs[i]);
+	}
+}
+
+static inline double latency_window_s(void)
+{
+	return (double)HISTOGRAM_WINDOW_NS / 1000000000.0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void set_latency(obs_data_t *data, const char *name,
+			const struct obs_latency_stats *stats)
+{
+	obs_data_t *obj = obs_data_create();
+
+	obs_data_set_int(obj, "count", (long long)stats->count);
+	obs_data_set_int(obj, "p50_ns", (long long)stats->p50_ns);
+	obs_data_set_int(obj, "p90_ns", (long long)stats->p90_ns);
+	obs_data_set_int(obj, "p99_ns", (long long)stats->p99_ns);
+	obs_data_set_int(obj, "p999_ns", (long long)stats->p999_ns);
+	obs_data_set_int(obj, "max_ns", (long long)stats->max_ns);
+	obs_data_set_obj(data, name, obj);
+	obs_data_release(obj);
+}
+
+static void add_config(obs_data_t *report, const struct bench_config *config)
+{
+	obs_data_t *obj = obs_data_create();
+
+	obs_data_set_int(obj, "sources", config->sources);
+	obs_data_set_int(obj, "filters", config->filters);
+	obs_data_set_int(obj, "audio_sources", config->audio_sources);
+	obs_data_set_int(obj, "outputs", config->outputs);
+	obs_data_set_int(obj, "width", config->width);
+	obs_data_set_int(obj, "height", config->height);
+	obs_data_set_int(obj, "fps", config->fps);
+	obs_data_set_int(obj, "duration", config->duration);
+	obs_data_set_string(obj, "video_encoder", config->video_encoder);
+	obs_data_set_string(obj, "audio_encoder", config->audio_encoder);
+	obs_data_set_obj(report, "config", obj);
+	obs_data_release(obj);
+}
+
+static void add_frames(obs_data_t *report, const struct frame_counts *start,
+		       const struct frame_counts *end)
+{
+	obs_data_t *obj = obs_data_create();
+
+	obs_data_set_int(obj, "rendered", end->rendered - start->rendered);
+	obs_data_set_int(obj, "lagged", end->lagged - start->lagged);
+	obs_data_set_int(obj, "output", end->output - start->output);
+	obs_data_set_int(obj, "skipped", end->skipped - start->skipped);
+	obs_data_set_obj(report, "frames", obj);
+	obs_data_release(obj);
+}
+
+static void add_latency(obs_data_t *report)
+{
+	obs_data_t *obj = obs_data_create();
+	struct obs_latency_stats stats;
+
+	/* not diffed: these cover the last one to two windows */
+	obs_data_set_double(obj, "window_min_s", latency_window_s());
+	obs_data_set_double(obj, "window_max_s", latency_window_s() * 2.0);
+
+	obs_get_render_latency(&stats);
+	set_latency(obj, "render", &stats);
+	obs_get_readback_latency(&stats);
+	set_latency(obj, "readback", &stats);
+	obs_get_audio_callback_latency(&stats);
+	set_latency(obj, "audio_callback", &stats);
+	obs_data_set_obj(report, "latency", obj);
+	obs_data_release(obj);
+}
+
+static void add_outputs(obs_data_t *report, obs_output_t **outputs,
+			const struct output_counts *start, size_t num)
+{
+	obs_data_array_t *array = obs_data_array_create();
+
+	for (size_t i = 0; i < num; i++) {
+		obs_output_t *output = outputs[i];
+		obs_data_t *obj = obs_data_create();
+		struct obs_latency_stats stats;
+		struct output_counts end;
+
+		get_output_counts(&end, &output, 1);
+
+		obs_data_set_string(obj, "name", obs_output_get_name(output));
+		obs_data_set_int(obj, "total_frames",
+				 end.total - start[i].total);
+		obs_data_set_int(obj, "dropped_frames",
+				 end.dropped - start[i].dropped);
+
+		obs_output_get_interleave_latency(output, &stats);
+		set_latency(obj, "interleave_latency", &stats);
+		obs_output_get_send_latency(output, &stats);
+		set_latency(obj, "send_latency", &stats);
+		obs_encoder_get_encode_latency(
+			obs_output_get_video_encoder(output), &stats);
+		set_latency(obj, "video_encode_latency", &stats);
+		obs_encoder_get_encode_latency(
+			obs_output_get_audio_encoder(output, 0), &stats);
+		set_latency(obj, "audio_encode_latency", &stats);
+
+		obs_data_array_push_back(array, obj);
+		obs_data_release(obj);
+	}
+
+	obs_data_set_array(report, "outputs", array);
+	obs_data_array_release(array);
+}
+
+/* stage times only count what ran after the warmup.  time_percent is the
+ * stage's share of wall time; stages are nested and may run on several
+ * threads, so the shares don't add up to anything meaningful. */
+static void add_stages(obs_data_t *report, const stage_array_t *start,
+		       const stage_array_t *end, uint64_t duration_us)
+{
+	obs_data_array_t *array = obs_data_array_create();
+
+	for (size_t i = 0; i < end->num; i++) {
+		const struct stage *stage = &end->array[i];
+		const struct stage *prev = find_stage(start, stage->path);
+		uint64_t calls = stage->calls - (prev ? prev->calls : 0);
+		uint64_t total_us = stage->total_us -
+				    (prev ? prev->total_us : 0);
+		obs_data_t *obj;
+
+		if (!calls)
+			continue;
+
+		obj = obs_data_create();
+		obs_data_set_string(obj, "name", stage->path);
+		obs_data_set_int(obj, "calls", (long long)calls);
+		obs_data_set_double(obj, "total_ms",
+				    (double)total_us / 1000.0);
+		obs_data_set_double(obj, "avg_ms",
+				    (double)total_us / (double)calls / 1000.0);
+		obs_data_set_double(obj, "time_percent",
+				    (double)total_us / (double)duration_us *
+					    100.0);
+		obs_data_array_push_back(array, obj);
+		obs_data_release(obj);
+	}
+
+	obs_data_set_array(report, "stages", array);
+	obs_data_array_release(array);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int run_benchmark(const struct bench_config *config)
+{
+	DARRAY(obs_output_t *) outputs = {0};
+	struct output_counts *start_output_counts = NULL;
+	stage_array_t start_stages = {0};
+	stage_array_t end_stages = {0};
+	struct frame_counts start_counts;
+	struct frame_counts end_counts;
+	os_cpu_usage_info_t *cpu_info;
+	obs_data_t *report;
+	obs_scene_t *scene;
+	uint64_t start_time;
+	uint64_t duration_us;
+	double cpu_usage;
+	int ret = 0;
+
+	scene = create_scene(config);
+	if (!scene)
+		return 1;
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+
+	for (int i = 0; i < config->outputs; i++) {
+		obs_output_t *output = create_output(config, i);
+		if (!output) {
+			ret = 1;
+			goto cleanup;
+		}
+
+		da_push_back(outputs, &output);
+	}
+
+	if ((uint64_t)config->duration * 1000000000ULL <
+	    HISTOGRAM_WINDOW_NS * 2)
+		blog(LOG_WARNING,
+		     "Latencies cover the last %g to %g seconds, so with "
+		     "a shorter duration they include the warmup",
+		     latency_window_s(), latency_window_s() * 2.0);
+
+	blog(LOG_INFO, "Warming up for %d seconds", config->warmup);
+	os_sleep_ms((uint32_t)config->warmup * 1000);
+
+	start_output_counts =
+		bzalloc(sizeof(struct output_counts) * outputs.num);
+
+	collect_stages(&start_stages);
+	get_frame_counts(&start_counts);
+	get_output_counts(start_output_counts, outputs.array, outputs.num);
+	cpu_info = os_cpu_usage_info_start();
+	start_time = os_gettime_ns();
+
+	blog(LOG_INFO, "Measuring for %d seconds", config->duration);
+	os_sleep_ms((uint32_t)config->duration * 1000);
+
+	cpu_usage = os_cpu_usage_info_query(cpu_info);
+	duration_us = (os_gettime_ns() - start_time) / 1000;
+	get_frame_counts(&end_counts);
+	collect_stages(&end_stages);
+	os_cpu_usage_info_destroy(cpu_info);
+
+	report = obs_data_create();
+	add_config(report, config);
+	add_frames(report, &start_counts, &end_counts);
+	obs_data_set_double(report, "cpu_usage", cpu_usage);
+	add_latency(report);
+	add_outputs(report, outputs.array, start_output_counts, outputs.num);
+	add_stages(report, &start_stages, &end_stages, duration_us);
+
+	if (config->report_file) {
+		if (!obs_data_save_json(report, config->report_file)) {
+			blog(LOG_ERROR, "Couldn't write '%s'",
+			     config->report_file);
+			ret = 1;
+		}
+	} else {
+		printf("%s\n", obs_data_get_json(report));
+	}
+
+	obs_data_release(report);
+
+cleanup:
+	for (size_t i = 0; i < outputs.num; i++) {
+		obs_output_stop(outputs.array[i]);
+		obs_output_release(outputs.array[i]);
+	}
+
+	obs_set_output_source(0, NULL);
+	obs_scene_release(scene);
+
+	free_stages(&start_stages);
+	free_stages(&end_stages);
+	bfree(start_output_counts);
+	da_free(outputs);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_config config = {
+		.sources = 16,
+		.filters = 1,
+		.audio_sources = 4,
+		.outputs = 1,
+		.width = 1920,
+		.height = 1080,
+		.fps = 60,
+		.warmup = 5,
+		.duration = 30,
+		.video_encoder = "obs_x264",
+		.audio_encoder = "ffmpeg_aac",
+	};
+	profiler_name_store_t *name_store;
+	int ret = 1;
+
+	if (!parse_args(&config, argc, argv)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	verbose = config.verbose;
+	base_set_log_handler(do_log, NULL);
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+	Display *display = XOpenDisplay(NULL);
+	if (!display) {
+		blog(LOG_ERROR, "Couldn't open an X display, run the benchmark "
+				"with xvfb-run if there's none");
+		return 1;
+	}
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_X11_EGL);
+	obs_set_nix_platform_display(display);
+#endif
+
+	name_store = profiler_name_store_create();
+	profiler_start();
+
+	if (!obs_startup("en-US", NULL, name_store)) {
+		blog(LOG_ERROR, "Couldn't start libobs");
+		goto done;
+	}
+
+	if (reset_video(&config)) {
+		obs_load_all_modules();
+		obs_post_load_modules();
+		ret = run_benchmark(&config);
+	}
+
+	obs_shutdown();
+
+done:
+	profiler_stop();
+	profiler_free();
+	profiler_name_store_free(name_store);
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+	XCloseDisplay(display);
+#endif
+	return ret;
+}
@@ -0,0 +1,193 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define TEST_FILE "test_file_watch.txt"
+#define OTHER_FILE "test_file_watch_other.txt"
+#define TIMEOUT_MS 5000
+
+struct watch_data {
+	obs_file_watch_t *watch;
+	os_event_t *called;
+	os_event_t *entered;
+	os_event_t *release;
+	volatile long calls;
+	volatile bool finished;
+	bool remove_self;
+	char path[512];
+};
+
+static void init_watch_data(struct watch_data *data)
+{
+	memset(data, 0, sizeof(*data));
+	os_event_init(&data->called, OS_EVENT_TYPE_MANUAL);
+	os_event_init(&data->entered, OS_EVENT_TYPE_MANUAL);
+	os_event_init(&data->release, OS_EVENT_TYPE_MANUAL);
+}
+
+static void free_watch_data(struct watch_data *data)
+{
+	os_event_destroy(data->called);
+	os_event_destroy(data->entered);
+	os_event_destroy(data->release);
+}
+
+static void touch_file(const char *path, const char *text)
+{
+	assert_true(os_quick_write_utf8_file(path, text, strlen(text), false));
+}
+
+static void watch_cb(void *param, const char *path)
+{
+	struct watch_data *data = param;
+
+	snprintf(data->path, sizeof(data->path), "%s", path);
+	os_atomic_inc_long(&data->calls);
+
+	if (data->remove_self) {
+		obs_file_watch_remove(data->watch);
+		data->watch = NULL;
+	}
+
+	os_event_signal(data->called);
+}
+
+static void blocking_cb(void *param, const char *path)
+{
+	struct watch_data *data = param;
+
+	UNUSED_PARAMETER(path);
+
+	os_event_signal(data->entered);
+	os_event_wait(data->release);
+	os_atomic_store_bool(&data->finished, true);
+}
+
+static void add_change_test(void **state)
+{
+	struct watch_data data;
+
+	init_watch_data(&data);
+	touch_file(TEST_FILE, "a");
+
+	data.watch = obs_file_watch_add(TEST_FILE, watch_cb, &data);
+	assert_non_null(data.watch);
+
+	touch_file(TEST_FILE, "changed");
+	assert_int_equal(os_event_timedwait(data.called, TIMEOUT_MS), 0);
+	assert_true(os_atomic_load_long(&data.calls) >= 1);
+	assert_non_null(strstr(data.path, TEST_FILE));
+
+	obs_file_watch_remove(data.watch);
+
+	/* nothing is called once remove returns */
+	os_event_reset(data.called);
+	touch_file(TEST_FILE, "changed again");
+	assert_int_equal(os_event_timedwait(data.called, 500), ETIMEDOUT);
+
+	os_unlink(TEST_FILE);
+	free_watch_data(&data);
+}
+
+static void remove_self_test(void **state)
+{
+	struct watch_data data;
+
+	init_watch_data(&data);
+	touch_file(TEST_FILE, "a");
+
+	data.remove_self = true;
+	data.watch = obs_file_watch_add(TEST_FILE, watch_cb, &data);
+	assert_non_null(data.watch);
+
+	touch_file(TEST_FILE, "changed");
+	assert_int_equal(os_event_timedwait(data.called, TIMEOUT_MS), 0);
+	assert_null(data.watch);
+
+	os_unlink(TEST_FILE);
+	free_watch_data(&data);
+}
+
+static void *remove_thread(void *param)
+{
+	struct watch_data *data = param;
+
+	obs_file_watch_remove(data->watch);
+
+	/* the callback must have returned before remove did */
+	if (!os_atomic_load_bool(&data->finished))
+		return (void *)1;
+	return NULL;
+}
+
+static void remove_during_callback_test(void **state)
+{
+	struct watch_data busy;
+	struct watch_data other;
+	obs_file_watch_t *other_watch;
+	pthread_t thread;
+	void *result = NULL;
+
+	init_watch_data(&busy);
+	init_watch_data(&other);
+	touch_file(TEST_FILE, "a");
+	touch_file(OTHER_FILE, "a");
+
+	busy.watch = obs_file_watch_add(TEST_FILE, blocking_cb, &busy);
+	other_watch = obs_file_watch_add(OTHER_FILE, watch_cb, &other);
+	assert_non_null(busy.watch);
+	assert_non_null(other_watch);
+
+	touch_file(TEST_FILE, "changed");
+	assert_int_equal(os_event_timedwait(busy.entered, TIMEOUT_MS), 0);
+
+	assert_int_equal(pthread_create(&thread, NULL, remove_thread, &busy),
+			 0);
+
+	/* a watch that isn't in its callback is removed right away, even
+	 * while another watch's callback is still running */
+	obs_file_watch_remove(other_watch);
+	assert_false(os_atomic_load_bool(&busy.finished));
+
+	os_event_signal(busy.release);
+	pthread_join(thread, &result);
+	assert_null(result);
+	assert_true(os_atomic_load_bool(&busy.finished));
+
+	os_unlink(TEST_FILE);
+	os_unlink(OTHER_FILE);
+	free_watch_data(&busy);
+	free_watch_data(&other);
+}
+
+static int setup(void **state)
+{
+	return obs_startup("en-US", NULL, NULL) ? 0 : -1;
+}
+
+static int teardown(void **state)
+{
+	obs_shutdown();
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(add_change_test),
+		cmocka_unit_test(remove_self_test),
+		cmocka_unit_test(remove_during_callback_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -0,0 +1,181 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+
+#include <graphics/image-file.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#define TEST_FILE "test_gif_decode.gif"
+#define FRAME_COUNT 5
+#define FRAME_NS 100000000ULL
+#define TIMEOUT_MS 5000
+
+/* 4x4, five solid color frames of 100 ms each, looping forever */
+static const uint8_t test_gif[] = {
+	0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x04, 0x00, 0x04, 0x00, 0x81, 0x00,
+	0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff,
+	0xff, 0x21, 0xff, 0x0b, 0x4e, 0x45, 0x54, 0x53, 0x43, 0x41, 0x50, 0x45,
+	0x32, 0x2e, 0x30, 0x03, 0x01, 0x00, 0x00, 0x00, 0x21, 0xf9, 0x04, 0x00,
+	0x0a, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x04,
+	0x00, 0x00, 0x02, 0x0a, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xa0, 0x00, 0x00, 0x21, 0xf9, 0x04, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x2c,
+	0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x04, 0x00, 0x00, 0x02, 0x0a, 0x4c,
+	0x12, 0x11, 0x11, 0x11, 0x11, 0x42, 0x08, 0xa1, 0x00, 0x00, 0x21, 0xf9,
+	0x04, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x00, 0x00, 0x00, 0x04,
+	0x00, 0x04, 0x00, 0x00, 0x02, 0x0a, 0x94, 0x24, 0x22, 0x22, 0x22, 0x22,
+	0x84, 0x10, 0xa2, 0x00, 0x00, 0x21, 0xf9, 0x04, 0x00, 0x0a, 0x00, 0x00,
+	0x00, 0x2c, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x04, 0x00, 0x00, 0x02,
+	0x0a, 0xdc, 0x36, 0x33, 0x33, 0x33, 0x33, 0xc6, 0x18, 0xa3, 0x00, 0x00,
+	0x21, 0xf9, 0x04, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x00, 0x00,
+	0x00, 0x04, 0x00, 0x04, 0x00, 0x00, 0x02, 0x0a, 0x04, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xa0, 0x00, 0x00, 0x3b,
+};
+
+static void write_test_gif(void)
+{
+	FILE *file = fopen(TEST_FILE, "wb");
+
+	assert_non_null(file);
+	assert_int_equal(fwrite(test_gif, 1, sizeof(test_gif), file),
+			 sizeof(test_gif));
+	fclose(file);
+}
+
+static void wait_decoded(gs_image_file4_t *if4, uint64_t frames)
+{
+	struct gs_image_file_gif_stats stats;
+
+	for (int i = 0; i < TIMEOUT_MS; i++) {
+		gs_image_file4_get_gif_stats(if4, &stats);
+		if (stats.frames_decoded >= frames)
+			return;
+		os_sleep_ms(1);
+	}
+
+	fail_msg("only %llu of %llu frames decoded",
+		 (unsigned long long)stats.frames_decoded,
+		 (unsigned long long)frames);
+}
+
+/* moves playback on by one frame, and waits for it if it isn't decoded */
+static void next_frame(gs_image_file4_t *if4)
+{
+	if (gs_image_file4_tick(if4, FRAME_NS + 1))
+		return;
+
+	for (int i = 0; i < TIMEOUT_MS; i++) {
+		os_sleep_ms(1);
+		if (gs_image_file4_tick(if4, 0))
+			return;
+	}
+
+	fail_msg("frame was never decoded");
+}
+
+static void gif_ring_test(void **state)
+{
+	struct gs_image_file_gif_stats stats;
+	gs_image_file4_t if4;
+	uint64_t misses;
+
+	write_test_gif();
+
+	/* too small for all frames, so they go through the smallest ring */
+	gs_image_file4_init(&if4, TEST_FILE, GS_IMAGE_ALPHA_STRAIGHT, 1);
+	assert_true(if4.image3.image2.image.loaded);
+	assert_true(if4.image3.image2.image.is_animated_gif);
+	assert_int_equal(if4.image3.image2.image.cx, 4);
+
+	/* the ring fills up ahead of playback */
+	wait_decoded(&if4, 3);
+	gs_image_file4_get_gif_stats(&if4, &stats);
+	assert_int_equal(stats.buffered_frames, 3);
+	assert_int_equal(stats.frames_decoded, 3);
+	assert_int_equal(stats.decode_misses, 0);
+
+	/* frames are decoded again each loop */
+	for (int i = 0; i < FRAME_COUNT * 2; i++)
+		next_frame(&if4);
+
+	gs_image_file4_get_gif_stats(&if4, &stats);
+	assert_int_equal(stats.buffered_frames, 3);
+	assert_true(stats.frames_decoded >= FRAME_COUNT * 2 + 1);
+	misses = stats.decode_misses;
+
+	/* a frame that was skipped over is dropped, not shown late.  once
+	 * the ring is full, the two frames after the one shown are ready */
+	wait_decoded(&if4, FRAME_COUNT * 2 + 3);
+	assert_true(gs_image_file4_tick(&if4, FRAME_NS * 2 + 1));
+	gs_image_file4_get_gif_stats(&if4, &stats);
+	assert_int_equal(stats.decode_misses, misses);
+
+	gs_image_file4_free(&if4);
+	os_unlink(TEST_FILE);
+}
+
+static void gif_cache_all_test(void **state)
+{
+	struct gs_image_file_gif_stats stats;
+	gs_image_file4_t if4;
+
+	write_test_gif();
+
+	gs_image_file4_init(&if4, TEST_FILE, GS_IMAGE_ALPHA_STRAIGHT,
+			    GS_IMAGE_FILE_GIF_MEMORY_LIMIT);
+	assert_true(if4.image3.image2.image.loaded);
+
+	/* every frame is decoded once, however often it's shown */
+	wait_decoded(&if4, FRAME_COUNT);
+	for (int i = 0; i < FRAME_COUNT * 2; i++)
+		next_frame(&if4);
+
+	gs_image_file4_get_gif_stats(&if4, &stats);
+	assert_int_equal(stats.buffered_frames, FRAME_COUNT);
+	assert_int_equal(stats.frames_decoded, FRAME_COUNT);
+	assert_int_equal(stats.decode_misses, 0);
+
+	gs_image_file4_free(&if4);
+	os_unlink(TEST_FILE);
+}
+
+static void gif_shared_decoder_test(void **state)
+{
+	gs_image_file4_t images[8];
+	long allocs = bnum_allocs();
+
+	write_test_gif();
+
+	/* gifs share one decode thread, freeing one while others (or the
+	 * freed one itself) are being decoded must not wait on or break the
+	 * rest */
+	for (int i = 0; i < 8; i++)
+		gs_image_file4_init(&images[i], TEST_FILE,
+				    GS_IMAGE_ALPHA_STRAIGHT,
+				    i % 2 ? 1 : GS_IMAGE_FILE_GIF_MEMORY_LIMIT);
+
+	for (int i = 0; i < 8; i += 2)
+		gs_image_file4_free(&images[i]);
+	for (int i = 1; i < 8; i += 2) {
+		wait_decoded(&images[i], 3);
+		next_frame(&images[i]);
+		gs_image_file4_free(&images[i]);
+	}
+
+	assert_int_equal(bnum_allocs(), allocs);
+	os_unlink(TEST_FILE);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(gif_ring_test),
+		cmocka_unit_test(gif_cache_all_test),
+		cmocka_unit_test(gif_shared_decoder_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,389 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <obs.h>
+#include <obs-nix-platform.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <X11/Xlib.h>
+
+/* Compares the NV12 frames texture encoders get on OpenGL (the plane
+ * textures VAAPI imports) with what the raw frame path downloads for the same
+ * fixed scene.  Skipped without an X display or an EGL capable GPU. */
+
+#define WIDTH 256
+#define HEIGHT 144
+#define CAPTURE_FRAME 10
+#define TIMEOUT_MS 10000
+
+struct nv12_frame {
+	uint8_t y[WIDTH * HEIGHT];
+	uint8_t uv[WIDTH * HEIGHT / 2];
+};
+
+struct capture {
+	struct nv12_frame raw;
+	struct nv12_frame tex;
+	volatile long raw_frames;
+	volatile long tex_frames;
+	os_event_t *raw_done;
+	os_event_t *tex_done;
+};
+
+static Display *display = NULL;
+static bool available = false;
+static struct capture capture;
+
+/* ------------------------------------------------------------------------- */
+/* fixed scene: four solid color quadrants */
+
+static const char *quadrants_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "NV12 test quadrants";
+}
+
+static void *quadrants_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void quadrants_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static uint32_t quadrants_get_width(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return WIDTH;
+}
+
+static uint32_t quadrants_get_height(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return HEIGHT;
+}
+
+static void quadrants_render(void *data, gs_effect_t *effect)
+{
+	static const uint32_t colors[4] = {0xFFFF0000, 0xFF00FF00, 0xFF0000FF,
+					   0xFFFFFFFF};
+	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+	gs_eparam_t *color = gs_effect_get_param_by_name(solid, "color");
+	gs_technique_t *tech = gs_effect_get_technique(solid, "Solid");
+
+	gs_technique_begin(tech);
+	gs_technique_begin_pass(tech, 0);
+
+	for (int i = 0; i < 4; i++) {
+		gs_effect_set_color(color, colors[i]);
+
+		gs_matrix_push();
+		gs_matrix_translate3f((float)(i % 2 * WIDTH / 2),
+				      (float)(i / 2 * HEIGHT / 2), 0.0f);
+		gs_draw_sprite(NULL, 0, WIDTH / 2, HEIGHT / 2);
+		gs_matrix_pop();
+	}
+
+	gs_technique_end_pass(tech);
+	gs_technique_end(tech);
+
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(effect);
+}
+
+static struct obs_source_info quadrants_source = {
+	.id = "nv12_test_quadrants",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = quadrants_get_name,
+	.create = quadrants_create,
+	.destroy = quadrants_destroy,
+	.get_width = quadrants_get_width,
+	.get_height = quadrants_get_height,
+	.video_render = quadrants_render,
+};
+
+/* ------------------------------------------------------------------------- */
+/* texture path: reads back the plane textures the encoder is given */
+
+static const char *readback_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "NV12 test readback";
+}
+
+static void *readback_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	UNUSED_PARAMETER(settings);
+	return encoder;
+}
+
+static void readback_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool read_plane(gs_texture_t *tex, enum gs_color_format format,
+		       uint32_t width, uint32_t height, uint32_t pixel_size,
+		       uint8_t *out)
+{
+	gs_stagesurf_t *stage = gs_stagesurface_create(width, height, format);
+	uint8_t *data;
+	uint32_t linesize;
+	bool success = false;
+
+	if (!stage)
+		return false;
+
+	gs_stage_texture(stage, tex);
+	if (gs_stagesurface_map(stage, &data, &linesize)) {
+		for (uint32_t y = 0; y < height; y++)
+			memcpy(out + y * width * pixel_size,
+			       data + y * linesize, width * pixel_size);
+		gs_stagesurface_unmap(stage);
+		success = true;
+	}
+
+	gs_stagesurface_destroy(stage);
+	return success;
+}
+
+static bool readback_encode_tex(void *data, struct encoder_texture *texture,
+				int64_t pts, uint64_t lock_key,
+				uint64_t *next_key,
+				struct encoder_packet *packet,
+				bool *received_packet)
+{
+	bool success = true;
+
+	*next_key = lock_key;
+	*received_packet = false;
+
+	if (os_atomic_inc_long(&capture.tex_frames) != CAPTURE_FRAME)
+		return true;
+
+	obs_enter_graphics();
+	success = read_plane(texture->tex[0], GS_R8, WIDTH, HEIGHT, 1,
+			     capture.tex.y) &&
+		  read_plane(texture->tex[1], GS_R8G8, WIDTH / 2, HEIGHT / 2,
+			     2, capture.tex.uv);
+	obs_leave_graphics();
+
+	os_event_signal(capture.tex_done);
+
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(pts);
+	UNUSED_PARAMETER(packet);
+	return success;
+}
+
+static struct obs_encoder_info readback_encoder = {
+	.id = "nv12_test_readback",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.caps = OBS_ENCODER_CAP_PASS_TEXTURE,
+	.get_name = readback_get_name,
+	.create = readback_create,
+	.destroy = readback_destroy,
+	.encode_texture2 = readback_encode_tex,
+};
+
+/* an output is needed to start the encoder */
+
+static const char *null_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "NV12 test output";
+}
+
+static void *null_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return output;
+}
+
+static void null_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool null_start(void *data)
+{
+	obs_output_t *output = data;
+
+	if (!obs_output_can_begin_data_capture(output, 0) ||
+	    !obs_output_initialize_encoders(output, 0))
+		return false;
+
+	return obs_output_begin_data_capture(output, 0);
+}
+
+static void null_stop(void *data, uint64_t ts)
+{
+	obs_output_end_data_capture(data);
+	UNUSED_PARAMETER(ts);
+}
+
+static void null_encoded_packet(void *data, struct encoder_packet *packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(packet);
+}
+
+static struct obs_output_info null_output = {
+	.id = "nv12_test_output",
+	.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED,
+	.get_name = null_get_name,
+	.create = null_create,
+	.destroy = null_destroy,
+	.start = null_start,
+	.stop = null_stop,
+	.encoded_packet = null_encoded_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+/* CPU path: the frame downloaded for raw outputs */
+
+static void raw_video(void *param, struct video_data *frame)
+{
+	if (os_atomic_inc_long(&capture.raw_frames) != CAPTURE_FRAME)
+		return;
+
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		memcpy(capture.raw.y + y * WIDTH,
+		       frame->data[0] + y * frame->linesize[0], WIDTH);
+	for (uint32_t y = 0; y < HEIGHT / 2; y++)
+		memcpy(capture.raw.uv + y * WIDTH,
+		       frame->data[1] + y * frame->linesize[1], WIDTH);
+
+	os_event_signal(capture.raw_done);
+
+	UNUSED_PARAMETER(param);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void nv12_planes_match_test(void **state)
+{
+	obs_source_t *source;
+	obs_encoder_t *encoder;
+	obs_output_t *output;
+
+	if (!available)
+		skip();
+
+	memset(&capture, 0, sizeof(capture));
+	os_event_init(&capture.raw_done, OS_EVENT_TYPE_MANUAL);
+	os_event_init(&capture.tex_done, OS_EVENT_TYPE_MANUAL);
+
+	source = obs_source_create("nv12_test_quadrants", "quadrants", NULL,
+				   NULL);
+	assert_non_null(source);
+	obs_set_output_source(0, source);
+
+	encoder = obs_video_encoder_create("nv12_test_readback", "readback",
+					   NULL, NULL);
+	output = obs_output_create("nv12_test_output", "output", NULL, NULL);
+	assert_non_null(encoder);
+	assert_non_null(output);
+
+	obs_encoder_set_video(encoder, obs_get_video());
+	obs_output_set_video_encoder(output, encoder);
+	obs_add_raw_video_callback(NULL, raw_video, NULL);
+	assert_true(obs_output_start(output));
+
+	assert_int_equal(os_event_timedwait(capture.raw_done, TIMEOUT_MS), 0);
+	assert_int_equal(os_event_timedwait(capture.tex_done, TIMEOUT_MS), 0);
+
+	obs_output_stop(output);
+	obs_remove_raw_video_callback(raw_video, NULL);
+	obs_set_output_source(0, NULL);
+
+	/* the scene doesn't change, so any frame from either path must be
+	 * identical */
+	assert_memory_equal(capture.raw.y, capture.tex.y,
+			    sizeof(capture.raw.y));
+	assert_memory_equal(capture.raw.uv, capture.tex.uv,
+			    sizeof(capture.raw.uv));
+
+	obs_output_release(output);
+	obs_encoder_release(encoder);
+	obs_source_release(source);
+	os_event_destroy(capture.raw_done);
+	os_event_destroy(capture.tex_done);
+}
+
+static bool reset_video(void)
+{
+	struct obs_video_info ovi = {0};
+
+	ovi.graphics_module = DL_OPENGL;
+	ovi.fps_num = 30;
+	ovi.fps_den = 1;
+	ovi.base_width = WIDTH;
+	ovi.base_height = HEIGHT;
+	ovi.output_width = WIDTH;
+	ovi.output_height = HEIGHT;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.gpu_conversion = true;
+	ovi.colorspace = VIDEO_CS_709;
+	ovi.range = VIDEO_RANGE_PARTIAL;
+	ovi.scale_type = OBS_SCALE_BILINEAR;
+
+	return obs_reset_video(&ovi) == OBS_VIDEO_SUCCESS;
+}
+
+static int setup(void **state)
+{
+	display = XOpenDisplay(NULL);
+	if (!display) {
+		print_message("no X display, skipping\n");
+		return 0;
+	}
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_X11_EGL);
+	obs_set_nix_platform_display(display);
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+
+	if (!reset_video() || !obs_nv12_planes_active()) {
+		print_message("no EGL capable GPU, skipping\n");
+		return 0;
+	}
+
+	obs_register_source(&quadrants_source);
+	obs_register_encoder(&readback_encoder);
+	obs_register_output(&null_output);
+	available = true;
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	if (!display)
+		return 0;
+
+	obs_shutdown();
+	XCloseDisplay(display);
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(nv12_planes_match_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
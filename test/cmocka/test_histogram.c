@@ -0,0 +1,68 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/histogram.h>
+#include <util/bmem.h>
+
+static void histogram_empty_test(void **state)
+{
+	struct histogram *h = bzalloc(sizeof(struct histogram));
+	double percentile = 50.0;
+	uint64_t value = 1;
+
+	assert_int_equal(histogram_get_percentiles(h, &percentile, &value, 1),
+			 0);
+	assert_int_equal(value, 0);
+
+	bfree(h);
+}
+
+static void histogram_percentiles_test(void **state)
+{
+	struct histogram *h = bzalloc(sizeof(struct histogram));
+	const double percentiles[] = {0.0, 50.0, 99.0, 100.0};
+	const uint64_t expected[] = {1000, 500000, 990000, 1000000};
+	uint64_t values[4];
+
+	for (uint64_t i = 1; i <= 1000; i++)
+		histogram_record(h, i * 1000);
+
+	assert_int_equal(histogram_get_percentiles(h, percentiles, values, 4),
+			 1000);
+
+	/* values are rounded up to the end of their bucket */
+	for (size_t i = 0; i < 4; i++) {
+		assert_true(values[i] >= expected[i]);
+		assert_true(values[i] <= expected[i] + expected[i] / 32);
+	}
+
+	bfree(h);
+}
+
+static void histogram_small_values_test(void **state)
+{
+	struct histogram *h = bzalloc(sizeof(struct histogram));
+	double percentile = 100.0;
+	uint64_t value;
+
+	histogram_record(h, 0);
+	histogram_record(h, 37);
+
+	histogram_get_percentiles(h, &percentile, &value, 1);
+	assert_int_equal(value, 37);
+
+	bfree(h);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(histogram_empty_test),
+		cmocka_unit_test(histogram_percentiles_test),
+		cmocka_unit_test(histogram_small_values_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,302 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <jansson.h>
+#include <obs-data.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#define NUM_KEYS 4000
+
+/* visits 0..count-1 in a scrambled order (count must be odd) */
+static inline size_t scrambled(size_t i, size_t count)
+{
+	return (i * 7919) % count;
+}
+
+static void make_key(char *buf, size_t size, size_t i)
+{
+	snprintf(buf, size, "key_%05zu", i);
+}
+
+static void order_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	obs_data_t *data = obs_data_create();
+	obs_data_item_t *item;
+	char key[32];
+	char prev[32] = "";
+	size_t count = 0;
+
+	for (size_t i = 0; i < NUM_KEYS - 1; i++) {
+		make_key(key, sizeof(key), scrambled(i, NUM_KEYS - 1));
+		obs_data_set_int(data, key, (long long)i);
+	}
+
+	/* iteration stays sorted by name no matter the insertion order */
+	for (item = obs_data_first(data); item; obs_data_item_next(&item)) {
+		const char *name = obs_data_item_get_name(item);
+		assert_true(strcmp(prev, name) < 0);
+		snprintf(prev, sizeof(prev), "%s", name);
+		count++;
+	}
+
+	assert_int_equal(count, NUM_KEYS - 1);
+	obs_data_release(data);
+}
+
+static void lookup_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	obs_data_t *data = obs_data_create();
+	char key[32];
+
+	for (size_t i = 0; i < NUM_KEYS; i++) {
+		make_key(key, sizeof(key), i);
+		obs_data_set_int(data, key, (long long)i);
+	}
+
+	/* erasing shifts other entries of the index around */
+	for (size_t i = 0; i < NUM_KEYS; i += 3) {
+		make_key(key, sizeof(key), i);
+		obs_data_erase(data, key);
+	}
+
+	/* growing an item reallocates it */
+	for (size_t i = 1; i < NUM_KEYS; i += 3) {
+		make_key(key, sizeof(key), i);
+		obs_data_set_string(data, key,
+				    "a value long enough to need a larger item");
+	}
+
+	for (size_t i = 0; i < NUM_KEYS; i++) {
+		make_key(key, sizeof(key), i);
+
+		if (i % 3 == 0) {
+			assert_false(obs_data_has_user_value(data, key));
+		} else if (i % 3 == 1) {
+			assert_string_equal(
+				obs_data_get_string(data, key),
+				"a value long enough to need a larger item");
+		} else {
+			assert_int_equal(obs_data_get_int(data, key), i);
+		}
+	}
+
+	obs_data_release(data);
+}
+
+static void benchmark_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	obs_data_t *data = obs_data_create();
+	obs_data_t *copy = obs_data_create();
+	obs_data_t *defaults;
+	char key[32];
+	uint64_t start, set_ns, get_ns, apply_ns, defaults_ns;
+	long long sum = 0;
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < NUM_KEYS - 1; i++) {
+		make_key(key, sizeof(key), scrambled(i, NUM_KEYS - 1));
+		obs_data_set_default_int(data, key, 1);
+		obs_data_set_int(data, key, (long long)i);
+	}
+	set_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < NUM_KEYS - 1; i++) {
+		make_key(key, sizeof(key), i);
+		sum += obs_data_get_int(data, key);
+	}
+	get_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	obs_data_apply(copy, data);
+	obs_data_apply(copy, data);
+	apply_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	defaults = obs_data_get_defaults(data);
+	defaults_ns = os_gettime_ns() - start;
+
+	assert_int_equal(sum, (long long)(NUM_KEYS - 1) * (NUM_KEYS - 2) / 2);
+
+	print_message("obs_data with %d items: set %.2f ms, get %.2f ms, "
+		      "apply x2 %.2f ms, get_defaults %.2f ms\n",
+		      NUM_KEYS - 1, set_ns / 1000000.0, get_ns / 1000000.0,
+		      apply_ns / 1000000.0, defaults_ns / 1000000.0);
+
+	obs_data_release(defaults);
+	obs_data_release(copy);
+	obs_data_release(data);
+}
+
+static void json_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	const char *json = "{ \"b\": [ {\"x\": 1}, 2, \"skipped\" ],\n"
+			   "  \"a\": \"\\u00e9\\t\\\"\\ud83d\\ude00\",\n"
+			   "  \"d\": 0.5, \"c\": null, \"e\": -1E+20,\n"
+			   "  \"f\": {\"g\": true, \"h\": false} }";
+	const char *expected = "{\"a\":\"\xc3\xa9\\t\\\"\xf0\x9f\x98\x80\","
+			       "\"b\":[{\"x\":1}],\"d\":0.5,\"e\":-1e20,"
+			       "\"f\":{\"g\":true,\"h\":false}}";
+	obs_data_t *data = obs_data_create_from_json(json);
+
+	assert_non_null(data);
+	assert_string_equal(obs_data_get_json(data), expected);
+	obs_data_release(data);
+
+	assert_null(obs_data_create_from_json("{\"a\": 1, \"a\": 2}"));
+	assert_null(obs_data_create_from_json("{\"a\": 01}"));
+	assert_null(obs_data_create_from_json("{\"a\": \"\\ud800\"}"));
+	assert_null(obs_data_create_from_json("{} {}"));
+}
+
+static void binary_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	const char *file = "test_obs_data.bin";
+	obs_data_t *data = obs_data_create_from_json(
+		"{\"a\":\"text\",\"b\":-123456789012,\"c\":0.25,"
+		"\"d\":[{\"a\":true},{\"a\":false}],\"e\":{\"a\":{}}}");
+	obs_data_t *loaded;
+
+	assert_true(obs_data_save_binary_safe(data, file, "tmp", NULL));
+	loaded = obs_data_create_from_binary_file(file);
+	os_unlink(file);
+
+	assert_non_null(loaded);
+	assert_string_equal(obs_data_get_json(loaded), obs_data_get_json(data));
+
+	obs_data_release(loaded);
+	obs_data_release(data);
+}
+
+/* roughly the shape of a scene collection */
+static obs_data_t *create_collection(size_t num_sources)
+{
+	obs_data_t *root = obs_data_create();
+	obs_data_array_t *sources = obs_data_array_create();
+
+	for (size_t i = 0; i < num_sources; i++) {
+		obs_data_t *source = obs_data_create();
+		obs_data_t *settings = obs_data_create();
+		obs_data_array_t *items = obs_data_array_create();
+		char name[32];
+
+		snprintf(name, sizeof(name), "Source %zu", i);
+		obs_data_set_string(source, "name", name);
+		obs_data_set_string(source, "id", "image_source");
+		obs_data_set_double(source, "volume", 1.0);
+		obs_data_set_bool(source, "enabled", true);
+
+		obs_data_set_string(settings, "file",
+				    "/home/user/Pictures/overlay.png");
+		obs_data_set_int(settings, "width", 1920);
+		obs_data_set_int(settings, "height", 1080);
+		obs_data_set_obj(source, "settings", settings);
+
+		for (size_t j = 0; j < 8; j++) {
+			obs_data_t *item = obs_data_create();
+			obs_data_set_int(item, "id", (long long)j);
+			obs_data_set_double(item, "rot", 0.0);
+			obs_data_set_double(item, "scale_x", 0.5);
+			obs_data_set_double(item, "scale_y", 0.5);
+			obs_data_set_bool(item, "visible", j % 2 == 0);
+			obs_data_array_push_back(items, item);
+			obs_data_release(item);
+		}
+		obs_data_set_array(source, "items", items);
+
+		obs_data_array_push_back(sources, source);
+
+		obs_data_array_release(items);
+		obs_data_release(settings);
+		obs_data_release(source);
+	}
+
+	obs_data_set_array(root, "sources", sources);
+	obs_data_array_release(sources);
+	return root;
+}
+
+static void serialize_benchmark_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	const char *file = "test_obs_data_bench.bin";
+	obs_data_t *data = create_collection(2000);
+	obs_data_t *loaded;
+	json_t *root;
+	char *dumped;
+	char *json;
+	uint64_t start, write_ns, read_ns, dom_ns, bin_write_ns, bin_read_ns;
+	int64_t bin_size;
+
+	start = os_gettime_ns();
+	json = bstrdup(obs_data_get_json(data));
+	write_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	loaded = obs_data_create_from_json(json);
+	read_ns = os_gettime_ns() - start;
+
+	assert_non_null(loaded);
+	assert_string_equal(obs_data_get_json(loaded), json);
+	obs_data_release(loaded);
+
+	/* just the jansson tree, without any conversion to or from obs_data */
+	start = os_gettime_ns();
+	root = json_loads(json, JSON_REJECT_DUPLICATES, NULL);
+	dumped = json_dumps(root, JSON_PRESERVE_ORDER | JSON_COMPACT);
+	dom_ns = os_gettime_ns() - start;
+
+	assert_string_equal(dumped, json);
+	free(dumped);
+	json_decref(root);
+
+	start = os_gettime_ns();
+	assert_true(obs_data_save_binary_safe(data, file, "tmp", NULL));
+	bin_write_ns = os_gettime_ns() - start;
+
+	bin_size = os_get_file_size(file);
+
+	start = os_gettime_ns();
+	loaded = obs_data_create_from_binary_file(file);
+	bin_read_ns = os_gettime_ns() - start;
+	os_unlink(file);
+
+	assert_non_null(loaded);
+	obs_data_release(loaded);
+
+	print_message("json: %zu bytes, write %.2f ms, read %.2f ms "
+		      "(jansson load+dump alone: %.2f ms)\n",
+		      strlen(json), write_ns / 1000000.0, read_ns / 1000000.0,
+		      dom_ns / 1000000.0);
+	print_message("binary: %lld bytes, write %.2f ms, read %.2f ms\n",
+		      (long long)bin_size, bin_write_ns / 1000000.0,
+		      bin_read_ns / 1000000.0);
+
+	bfree(json);
+	obs_data_release(data);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(order_test),
+		cmocka_unit_test(lookup_test),
+		cmocka_unit_test(benchmark_test),
+		cmocka_unit_test(json_test),
+		cmocka_unit_test(binary_test),
+		cmocka_unit_test(serialize_benchmark_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
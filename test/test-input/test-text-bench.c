@@ -0,0 +1,202 @@
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/dstr.h>
+
+/* Drives freetype text sources with text that changes every frame, half of
+ * them showing a counter and half a growing chat log, and logs how long the
+ * text updates take.  Updates are applied directly from video_tick, so at
+ * 60 fps each text source updates 60 times a second. */
+
+#define MAX_TEXTS 64
+#define LOG_FRAMES 600
+#define MAX_CHAT_LEN 4000
+
+struct text_bench {
+	obs_source_t *source;
+
+	obs_source_t *texts[MAX_TEXTS];
+	struct dstr chat[MAX_TEXTS];
+	size_t count;
+
+	uint64_t frame;
+	uint64_t frames;
+	uint64_t updates;
+	uint64_t total_ns;
+	uint64_t max_ns;
+};
+
+static const char *text_bench_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Text Update Benchmark (Test)";
+}
+
+static void text_bench_destroy(void *data)
+{
+	struct text_bench *tb = data;
+
+	for (size_t i = 0; i < tb->count; i++) {
+		obs_source_remove_active_child(tb->source, tb->texts[i]);
+		obs_source_release(tb->texts[i]);
+		dstr_free(&tb->chat[i]);
+	}
+
+	bfree(tb);
+}
+
+static void *text_bench_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct text_bench *tb = bzalloc(sizeof(struct text_bench));
+	long long count = obs_data_get_int(settings, "count");
+
+	tb->source = source;
+	if (count > MAX_TEXTS)
+		count = MAX_TEXTS;
+
+	for (long long i = 0; i < count; i++) {
+		obs_data_t *text_settings = obs_data_create();
+		obs_source_t *text;
+
+		obs_data_set_string(text_settings, "text", "0");
+		text = obs_source_create_private("text_ft2_source_v2", NULL,
+						 text_settings);
+		obs_data_release(text_settings);
+
+		/* text-freetype2 isn't loaded */
+		if (!text)
+			break;
+
+		obs_source_add_active_child(source, text);
+		tb->texts[tb->count++] = text;
+	}
+
+	return tb;
+}
+
+static void text_bench_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "count", 8);
+}
+
+static obs_properties_t *text_bench_properties(void *unused)
+{
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_int(props, "count", "Text sources", 1, MAX_TEXTS,
+			       1);
+
+	UNUSED_PARAMETER(unused);
+	return props;
+}
+
+static void update_text(struct text_bench *tb, size_t idx)
+{
+	obs_data_t *settings = obs_data_create();
+	struct dstr *chat = &tb->chat[idx];
+	char counter[32];
+	uint64_t start, elapsed;
+
+	if (idx & 1) {
+		if (chat->len > MAX_CHAT_LEN)
+			dstr_free(chat);
+		dstr_catf(chat, "user%llu: message number %llu\n",
+			  (unsigned long long)(tb->frame % 17),
+			  (unsigned long long)tb->frame);
+		obs_data_set_string(settings, "text", chat->array);
+	} else {
+		snprintf(counter, sizeof(counter), "%llu",
+			 (unsigned long long)tb->frame);
+		obs_data_set_string(settings, "text", counter);
+	}
+
+	start = os_gettime_ns();
+	obs_source_update_directly(tb->texts[idx], settings);
+	elapsed = os_gettime_ns() - start;
+
+	tb->total_ns += elapsed;
+	if (elapsed > tb->max_ns)
+		tb->max_ns = elapsed;
+	tb->updates++;
+
+	obs_data_release(settings);
+}
+
+static void text_bench_tick(void *data, float seconds)
+{
+	struct text_bench *tb = data;
+
+	for (size_t i = 0; i < tb->count; i++)
+		update_text(tb, i);
+
+	tb->frame++;
+
+	if (++tb->frames == LOG_FRAMES && tb->updates) {
+		blog(LOG_INFO,
+		     "text bench: %d sources, %llu updates, "
+		     "avg %.1f us, max %.1f us per update",
+		     (int)tb->count, (unsigned long long)tb->updates,
+		     (double)tb->total_ns / (double)tb->updates / 1000.0,
+		     (double)tb->max_ns / 1000.0);
+
+		tb->frames = 0;
+		tb->updates = 0;
+		tb->total_ns = 0;
+		tb->max_ns = 0;
+	}
+
+	UNUSED_PARAMETER(seconds);
+}
+
+static void text_bench_render(void *data, gs_effect_t *effect)
+{
+	struct text_bench *tb = data;
+	uint32_t y = 0;
+
+	for (size_t i = 0; i < tb->count; i++) {
+		gs_matrix_push();
+		gs_matrix_translate3f(0.0f, (float)y, 0.0f);
+		obs_source_video_render(tb->texts[i]);
+		gs_matrix_pop();
+
+		y += obs_source_get_height(tb->texts[i]);
+	}
+
+	UNUSED_PARAMETER(effect);
+}
+
+static void text_bench_enum_sources(void *data, obs_source_enum_proc_t cb,
+				    void *param)
+{
+	struct text_bench *tb = data;
+
+	for (size_t i = 0; i < tb->count; i++)
+		cb(tb->source, tb->texts[i], param);
+}
+
+static uint32_t text_bench_width(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 1920;
+}
+
+static uint32_t text_bench_height(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 1080;
+}
+
+struct obs_source_info text_bench = {
+	.id = "text_bench",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = text_bench_getname,
+	.create = text_bench_create,
+	.destroy = text_bench_destroy,
+	.get_defaults = text_bench_defaults,
+	.get_properties = text_bench_properties,
+	.video_tick = text_bench_tick,
+	.video_render = text_bench_render,
+	.enum_active_sources = text_bench_enum_sources,
+	.get_width = text_bench_width,
+	.get_height = text_bench_height,
+};